@@ -19,7 +19,7 @@ subject to the following restrictions:
 #include <assert.h>
 //#include "bLog.h"
 #include "LinearMath/btAlignedObjectArray.h"
-#include "LinearMath/btHashMap.h"
+#include "LinearMath/btFlatHashMap.h"
 
 namespace bParse
 {
@@ -34,7 +34,7 @@ typedef struct bStructHandle
 	int unused;
 } bStructHandle;
 typedef btAlignedObjectArray<bStructHandle*> bListBasePtr;
-typedef btHashMap<btHashPtr, bStructHandle*> bPtrMap;
+typedef btFlatHashMap<btHashPtr, bStructHandle*> bPtrMap;
 }  // namespace bParse
 
 #endif  //__BCOMMON_H__
@@ -65,7 +65,7 @@ protected:
 	btAlignedObjectArray<char*> m_pointerPtrFixupArray;
 
 	btAlignedObjectArray<bChunkInd> m_chunks;
-	btHashMap<btHashPtr, bChunkInd> m_chunkPtrPtrMap;
+	btFlatHashMap<btHashPtr, bChunkInd> m_chunkPtrPtrMap;
 
 	//
 
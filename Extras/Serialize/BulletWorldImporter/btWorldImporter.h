@@ -19,7 +19,7 @@ subject to the following restrictions:
 #include "LinearMath/btTransform.h"
 #include "LinearMath/btVector3.h"
 #include "LinearMath/btAlignedObjectArray.h"
-#include "LinearMath/btHashMap.h"
+#include "LinearMath/btFlatHashMap.h"
 
 class btCollisionShape;
 class btCollisionObject;
@@ -88,16 +88,16 @@ protected:
 	btAlignedObjectArray<btVector3FloatData*> m_floatVertexArrays;
 	btAlignedObjectArray<btVector3DoubleData*> m_doubleVertexArrays;
 
-	btHashMap<btHashPtr, btOptimizedBvh*> m_bvhMap;
-	btHashMap<btHashPtr, btTriangleInfoMap*> m_timMap;
+	btFlatHashMap<btHashPtr, btOptimizedBvh*> m_bvhMap;
+	btFlatHashMap<btHashPtr, btTriangleInfoMap*> m_timMap;
 
-	btHashMap<btHashString, btCollisionShape*> m_nameShapeMap;
-	btHashMap<btHashString, btRigidBody*> m_nameBodyMap;
-	btHashMap<btHashString, btTypedConstraint*> m_nameConstraintMap;
-	btHashMap<btHashPtr, const char*> m_objectNameMap;
+	btFlatHashMap<btHashString, btCollisionShape*> m_nameShapeMap;
+	btFlatHashMap<btHashString, btRigidBody*> m_nameBodyMap;
+	btFlatHashMap<btHashString, btTypedConstraint*> m_nameConstraintMap;
+	btFlatHashMap<btHashPtr, const char*> m_objectNameMap;
 
-	btHashMap<btHashPtr, btCollisionShape*> m_shapeMap;
-	btHashMap<btHashPtr, btCollisionObject*> m_bodyMap;
+	btFlatHashMap<btHashPtr, btCollisionShape*> m_shapeMap;
+	btFlatHashMap<btHashPtr, btCollisionObject*> m_bodyMap;
 
 	//methods
 
@@ -0,0 +1,132 @@
+
+#include "AsyncFrameLogger.hpp"
+#include "BodyState.hpp"
+
+#include <chrono>
+#include <cstdio>
+
+// how long the writer spins on an empty ring before it starts sleeping
+static const int writerSpinCount = 64;
+
+
+AsyncFrameLogger::AsyncFrameLogger(int bodyCount, int slotCount, BackpressurePolicy policy)
+	: bodyCount(bodyCount),
+	  slotCount(slotCount > 1 ? slotCount : 2),
+	  frameScalars(size_t(TRAJECTORY_CHANNEL_COUNT) * bodyCount),
+	  policy(policy),
+	  head(0),
+	  tail(0),
+	  running(false),
+	  framesWritten(0)
+{
+	slots.resize(frameScalars * this->slotCount);
+	slotFlags.resize(size_t(bodyCount) * this->slotCount);
+}
+
+
+void AsyncFrameLogger::start()
+{
+	if (running.load()) {
+		return;
+	}
+	running.store(true);
+	writer = std::thread(&AsyncFrameLogger::writerLoop, this);
+}
+
+
+void AsyncFrameLogger::stop()
+{
+	if (!running.load()) {
+		return;
+	}
+	running.store(false, std::memory_order_release);
+	writer.join();
+}
+
+
+bool AsyncFrameLogger::pushFrame(btRigidBody* const* bodies)
+{
+	uint64_t h = head.load(std::memory_order_relaxed);
+
+	if (h - tail.load(std::memory_order_acquire) >= (uint64_t)slotCount) {
+		if (policy == DROP_WHEN_FULL || !running.load(std::memory_order_relaxed)) {
+			framesDropped++;
+			return false;
+		}
+		framesBlocked++;
+		while (h - tail.load(std::memory_order_acquire) >= (uint64_t)slotCount) {
+			std::this_thread::yield();
+		}
+	}
+
+	btScalar* slot = slots.data() + frameScalars * (h % slotCount);
+	gatherBodyStates(bodies, bodyCount, slot);
+	gatherBodyFlags(bodies, bodyCount, slotFlags.data() + size_t(bodyCount) * (h % slotCount));
+
+	head.store(h + 1, std::memory_order_release);
+	framesPushed++;
+
+	int depth = (int)(h + 1 - tail.load(std::memory_order_relaxed));
+	if (depth > maxQueueDepth) {
+		maxQueueDepth = depth;
+	}
+	return true;
+}
+
+
+void AsyncFrameLogger::writerLoop()
+{
+	int idle = 0;
+
+	for (;;) {
+		uint64_t t = tail.load(std::memory_order_relaxed);
+		uint64_t h = head.load(std::memory_order_acquire);
+
+		if (t == h) {
+			// the producer has stopped and everything it pushed is written
+			if (!running.load(std::memory_order_acquire) && head.load(std::memory_order_acquire) == t) {
+				break;
+			}
+			if (++idle < writerSpinCount) {
+				std::this_thread::yield();
+			} else {
+				std::this_thread::sleep_for(std::chrono::microseconds(200));
+			}
+			continue;
+		}
+		idle = 0;
+
+		for (; t != h; t++) {
+			const btScalar* slot = slots.data() + frameScalars * (t % slotCount);
+			const unsigned char* flags = slotFlags.data() + size_t(bodyCount) * (t % slotCount);
+			for (size_t i = 0; i < sinks.size(); i++) {
+				sinks[i](slot, flags, bodyCount);
+			}
+			// hand the slot back after each frame so a blocked tick can continue early
+			tail.store(t + 1, std::memory_order_release);
+			framesWritten.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+}
+
+
+AsyncFrameLogger::Stats AsyncFrameLogger::getStats() const
+{
+	Stats stats;
+	stats.framesPushed = framesPushed;
+	stats.framesWritten = framesWritten.load(std::memory_order_relaxed);
+	stats.framesDropped = framesDropped;
+	stats.framesBlocked = framesBlocked;
+	stats.maxQueueDepth = maxQueueDepth;
+	return stats;
+}
+
+
+void AsyncFrameLogger::printStats() const
+{
+	Stats stats = getStats();
+	printf("AsyncFrameLogger: %llu frames pushed, %llu written, %llu dropped, %llu blocked, max queue depth %d/%d\n",
+		   (unsigned long long)stats.framesPushed, (unsigned long long)stats.framesWritten,
+		   (unsigned long long)stats.framesDropped, (unsigned long long)stats.framesBlocked,
+		   stats.maxQueueDepth, slotCount);
+}
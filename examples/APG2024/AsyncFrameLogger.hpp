@@ -0,0 +1,88 @@
+#ifndef ASYNC_FRAME_LOGGER_HPP
+#define ASYNC_FRAME_LOGGER_HPP
+
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "BulletDynamics/Dynamics/btRigidBody.h"
+
+// Moves trajectory output off the physics tick. The tick callback only copies body
+// states into a preallocated single producer / single consumer ring of frame slots,
+// a writer thread drains the ring and hands every frame to the registered sinks
+// (TrajectoryRecorder::writeFrame, JsonGenerator::recordFrame, ...).
+class AsyncFrameLogger {
+
+public:
+
+	enum BackpressurePolicy {
+		// wait for the writer when the ring is full, no frame is lost
+		BLOCK_WHEN_FULL,
+		// skip the frame when the ring is full, stepping never waits
+		DROP_WHEN_FULL,
+	};
+
+	struct Stats {
+		uint64_t framesPushed;
+		uint64_t framesWritten;
+		uint64_t framesDropped;
+		// frames for which the tick had to wait for a free slot
+		uint64_t framesBlocked;
+		int maxQueueDepth;
+	};
+
+	// bodyFlags holds the BodyStateFlags of every body
+	typedef std::function<void(const btScalar* frame, const unsigned char* bodyFlags, int bodyCount)> FrameSink;
+
+	AsyncFrameLogger(int bodyCount, int slotCount = 64, BackpressurePolicy policy = BLOCK_WHEN_FULL);
+
+	~AsyncFrameLogger() {
+		stop();
+	}
+
+	// sinks are called on the writer thread, in the order they were added
+	void addSink(const FrameSink& sink) {
+		sinks.push_back(sink);
+	}
+
+	void start();
+
+	// drains the remaining frames and joins the writer thread
+	void stop();
+
+	// called from the tick callback
+	bool pushFrame(btRigidBody* const* bodies);
+
+	Stats getStats() const;
+
+	void printStats() const;
+
+private:
+
+	int bodyCount;
+	int slotCount;
+	size_t frameScalars;
+	BackpressurePolicy policy;
+
+	std::vector<btScalar> slots;
+	std::vector<unsigned char> slotFlags;
+	std::vector<FrameSink> sinks;
+
+	// head is only written by the producer, tail only by the writer thread
+	alignas(64) std::atomic<uint64_t> head;
+	alignas(64) std::atomic<uint64_t> tail;
+
+	std::atomic<bool> running;
+	std::thread writer;
+
+	uint64_t framesPushed = 0;
+	uint64_t framesDropped = 0;
+	uint64_t framesBlocked = 0;
+	int maxQueueDepth = 0;
+	std::atomic<uint64_t> framesWritten;
+
+	void writerLoop();
+};
+
+#endif
@@ -1,7 +1,9 @@
 
 #include "BallGeyser.hpp"
-#include "FileGenerator.hpp"
+#include "TrajectoryRecorder.hpp"
 #include "JsonGenerator.hpp"
+#include "AsyncFrameLogger.hpp"
+#include "SceneParams.hpp"
 
 #include "btBulletDynamicsCommon.h"
 #include "LinearMath/btVector3.h"
@@ -22,17 +24,47 @@ struct BallGeyserExample : public CommonRigidBodyBase {
     // odd number
     int layer = 7;
 
-	FileGenerator* fileGenerator;
+	TrajectoryRecorder* trajectoryRecorder;
 
 	JsonGenerator* jsonGenerator;
 
-	BallGeyserExample(struct GUIHelperInterface* helper) : CommonRigidBodyBase(helper) {
-		fileGenerator = new FileGenerator("BallGeyser");
-		jsonGenerator = new JsonGenerator("Scene");
+	AsyncFrameLogger* frameLogger = nullptr;
+
+	bool asyncOutput = true;
+
+	btScalar restitution = 1;
+
+	BallGeyserExample(struct GUIHelperInterface* helper, const SceneParams& params = SceneParams()) : CommonRigidBodyBase(helper) {
+		bool defaultOutput = params.outputPrefix.empty();
+		trajectoryRecorder = new TrajectoryRecorder(defaultOutput ? "BallGeyser" : params.outputPrefix.c_str());
+		jsonGenerator = new JsonGenerator(defaultOutput ? "Scene" : params.outputPrefix.c_str());
+		if (!defaultOutput) {
+			trajectoryRecorder->setFileName(params.outputPrefix + ".bttraj");
+		}
+
+		if (params.velocity) {
+			velocity.setY(*params.velocity);
+		}
+		if (params.layer) {
+			layer = *params.layer;
+		}
+		if (params.restitution) {
+			restitution = *params.restitution;
+		}
+		asyncOutput = params.asyncOutput;
+
+		if (params.deltaKeyframeInterval > 0) {
+			trajectoryRecorder->setDeltaEncoding(params.deltaKeyframeInterval);
+		}
 	}
 
 	virtual ~BallGeyserExample() {
-		delete fileGenerator;
+		if (frameLogger) {
+			frameLogger->stop();
+			frameLogger->printStats();
+			delete frameLogger;
+		}
+		delete trajectoryRecorder;
 		delete jsonGenerator;
 	}
 	virtual void initPhysics();
@@ -51,15 +83,15 @@ struct BallGeyserExample : public CommonRigidBodyBase {
 void BallGeyserOutputBodyInfo(btDynamicsWorld* world, btScalar deltaTime) {
 	BallGeyserExample* example = (BallGeyserExample*)world->getWorldUserInfo();
 
-	btRigidBody** bodies = example->bodies;
-	int bodyCount = example->bodyCount;
-	std::string* names = example->names;
-
-	FileGenerator* fileGenerator = example->fileGenerator;
-	fileGenerator->saveBodyInfo(bodies, names, bodyCount);
+	if (example->frameLogger) {
+		// formatting and file output run on the logger's writer thread
+		example->frameLogger->pushFrame(example->bodies);
+		return;
+	}
 
-	JsonGenerator* jsonGenerator = example->jsonGenerator;
-	jsonGenerator->recordFrame(bodies, bodyCount);
+	int bodyCount = example->bodyCount;
+	example->trajectoryRecorder->saveBodyInfo(example->bodies, example->names, bodyCount);
+	example->jsonGenerator->recordFrame(example->bodies, bodyCount);
 }
 
 
@@ -85,7 +117,7 @@ void BallGeyserExample::initPhysics()
 
 	btRigidBody* groundBody = createRigidBody(0, groundTransform, groundShape);
 	groundBody->setFriction(0);
-	groundBody->setRestitution(1);
+	groundBody->setRestitution(restitution);
 	groundBody->setRollingFriction(0);
 	groundBody->setSpinningFriction(0);
 
@@ -170,13 +202,21 @@ void BallGeyserExample::initPhysics()
 		bodies[i]->setRollingFriction(0);
 		bodies[i]->setSpinningFriction(0);
 		bodies[i]->setDamping(0, 0);
-		bodies[i]->setRestitution(1);
+		bodies[i]->setRestitution(restitution);
 	}
 
 	m_dynamicsWorld->setInternalTickCallback(BallGeyserOutputBodyInfo, this, true);
 	m_guiHelper->autogenerateGraphicsObjects(m_dynamicsWorld);
 
 	jsonGenerator->addObjects(bodies, names, bodyCount);
+	trajectoryRecorder->openFile(bodies, names, bodyCount);
+
+	if (asyncOutput && !frameLogger) {
+		frameLogger = new AsyncFrameLogger(bodyCount);
+		frameLogger->addSink([this](const btScalar* frame, const unsigned char* flags, int count) { trajectoryRecorder->writeFrame(frame, flags); });
+		frameLogger->addSink([this](const btScalar* frame, const unsigned char* flags, int count) { jsonGenerator->recordFrame(frame, count); });
+		frameLogger->start();
+	}
 }
 
 
@@ -191,4 +231,9 @@ CommonExampleInterface* BallGeyserCreateFunc(CommonExampleOptions& options)
 	return new BallGeyserExample(options.m_guiHelper);
 }
 
+CommonRigidBodyBase* BallGeyserCreateWithParams(GUIHelperInterface* helper, const SceneParams& params)
+{
+	return new BallGeyserExample(helper, params);
+}
+
 B3_STANDALONE_EXAMPLE(CradleCreateFunc);
\ No newline at end of file
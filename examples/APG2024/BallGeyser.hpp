@@ -4,5 +4,7 @@
 
 class CommonExampleInterface* BallGeyserCreateFunc(struct CommonExampleOptions& options);
 
+struct CommonRigidBodyBase* BallGeyserCreateWithParams(struct GUIHelperInterface* helper, const struct SceneParams& params);
+
 
 #endif
\ No newline at end of file
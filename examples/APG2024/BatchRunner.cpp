@@ -0,0 +1,239 @@
+
+// Runs APG2024 scenes without the ExampleBrowser. Every combination of the given
+// parameter lists becomes an independent world, the worlds are stepped in parallel
+// on a pool of threads and each one writes its own trajectory and json file.
+//
+//   App_APG2024Batch --scene BallGeyser --frames 2400 --velocity 10,20,30 --layer 5,7 --restitution 0.9,1 --delta 64 --threads 8
+
+#include "BallGeyser.hpp"
+#include "Bernoulli.hpp"
+#include "Billiards.hpp"
+#include "Cradle.hpp"
+#include "SceneParams.hpp"
+
+#include "../CommonInterfaces/CommonRigidBodyBase.h"
+#include "../CommonInterfaces/CommonGUIHelperInterface.h"
+
+#include "LinearMath/btQuickprof.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef CommonRigidBodyBase* (*SceneCreateFunc)(GUIHelperInterface* helper, const SceneParams& params);
+
+struct SceneEntry {
+	const char* name;
+	SceneCreateFunc createFunc;
+	// bodies are kept in fixed arrays of 1024 entries
+	int maxLayer;
+};
+
+static const SceneEntry sceneEntries[] = {
+	{"BallGeyser", BallGeyserCreateWithParams, 40},
+	{"Billiards", BilliardsCreateWithParams, 44},
+	{"Cradle", CradleCreateWithParams, 1000},
+	{"Bernoulli", BernoulliCreateWithParams, 1000},
+};
+
+static const int sceneEntryCount = sizeof(sceneEntries) / sizeof(sceneEntries[0]);
+
+struct BatchJob {
+	const SceneEntry* scene;
+	SceneParams params;
+	double seconds;
+};
+
+// the profiler keeps one tree per thread and is not meant for many worlds
+// stepping at once, the batch runner does not read it anyway
+static void batchEnterProfileZone(const char* name) {}
+static void batchLeaveProfileZone() {}
+
+static void parseList(const char* text, std::vector<double>& values)
+{
+	values.clear();
+	while (*text) {
+		char* end;
+		values.push_back(strtod(text, &end));
+		if (end == text) {
+			break;
+		}
+		text = *end == ',' ? end + 1 : end;
+	}
+}
+
+static std::string formatValue(double value)
+{
+	char text[32];
+	snprintf(text, sizeof(text), "%g", value);
+	return text;
+}
+
+static void usage(const char* program)
+{
+	printf("usage: %s --scene <name|all> [--frames N] [--dt seconds] [--velocity v0,v1,..] [--layer l0,l1,..] [--restitution e0,e1,..] [--delta keyframeInterval] [--threads N]\n", program);
+	printf("scenes:");
+	for (int i = 0; i < sceneEntryCount; i++) {
+		printf(" %s", sceneEntries[i].name);
+	}
+	printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+	const char* sceneName = nullptr;
+	int frameCount = 2400;
+	double deltaTime = 1. / 240.;
+	int threadCount = (int)std::thread::hardware_concurrency();
+	int deltaKeyframeInterval = 0;
+	std::vector<double> velocities, layers, restitutions;
+
+	for (int i = 1; i < argc; i++) {
+		bool hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "--scene") && hasValue) {
+			sceneName = argv[++i];
+		} else if (!strcmp(argv[i], "--frames") && hasValue) {
+			frameCount = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--dt") && hasValue) {
+			deltaTime = atof(argv[++i]);
+		} else if (!strcmp(argv[i], "--velocity") && hasValue) {
+			parseList(argv[++i], velocities);
+		} else if (!strcmp(argv[i], "--layer") && hasValue) {
+			parseList(argv[++i], layers);
+		} else if (!strcmp(argv[i], "--restitution") && hasValue) {
+			parseList(argv[++i], restitutions);
+		} else if (!strcmp(argv[i], "--delta") && hasValue) {
+			deltaKeyframeInterval = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--threads") && hasValue) {
+			threadCount = atoi(argv[++i]);
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (!sceneName || frameCount <= 0 || deltaTime <= 0) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	std::vector<const SceneEntry*> scenes;
+	for (int i = 0; i < sceneEntryCount; i++) {
+		if (!strcmp(sceneName, "all") || !strcmp(sceneName, sceneEntries[i].name)) {
+			scenes.push_back(&sceneEntries[i]);
+		}
+	}
+	if (scenes.empty()) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	// an empty list keeps the scene default, NaN marks that in the sweep below
+	double keepDefault = std::numeric_limits<double>::quiet_NaN();
+	if (velocities.empty()) velocities.push_back(keepDefault);
+	if (layers.empty()) layers.push_back(keepDefault);
+	if (restitutions.empty()) restitutions.push_back(keepDefault);
+
+	std::vector<BatchJob> jobs;
+	for (const SceneEntry* scene : scenes) {
+		for (double velocity : velocities) {
+			for (double layer : layers) {
+				for (double restitution : restitutions) {
+					BatchJob job;
+					job.scene = scene;
+					job.seconds = 0;
+					std::string prefix = scene->name;
+
+					if (velocity == velocity) {
+						job.params.velocity = (btScalar)velocity;
+						prefix += "_v" + formatValue(velocity);
+					}
+					if (layer == layer) {
+						if (layer < 1 || layer > scene->maxLayer) {
+							printf("%s: layer %g out of range [1, %d]\n", scene->name, layer, scene->maxLayer);
+							return 1;
+						}
+						job.params.layer = (int)layer;
+						prefix += "_l" + formatValue(layer);
+					}
+					if (restitution == restitution) {
+						job.params.restitution = (btScalar)restitution;
+						prefix += "_e" + formatValue(restitution);
+					}
+
+					// every world gets its output name here, repeated values in a list would reuse one
+					for (const BatchJob& other : jobs) {
+						if (other.params.outputPrefix == prefix) {
+							prefix += "_" + std::to_string(jobs.size());
+							break;
+						}
+					}
+					job.params.outputPrefix = prefix;
+					job.params.deltaKeyframeInterval = deltaKeyframeInterval;
+					// the worlds already keep every core busy
+					job.params.asyncOutput = false;
+					jobs.push_back(job);
+				}
+			}
+		}
+	}
+
+	if (threadCount < 1) {
+		threadCount = 1;
+	}
+	if (threadCount > (int)jobs.size()) {
+		threadCount = (int)jobs.size();
+	}
+
+	btSetCustomEnterProfileZoneFunc(batchEnterProfileZone);
+	btSetCustomLeaveProfileZoneFunc(batchLeaveProfileZone);
+
+	printf("running %d worlds of %d frames on %d threads\n", (int)jobs.size(), frameCount, threadCount);
+
+	std::atomic<int> nextJob(0);
+	auto worker = [&]() {
+		DummyGUIHelper guiHelper;
+		for (;;) {
+			int jobIndex = nextJob.fetch_add(1);
+			if (jobIndex >= (int)jobs.size()) {
+				break;
+			}
+			BatchJob& job = jobs[jobIndex];
+			auto start = std::chrono::steady_clock::now();
+
+			CommonRigidBodyBase* example = job.scene->createFunc(&guiHelper, job.params);
+			example->initPhysics();
+			for (int frame = 0; frame < frameCount; frame++) {
+				// exactly one internal tick, and so one recorded frame, per step
+				example->m_dynamicsWorld->stepSimulation(btScalar(deltaTime), 1, btScalar(deltaTime));
+			}
+			example->exitPhysics();
+			delete example;
+
+			job.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			printf("%s done in %.3f s\n", job.params.outputPrefix.c_str(), job.seconds);
+		}
+	};
+
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> threads;
+	for (int i = 1; i < threadCount; i++) {
+		threads.push_back(std::thread(worker));
+	}
+	worker();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("%d worlds, %lld frames in %.3f s (%.0f frames/s)\n", (int)jobs.size(), (long long)jobs.size() * frameCount,
+		   seconds, jobs.size() * frameCount / seconds);
+	return 0;
+}
@@ -1,6 +1,6 @@
 
 #include "Bernoulli.hpp"
-#include "FileGenerator.hpp"
+#include "TrajectoryRecorder.hpp"
 
 #include "btBulletDynamicsCommon.h"
 #include "LinearMath/btVector3.h"
@@ -9,6 +9,8 @@
 #include "../CommonInterfaces/CommonRigidBodyBase.h"
 
 #include "JsonGenerator.hpp"
+#include "AsyncFrameLogger.hpp"
+#include "SceneParams.hpp"
 
 struct BernoulliExample : public CommonRigidBodyBase {
 
@@ -20,15 +22,45 @@ struct BernoulliExample : public CommonRigidBodyBase {
 
 	int sphereCount = 8;
 
-	FileGenerator* fileGenerator;
+	TrajectoryRecorder* trajectoryRecorder;
 	JsonGenerator* jsonGenerator;
 
-	BernoulliExample(struct GUIHelperInterface* helper) : CommonRigidBodyBase(helper) {
-		fileGenerator = new FileGenerator("Bernoulli");
-		jsonGenerator = new JsonGenerator("Scene");
+	AsyncFrameLogger* frameLogger = nullptr;
+
+	bool asyncOutput = true;
+
+	btScalar restitution = 1;
+
+	BernoulliExample(struct GUIHelperInterface* helper, const SceneParams& params = SceneParams()) : CommonRigidBodyBase(helper) {
+		bool defaultOutput = params.outputPrefix.empty();
+		trajectoryRecorder = new TrajectoryRecorder(defaultOutput ? "Bernoulli" : params.outputPrefix.c_str());
+		jsonGenerator = new JsonGenerator(defaultOutput ? "Scene" : params.outputPrefix.c_str());
+		if (!defaultOutput) {
+			trajectoryRecorder->setFileName(params.outputPrefix + ".bttraj");
+		}
+
+		if (params.velocity) {
+			velocity.setY(*params.velocity);
+		}
+		if (params.layer) {
+			sphereCount = *params.layer;
+		}
+		if (params.restitution) {
+			restitution = *params.restitution;
+		}
+		asyncOutput = params.asyncOutput;
+
+		if (params.deltaKeyframeInterval > 0) {
+			trajectoryRecorder->setDeltaEncoding(params.deltaKeyframeInterval);
+		}
 	}
 	virtual ~BernoulliExample() {
-		delete fileGenerator;
+		if (frameLogger) {
+			frameLogger->stop();
+			frameLogger->printStats();
+			delete frameLogger;
+		}
+		delete trajectoryRecorder;
 		delete jsonGenerator;
 	}
 	virtual void initPhysics();
@@ -47,16 +79,15 @@ struct BernoulliExample : public CommonRigidBodyBase {
 void BernoulliOutputBodyInfo(btDynamicsWorld* world, btScalar deltaTime) {
 	BernoulliExample* example = (BernoulliExample*)world->getWorldUserInfo();
 
-	btRigidBody** bodies = example->bodies;
-	// 1 is dynamic body
-	int bodyCount = example->sphereCount + 1;
-	std::string* names = example->names;
-
-	FileGenerator* fileGenerator = example->fileGenerator;
-	fileGenerator->saveBodyInfo(bodies, names, bodyCount);
+	if (example->frameLogger) {
+		// formatting and file output run on the logger's writer thread
+		example->frameLogger->pushFrame(example->bodies);
+		return;
+	}
 
-	JsonGenerator* jsonGenerator = example->jsonGenerator;
-	jsonGenerator->recordFrame(bodies, bodyCount);
+	int bodyCount = example->sphereCount + 1;
+	example->trajectoryRecorder->saveBodyInfo(example->bodies, example->names, bodyCount);
+	example->jsonGenerator->recordFrame(example->bodies, bodyCount);
 }
 
 
@@ -82,7 +113,7 @@ void BernoulliExample::initPhysics()
 
 	btRigidBody* groundBody = createRigidBody(0, groundTransform, groundShape);
 	groundBody->setFriction(0);
-	groundBody->setRestitution(1);
+	groundBody->setRestitution(restitution);
 	groundBody->setRollingFriction(0);
 	groundBody->setSpinningFriction(0);
 
@@ -117,13 +148,21 @@ void BernoulliExample::initPhysics()
 		bodies[i]->setRollingFriction(0);
 		bodies[i]->setSpinningFriction(0);
 		bodies[i]->setDamping(0, 0);
-		bodies[i]->setRestitution(1);
+		bodies[i]->setRestitution(restitution);
 	}
 
 	m_dynamicsWorld->setInternalTickCallback(BernoulliOutputBodyInfo, this, true);
 	m_guiHelper->autogenerateGraphicsObjects(m_dynamicsWorld);
 
 	jsonGenerator->addObjects(bodies, names, sphereCount + 1); // 1 is dynamic body
+	trajectoryRecorder->openFile(bodies, names, sphereCount + 1);
+
+	if (asyncOutput && !frameLogger) {
+		frameLogger = new AsyncFrameLogger(sphereCount + 1);
+		frameLogger->addSink([this](const btScalar* frame, const unsigned char* flags, int count) { trajectoryRecorder->writeFrame(frame, flags); });
+		frameLogger->addSink([this](const btScalar* frame, const unsigned char* flags, int count) { jsonGenerator->recordFrame(frame, count); });
+		frameLogger->start();
+	}
 }
 
 
@@ -138,5 +177,10 @@ CommonExampleInterface* BernoulliCreateFunc(CommonExampleOptions& options)
 	return new BernoulliExample(options.m_guiHelper);
 }
 
+CommonRigidBodyBase* BernoulliCreateWithParams(GUIHelperInterface* helper, const SceneParams& params)
+{
+	return new BernoulliExample(helper, params);
+}
+
 B3_STANDALONE_EXAMPLE(BernoulliCreateFunc);
 
@@ -4,4 +4,6 @@
 
 class CommonExampleInterface* BernoulliCreateFunc(struct CommonExampleOptions& options);
 
+struct CommonRigidBodyBase* BernoulliCreateWithParams(struct GUIHelperInterface* helper, const struct SceneParams& params);
+
 #endif //APG2024_BERNOULLI_HPP
\ No newline at end of file
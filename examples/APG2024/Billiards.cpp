@@ -1,7 +1,9 @@
 
 #include "Billiards.hpp"
-#include "FileGenerator.hpp"
+#include "TrajectoryRecorder.hpp"
 #include "JsonGenerator.hpp"
+#include "AsyncFrameLogger.hpp"
+#include "SceneParams.hpp"
 
 #include "btBulletDynamicsCommon.h"
 #include "LinearMath/btVector3.h"
@@ -20,18 +22,48 @@ struct BilliardsExample : public CommonRigidBodyBase {
 
 	JsonGenerator* jsonGenerator;
 
+	AsyncFrameLogger* frameLogger = nullptr;
+
+	bool asyncOutput = true;
+
+	btScalar restitution = 1;
+
 	int sphereCount;
 
 	int layer = 4;
 
-	FileGenerator* fileGenerator;
+	TrajectoryRecorder* trajectoryRecorder;
+
+	BilliardsExample(struct GUIHelperInterface* helper, const SceneParams& params = SceneParams()) : CommonRigidBodyBase(helper) {
+		bool defaultOutput = params.outputPrefix.empty();
+		trajectoryRecorder = new TrajectoryRecorder(defaultOutput ? "Billiards" : params.outputPrefix.c_str());
+		jsonGenerator = new JsonGenerator(defaultOutput ? "Scene" : params.outputPrefix.c_str());
+		if (!defaultOutput) {
+			trajectoryRecorder->setFileName(params.outputPrefix + ".bttraj");
+		}
+
+		if (params.velocity) {
+			velocity.setY(*params.velocity);
+		}
+		if (params.layer) {
+			layer = *params.layer;
+		}
+		if (params.restitution) {
+			restitution = *params.restitution;
+		}
+		asyncOutput = params.asyncOutput;
 
-	BilliardsExample(struct GUIHelperInterface* helper) : CommonRigidBodyBase(helper) {
-		fileGenerator = new FileGenerator("Billiards");
-		jsonGenerator = new JsonGenerator("Scene");
+		if (params.deltaKeyframeInterval > 0) {
+			trajectoryRecorder->setDeltaEncoding(params.deltaKeyframeInterval);
+		}
 	}
 	virtual ~BilliardsExample() {
-		delete fileGenerator;
+		if (frameLogger) {
+			frameLogger->stop();
+			frameLogger->printStats();
+			delete frameLogger;
+		}
+		delete trajectoryRecorder;
 		delete jsonGenerator;
 	}
 	virtual void initPhysics();
@@ -50,15 +82,15 @@ struct BilliardsExample : public CommonRigidBodyBase {
 void BilliardsOutputBodyInfo(btDynamicsWorld* world, btScalar deltaTime) {
 	BilliardsExample* example = (BilliardsExample*)world->getWorldUserInfo();
 
-	btRigidBody** bodies = example->bodies;
-	int bodyCount = example->sphereCount;
-	std::string* names = example->names;
-
-	FileGenerator* fileGenerator = example->fileGenerator;
-	fileGenerator->saveBodyInfo(bodies, names, bodyCount);
+	if (example->frameLogger) {
+		// formatting and file output run on the logger's writer thread
+		example->frameLogger->pushFrame(example->bodies);
+		return;
+	}
 
-	JsonGenerator* jsonGenerator = example->jsonGenerator;
-	jsonGenerator->recordFrame(bodies, bodyCount);
+	int bodyCount = example->sphereCount;
+	example->trajectoryRecorder->saveBodyInfo(example->bodies, example->names, bodyCount);
+	example->jsonGenerator->recordFrame(example->bodies, bodyCount);
 }
 
 
@@ -84,7 +116,7 @@ void BilliardsExample::initPhysics()
 
 	btRigidBody* groundBody = createRigidBody(0, groundTransform, groundShape);
 	groundBody->setFriction(0);
-	groundBody->setRestitution(1);
+	groundBody->setRestitution(restitution);
 	groundBody->setRollingFriction(0);
 	groundBody->setSpinningFriction(0);
 
@@ -125,13 +157,21 @@ void BilliardsExample::initPhysics()
 		bodies[i]->setRollingFriction(0);
 		bodies[i]->setSpinningFriction(0);
 		bodies[i]->setDamping(0, 0);
-		bodies[i]->setRestitution(1);
+		bodies[i]->setRestitution(restitution);
 	}
 
 	m_dynamicsWorld->setInternalTickCallback(BilliardsOutputBodyInfo, this, true);
 	m_guiHelper->autogenerateGraphicsObjects(m_dynamicsWorld);
 
 	jsonGenerator->addObjects(bodies, names, sphereCount);
+	trajectoryRecorder->openFile(bodies, names, sphereCount);
+
+	if (asyncOutput && !frameLogger) {
+		frameLogger = new AsyncFrameLogger(sphereCount);
+		frameLogger->addSink([this](const btScalar* frame, const unsigned char* flags, int count) { trajectoryRecorder->writeFrame(frame, flags); });
+		frameLogger->addSink([this](const btScalar* frame, const unsigned char* flags, int count) { jsonGenerator->recordFrame(frame, count); });
+		frameLogger->start();
+	}
 }
 
 
@@ -146,5 +186,10 @@ CommonExampleInterface* BilliardsCreateFunc(CommonExampleOptions& options)
 	return new BilliardsExample(options.m_guiHelper);
 }
 
+CommonRigidBodyBase* BilliardsCreateWithParams(GUIHelperInterface* helper, const SceneParams& params)
+{
+	return new BilliardsExample(helper, params);
+}
+
 B3_STANDALONE_EXAMPLE(BilliardsCreateFunc);
 
@@ -5,4 +5,6 @@
 
 class CommonExampleInterface* BilliardsCreateFunc(struct CommonExampleOptions& options);
 
+struct CommonRigidBodyBase* BilliardsCreateWithParams(struct GUIHelperInterface* helper, const struct SceneParams& params);
+
 #endif //APG2024_BILLIARDS_HPP
\ No newline at end of file
@@ -0,0 +1,66 @@
+#ifndef BODY_STATE_HPP
+#define BODY_STATE_HPP
+
+#include "TrajectoryFormat.hpp"
+
+#include "BulletDynamics/Dynamics/btRigidBody.h"
+
+// Copies the state of count bodies into out, channel by channel
+// (out[channel * count + body]), which is the frame layout of TrajectoryFormat.hpp.
+// out must hold TRAJECTORY_CHANNEL_COUNT * count scalars.
+inline void gatherBodyStates(btRigidBody* const* bodies, int count, btScalar* out)
+{
+	btScalar* px = out + TRAJECTORY_PX * count;
+	btScalar* py = out + TRAJECTORY_PY * count;
+	btScalar* pz = out + TRAJECTORY_PZ * count;
+	btScalar* qx = out + TRAJECTORY_QX * count;
+	btScalar* qy = out + TRAJECTORY_QY * count;
+	btScalar* qz = out + TRAJECTORY_QZ * count;
+	btScalar* qw = out + TRAJECTORY_QW * count;
+	btScalar* vx = out + TRAJECTORY_VX * count;
+	btScalar* vy = out + TRAJECTORY_VY * count;
+	btScalar* vz = out + TRAJECTORY_VZ * count;
+	btScalar* wx = out + TRAJECTORY_WX * count;
+	btScalar* wy = out + TRAJECTORY_WY * count;
+	btScalar* wz = out + TRAJECTORY_WZ * count;
+
+	for (int i = 0; i < count; i++) {
+		const btRigidBody* body = bodies[i];
+
+		const btVector3& p = body->getCenterOfMassPosition();
+		btQuaternion q = body->getOrientation();
+		const btVector3& v = body->getLinearVelocity();
+		const btVector3& w = body->getAngularVelocity();
+
+		px[i] = p.x();
+		py[i] = p.y();
+		pz[i] = p.z();
+		qx[i] = q.x();
+		qy[i] = q.y();
+		qz[i] = q.z();
+		qw[i] = q.w();
+		vx[i] = v.x();
+		vy[i] = v.y();
+		vz[i] = v.z();
+		wx[i] = w.x();
+		wy[i] = w.y();
+		wz[i] = w.z();
+	}
+}
+
+enum BodyStateFlags {
+	BODY_STATE_STATIC = 1,
+	// deactivated by the island manager, the state does not change until it wakes up
+	BODY_STATE_SLEEPING = 2,
+};
+
+// Per body BodyStateFlags, lets the delta encoder skip bodies without looking at their state.
+inline void gatherBodyFlags(btRigidBody* const* bodies, int count, unsigned char* out)
+{
+	for (int i = 0; i < count; i++) {
+		const btRigidBody* body = bodies[i];
+		out[i] = (body->isStaticObject() ? BODY_STATE_STATIC : 0) | (body->isActive() ? 0 : BODY_STATE_SLEEPING);
+	}
+}
+
+#endif
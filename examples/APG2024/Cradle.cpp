@@ -1,7 +1,9 @@
 
 #include "Cradle.hpp"
-#include "FileGenerator.hpp"
+#include "TrajectoryRecorder.hpp"
 #include "JsonGenerator.hpp"
+#include "AsyncFrameLogger.hpp"
+#include "SceneParams.hpp"
 
 #include "btBulletDynamicsCommon.h"
 #include "LinearMath/btVector3.h"
@@ -19,17 +21,47 @@ struct CradleExample : public CommonRigidBodyBase {
 
 	int sphereCount = 8;
 
-	FileGenerator* fileGenerator;
+	TrajectoryRecorder* trajectoryRecorder;
 
 	JsonGenerator* jsonGenerator;
 
-	CradleExample(struct GUIHelperInterface* helper) : CommonRigidBodyBase(helper) {
-		fileGenerator = new FileGenerator("Cradle");
-		jsonGenerator = new JsonGenerator("Scene");
+	AsyncFrameLogger* frameLogger = nullptr;
+
+	bool asyncOutput = true;
+
+	btScalar restitution = 1;
+
+	CradleExample(struct GUIHelperInterface* helper, const SceneParams& params = SceneParams()) : CommonRigidBodyBase(helper) {
+		bool defaultOutput = params.outputPrefix.empty();
+		trajectoryRecorder = new TrajectoryRecorder(defaultOutput ? "Cradle" : params.outputPrefix.c_str());
+		jsonGenerator = new JsonGenerator(defaultOutput ? "Scene" : params.outputPrefix.c_str());
+		if (!defaultOutput) {
+			trajectoryRecorder->setFileName(params.outputPrefix + ".bttraj");
+		}
+
+		if (params.velocity) {
+			velocity.setY(*params.velocity);
+		}
+		if (params.layer) {
+			sphereCount = *params.layer;
+		}
+		if (params.restitution) {
+			restitution = *params.restitution;
+		}
+		asyncOutput = params.asyncOutput;
+
+		if (params.deltaKeyframeInterval > 0) {
+			trajectoryRecorder->setDeltaEncoding(params.deltaKeyframeInterval);
+		}
 	}
 
 	virtual ~CradleExample() {
-		delete fileGenerator;
+		if (frameLogger) {
+			frameLogger->stop();
+			frameLogger->printStats();
+			delete frameLogger;
+		}
+		delete trajectoryRecorder;
 		delete jsonGenerator;
 	}
 	virtual void initPhysics();
@@ -48,16 +80,15 @@ struct CradleExample : public CommonRigidBodyBase {
 void CradleOutputBodyInfo(btDynamicsWorld* world, btScalar deltaTime) {
 	CradleExample* example = (CradleExample*)world->getWorldUserInfo();
 
-	btRigidBody** bodies = example->bodies;
-	// 1 is dynamic body
-	int bodyCount = example->sphereCount + 1;
-	std::string* names = example->names;
-
-	FileGenerator* fileGenerator = example->fileGenerator;
-	fileGenerator->saveBodyInfo(bodies, names, bodyCount);
+	if (example->frameLogger) {
+		// formatting and file output run on the logger's writer thread
+		example->frameLogger->pushFrame(example->bodies);
+		return;
+	}
 
-	JsonGenerator* jsonGenerator = example->jsonGenerator;
-	jsonGenerator->recordFrame(bodies, bodyCount);
+	int bodyCount = example->sphereCount + 1;
+	example->trajectoryRecorder->saveBodyInfo(example->bodies, example->names, bodyCount);
+	example->jsonGenerator->recordFrame(example->bodies, bodyCount);
 }
 
 
@@ -83,7 +114,7 @@ void CradleExample::initPhysics()
 
 	btRigidBody* groundBody = createRigidBody(0, groundTransform, groundShape);
 	groundBody->setFriction(0);
-	groundBody->setRestitution(1);
+	groundBody->setRestitution(restitution);
 	groundBody->setRollingFriction(0);
 	groundBody->setSpinningFriction(0);
 
@@ -116,13 +147,21 @@ void CradleExample::initPhysics()
 		bodies[i]->setRollingFriction(0);
 		bodies[i]->setSpinningFriction(0);
 		bodies[i]->setDamping(0, 0);
-		bodies[i]->setRestitution(1);
+		bodies[i]->setRestitution(restitution);
 	}
 
 	m_dynamicsWorld->setInternalTickCallback(CradleOutputBodyInfo, this, true);
 	m_guiHelper->autogenerateGraphicsObjects(m_dynamicsWorld);
 
 	jsonGenerator->addObjects(bodies, names, sphereCount + 1); // 1 is dynamic body
+	trajectoryRecorder->openFile(bodies, names, sphereCount + 1);
+
+	if (asyncOutput && !frameLogger) {
+		frameLogger = new AsyncFrameLogger(sphereCount + 1);
+		frameLogger->addSink([this](const btScalar* frame, const unsigned char* flags, int count) { trajectoryRecorder->writeFrame(frame, flags); });
+		frameLogger->addSink([this](const btScalar* frame, const unsigned char* flags, int count) { jsonGenerator->recordFrame(frame, count); });
+		frameLogger->start();
+	}
 }
 
 
@@ -137,4 +176,9 @@ CommonExampleInterface* CradleCreateFunc(CommonExampleOptions& options)
 	return new CradleExample(options.m_guiHelper);
 }
 
+CommonRigidBodyBase* CradleCreateWithParams(GUIHelperInterface* helper, const SceneParams& params)
+{
+	return new CradleExample(helper, params);
+}
+
 B3_STANDALONE_EXAMPLE(CradleCreateFunc);
\ No newline at end of file
@@ -4,4 +4,6 @@
 
 class CommonExampleInterface* CradleCreateFunc(struct CommonExampleOptions& options);
 
+struct CommonRigidBodyBase* CradleCreateWithParams(struct GUIHelperInterface* helper, const struct SceneParams& params);
+
 #endif
\ No newline at end of file
@@ -1,6 +1,9 @@
 
 #include "JsonGenerator.hpp"
-#include <fstream>
+#include "BodyState.hpp"
+
+#include <cmath>
+#include <cstring>
 #include <filesystem>
 #include <iostream>
 #include <string>
@@ -39,29 +42,97 @@ void JsonGenerator::addObjects(btRigidBody** bodies, std::string* names, int bod
 				break;
 		}
 
+		objectKeys.push_back(objJson["name"].dump() + ":");
 		metaJson.push_back(objJson);
 	}
+
+	frameBuffer.reserve(objectKeys.size() * 256);
+	openFile();
 }
 
 void JsonGenerator::recordFrame(btRigidBody** bodies, int bodyCount)
 {
-	using json = nlohmann::json;
+	stateBuffer.resize(size_t(TRAJECTORY_CHANNEL_COUNT) * bodyCount);
+	gatherBodyStates(bodies, bodyCount, stateBuffer.data());
+	recordFrame(stateBuffer.data(), bodyCount);
+}
 
-	json frameJson;
 
-	for (int i = 0; i < bodyCount; i++) {
-		btRigidBody* body = bodies[i];
+void JsonGenerator::appendNumber(btScalar value)
+{
+	if (!std::isfinite(value)) {
+		frameBuffer += "null";
+		return;
+	}
+	char text[32];
+#ifdef BT_USE_DOUBLE_PRECISION
+	int length = snprintf(text, sizeof(text), "%.17g", value);
+#else
+	int length = snprintf(text, sizeof(text), "%.9g", value);
+#endif
+	// keep integral values typed as floats, like nlohmann::json prints them
+	if (!strpbrk(text, ".e")) {
+		text[length++] = '.';
+		text[length++] = '0';
+	}
+	frameBuffer.append(text, length);
+}
+
+
+void JsonGenerator::recordFrame(const btScalar* frame, int bodyCount)
+{
+	if (!file) {
+		return;
+	}
 
-		btVector3 p = body->getCenterOfMassPosition();
-		btQuaternion q = body->getOrientation();
+	// the channels of the frame are bodyCount apart, only bodies with a key are written
+	int keyCount = bodyCount;
+	if (keyCount > (int)objectKeys.size()) {
+		keyCount = (int)objectKeys.size();
+	}
 
-		json statusJson;
-		statusJson["position"] = {p.x(), p.y(), p.z()};
-		statusJson["quaternion"] = {q.w(), q.x(), q.y(), q.z()};
-		frameJson[metaJson[i]["name"]] = statusJson;
+	const char* objectIndent = compact ? "" : "\n            ";
+	const char* memberIndent = compact ? "" : "\n                ";
+	const char* separator = compact ? "," : ", ";
+
+	frameBuffer.clear();
+	frameBuffer += frameCount ? "," : "";
+	frameBuffer += compact ? "{" : "\n        {";
+
+	for (int i = 0; i < keyCount; i++) {
+		frameBuffer += i ? "," : "";
+		frameBuffer += objectIndent;
+		frameBuffer += objectKeys[i];
+		frameBuffer += compact ? "{" : " {";
+
+		frameBuffer += memberIndent;
+		frameBuffer += compact ? "\"position\":[" : "\"position\": [";
+		appendNumber(frame[TRAJECTORY_PX * bodyCount + i]);
+		frameBuffer += separator;
+		appendNumber(frame[TRAJECTORY_PY * bodyCount + i]);
+		frameBuffer += separator;
+		appendNumber(frame[TRAJECTORY_PZ * bodyCount + i]);
+		frameBuffer += "],";
+
+		frameBuffer += memberIndent;
+		frameBuffer += compact ? "\"quaternion\":[" : "\"quaternion\": [";
+		appendNumber(frame[TRAJECTORY_QW * bodyCount + i]);
+		frameBuffer += separator;
+		appendNumber(frame[TRAJECTORY_QX * bodyCount + i]);
+		frameBuffer += separator;
+		appendNumber(frame[TRAJECTORY_QY * bodyCount + i]);
+		frameBuffer += separator;
+		appendNumber(frame[TRAJECTORY_QZ * bodyCount + i]);
+		frameBuffer += "]";
+
+		frameBuffer += objectIndent;
+		frameBuffer += "}";
 	}
 
-	framesJson.push_back(frameJson);
+	frameBuffer += compact ? "}" : "\n        }";
+
+	fwrite(frameBuffer.data(), 1, frameBuffer.size(), file);
+	frameCount++;
 }
 
 
@@ -91,8 +162,12 @@ int JsonGenerator::getFileCount() const
 }
 
 
-void JsonGenerator::saveToFile()
+void JsonGenerator::openFile()
 {
+	if (file) {
+		return;
+	}
+
 	createDirectory();
 
 	// int fileCount = getFileCount();
@@ -100,16 +175,33 @@ void JsonGenerator::saveToFile()
 	// std::filesystem::path fileName = dir / (jsonFileNamePrefix + "_" + std::to_string(fileCount) + ".json");
     std::filesystem::path fileName = dir / (jsonFileNamePrefix + ".json");
 
-	std::ofstream file(fileName);
+	file = fopen(fileName.string().c_str(), "w");
+	if (!file) {
+		std::cerr << "Failed to open file " << fileName << std::endl;
+		return;
+	}
 
+	// dump the meta block with the library and cut off the closing brace,
+	// the frames array is streamed in after it
 	nlohmann::json json;
 	json["meta"] = metaJson;
-	json["frames"] = framesJson;
+	std::string head = compact ? json.dump() : json.dump(4);
+	head.resize(head.size() - (compact ? 1 : 2));
+	head += compact ? ",\"frames\":[" : ",\n    \"frames\": [";
 
-	if (file.is_open()) {
-		file << json.dump(4);
-		file.close();
-	} else {
-		std::cerr << "Failed to open file " << fileName << std::endl;
+	fwrite(head.data(), 1, head.size(), file);
+	frameCount = 0;
+}
+
+
+void JsonGenerator::saveToFile()
+{
+	if (!file) {
+		return;
 	}
-}
\ No newline at end of file
+
+	const char* tail = compact ? "]}" : (frameCount ? "\n    ]\n}" : "]\n}");
+	fputs(tail, file);
+	fclose(file);
+	file = nullptr;
+}
@@ -1,32 +1,41 @@
 
-
 #ifndef JSON_GENERATOR_HPP
 #define JSON_GENERATOR_HPP
 
 #include "json.hpp"
 
+#include <cstdio>
+
 #include "BulletDynamics/Dynamics/btRigidBody.h"
 
+// Writes the {"meta": [...], "frames": [...]} scene file. The meta block is written
+// when the objects are added, after that every recorded frame is formatted into a
+// reusable buffer and appended to the file straight away, so memory use does not
+// grow with the length of the run. saveToFile closes the frames array.
 class JsonGenerator {
 
 public:
 
 	nlohmann::json metaJson;
-	nlohmann::json framesJson;
 
 	std::string jsonFileNamePrefix;
 
 	static std::filesystem::path dir;
 
-	JsonGenerator(const char* name) : jsonFileNamePrefix(name) {
+	// no indentation or line breaks between tokens
+	bool compact;
+
+	JsonGenerator(const char* name, bool compact = false) : jsonFileNamePrefix(name), compact(compact) {
 		metaJson = nlohmann::json::array();
-		framesJson = nlohmann::json::array();
 	}
 
 	void addObjects(btRigidBody** bodies, std::string* names, int bodyCount);
 
 	void recordFrame(btRigidBody** bodies, int bodyCount);
 
+	// frame holds channel-major body states, see gatherBodyStates
+	void recordFrame(const btScalar* frame, int bodyCount);
+
 	void saveToFile();
 
 	static void createDirectory();
@@ -36,7 +45,24 @@ public:
 	~JsonGenerator() {
 		saveToFile();
 	}
+
+private:
+
+	FILE* file = nullptr;
+
+	int frameCount = 0;
+
+	// "<name>": fragment of every object, escaped once when the objects are added
+	std::vector<std::string> objectKeys;
+
+	std::vector<btScalar> stateBuffer;
+
+	std::string frameBuffer;
+
+	void openFile();
+
+	void appendNumber(btScalar value);
 };
 
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,33 @@
+#ifndef SCENE_PARAMS_HPP
+#define SCENE_PARAMS_HPP
+
+#include <optional>
+#include <string>
+
+#include "LinearMath/btScalar.h"
+
+// Overrides for the APG2024 scenes, unset values keep the defaults the scenes use
+// in the ExampleBrowser. Used by App_APG2024Batch to run parameter sweeps.
+struct SceneParams {
+	// y velocity of the initial velocity sphere
+	std::optional<btScalar> velocity;
+
+	// pyramid layers for BallGeyser and Billiards, sphere count for Cradle and Bernoulli
+	std::optional<int> layer;
+
+	// restitution of the ground and of every recorded body
+	std::optional<btScalar> restitution;
+
+	// names the trajectory (<prefix>.bttraj) and json output, must be unique per world
+	// when several worlds run at the same time. Empty keeps the numbered default files
+	std::string outputPrefix;
+
+	// record trajectories as keyframes every this many frames plus quantized deltas,
+	// 0 writes every frame in full
+	int deltaKeyframeInterval = 0;
+
+	// write output on a separate thread (AsyncFrameLogger) instead of inside the tick
+	bool asyncOutput = true;
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef TRAJECTORY_FORMAT_HPP
+#define TRAJECTORY_FORMAT_HPP
+
+#include <cstdint>
+
+// On-disk layout of the binary trajectory files written by TrajectoryRecorder.
+// This header has no Bullet dependency so offline tools can include it on their own.
+//
+//   TrajectoryFileHeader
+//   TrajectoryDeltaInfo               (only for TRAJECTORY_ENCODING_DELTA)
+//   TrajectoryBodyInfo[bodyCount]
+//   char names[namesBytes]            (zero terminated names, back to back)
+//   padding up to frameDataOffset
+//   frame[frameCount]                 (each frame is channelCount * bodyCount scalars,
+//                                      stored channel by channel: all p_x, then all p_y, ...)
+//
+// With TRAJECTORY_ENCODING_DELTA every frame starts with a TrajectoryFrameRecord:
+//   keyframe (every keyframeInterval frames): a full frame as above
+//   delta frame: bodyCount entries of
+//       uint32_t body                 (TRAJECTORY_DELTA_RAW set: the values follow as scalars,
+//                                      TRAJECTORY_DELTA_SMALL set: the deltas are int8_t)
+//       int16_t delta[channelCount]   (or int8_t delta[channelCount] or scalar value[channelCount])
+//   bodies missing from a delta frame did not change. Deltas are relative to the state
+//   a decoder reconstructs for the previous frame, in units of quantum[channel], so the
+//   error of a decoded value stays within half a quantum and does not accumulate.
+//   The file ends with uint64_t offsets[frameCount] of every record relative to
+//   frameDataOffset, located at TrajectoryDeltaInfo::frameIndexOffset.
+
+#define TRAJECTORY_MAGIC "BTTRAJ1"
+#define TRAJECTORY_VERSION 1
+
+enum TrajectoryChannel {
+	TRAJECTORY_PX,
+	TRAJECTORY_PY,
+	TRAJECTORY_PZ,
+	TRAJECTORY_QX,
+	TRAJECTORY_QY,
+	TRAJECTORY_QZ,
+	TRAJECTORY_QW,
+	TRAJECTORY_VX,
+	TRAJECTORY_VY,
+	TRAJECTORY_VZ,
+	TRAJECTORY_WX,
+	TRAJECTORY_WY,
+	TRAJECTORY_WZ,
+	TRAJECTORY_CHANNEL_COUNT
+};
+
+enum TrajectoryEncoding {
+	TRAJECTORY_ENCODING_RAW = 0,
+	TRAJECTORY_ENCODING_DELTA = 1,
+};
+
+enum TrajectoryFrameType {
+	TRAJECTORY_FRAME_KEY = 0,
+	TRAJECTORY_FRAME_DELTA = 1,
+};
+
+#define TRAJECTORY_DELTA_RAW 0x80000000u
+#define TRAJECTORY_DELTA_SMALL 0x40000000u
+#define TRAJECTORY_DELTA_BODY_MASK 0x3fffffffu
+
+enum TrajectoryShapeType {
+	TRAJECTORY_SHAPE_UNKNOWN = 0,
+	TRAJECTORY_SHAPE_SPHERE = 1,
+	TRAJECTORY_SHAPE_BOX = 2,
+};
+
+struct TrajectoryFileHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t scalarSize;  // 4 for float, 8 for double
+	uint32_t bodyCount;
+	uint32_t channelCount;
+	uint32_t namesBytes;
+	uint32_t encoding;  // TrajectoryEncoding
+	uint64_t frameDataOffset;
+	uint64_t frameCount;  // patched when the recorder is closed
+};
+
+struct TrajectoryDeltaInfo {
+	uint32_t keyframeInterval;
+	uint32_t reserved;
+	double quantum[TRAJECTORY_CHANNEL_COUNT];
+	uint64_t frameIndexOffset;  // 0 when the recorder was not closed, readers rebuild the index
+};
+
+struct TrajectoryFrameRecord {
+	uint32_t type;       // TrajectoryFrameType
+	uint32_t bodyCount;  // bodies stored in this record
+};
+
+struct TrajectoryBodyInfo {
+	uint32_t nameOffset;  // offset into the names block
+	uint32_t shapeType;   // TrajectoryShapeType
+	double dims[3];       // sphere: radius, 0, 0; box: full extents x, y, z
+};
+
+static const char* const trajectoryChannelNames[TRAJECTORY_CHANNEL_COUNT] = {
+	"p_x", "p_y", "p_z", "q_x", "q_y", "q_z", "q_w", "v_x", "v_y", "v_z", "w_x", "w_y", "w_z"};
+
+#endif
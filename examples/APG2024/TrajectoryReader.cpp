@@ -0,0 +1,284 @@
+
+#include "TrajectoryReader.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+
+bool TrajectoryReader::open(const std::string& path)
+{
+	file.open(path, std::ios::binary);
+	if (!file.is_open()) {
+		std::cerr << "Failed to open file: " << path << std::endl;
+		return false;
+	}
+
+	file.read((char*)&header, sizeof(header));
+	if (!file || memcmp(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic)) != 0) {
+		std::cerr << "Not a trajectory file: " << path << std::endl;
+		file.close();
+		return false;
+	}
+
+	if (header.version != TRAJECTORY_VERSION || header.channelCount != TRAJECTORY_CHANNEL_COUNT ||
+		(header.scalarSize != sizeof(float) && header.scalarSize != sizeof(double)) ||
+		(header.encoding != TRAJECTORY_ENCODING_RAW && header.encoding != TRAJECTORY_ENCODING_DELTA)) {
+		std::cerr << "Unsupported trajectory file: " << path << std::endl;
+		file.close();
+		return false;
+	}
+
+	if (isDeltaEncoded()) {
+		file.read((char*)&deltaInfo, sizeof(deltaInfo));
+		if (!file || deltaInfo.keyframeInterval == 0) {
+			std::cerr << "Truncated trajectory header: " << path << std::endl;
+			file.close();
+			return false;
+		}
+	}
+
+	bodyInfos.resize(header.bodyCount);
+	file.read((char*)bodyInfos.data(), sizeof(TrajectoryBodyInfo) * header.bodyCount);
+
+	std::vector<char> namesBlock(header.namesBytes + 1, '\0');
+	file.read(namesBlock.data(), header.namesBytes);
+	if (!file) {
+		std::cerr << "Truncated trajectory header: " << path << std::endl;
+		file.close();
+		return false;
+	}
+
+	names.resize(header.bodyCount);
+	for (uint32_t i = 0; i < header.bodyCount; i++) {
+		uint32_t offset = bodyInfos[i].nameOffset;
+		names[i] = offset < header.namesBytes ? std::string(namesBlock.data() + offset) : std::string();
+	}
+
+	frameBytes = uint64_t(header.channelCount) * header.bodyCount * header.scalarSize;
+
+	// a recorder that did not shut down cleanly leaves frameCount at zero,
+	// recover whatever complete frames made it to disk
+	file.seekg(0, std::ios::end);
+	uint64_t fileBytes = (uint64_t)file.tellg();
+
+	if (isDeltaEncoded()) {
+		if (!header.frameCount || !deltaInfo.frameIndexOffset || !readIndex(fileBytes)) {
+			scanRecords(fileBytes);
+		}
+		frameCount = frameOffsets.size() - 1;
+		decoded.assign(size_t(header.channelCount) * header.bodyCount, 0);
+		decodedFrame = -1;
+		return true;
+	}
+
+	uint64_t available = (frameBytes && fileBytes > header.frameDataOffset) ? (fileBytes - header.frameDataOffset) / frameBytes : 0;
+	frameCount = header.frameCount ? std::min(header.frameCount, available) : available;
+
+	raw.resize(frameBytes);
+	return true;
+}
+
+
+bool TrajectoryReader::readIndex(uint64_t fileBytes)
+{
+	uint64_t indexBytes = header.frameCount * sizeof(uint64_t);
+	if (deltaInfo.frameIndexOffset < header.frameDataOffset || deltaInfo.frameIndexOffset + indexBytes > fileBytes) {
+		return false;
+	}
+
+	frameOffsets.resize(header.frameCount + 1);
+	file.clear();
+	file.seekg(deltaInfo.frameIndexOffset);
+	file.read((char*)frameOffsets.data(), indexBytes);
+	frameOffsets[header.frameCount] = deltaInfo.frameIndexOffset - header.frameDataOffset;
+	return (bool)file;
+}
+
+
+void TrajectoryReader::scanRecords(uint64_t fileBytes)
+{
+	uint64_t dataBytes = fileBytes > header.frameDataOffset ? fileBytes - header.frameDataOffset : 0;
+	uint64_t entryBytes = sizeof(uint32_t) + uint64_t(header.channelCount) * sizeof(int16_t);
+	uint64_t smallEntryBytes = sizeof(uint32_t) + uint64_t(header.channelCount) * sizeof(int8_t);
+	uint64_t rawEntryBytes = sizeof(uint32_t) + uint64_t(header.channelCount) * header.scalarSize;
+
+	frameOffsets.clear();
+	uint64_t offset = 0;
+
+	file.clear();
+	for (;;) {
+		TrajectoryFrameRecord record;
+		if (offset + sizeof(record) > dataBytes) {
+			break;
+		}
+		file.seekg(header.frameDataOffset + offset);
+		file.read((char*)&record, sizeof(record));
+
+		uint64_t end = offset + sizeof(record);
+		if (record.type == TRAJECTORY_FRAME_KEY) {
+			end += frameBytes;
+		} else {
+			bool valid = true;
+			for (uint32_t i = 0; i < record.bodyCount && valid; i++) {
+				uint32_t tag;
+				file.seekg(header.frameDataOffset + end);
+				file.read((char*)&tag, sizeof(tag));
+				valid = (bool)file;
+				if (tag & TRAJECTORY_DELTA_RAW) {
+					end += rawEntryBytes;
+				} else {
+					end += (tag & TRAJECTORY_DELTA_SMALL) ? smallEntryBytes : entryBytes;
+				}
+			}
+			if (!valid) {
+				break;
+			}
+		}
+
+		if (!file || end > dataBytes) {
+			break;
+		}
+		frameOffsets.push_back(offset);
+		offset = end;
+	}
+	frameOffsets.push_back(offset);
+	file.clear();
+}
+
+
+bool TrajectoryReader::readRecord(uint64_t frame)
+{
+	uint64_t bytes = frameOffsets[frame + 1] - frameOffsets[frame];
+	raw.resize(bytes);
+
+	file.clear();
+	file.seekg(header.frameDataOffset + frameOffsets[frame]);
+	file.read(raw.data(), bytes);
+	return (bool)file && bytes >= sizeof(TrajectoryFrameRecord);
+}
+
+
+bool TrajectoryReader::applyRecord()
+{
+	TrajectoryFrameRecord record;
+	memcpy(&record, raw.data(), sizeof(record));
+
+	const char* cursor = raw.data() + sizeof(record);
+	const char* end = raw.data() + raw.size();
+	uint32_t n = header.bodyCount;
+	size_t scalars = decoded.size();
+
+	if (record.type == TRAJECTORY_FRAME_KEY) {
+		if (size_t(end - cursor) < scalars * header.scalarSize) {
+			return false;
+		}
+		for (size_t k = 0; k < scalars; k++, cursor += header.scalarSize) {
+			if (header.scalarSize == sizeof(double)) {
+				memcpy(&decoded[k], cursor, sizeof(double));
+			} else {
+				float value;
+				memcpy(&value, cursor, sizeof(float));
+				decoded[k] = value;
+			}
+		}
+		return true;
+	}
+
+	for (uint32_t i = 0; i < record.bodyCount; i++) {
+		uint32_t tag;
+		if (size_t(end - cursor) < sizeof(tag)) {
+			return false;
+		}
+		memcpy(&tag, cursor, sizeof(tag));
+		cursor += sizeof(tag);
+
+		uint32_t body = tag & TRAJECTORY_DELTA_BODY_MASK;
+		if (body >= n) {
+			return false;
+		}
+
+		if (tag & TRAJECTORY_DELTA_RAW) {
+			if (size_t(end - cursor) < header.channelCount * header.scalarSize) {
+				return false;
+			}
+			for (uint32_t c = 0; c < header.channelCount; c++, cursor += header.scalarSize) {
+				size_t k = size_t(c) * n + body;
+				if (header.scalarSize == sizeof(double)) {
+					memcpy(&decoded[k], cursor, sizeof(double));
+				} else {
+					float value;
+					memcpy(&value, cursor, sizeof(float));
+					decoded[k] = value;
+				}
+			}
+		} else {
+			int16_t delta[TRAJECTORY_CHANNEL_COUNT];
+			if (tag & TRAJECTORY_DELTA_SMALL) {
+				if (size_t(end - cursor) < header.channelCount) {
+					return false;
+				}
+				for (uint32_t c = 0; c < header.channelCount; c++) {
+					delta[c] = (int8_t)*cursor++;
+				}
+			} else {
+				if (size_t(end - cursor) < sizeof(delta)) {
+					return false;
+				}
+				memcpy(delta, cursor, sizeof(delta));
+				cursor += sizeof(delta);
+			}
+			for (uint32_t c = 0; c < header.channelCount; c++) {
+				size_t k = size_t(c) * n + body;
+				decoded[k] = decoded[k] + delta[c] * deltaInfo.quantum[c];
+			}
+		}
+	}
+	return true;
+}
+
+
+bool TrajectoryReader::readFrame(uint64_t frame, std::vector<double>& out)
+{
+	if (frame >= frameCount) {
+		return false;
+	}
+
+	if (isDeltaEncoded()) {
+		uint64_t keyframe = frame - frame % deltaInfo.keyframeInterval;
+		uint64_t next = keyframe;
+		// continue from the last decoded frame when it lies between the keyframe and frame
+		if (decodedFrame >= (int64_t)keyframe && decodedFrame <= (int64_t)frame) {
+			next = decodedFrame + 1;
+		}
+		for (; next <= frame; next++) {
+			if (!readRecord(next) || !applyRecord()) {
+				decodedFrame = -1;
+				return false;
+			}
+			decodedFrame = next;
+		}
+		out = decoded;
+		return true;
+	}
+
+	file.clear();
+	file.seekg(header.frameDataOffset + frame * frameBytes);
+	file.read(raw.data(), frameBytes);
+	if (!file) {
+		return false;
+	}
+
+	size_t scalars = size_t(header.channelCount) * header.bodyCount;
+	out.resize(scalars);
+
+	if (header.scalarSize == sizeof(double)) {
+		memcpy(out.data(), raw.data(), scalars * sizeof(double));
+	} else {
+		const float* src = (const float*)raw.data();
+		for (size_t i = 0; i < scalars; i++) {
+			out[i] = src[i];
+		}
+	}
+	return true;
+}
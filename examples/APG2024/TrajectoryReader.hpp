@@ -0,0 +1,80 @@
+#ifndef TRAJECTORY_READER_HPP
+#define TRAJECTORY_READER_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "TrajectoryFormat.hpp"
+
+// Reads files written by TrajectoryRecorder. Independent of Bullet and of the
+// precision the recorder was built with: frames are always returned as doubles,
+// channel by channel (frame[channel * bodyCount + body]). Delta encoded files are
+// decoded from the closest keyframe, reading frames in order only applies one delta
+// record per frame.
+class TrajectoryReader {
+
+	std::ifstream file;
+
+	TrajectoryFileHeader header;
+	std::vector<TrajectoryBodyInfo> bodyInfos;
+	std::vector<std::string> names;
+
+	uint64_t frameCount = 0;
+	uint64_t frameBytes = 0;
+
+	std::vector<char> raw;
+
+	// delta encoding
+	TrajectoryDeltaInfo deltaInfo;
+	// record offsets relative to frameDataOffset, plus the end of the last record
+	std::vector<uint64_t> frameOffsets;
+	std::vector<double> decoded;
+	int64_t decodedFrame = -1;
+
+	bool readIndex(uint64_t fileBytes);
+	void scanRecords(uint64_t fileBytes);
+	bool readRecord(uint64_t frame);
+	bool applyRecord();
+
+public:
+
+	bool open(const std::string& path);
+
+	void close() {
+		file.close();
+	}
+
+	int getBodyCount() const {
+		return (int)header.bodyCount;
+	}
+
+	uint64_t getFrameCount() const {
+		return frameCount;
+	}
+
+	bool isDeltaEncoded() const {
+		return header.encoding == TRAJECTORY_ENCODING_DELTA;
+	}
+
+	int getScalarSize() const {
+		return (int)header.scalarSize;
+	}
+
+	const std::string& getBodyName(int body) const {
+		return names[body];
+	}
+
+	const TrajectoryBodyInfo& getBodyInfo(int body) const {
+		return bodyInfos[body];
+	}
+
+	bool readFrame(uint64_t frame, std::vector<double>& out);
+
+	double getValue(const std::vector<double>& frame, int channel, int body) const {
+		return frame[size_t(channel) * header.bodyCount + body];
+	}
+};
+
+#endif
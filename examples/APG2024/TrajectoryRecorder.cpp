@@ -0,0 +1,509 @@
+
+#include "TrajectoryRecorder.hpp"
+#include "BodyState.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+#include "BulletCollision/CollisionShapes/btSphereShape.h"
+#include "BulletCollision/CollisionShapes/btBoxShape.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+std::filesystem::path TrajectoryRecorder::dir = "BodyInfo";
+
+static const uint64_t frameDataAlignment = 64;
+
+
+void TrajectoryRecorder::createDirectory() {
+	if (std::filesystem::exists(dir)) {
+		return;
+	}
+	std::filesystem::create_directory(dir);
+}
+
+int TrajectoryRecorder::getFileCount() const {
+	int count = 0;
+	std::filesystem::directory_entry entry(dir);
+	std::filesystem::directory_iterator files(entry);
+
+	// only prefix_<digits>.bttraj, other prefixes that start with this one have their own numbering
+	const std::string head = filePrefix + "_";
+	const std::string extension = ".bttraj";
+
+	for(auto& file : files) {
+		std::string fileName = file.path().filename().string();
+
+		if (fileName.size() <= head.size() + extension.size() || fileName.compare(0, head.size(), head) != 0 ||
+			fileName.compare(fileName.size() - extension.size(), extension.size(), extension) != 0) {
+			continue;
+		}
+		size_t digits = fileName.size() - head.size() - extension.size();
+		if (fileName.find_first_not_of("0123456789", head.size()) == head.size() + digits) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+
+static void fillBodyInfo(const btRigidBody* body, TrajectoryBodyInfo& info)
+{
+	const btCollisionShape* shape = body->getCollisionShape();
+
+	info.shapeType = TRAJECTORY_SHAPE_UNKNOWN;
+	info.dims[0] = info.dims[1] = info.dims[2] = 0;
+
+	switch (shape->getShapeType())
+	{
+		case SPHERE_SHAPE_PROXYTYPE:
+			info.shapeType = TRAJECTORY_SHAPE_SPHERE;
+			info.dims[0] = ((const btSphereShape*)shape)->getRadius();
+			break;
+		case BOX_SHAPE_PROXYTYPE: {
+			info.shapeType = TRAJECTORY_SHAPE_BOX;
+			btVector3 xyz = ((const btBoxShape*)shape)->getHalfExtentsWithMargin() * 2;
+			info.dims[0] = xyz.x();
+			info.dims[1] = xyz.y();
+			info.dims[2] = xyz.z();
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+
+void TrajectoryRecorder::setDeltaEncoding(int keyframeInterval, double positionQuantum, double orientationQuantum, double velocityQuantum)
+{
+	if (fileIsOpen) {
+		return;
+	}
+
+	encoding = TRAJECTORY_ENCODING_DELTA;
+	memset(&deltaInfo, 0, sizeof(deltaInfo));
+	deltaInfo.keyframeInterval = keyframeInterval > 0 ? keyframeInterval : 1;
+
+	for (int c = 0; c < TRAJECTORY_CHANNEL_COUNT; c++) {
+		if (c <= TRAJECTORY_PZ) {
+			deltaInfo.quantum[c] = positionQuantum;
+		} else if (c <= TRAJECTORY_QW) {
+			deltaInfo.quantum[c] = orientationQuantum;
+		} else {
+			deltaInfo.quantum[c] = velocityQuantum;
+		}
+	}
+}
+
+
+bool TrajectoryRecorder::openFile(btRigidBody* const* bodies, const std::string* names, int count)
+{
+	if (fileIsOpen) {
+		return true;
+	}
+
+	bodyCount = count;
+	frameScalars = size_t(TRAJECTORY_CHANNEL_COUNT) * count;
+	frameDataBytes = 0;
+	frameCount = 0;
+
+	size_t frameBytes = frameScalars * sizeof(btScalar);
+	size_t deltaInfoBytes = 0;
+	maxRecordBytes = frameBytes;
+
+	if (encoding == TRAJECTORY_ENCODING_DELTA) {
+		deltaInfoBytes = sizeof(TrajectoryDeltaInfo);
+		size_t deltaBytes = size_t(count) * (sizeof(uint32_t) + TRAJECTORY_CHANNEL_COUNT * sizeof(btScalar));
+		maxRecordBytes = sizeof(TrajectoryFrameRecord) + (deltaBytes > frameBytes ? deltaBytes : frameBytes);
+
+		stagingFrame.resize(frameScalars);
+		stagingFlags.resize(count);
+		reference.assign(frameScalars, 0);
+		referenceFlags.assign(count, 0);
+		frameOffsets.clear();
+	}
+
+	std::vector<TrajectoryBodyInfo> infos(count);
+	std::string namesBlock;
+	for (int i = 0; i < count; i++) {
+		infos[i].nameOffset = (uint32_t)namesBlock.size();
+		fillBodyInfo(bodies[i], infos[i]);
+		namesBlock += names[i];
+		namesBlock.push_back('\0');
+	}
+
+	TrajectoryFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic));
+	header.version = TRAJECTORY_VERSION;
+	header.scalarSize = sizeof(btScalar);
+	header.bodyCount = count;
+	header.channelCount = TRAJECTORY_CHANNEL_COUNT;
+	header.namesBytes = (uint32_t)namesBlock.size();
+	header.encoding = encoding;
+
+	size_t infosOffset = sizeof(header) + deltaInfoBytes;
+	size_t namesOffset = infosOffset + sizeof(TrajectoryBodyInfo) * count;
+	uint64_t headBytes = namesOffset + namesBlock.size();
+	frameDataOffset = (headBytes + frameDataAlignment - 1) / frameDataAlignment * frameDataAlignment;
+	header.frameDataOffset = frameDataOffset;
+
+	std::vector<char> head(frameDataOffset, 0);
+	memcpy(head.data(), &header, sizeof(header));
+	if (deltaInfoBytes) {
+		memcpy(head.data() + sizeof(header), &deltaInfo, deltaInfoBytes);
+	}
+	if (count) {
+		memcpy(head.data() + infosOffset, infos.data(), sizeof(TrajectoryBodyInfo) * count);
+	}
+	memcpy(head.data() + namesOffset, namesBlock.data(), namesBlock.size());
+
+	filePath = dir / (fileName.empty() ? filePrefix + "_" + std::to_string(getFileCount()) + ".bttraj" : fileName);
+
+	fileIsOpen = useMemoryMap ? openMapped(filePath, head) : openBuffered(filePath, head);
+	return fileIsOpen;
+}
+
+
+bool TrajectoryRecorder::openBuffered(const std::filesystem::path& path, const std::vector<char>& head)
+{
+	file = fopen(path.string().c_str(), "wb");
+	if (!file) {
+		std::cerr << "Failed to open file: " << path.string() << std::endl;
+		return false;
+	}
+
+	fwrite(head.data(), 1, head.size(), file);
+	block.resize(maxRecordBytes * framesPerBlock);
+	blockBytes = 0;
+	return true;
+}
+
+
+bool TrajectoryRecorder::openMapped(const std::filesystem::path& path, const std::vector<char>& head)
+{
+#ifndef _WIN32
+	fd = ::open(path.string().c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		std::cerr << "Failed to open file: " << path.string() << std::endl;
+		return false;
+	}
+
+	if (!growMapping(head.size() + maxRecordBytes * framesPerBlock)) {
+		::close(fd);
+		fd = -1;
+		return false;
+	}
+	memcpy(mapped, head.data(), head.size());
+	return true;
+#else
+	std::cerr << "Memory mapped trajectory output is not supported on this platform, using buffered output" << std::endl;
+	useMemoryMap = false;
+	return openBuffered(path, head);
+#endif
+}
+
+
+bool TrajectoryRecorder::growMapping(uint64_t minBytes)
+{
+#ifndef _WIN32
+	uint64_t newBytes = mappedBytes ? mappedBytes : minBytes;
+	while (newBytes < minBytes) {
+		newBytes *= 2;
+	}
+
+	if (ftruncate(fd, (off_t)newBytes) != 0) {
+		std::cerr << "Failed to grow trajectory file" << std::endl;
+		return false;
+	}
+
+	// the old mapping is only dropped once the new one is in place, on failure the frames
+	// written so far stay mapped and closeFile can still finish the file
+	void* ptr = mmap(nullptr, newBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (ptr == MAP_FAILED) {
+		std::cerr << "Failed to map trajectory file" << std::endl;
+		return false;
+	}
+
+	if (mapped) {
+		munmap(mapped, mappedBytes);
+	}
+	mapped = (char*)ptr;
+	mappedBytes = newBytes;
+	return true;
+#else
+	(void)minBytes;
+	return false;
+#endif
+}
+
+
+void TrajectoryRecorder::flushBlock()
+{
+	if (file && blockBytes) {
+		fwrite(block.data(), 1, blockBytes, file);
+	}
+	blockBytes = 0;
+}
+
+
+char* TrajectoryRecorder::reserveBytes(size_t bytes)
+{
+	if (useMemoryMap) {
+		uint64_t end = frameDataOffset + frameDataBytes + bytes;
+		if (end > mappedBytes && !growMapping(end)) {
+			return nullptr;
+		}
+		return mapped + frameDataOffset + frameDataBytes;
+	}
+
+	if (blockBytes + bytes > block.size()) {
+		flushBlock();
+	}
+	return block.data() + blockBytes;
+}
+
+
+void TrajectoryRecorder::commitBytes(size_t bytes)
+{
+	if (!useMemoryMap) {
+		blockBytes += bytes;
+	}
+	frameDataBytes += bytes;
+}
+
+
+bool TrajectoryRecorder::encodeFrame(const btScalar* frame, const unsigned char* bodyFlags)
+{
+	char* out = reserveBytes(maxRecordBytes);
+	if (!out) {
+		closeFile();
+		return false;
+	}
+	frameOffsets.push_back(frameDataBytes);
+
+	TrajectoryFrameRecord record;
+	char* cursor = out + sizeof(record);
+	int n = bodyCount;
+
+	if (frameCount % deltaInfo.keyframeInterval == 0) {
+		record.type = TRAJECTORY_FRAME_KEY;
+		record.bodyCount = n;
+
+		memcpy(cursor, frame, frameScalars * sizeof(btScalar));
+		cursor += frameScalars * sizeof(btScalar);
+
+		for (size_t i = 0; i < frameScalars; i++) {
+			reference[i] = frame[i];
+		}
+		for (int i = 0; i < n; i++) {
+			referenceFlags[i] = bodyFlags ? bodyFlags[i] : 0;
+		}
+	} else {
+		record.type = TRAJECTORY_FRAME_DELTA;
+		record.bodyCount = 0;
+
+		for (int i = 0; i < n; i++) {
+			unsigned char flags = bodyFlags ? bodyFlags[i] : 0;
+
+			// static and sleeping bodies keep their state, the frame in which they
+			// stopped has already been written
+			if (flags && flags == referenceFlags[i]) {
+				continue;
+			}
+			referenceFlags[i] = flags;
+
+			int16_t delta[TRAJECTORY_CHANNEL_COUNT];
+			bool fits = true;
+			bool small = true;
+			bool moved = false;
+			for (int c = 0; c < TRAJECTORY_CHANNEL_COUNT; c++) {
+				size_t k = size_t(c) * n + i;
+				double steps = nearbyint((frame[k] - reference[k]) / deltaInfo.quantum[c]);
+				if (!(fabs(steps) <= 32767.0)) {
+					fits = false;
+					break;
+				}
+				delta[c] = (int16_t)steps;
+				small &= delta[c] >= -128 && delta[c] <= 127;
+				moved |= delta[c] != 0;
+			}
+
+			if (fits && !moved) {
+				continue;
+			}
+
+			uint32_t tag = (uint32_t)i;
+			if (!fits) {
+				tag |= TRAJECTORY_DELTA_RAW;
+			} else if (small) {
+				tag |= TRAJECTORY_DELTA_SMALL;
+			}
+			memcpy(cursor, &tag, sizeof(tag));
+			cursor += sizeof(tag);
+
+			for (int c = 0; c < TRAJECTORY_CHANNEL_COUNT; c++) {
+				size_t k = size_t(c) * n + i;
+				if (fits) {
+					// same arithmetic as the decoder, so both sides agree on the reference
+					reference[k] = reference[k] + delta[c] * deltaInfo.quantum[c];
+				} else {
+					memcpy(cursor, &frame[k], sizeof(btScalar));
+					cursor += sizeof(btScalar);
+					reference[k] = frame[k];
+				}
+			}
+			if (fits && small) {
+				for (int c = 0; c < TRAJECTORY_CHANNEL_COUNT; c++) {
+					*cursor++ = (char)(int8_t)delta[c];
+				}
+			} else if (fits) {
+				memcpy(cursor, delta, sizeof(delta));
+				cursor += sizeof(delta);
+			}
+			record.bodyCount++;
+		}
+	}
+
+	memcpy(out, &record, sizeof(record));
+	commitBytes(cursor - out);
+	return true;
+}
+
+
+btScalar* TrajectoryRecorder::beginFrame()
+{
+	if (!fileIsOpen) {
+		return nullptr;
+	}
+
+	if (encoding == TRAJECTORY_ENCODING_DELTA) {
+		return stagingFrame.data();
+	}
+
+	btScalar* frame = (btScalar*)reserveBytes(frameScalars * sizeof(btScalar));
+	if (!frame) {
+		closeFile();
+	}
+	return frame;
+}
+
+
+bool TrajectoryRecorder::endFrame(const unsigned char* bodyFlags)
+{
+	if (!fileIsOpen) {
+		return false;
+	}
+
+	if (encoding == TRAJECTORY_ENCODING_DELTA) {
+		if (!encodeFrame(stagingFrame.data(), bodyFlags)) {
+			return false;
+		}
+	} else {
+		commitBytes(frameScalars * sizeof(btScalar));
+	}
+	frameCount++;
+	return true;
+}
+
+
+bool TrajectoryRecorder::writeFrame(const btScalar* frame, const unsigned char* bodyFlags)
+{
+	if (!fileIsOpen) {
+		return false;
+	}
+
+	if (encoding == TRAJECTORY_ENCODING_DELTA) {
+		if (!encodeFrame(frame, bodyFlags)) {
+			return false;
+		}
+		frameCount++;
+		return true;
+	}
+
+	btScalar* dst = beginFrame();
+	if (!dst) {
+		return false;
+	}
+	memcpy(dst, frame, frameScalars * sizeof(btScalar));
+	return endFrame();
+}
+
+
+bool TrajectoryRecorder::saveBodyInfo(btRigidBody** bodies, std::string* names, int count)
+{
+	openFile(bodies, names, count);
+
+	btScalar* frame = beginFrame();
+	if (!frame) {
+		return false;
+	}
+	gatherBodyStates(bodies, bodyCount, frame);
+
+	if (encoding == TRAJECTORY_ENCODING_DELTA) {
+		gatherBodyFlags(bodies, bodyCount, stagingFlags.data());
+		return endFrame(stagingFlags.data());
+	}
+	return endFrame();
+}
+
+
+void TrajectoryRecorder::closeFile()
+{
+	if (!fileIsOpen) {
+		return;
+	}
+	fileIsOpen = false;
+
+	uint64_t frameCountOffset = offsetof(TrajectoryFileHeader, frameCount);
+	uint64_t frameIndexOffsetOffset = sizeof(TrajectoryFileHeader) + offsetof(TrajectoryDeltaInfo, frameIndexOffset);
+	uint64_t indexBytes = encoding == TRAJECTORY_ENCODING_DELTA ? frameOffsets.size() * sizeof(uint64_t) : 0;
+	uint64_t frameIndexOffset = frameDataOffset + frameDataBytes;
+
+	if (file) {
+		flushBlock();
+		if (indexBytes) {
+			fwrite(frameOffsets.data(), 1, indexBytes, file);
+			fseek(file, (long)frameIndexOffsetOffset, SEEK_SET);
+			fwrite(&frameIndexOffset, sizeof(frameIndexOffset), 1, file);
+		}
+		fseek(file, (long)frameCountOffset, SEEK_SET);
+		fwrite(&frameCount, sizeof(frameCount), 1, file);
+		fclose(file);
+		file = nullptr;
+		block.clear();
+		block.shrink_to_fit();
+	}
+
+#ifndef _WIN32
+	if (fd >= 0) {
+		if (mapped && indexBytes && frameIndexOffset + indexBytes > mappedBytes && !growMapping(frameIndexOffset + indexBytes)) {
+			// no room for the index, the reader rebuilds it by scanning the records
+			indexBytes = 0;
+		}
+		if (mapped) {
+			if (indexBytes) {
+				memcpy(mapped + frameIndexOffset, frameOffsets.data(), indexBytes);
+				memcpy(mapped + frameIndexOffsetOffset, &frameIndexOffset, sizeof(frameIndexOffset));
+			}
+			memcpy(mapped + frameCountOffset, &frameCount, sizeof(frameCount));
+			munmap(mapped, mappedBytes);
+			mapped = nullptr;
+			mappedBytes = 0;
+		}
+		uint64_t usedBytes = frameIndexOffset + indexBytes;
+		if (ftruncate(fd, (off_t)usedBytes) != 0) {
+			std::cerr << "Failed to truncate trajectory file" << std::endl;
+		}
+		::close(fd);
+		fd = -1;
+	}
+#endif
+}
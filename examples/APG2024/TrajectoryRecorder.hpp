@@ -0,0 +1,137 @@
+#ifndef TRAJECTORY_RECORDER_HPP
+#define TRAJECTORY_RECORDER_HPP
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "TrajectoryFormat.hpp"
+
+#include "BulletDynamics/Dynamics/btRigidBody.h"
+
+// Writes binary trajectory files. Body names and shape metadata go into a fixed
+// header once, after that every tick appends one frame of channel-major scalars
+// (see TrajectoryFormat.hpp). Frames are gathered straight into a preallocated block
+// that is written out when full, or into a memory mapped view of the output file.
+// Use TrajectoryReader or App_TrajectoryToCsv to read the files back.
+//
+// setDeltaEncoding switches to keyframes plus quantized per body deltas, bodies that
+// are static, asleep or did not move are left out of the delta frames.
+class TrajectoryRecorder {
+
+	static std::filesystem::path dir;
+	std::string filePrefix;
+	std::string fileName;
+	std::filesystem::path filePath;
+
+	int framesPerBlock;
+	bool useMemoryMap;
+
+	int bodyCount = 0;
+	size_t frameScalars = 0;
+	// largest record a single frame can produce
+	size_t maxRecordBytes = 0;
+	uint64_t frameDataOffset = 0;
+	uint64_t frameDataBytes = 0;
+	uint64_t frameCount = 0;
+
+	// delta encoding
+	uint32_t encoding = TRAJECTORY_ENCODING_RAW;
+	TrajectoryDeltaInfo deltaInfo;
+	std::vector<btScalar> stagingFrame;
+	std::vector<unsigned char> stagingFlags;
+	// the state a decoder reconstructs for the last written frame
+	std::vector<double> reference;
+	std::vector<unsigned char> referenceFlags;
+	std::vector<uint64_t> frameOffsets;
+
+	// buffered output
+	FILE* file = nullptr;
+	std::vector<char> block;
+	size_t blockBytes = 0;
+
+	// memory mapped output
+	int fd = -1;
+	char* mapped = nullptr;
+	uint64_t mappedBytes = 0;
+
+	bool fileIsOpen = false;
+
+	bool openBuffered(const std::filesystem::path& path, const std::vector<char>& head);
+	bool openMapped(const std::filesystem::path& path, const std::vector<char>& head);
+	bool growMapping(uint64_t minBytes);
+	void flushBlock();
+
+	// output space for the next record, valid until commitBytes
+	char* reserveBytes(size_t bytes);
+	void commitBytes(size_t bytes);
+
+	bool encodeFrame(const btScalar* frame, const unsigned char* bodyFlags);
+
+public:
+
+	TrajectoryRecorder(const char* prefix, int framesPerBlock = 256, bool useMemoryMap = false)
+		: filePrefix(prefix), framesPerBlock(framesPerBlock > 0 ? framesPerBlock : 1), useMemoryMap(useMemoryMap) {
+		createDirectory();
+	}
+
+	static void createDirectory();
+
+	// the number of prefix_N.bttraj files in the output directory
+	int getFileCount() const;
+
+	// must be called before openFile. Writes to this file in the output directory instead of
+	// numbering the files of the prefix, for callers that run several recorders at once
+	void setFileName(const std::string& name) {
+		if (!fileIsOpen) {
+			fileName = name;
+		}
+	}
+
+	// the file of the last openFile, relative to the working directory
+	std::filesystem::path getFilePath() const {
+		return filePath;
+	}
+
+	// must be called before openFile. Quanta are the step sizes of the stored deltas for
+	// positions, quaternion components and linear/angular velocities.
+	void setDeltaEncoding(int keyframeInterval, double positionQuantum = 1e-5, double orientationQuantum = 1e-6, double velocityQuantum = 1e-4);
+
+	bool isOpen() const {
+		return fileIsOpen;
+	}
+
+	int getBodyCount() const {
+		return bodyCount;
+	}
+
+	uint64_t getFrameCount() const {
+		return frameCount;
+	}
+
+	// writes the header, does nothing if the file is already open
+	bool openFile(btRigidBody* const* bodies, const std::string* names, int count);
+
+	// returns storage for the next frame (TRAJECTORY_CHANNEL_COUNT * bodyCount scalars),
+	// the frame is committed by endFrame
+	btScalar* beginFrame();
+
+	// bodyFlags (BodyStateFlags per body) is optional and only used by the delta encoding.
+	// Returns false if the frame could not be stored, the file is closed with the frames
+	// recorded before it
+	bool endFrame(const unsigned char* bodyFlags = nullptr);
+
+	bool writeFrame(const btScalar* frame, const unsigned char* bodyFlags = nullptr);
+
+	// opens the file on the first call and records the current state of the bodies as the next frame
+	bool saveBodyInfo(btRigidBody** bodies, std::string* names, int count);
+
+	void closeFile();
+
+	~TrajectoryRecorder() {
+		closeFile();
+	}
+};
+
+#endif
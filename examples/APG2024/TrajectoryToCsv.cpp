@@ -0,0 +1,77 @@
+
+// Converts a binary trajectory (TrajectoryRecorder) into CSV: a row of body names and channel
+// names, then one row per frame with the channels of each body separated by an empty column.
+//
+//   App_TrajectoryToCsv input.bttraj [output.csv] [-p precision]
+
+#include "TrajectoryReader.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+	const char* inputPath = nullptr;
+	const char* outputPath = nullptr;
+	int precision = 6;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+			precision = atoi(argv[++i]);
+		} else if (!inputPath) {
+			inputPath = argv[i];
+		} else if (!outputPath) {
+			outputPath = argv[i];
+		}
+	}
+
+	if (!inputPath) {
+		std::cerr << "usage: " << argv[0] << " input.bttraj [output.csv] [-p precision]" << std::endl;
+		return 1;
+	}
+
+	TrajectoryReader reader;
+	if (!reader.open(inputPath)) {
+		return 1;
+	}
+
+	std::string csvPath = outputPath ? outputPath : std::string(inputPath) + ".csv";
+	FILE* csv = fopen(csvPath.c_str(), "w");
+	if (!csv) {
+		std::cerr << "Failed to open file: " << csvPath << std::endl;
+		return 1;
+	}
+
+	int bodyCount = reader.getBodyCount();
+
+	for (int i = 0; i < bodyCount; i++) {
+		fprintf(csv, "%s,", reader.getBodyName(i).c_str());
+		for (int c = 0; c < TRAJECTORY_CHANNEL_COUNT; c++) {
+			fprintf(csv, c + 1 < TRAJECTORY_CHANNEL_COUNT ? "%s," : "%s, ,", trajectoryChannelNames[c]);
+		}
+	}
+	fprintf(csv, "\n");
+
+	std::vector<double> frame;
+	for (uint64_t f = 0; f < reader.getFrameCount(); f++) {
+		if (!reader.readFrame(f, frame)) {
+			std::cerr << "Failed to read frame " << f << std::endl;
+			break;
+		}
+
+		for (int i = 0; i < bodyCount; i++) {
+			fprintf(csv, ",");
+			for (int c = 0; c < TRAJECTORY_CHANNEL_COUNT; c++) {
+				fprintf(csv, c + 1 < TRAJECTORY_CHANNEL_COUNT ? "%.*g," : "%.*g, ,", precision, reader.getValue(frame, c, i));
+			}
+		}
+		fprintf(csv, "\n");
+	}
+
+	fclose(csv);
+	return 0;
+}
@@ -295,6 +295,11 @@ public:
 			m_allocatedTaskSchedulers.push_back(ts);
 			addTaskScheduler(ts);
 		}
+		if (btITaskScheduler* ts = btCreateWorkStealingTaskScheduler())
+		{
+			m_allocatedTaskSchedulers.push_back(ts);
+			addTaskScheduler(ts);
+		}
 		addTaskScheduler(btGetOpenMPTaskScheduler());
 		addTaskScheduler(btGetTBBTaskScheduler());
 		addTaskScheduler(btGetPPLTaskScheduler());
@@ -532,6 +537,8 @@ void CommonRigidBodyMTBase::createEmptyDynamicsWorld()
 		btDefaultCollisionConstructionInfo cci;
 		cci.m_defaultMaxPersistentManifoldPoolSize = 80000;
 		cci.m_defaultMaxCollisionAlgorithmPoolSize = 80000;
+		cci.m_usePoolThreadCaches = true;
+		cci.m_growablePools = true;
 		m_collisionConfiguration = new btDefaultCollisionConfiguration(cci);
 
 		m_dispatcher = new MyCollisionDispatcher(m_collisionConfiguration, 40);
@@ -61,7 +61,7 @@
 #include "b3PluginManager.h"
 #include "../Extras/Serialize/BulletFileLoader/btBulletFile.h"
 #include "BulletCollision/NarrowPhaseCollision/btRaycastCallback.h"
-#include "LinearMath/TaskScheduler/btThreadSupportInterface.h"
+#include "LinearMath/btThreads.h"
 #include "Wavefront/tiny_obj_loader.h"
 #ifndef SKIP_COLLISION_FILTER_PLUGIN
 #include "plugins/collisionFilterPlugin/collisionFilterPlugin.h"
@@ -143,54 +143,6 @@ btScalar gRhsClamp = 1.f;
 
 #include "../CommonInterfaces/CommonFileIOInterface.h"
 
-class b3ThreadPool
-{
-public:
-	b3ThreadPool(const char* name = "b3ThreadPool")
-	{
-		btThreadSupportInterface::ConstructionInfo info(name, threadFunction);
-		m_threadSupportInterface = btThreadSupportInterface::create(info);
-	}
-
-	~b3ThreadPool()
-	{
-		delete m_threadSupportInterface;
-	}
-
-	const int numWorkers() const { return m_threadSupportInterface->getNumWorkerThreads(); }
-
-	void runTask(int threadIdx, btThreadSupportInterface::ThreadFunc func, void* arg)
-	{
-		FunctionContext& ctx = m_functionContexts[threadIdx];
-		ctx.func = func;
-		ctx.arg = arg;
-		m_threadSupportInterface->runTask(threadIdx, (void*)&ctx);
-	}
-
-	void waitForAllTasks()
-	{
-		BT_PROFILE("b3ThreadPool_waitForAllTasks");
-		m_threadSupportInterface->waitForAllTasks();
-	}
-
-private:
-	struct FunctionContext
-	{
-		btThreadSupportInterface::ThreadFunc func;
-		void* arg;
-	};
-
-	static void threadFunction(void* userPtr)
-	{
-		BT_PROFILE("b3ThreadPool_threadFunction");
-		FunctionContext* ctx = (FunctionContext*)userPtr;
-		ctx->func(ctx->arg);
-	}
-
-	btThreadSupportInterface* m_threadSupportInterface;
-	FunctionContext m_functionContexts[BT_MAX_THREAD_COUNT];
-};
-
 struct SharedMemoryDebugDrawer : public btIDebugDraw
 {
 	int m_debugMode;
@@ -1732,7 +1684,7 @@ struct PhysicsServerCommandProcessorInternalData
 	b3HashMap<b3HashString, char*> m_profileEvents;
 	b3HashMap<b3HashString, UrdfVisualShapeCache> m_cachedVUrdfisualShapes;
 
-	b3ThreadPool* m_threadPool;
+	btITaskScheduler* m_taskScheduler;  // casts ray batches, never installed with btSetTaskScheduler
 	btScalar m_defaultCollisionMargin;
 
 	double m_remoteSyncTransformTime;
@@ -1777,7 +1729,7 @@ struct PhysicsServerCommandProcessorInternalData
 		  m_pdControlPlugin(-1),
 		  m_collisionFilterPlugin(-1),
 		  m_grpcPlugin(-1),
-		  m_threadPool(0),
+		  m_taskScheduler(0),
 		  m_defaultCollisionMargin(0.001),
 		  m_remoteSyncTransformTime(1. / 30.),
 		  m_remoteSyncTransformInterval(1. / 30.),
@@ -2067,8 +2019,8 @@ PhysicsServerCommandProcessor::~PhysicsServerCommandProcessor()
 		char* event = *m_data->m_profileEvents.getAtIndex(i);
 		delete[] event;
 	}
-	if (m_data->m_threadPool)
-		delete m_data->m_threadPool;
+	if (m_data->m_taskScheduler)
+		delete m_data->m_taskScheduler;
 
 	for (int i = 0; i < m_data->m_savedStates.size(); i++)
 	{
@@ -6390,40 +6342,14 @@ bool PhysicsServerCommandProcessor::processRequestKeyboardEventsCommand(const st
 	return hasStatus;
 }
 
-#if __cplusplus >= 201103L
-#include <atomic>
-
-struct CastSyncInfo
-{
-	std::atomic<int> m_nextTaskNumber;
-
-	CastSyncInfo() : m_nextTaskNumber(0) {}
-
-	inline int getNextTask()
-	{
-		return m_nextTaskNumber++;
-	}
-};
-#else   // __cplusplus >= 201103L
-struct CastSyncInfo
+struct FilteredClosestRayResultCallback : public btCollisionWorld::ClosestRayResultCallback
 {
-	volatile int m_nextTaskNumber;
-	btSpinMutex m_taskLock;
-
-	CastSyncInfo() : m_nextTaskNumber(0) {}
-
-	inline int getNextTask()
+	FilteredClosestRayResultCallback()
+		: btCollisionWorld::ClosestRayResultCallback(btVector3(0, 0, 0), btVector3(0, 0, 0)),
+		  m_collisionFilterMask(-1)
 	{
-		m_taskLock.lock();
-		const int taskNr = m_nextTaskNumber++;
-		m_taskLock.unlock();
-		return taskNr;
 	}
-};
-#endif  // __cplusplus >= 201103L
 
-struct FilteredClosestRayResultCallback : public btCollisionWorld::ClosestRayResultCallback
-{
 	FilteredClosestRayResultCallback(const btVector3& rayFromWorld, const btVector3& rayToWorld, int collisionFilterMask)
 		: btCollisionWorld::ClosestRayResultCallback(rayFromWorld, rayToWorld),
 		  m_collisionFilterMask(collisionFilterMask)
@@ -6481,10 +6407,22 @@ struct FilteredAllHitsRayResultCallback : public btCollisionWorld::AllHitsRayRes
 	}
 };
 
-struct BatchRayCaster
+///scratch of one thread of BatchRayCaster
+struct BatchRayCasterThreadBuffer
+{
+	btAlignedObjectArray<btVector3> m_rayFrom;
+	btAlignedObjectArray<btVector3> m_rayTo;
+	btAlignedObjectArray<FilteredClosestRayResultCallback> m_results;
+	btAlignedObjectArray<btCollisionWorld::RayResultCallback*> m_resultPointers;
+};
+
+///BatchRayCaster casts the rays of a batch with parallelFor on the task scheduler of the command processor, or on the
+///calling thread without one. The scheduler is called directly and not installed with btSetTaskScheduler, which must be
+///called from the main thread. Each thread takes a range of rays and writes their hits straight into the output buffer.
+///Closest hits go through btCollisionWorld::rayTestBatch with the per-thread buffers, the hit number of m_reportHitNumber
+///needs all hits and casts one ray at a time
+struct BatchRayCaster : public btIParallelForBody
 {
-	b3ThreadPool* m_threadPool;
-	CastSyncInfo* m_syncInfo;
 	const btCollisionWorld* m_world;
 	const b3RayData* m_rayInputBuffer;
 	b3RayHitInfo* m_hitInfoOutputBuffer;
@@ -6492,70 +6430,73 @@ struct BatchRayCaster
 	int m_reportHitNumber;
 	int m_collisionFilterMask;
 	btScalar m_fractionEpsilon;
+	mutable btAlignedObjectArray<BatchRayCasterThreadBuffer> m_threadBuffers;
 
-	BatchRayCaster(b3ThreadPool* threadPool, const btCollisionWorld* world, const b3RayData* rayInputBuffer, b3RayHitInfo* hitInfoOutputBuffer, int numRays, int reportHitNumber, int collisionFilterMask, btScalar fractionEpsilon)
-		: m_threadPool(threadPool), m_world(world), m_rayInputBuffer(rayInputBuffer), m_hitInfoOutputBuffer(hitInfoOutputBuffer), m_numRays(numRays), m_reportHitNumber(reportHitNumber), m_collisionFilterMask(collisionFilterMask), m_fractionEpsilon(fractionEpsilon)
-	{
-		m_syncInfo = new CastSyncInfo;
-	}
-
-	~BatchRayCaster()
+	BatchRayCaster(const btCollisionWorld* world, const b3RayData* rayInputBuffer, b3RayHitInfo* hitInfoOutputBuffer, int numRays, int reportHitNumber, int collisionFilterMask, btScalar fractionEpsilon)
+		: m_world(world), m_rayInputBuffer(rayInputBuffer), m_hitInfoOutputBuffer(hitInfoOutputBuffer), m_numRays(numRays), m_reportHitNumber(reportHitNumber), m_collisionFilterMask(collisionFilterMask), m_fractionEpsilon(fractionEpsilon)
 	{
-		delete m_syncInfo;
 	}
 
-	void castRays(int numWorkers)
+	void castRays(btITaskScheduler* scheduler)
 	{
 #if BT_THREADSAFE
-		if (numWorkers <= 1)
-		{
-			castSequentially();
-		}
-		else
+		if (scheduler && scheduler->getNumThreads() > 1)
 		{
-			{
-				BT_PROFILE("BatchRayCaster_startingWorkerThreads");
-				int numTasks = btMin(m_threadPool->numWorkers(), numWorkers - 1);
-				for (int i = 0; i < numTasks; i++)
-				{
-					m_threadPool->runTask(i, BatchRayCaster::rayCastWorker, this);
-				}
-			}
-			rayCastWorker(this);
-			m_threadPool->waitForAllTasks();
+			BT_PROFILE("BatchRayCaster_parallelFor");
+			m_threadBuffers.resize(BT_MAX_THREAD_COUNT);
+			// about one range per thread of the scheduler, each a multiple of a ray packet and long enough to sort into coherent packets
+			const int numThreads = scheduler->getNumThreads();
+			int grainSize = btMax(64, (m_numRays + numThreads - 1) / numThreads);
+			grainSize = (grainSize + BT_RAY_PACKET_SIZE - 1) / BT_RAY_PACKET_SIZE * BT_RAY_PACKET_SIZE;
+			scheduler->parallelFor(0, m_numRays, grainSize, *this);
+			return;
 		}
-#else   // BT_THREADSAFE
-		castSequentially();
+#else
+		(void)scheduler;
 #endif  // BT_THREADSAFE
+		m_threadBuffers.resize(1);
+		forLoop(0, m_numRays);
 	}
 
-	static void rayCastWorker(void* arg)
+	virtual void forLoop(int iBegin, int iEnd) const
 	{
-		BT_PROFILE("BatchRayCaster_raycastWorker");
-		BatchRayCaster* const obj = (BatchRayCaster*)arg;
-		const int numRays = obj->m_numRays;
-		int taskNr;
-		while (true)
+		BT_PROFILE("BatchRayCaster_forLoop");
+		if (m_reportHitNumber >= 0)
 		{
+			for (int ray = iBegin; ray < iEnd; ray++)
 			{
-				BT_PROFILE("CastSyncInfo_getNextTask");
-				taskNr = obj->m_syncInfo->getNextTask();
+				processRay(ray);
 			}
-			if (taskNr >= numRays)
-				return;
-			obj->processRay(taskNr);
+			return;
 		}
-	}
 
-	void castSequentially()
-	{
-		for (int i = 0; i < m_numRays; i++)
+		// a thread that shares its index with another live thread uses a buffer of its own
+		BatchRayCasterThreadBuffer localBuffer;
+		const int threadIndex = m_threadBuffers.size() > 1 ? btGetUniqueThreadIndex() : 0;
+		BatchRayCasterThreadBuffer& buffer = threadIndex >= 0 ? m_threadBuffers[threadIndex] : localBuffer;
+		const int numRays = iEnd - iBegin;
+		buffer.m_rayFrom.resize(numRays);
+		buffer.m_rayTo.resize(numRays);
+		buffer.m_results.resize(numRays);
+		buffer.m_resultPointers.resize(numRays);
+		for (int i = 0; i < numRays; i++)
 		{
-			processRay(i);
+			const double* from = m_rayInputBuffer[iBegin + i].m_rayFromPosition;
+			const double* to = m_rayInputBuffer[iBegin + i].m_rayToPosition;
+			buffer.m_rayFrom[i].setValue(from[0], from[1], from[2]);
+			buffer.m_rayTo[i].setValue(to[0], to[1], to[2]);
+			buffer.m_results[i] = FilteredClosestRayResultCallback(buffer.m_rayFrom[i], buffer.m_rayTo[i], m_collisionFilterMask);
+			buffer.m_results[i].m_flags |= btTriangleRaycastCallback::kF_UseGjkConvexCastRaytest;
+			buffer.m_resultPointers[i] = &buffer.m_results[i];
+		}
+		m_world->rayTestBatch(&buffer.m_rayFrom[0], &buffer.m_rayTo[0], &buffer.m_resultPointers[0], numRays);
+		for (int i = 0; i < numRays; i++)
+		{
+			writeHit(m_hitInfoOutputBuffer[iBegin + i], buffer.m_results[i]);
 		}
 	}
 
-	void processRay(int ray)
+	void processRay(int ray) const
 	{
 		BT_PROFILE("BatchRayCaster_processRay");
 		const double* from = m_rayInputBuffer[ray].m_rayFromPosition;
@@ -6584,7 +6525,11 @@ struct BatchRayCaster
 			m_world->rayTest(rayFromWorld, rayToWorld, rayResultCallback);
 		}
 
-		b3RayHitInfo& hit = m_hitInfoOutputBuffer[ray];
+		writeHit(m_hitInfoOutputBuffer[ray], rayResultCallback);
+	}
+
+	static void writeHit(b3RayHitInfo& hit, const btCollisionWorld::ClosestRayResultCallback& rayResultCallback)
+	{
 		if (rayResultCallback.hasHit())
 		{
 			hit.m_hitFraction = rayResultCallback.m_closestHitFraction;
@@ -6639,12 +6584,12 @@ struct BatchRayCaster
 	}
 };
 
-void PhysicsServerCommandProcessor::createThreadPool()
+void PhysicsServerCommandProcessor::createTaskScheduler()
 {
 #ifdef BT_THREADSAFE
-	if (m_data->m_threadPool == 0)
+	if (m_data->m_taskScheduler == 0)
 	{
-		m_data->m_threadPool = new b3ThreadPool("PhysicsServerCommandProcessorThreadPool");
+		m_data->m_taskScheduler = btCreateDefaultTaskScheduler();
 	}
 #endif  //BT_THREADSAFE
 }
@@ -6668,9 +6613,15 @@ bool PhysicsServerCommandProcessor::processRequestRaycastIntersectionsCommand(co
 		// About 16 rays per thread seems to work reasonably well.
 		numThreads = btMax(1, totalRays / 16);
 	}
+	btITaskScheduler* scheduler = 0;
 	if (numThreads > 1)
 	{
-		createThreadPool();
+		createTaskScheduler();
+		scheduler = m_data->m_taskScheduler;
+		if (scheduler)
+		{
+			scheduler->setNumThreads(btMin(numThreads, scheduler->getMaxNumThreads()));
+		}
 	}
 
 	btAlignedObjectArray<b3RayData> rays;
@@ -6730,8 +6681,8 @@ bool PhysicsServerCommandProcessor::processRequestRaycastIntersectionsCommand(co
 		}
 	}
 
-	BatchRayCaster batchRayCaster(m_data->m_threadPool, m_data->m_dynamicsWorld, &rays[0], (b3RayHitInfo*)bufferServerToClient, totalRays, reportHitNumber, collisionFilterMask, fractionEpsilon);
-	batchRayCaster.castRays(numThreads);
+	BatchRayCaster batchRayCaster(m_data->m_dynamicsWorld, &rays[0], (b3RayHitInfo*)bufferServerToClient, totalRays, reportHitNumber, collisionFilterMask, fractionEpsilon);
+	batchRayCaster.castRays(scheduler);
 
 	serverStatusOut.m_numDataStreamBytes = totalRays * sizeof(b3RayData);
 	serverStatusOut.m_raycastHits.m_numRaycastHits = totalRays;
@@ -20,7 +20,7 @@ class PhysicsServerCommandProcessor : public CommandProcessorInterface
 	struct PhysicsServerCommandProcessorInternalData* m_data;
 
 	void resetSimulation(int flags = 0);
-	void createThreadPool();
+	void createTaskScheduler();
 
 	class btDeformableMultiBodyDynamicsWorld* getDeformableWorld();
 	class btSoftMultiBodyDynamicsWorld* getSoftWorld();
@@ -5,7 +5,11 @@
 #include "LinearMath/btAlignedObjectArray.h"
 #include "Bullet3Common/b3Logging.h"
 #include <stdio.h>
+#include <string.h>
 #include <climits>
+#include <atomic>
+#include <chrono>
+#include <thread>
 
 struct btTiming
 {
@@ -43,6 +47,15 @@ struct btTimings
 			int threadId = m_timings[m_activeBuffer][i].m_threadId;
 			unsigned long long int startTime = m_timings[m_activeBuffer][i].m_usStartTime;
 			unsigned long long int endTime = m_timings[m_activeBuffer][i].m_usEndTime;
+			char args[512] = "";
+			if (i < m_counters.size() && m_counters[i].m_values[BT_PROFILE_CYCLES])
+			{
+				const btProfileCounters& c = m_counters[i];
+				sprintf(args, "\"cycles\":%llu,\"instructions\":%llu,\"ipc\":%.3f,\"l1dMisses\":%llu,\"llcMisses\":%llu,\"branchMisses\":%llu",
+						c.m_values[BT_PROFILE_CYCLES], c.m_values[BT_PROFILE_INSTRUCTIONS],
+						double(c.m_values[BT_PROFILE_INSTRUCTIONS]) / double(c.m_values[BT_PROFILE_CYCLES]),
+						c.m_values[BT_PROFILE_L1D_MISSES], c.m_values[BT_PROFILE_LLC_MISSES], c.m_values[BT_PROFILE_BRANCH_MISSES]);
+			}
 
 			if (!m_firstTiming)
 			{
@@ -112,23 +125,24 @@ struct btTimings
 			sprintf(newname, "%s%d", name, counter2++);
 
 #ifdef _WIN32
-			fprintf(gTimingFile, "{\"cat\":\"timing\",\"pid\":1,\"tid\":%d,\"ts\":%I64d.%s ,\"ph\":\"B\",\"name\":\"%s\",\"args\":{}},\n",
-					threadId, startTimeDiv1000, startTimeRem1000Str, newname);
+			fprintf(gTimingFile, "{\"cat\":\"timing\",\"pid\":1,\"tid\":%d,\"ts\":%I64d.%s ,\"ph\":\"B\",\"name\":\"%s\",\"args\":{%s}},\n",
+					threadId, startTimeDiv1000, startTimeRem1000Str, newname, args);
 			fprintf(gTimingFile, "{\"cat\":\"timing\",\"pid\":1,\"tid\":%d,\"ts\":%I64d.%s ,\"ph\":\"E\",\"name\":\"%s\",\"args\":{}}",
 					threadId, endTimeDiv1000, endTimeRem1000Str, newname);
 #else
 			// Note: on 64b build, PRIu64 resolves in 'lu' whereas timings ('ts') have to be printed as 'llu'.
-			fprintf(gTimingFile, "{\"cat\":\"timing\",\"pid\":1,\"tid\":%d,\"ts\":%llu.%s ,\"ph\":\"B\",\"name\":\"%s\",\"args\":{}},\n",
-					threadId, startTimeDiv1000, startTimeRem1000Str, newname);
+			fprintf(gTimingFile, "{\"cat\":\"timing\",\"pid\":1,\"tid\":%d,\"ts\":%llu.%s ,\"ph\":\"B\",\"name\":\"%s\",\"args\":{%s}},\n",
+					threadId, startTimeDiv1000, startTimeRem1000Str, newname, args);
 			fprintf(gTimingFile, "{\"cat\":\"timing\",\"pid\":1,\"tid\":%d,\"ts\":%llu.%s ,\"ph\":\"E\",\"name\":\"%s\",\"args\":{}}",
 					threadId, endTimeDiv1000, endTimeRem1000Str, newname);
 #endif
 #endif
 		}
 		m_numTimings = 0;
+		m_counters.resizeNoInitialize(0);
 	}
 
-	void addTiming(const char* name, int threadId, unsigned long long int startTime, unsigned long long int endTime)
+	void addTiming(const char* name, int threadId, unsigned long long int startTime, unsigned long long int endTime, const btProfileCounters* counters = 0)
 	{
 		if (m_numTimings >= BT_TIMING_CAPACITY)
 		{
@@ -146,11 +160,28 @@ struct btTimings
 		m_timings[m_activeBuffer][slot].m_threadId = threadId;
 		m_timings[m_activeBuffer][slot].m_usStartTime = startTime;
 		m_timings[m_activeBuffer][slot].m_usEndTime = endTime;
+
+		// hardware counters are kept apart, only threads that have them pay for the memory
+		if (counters)
+		{
+			if (m_counters.capacity() == 0)
+			{
+				m_counters.reserve(BT_TIMING_CAPACITY);
+			}
+			btProfileCounters none;
+			memset(&none, 0, sizeof(none));
+			while (m_counters.size() < slot)
+			{
+				m_counters.push_back(none);
+			}
+			m_counters.push_back(*counters);
+		}
 	}
 
 	int m_numTimings;
 	int m_activeBuffer;
 	btAlignedObjectArray<btTiming> m_timings[1];
+	btAlignedObjectArray<btProfileCounters> m_counters;
 };
 //#ifndef BT_NO_PROFILE
 btTimings gTimings[BT_QUICKPROF_MAX_THREAD_COUNT];
@@ -158,6 +189,7 @@ btTimings gTimings[BT_QUICKPROF_MAX_THREAD_COUNT];
 int gStackDepths[BT_QUICKPROF_MAX_THREAD_COUNT] = {0};
 const char* gFuncNames[BT_QUICKPROF_MAX_THREAD_COUNT][MAX_NESTING];
 unsigned long long int gStartTimes[BT_QUICKPROF_MAX_THREAD_COUNT][MAX_NESTING];
+btAlignedObjectArray<btProfileCounters> gStartCounters[BT_QUICKPROF_MAX_THREAD_COUNT];
 //#endif
 
 btClock clk;
@@ -192,6 +224,18 @@ void MyEnterProfileZoneFunc(const char* msg)
 	{
 		gStartTimes[threadId][gStackDepths[threadId]] = 1 + gStartTimes[threadId][gStackDepths[threadId] - 1];
 	}
+	if (btProfileHardwareCountersEnabled())
+	{
+		if (gStartCounters[threadId].size() == 0)
+		{
+			gStartCounters[threadId].resize(MAX_NESTING);
+		}
+		btProfileCounters& counters = gStartCounters[threadId][gStackDepths[threadId]];
+		if (!btReadProfileHardwareCounters(counters))
+		{
+			counters.m_values[BT_PROFILE_CYCLES] = 0;
+		}
+	}
 	gStackDepths[threadId]++;
 
 }
@@ -215,7 +259,22 @@ void MyLeaveProfileZoneFunc()
 	unsigned long long int startTime = gStartTimes[threadId][gStackDepths[threadId]];
 
 	unsigned long long int endTime = clk.getTimeNanoseconds();
-	gTimings[threadId].addTiming(name, threadId, startTime, endTime);
+	btProfileCounters counters;
+	if (btProfileHardwareCountersEnabled() && gStartCounters[threadId].size() &&
+		gStartCounters[threadId][gStackDepths[threadId]].m_values[BT_PROFILE_CYCLES] &&
+		btReadProfileHardwareCounters(counters))
+	{
+		const btProfileCounters& start = gStartCounters[threadId][gStackDepths[threadId]];
+		for (int i = 0; i < BT_PROFILE_NUM_COUNTERS; i++)
+		{
+			counters.m_values[i] -= start.m_values[i];
+		}
+		gTimings[threadId].addTiming(name, threadId, startTime, endTime, &counters);
+	}
+	else
+	{
+		gTimings[threadId].addTiming(name, threadId, startTime, endTime);
+	}
 
 }
 
@@ -269,3 +328,98 @@ void b3ChromeUtilsEnableProfiling()
 {
 	gProfileDisabled = false;
 }
+
+static FILE* gStreamingFile = 0;
+static std::atomic<bool> gStreamingTimings(false);
+static std::thread gStreamingThread;
+static bool gFirstStreamedTiming = true;
+
+static void writeStreamedTimings()
+{
+	const int kMaxRecords = 4096;
+	static btProfileRecord records[kMaxRecords];
+	for (int threadId = 0; threadId < BT_QUICKPROF_MAX_THREAD_COUNT; threadId++)
+	{
+		int numRecords;
+		while ((numRecords = btDrainProfileRing(threadId, records, kMaxRecords)) > 0)
+		{
+			for (int i = 0; i < numRecords; i++)
+			{
+				unsigned long long int startTime = btProfileTicksToNanoseconds(records[i].m_startTicks);
+				unsigned long long int endTime = btProfileTicksToNanoseconds(records[i].m_endTicks);
+				if (endTime < startTime)
+				{
+					endTime = startTime;
+				}
+				unsigned long long int duration = endTime - startTime;
+				// complete events, times in microseconds with nanosecond fractions
+				fprintf(gStreamingFile, "%s{\"cat\":\"timing\",\"pid\":1,\"tid\":%d,\"ts\":%llu.%03u,\"dur\":%llu.%03u,\"ph\":\"X\",\"name\":\"%s\",\"args\":{}}",
+						gFirstStreamedTiming ? "" : ",\n", threadId, startTime / 1000, (unsigned int)(startTime % 1000),
+						duration / 1000, (unsigned int)(duration % 1000), records[i].m_name);
+				gFirstStreamedTiming = false;
+			}
+		}
+	}
+}
+
+static void streamTimingsLoop()
+{
+	while (gStreamingTimings.load())
+	{
+		writeStreamedTimings();
+		fflush(gStreamingFile);
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+}
+
+bool b3ChromeUtilsStartStreamingTimings(const char* fileName)
+{
+	if (gStreamingFile)
+	{
+		return false;
+	}
+	gStreamingFile = fopen(fileName, "w");
+	if (!gStreamingFile)
+	{
+		b3Printf("Error opening file");
+		b3Printf(fileName);
+		return false;
+	}
+	if (!btStartProfileRings())
+	{
+		b3Printf("Profile rings are not supported by this build");
+		fclose(gStreamingFile);
+		gStreamingFile = 0;
+		return false;
+	}
+	fprintf(gStreamingFile, "{\"traceEvents\":[\n");
+	gFirstStreamedTiming = true;
+	gStreamingTimings.store(true);
+	gStreamingThread = std::thread(streamTimingsLoop);
+	return true;
+}
+
+void b3ChromeUtilsStopStreamingTimings()
+{
+	if (!gStreamingFile)
+	{
+		return;
+	}
+	btStopProfileRings();
+	gStreamingTimings.store(false);
+	gStreamingThread.join();
+	// whatever was recorded after the last drain
+	writeStreamedTimings();
+	unsigned int numDropped = 0;
+	for (int threadId = 0; threadId < BT_QUICKPROF_MAX_THREAD_COUNT; threadId++)
+	{
+		numDropped += btGetProfileRingNumDropped(threadId);
+	}
+	if (numDropped)
+	{
+		b3Printf("%u timings were dropped because a profile ring was full", numDropped);
+	}
+	fprintf(gStreamingFile, "\n],\n\"displayTimeUnit\": \"ns\"}");
+	fclose(gStreamingFile);
+	gStreamingFile = 0;
+}
@@ -2,8 +2,15 @@
 #ifndef B3_CHROME_TRACE_UTIL_H
 #define B3_CHROME_TRACE_UTIL_H
 
+// with btEnableProfileHardwareCounters(true) each timing also carries the cycles, IPC and cache and
+// branch misses of its scope as event args
 void b3ChromeUtilsStartTimings();
 void b3ChromeUtilsStopTimingsAndWriteJsonFile(const char* fileNamePrefix);
 void b3ChromeUtilsEnableProfiling();
 
+// streams the BT_PROFILE scopes of all threads into a Chrome trace file while stepping continues,
+// a writer thread drains the btQuickprof profile rings
+bool b3ChromeUtilsStartStreamingTimings(const char* fileName);
+void b3ChromeUtilsStopStreamingTimings();
+
 #endif  //B3_CHROME_TRACE_UTIL_H
\ No newline at end of file
@@ -19,6 +19,7 @@ subject to the following restrictions:
 struct btDispatcherInfo;
 class btDispatcher;
 #include "btBroadphaseProxy.h"
+#include "LinearMath/btAabbUtil2.h"
 
 class btOverlappingPairCache;
 
@@ -41,6 +42,43 @@ protected:
 	btBroadphaseRayCallback() {}
 };
 
+///btBroadphaseRayPacketCallback is used by btBroadphaseInterface::rayTestPacket. The packet holds up to four rays, and
+///processPacket may lower the lambda_max of a ray in the packet as hits are found, to skip the rest of the tree behind them.
+struct btBroadphaseRayPacketCallback
+{
+	btRayPacket m_packet;
+	btVector3 m_rayTo[BT_RAY_PACKET_SIZE];
+
+	virtual ~btBroadphaseRayPacketCallback() {}
+	///rayMask has bit i set for each ray i of the packet that hits the aabb of the proxy
+	virtual void processPacket(const btBroadphaseProxy* proxy, int rayMask) = 0;
+};
+
+///tests a single ray of a packet with btBroadphaseInterface::rayTest
+struct btBroadphaseRayPacketLaneCallback : public btBroadphaseRayCallback
+{
+	btBroadphaseRayPacketCallback& m_packetCallback;
+	int m_lane;
+
+	btBroadphaseRayPacketLaneCallback(btBroadphaseRayPacketCallback& packetCallback, int lane)
+		: m_packetCallback(packetCallback),
+		  m_lane(lane)
+	{
+		m_rayDirectionInverse = packetCallback.m_packet.getRayDirectionInverse(lane);
+		m_signs[0] = m_rayDirectionInverse[0] < 0.0;
+		m_signs[1] = m_rayDirectionInverse[1] < 0.0;
+		m_signs[2] = m_rayDirectionInverse[2] < 0.0;
+		m_lambda_max = packetCallback.m_packet.m_lambda_max[lane];
+	}
+
+	virtual bool process(const btBroadphaseProxy* proxy)
+	{
+		m_packetCallback.processPacket(proxy, 1 << m_lane);
+		m_lambda_max = m_packetCallback.m_packet.m_lambda_max[m_lane];
+		return true;
+	}
+};
+
 #include "LinearMath/btVector3.h"
 
 ///The btBroadphaseInterface class provides an interface to detect aabb-overlapping object pairs.
@@ -60,6 +98,17 @@ public:
 
 	virtual void aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback) = 0;
 
+	///rayTestPacket reports the proxies hit by the rays of a packet. The default tests one ray at a time with rayTest,
+	///broadphases with a tree override it to walk the tree once for the whole packet
+	virtual void rayTestPacket(btBroadphaseRayPacketCallback& packetCallback)
+	{
+		for (int lane = 0; lane < packetCallback.m_packet.m_numRays; lane++)
+		{
+			btBroadphaseRayPacketLaneCallback laneCallback(packetCallback, lane);
+			rayTest(packetCallback.m_packet.getRayFrom(lane), packetCallback.m_rayTo[lane], laneCallback);
+		}
+	}
+
 	///calculateOverlappingPairs is optional: incremental algorithms (sweep and prune) might do it during the set aabb
 	virtual void calculateOverlappingPairs(btDispatcher* dispatcher) = 0;
 
@@ -15,6 +15,7 @@ subject to the following restrictions:
 ///btDbvt implementation by Nathanael Presson
 
 #include "btDbvt.h"
+#include "LinearMath/btThreads.h"
 
 //
 typedef btAlignedObjectArray<btDbvtNode*> tNodeArray;
@@ -74,6 +75,7 @@ static DBVT_INLINE void deletenode(btDbvt* pdbvt,
 {
 	btAlignedFree(pdbvt->m_free);
 	pdbvt->m_free = node;
+	++pdbvt->m_topology;
 }
 
 //
@@ -108,6 +110,7 @@ static DBVT_INLINE btDbvtNode* createnode(btDbvt* pdbvt,
 	node->parent = parent;
 	node->data = data;
 	node->childs[1] = 0;
+	++pdbvt->m_topology;
 	return (node);
 }
 
@@ -445,6 +448,299 @@ static DBVT_INLINE btDbvtNode* sort(btDbvtNode* n, btDbvtNode*& r)
 	return (n);
 }
 
+// half the surface area
+static DBVT_INLINE btScalar area(const btDbvtVolume& a)
+{
+	const btVector3 edges = a.Lengths();
+	return (edges.x() * edges.y() + edges.y() * edges.z() + edges.z() * edges.x());
+}
+
+// refits the internal nodes below root, returns the sum of their areas. nodes is scratch space,
+// the walk is iterative so that the depth of the tree does not matter.
+static btScalar refitsubtree(btDbvtNode* root, tNodeArray& nodes)
+{
+	nodes.resize(0);
+	if (root->isinternal()) nodes.push_back(root);
+	// breadth first, parents come before their children
+	for (int i = 0; i < nodes.size(); ++i)
+	{
+		if (nodes[i]->childs[0]->isinternal()) nodes.push_back(nodes[i]->childs[0]);
+		if (nodes[i]->childs[1]->isinternal()) nodes.push_back(nodes[i]->childs[1]);
+	}
+	btScalar cost = 0;
+	for (int i = nodes.size() - 1; i >= 0; --i)
+	{
+		btDbvtNode* node = nodes[i];
+		Merge(node->childs[0]->volume, node->childs[1]->volume, node->volume);
+		cost += area(node->volume);
+	}
+	return (cost);
+}
+
+//
+static void fetchsubtree(btDbvtNode* root, tNodeArray& leaves, tNodeArray& internals)
+{
+	if (root->isleaf())
+	{
+		leaves.push_back(root);
+		return;
+	}
+	internals.push_back(root);
+	for (int i = internals.size() - 1; i < internals.size(); ++i)
+	{
+		for (int j = 0; j < 2; ++j)
+		{
+			btDbvtNode* child = internals[i]->childs[j];
+			if (child->isinternal())
+				internals.push_back(child);
+			else
+				leaves.push_back(child);
+		}
+	}
+}
+
+#define DBVT_SAH_BINS 16
+
+//
+static DBVT_INLINE int sahbin(const btVector3& center, int axis, btScalar cmin, btScalar scale)
+{
+	const int bin = (int)((center[axis] - cmin) * scale);
+	return (btMin(bin, DBVT_SAH_BINS - 1));
+}
+
+// Reorders leaves and centers so that the first returned count go to the left child, splitting at
+// the bin boundary with the lowest surface area heuristic cost. Both sides get at least one leaf.
+static int sahpartition(btDbvtNode** leaves, btVector3* centers, int count)
+{
+	btVector3 cmin = centers[0];
+	btVector3 cmax = cmin;
+	for (int i = 1; i < count; ++i)
+	{
+		cmin.setMin(centers[i]);
+		cmax.setMax(centers[i]);
+	}
+	int bestaxis = -1;
+	int bestsplit = 0;
+	btScalar bestcost = SIMD_INFINITY;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		const btScalar extent = cmax[axis] - cmin[axis];
+		if (extent <= SIMD_EPSILON) continue;
+		const btScalar scale = DBVT_SAH_BINS / extent;
+		int counts[DBVT_SAH_BINS] = {0};
+		btDbvtVolume boxes[DBVT_SAH_BINS];
+		for (int i = 0; i < count; ++i)
+		{
+			const int bin = sahbin(centers[i], axis, cmin[axis], scale);
+			if (counts[bin]++)
+				Merge(boxes[bin], leaves[i]->volume, boxes[bin]);
+			else
+				boxes[bin] = leaves[i]->volume;
+		}
+		// cost of the bins right of each boundary
+		btScalar rightcost[DBVT_SAH_BINS];
+		btDbvtVolume box;
+		int n = 0;
+		for (int bin = DBVT_SAH_BINS - 1; bin > 0; --bin)
+		{
+			if (counts[bin])
+			{
+				if (n)
+					Merge(box, boxes[bin], box);
+				else
+					box = boxes[bin];
+				n += counts[bin];
+			}
+			rightcost[bin] = n ? area(box) * n : 0;
+		}
+		n = 0;
+		for (int bin = 0; bin < DBVT_SAH_BINS - 1; ++bin)
+		{
+			if (counts[bin])
+			{
+				if (n)
+					Merge(box, boxes[bin], box);
+				else
+					box = boxes[bin];
+				n += counts[bin];
+			}
+			if (n == 0 || n == count) continue;
+			const btScalar cost = area(box) * n + rightcost[bin + 1];
+			if (cost < bestcost)
+			{
+				bestcost = cost;
+				bestaxis = axis;
+				bestsplit = bin + 1;
+			}
+		}
+	}
+	if (bestaxis < 0) return (count / 2);
+	const btScalar scale = DBVT_SAH_BINS / (cmax[bestaxis] - cmin[bestaxis]);
+	int begin = 0;
+	int end = count;
+	while (begin < end)
+	{
+		if (sahbin(centers[begin], bestaxis, cmin[bestaxis], scale) < bestsplit)
+		{
+			++begin;
+		}
+		else
+		{
+			--end;
+			btSwap(leaves[begin], leaves[end]);
+			btSwap(centers[begin], centers[end]);
+		}
+	}
+	return (begin);
+}
+
+// a range of leaves that still has to be built, and where its root goes
+struct btDbvtSahRange
+{
+	int begin;
+	int count;
+	btDbvtNode* parent;
+	int slot;
+};
+
+// Builds a subtree over leaves with binned SAH splits. centers holds the leaf centers and is
+// reordered with them. The count-1 internal nodes are taken from internals, ranges is scratch
+// space. Iterative, so a run of unbalanced splits cannot overflow the stack.
+static btDbvtNode* binnedsah(btDbvtNode** leaves, btVector3* centers, int count, btDbvtNode** internals, btAlignedObjectArray<btDbvtSahRange>& ranges)
+{
+	if (count == 1) return (leaves[0]);
+	btDbvtNode* root = 0;
+	int numinternals = 0;
+	ranges.resize(0);
+	btDbvtSahRange all = {0, count, 0, 0};
+	ranges.push_back(all);
+	while (ranges.size())
+	{
+		const btDbvtSahRange range = ranges[ranges.size() - 1];
+		ranges.pop_back();
+		btDbvtNode* node;
+		if (range.count == 1)
+		{
+			node = leaves[range.begin];
+		}
+		else
+		{
+			// parents take their nodes before their children
+			node = internals[numinternals++];
+			const int partition = sahpartition(leaves + range.begin, centers + range.begin, range.count);
+			btDbvtSahRange left = {range.begin, partition, node, 0};
+			btDbvtSahRange right = {range.begin + partition, range.count - partition, node, 1};
+			ranges.push_back(right);
+			ranges.push_back(left);
+		}
+		node->parent = range.parent;
+		if (range.parent)
+			range.parent->childs[range.slot] = node;
+		else
+			root = node;
+	}
+	for (int i = numinternals - 1; i >= 0; --i)
+	{
+		btDbvtNode* node = internals[i];
+		Merge(node->childs[0]->volume, node->childs[1]->volume, node->volume);
+	}
+	return (root);
+}
+
+//
+static DBVT_INLINE btScalar subtreecost(btDbvtNode* root, tNodeArray& nodes)
+{
+	const btScalar cost = refitsubtree(root, nodes);
+	return (root->isinternal() ? cost / btMax(area(root->volume), SIMD_EPSILON) : 0);
+}
+
+//
+struct btDbvtRefitLoop : btIParallelForBody
+{
+	btDbvt::sRefitSubtree* subtrees;
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			subtrees[i].cost = subtreecost(subtrees[i].root, subtrees[i].nodes);
+		}
+	}
+};
+
+//
+struct btDbvtRebuildLoop : btIParallelForBody
+{
+	btDbvt* pdbvt;
+	const int* indices;
+	void forLoop(int iBegin, int iEnd) const
+	{
+		tNodeArray leaves;
+		tNodeArray internals;
+		btAlignedObjectArray<btVector3> centers;
+		btAlignedObjectArray<btDbvtSahRange> ranges;
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			btDbvt::sRefitSubtree& subtree = pdbvt->m_refitSubtrees[indices[i]];
+			btDbvtNode* parent = subtree.root->parent;
+			const int slot = parent ? indexof(subtree.root) : 0;
+			leaves.resize(0);
+			internals.resize(0);
+			fetchsubtree(subtree.root, leaves, internals);
+			centers.resize(leaves.size());
+			for (int j = 0; j < leaves.size(); ++j)
+			{
+				centers[j] = leaves[j]->volume.Center();
+			}
+			subtree.root = binnedsah(&leaves[0], &centers[0], leaves.size(), &internals[0], ranges);
+			subtree.root->parent = parent;
+			// subtrees sharing a parent write different slots
+			if (parent)
+				parent->childs[slot] = subtree.root;
+			else
+				pdbvt->m_root = subtree.root;
+			subtree.cost = subtree.buildcost = subtreecost(subtree.root, subtree.nodes);
+		}
+	}
+};
+
+#define DBVT_REFIT_SUBTREES 64
+
+// Splits the tree breadth first into about DBVT_REFIT_SUBTREES subtrees, independent of the number of threads
+static void choosesubtrees(btDbvt* pdbvt)
+{
+	pdbvt->m_refitTop.resize(0);
+	tNodeArray frontier;
+	tNodeArray next;
+	frontier.push_back(pdbvt->m_root);
+	bool expanded = true;
+	while (expanded && frontier.size() < DBVT_REFIT_SUBTREES)
+	{
+		expanded = false;
+		next.resize(0);
+		for (int i = 0; i < frontier.size(); ++i)
+		{
+			if (frontier[i]->isinternal())
+			{
+				pdbvt->m_refitTop.push_back(frontier[i]);
+				next.push_back(frontier[i]->childs[0]);
+				next.push_back(frontier[i]->childs[1]);
+				expanded = true;
+			}
+			else
+			{
+				next.push_back(frontier[i]);
+			}
+		}
+		if (expanded) frontier.copyFromArray(next);
+	}
+	pdbvt->m_refitSubtrees.resize(frontier.size());
+	for (int i = 0; i < frontier.size(); ++i)
+	{
+		pdbvt->m_refitSubtrees[i].root = frontier[i];
+	}
+	pdbvt->m_refitTopology = pdbvt->m_topology;
+}
+
 #if 0
 static DBVT_INLINE btDbvtNode*	walkup(btDbvtNode* n,int count)
 {
@@ -465,6 +761,8 @@ btDbvt::btDbvt()
 	m_lkhd = -1;
 	m_leaves = 0;
 	m_opath = 0;
+	m_topology = 0;
+	m_refitTopology = 0;
 }
 
 //
@@ -482,6 +780,8 @@ void btDbvt::clear()
 	m_free = 0;
 	m_lkhd = -1;
 	m_stkStack.clear();
+	m_refitTop.clear();
+	m_refitSubtrees.clear();
 	m_opath = 0;
 }
 
@@ -531,6 +831,41 @@ void btDbvt::optimizeIncremental(int passes)
 	}
 }
 
+//
+int btDbvt::refit(btScalar rebuildThreshold)
+{
+	if (!m_root) return (0);
+	// the first refit rebuilds all subtrees, later choices start from the cost they have
+	const bool first = m_refitSubtrees.size() == 0;
+	const bool choose = first || m_refitTopology != m_topology;
+	if (choose) choosesubtrees(this);
+	btDbvtRefitLoop refitLoop;
+	refitLoop.subtrees = &m_refitSubtrees[0];
+	btParallelForOrSerial(0, m_refitSubtrees.size(), 1, refitLoop);
+	btAlignedObjectArray<int> rebuilds;
+	for (int i = 0; i < m_refitSubtrees.size(); ++i)
+	{
+		sRefitSubtree& subtree = m_refitSubtrees[i];
+		// a subtree that was just chosen is measured against its own cost, not the one of the subtree that had its slot
+		if (choose) subtree.buildcost = subtree.cost;
+		if (rebuildThreshold > 0 && (first || subtree.cost > subtree.buildcost * rebuildThreshold))
+			rebuilds.push_back(i);
+	}
+	if (rebuilds.size())
+	{
+		btDbvtRebuildLoop rebuildLoop;
+		rebuildLoop.pdbvt = this;
+		rebuildLoop.indices = &rebuilds[0];
+		btParallelForOrSerial(0, rebuilds.size(), 1, rebuildLoop);
+	}
+	for (int i = m_refitTop.size() - 1; i >= 0; --i)
+	{
+		btDbvtNode* node = m_refitTop[i];
+		Merge(node->childs[0]->volume, node->childs[1]->volume, node->volume);
+	}
+	return (rebuilds.size());
+}
+
 //
 btDbvtNode* btDbvt::insert(const btDbvtVolume& volume, void* data)
 {
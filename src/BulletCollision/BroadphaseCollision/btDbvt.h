@@ -275,6 +275,7 @@ struct btDbvt
         DBVT_VIRTUAL void Process(const btDbvntNode*, const btDbvntNode*) {}
 		DBVT_VIRTUAL bool Descent(const btDbvtNode*) { return (true); }
 		DBVT_VIRTUAL bool AllLeaves(const btDbvtNode*) { return (true); }
+		DBVT_VIRTUAL void ProcessRays(const btDbvtNode*, int /*rayMask*/) {}
 	};
 	/* IWriter	*/
 	struct IWriter
@@ -298,14 +299,27 @@ struct btDbvt
 		DOUBLE_STACKSIZE = SIMPLE_STACKSIZE * 2
 	};
 
+	/* Subtree refit by one job of refit	*/
+	struct sRefitSubtree
+	{
+		btDbvtNode* root;
+		btScalar cost;       // sum of the internal node areas over the root area
+		btScalar buildcost;  // cost when the subtree was last chosen or rebuilt
+		btAlignedObjectArray<btDbvtNode*> nodes;  // scratch of the refit job, kept to avoid allocations
+	};
+
 	// Fields
 	btDbvtNode* m_root;
 	btDbvtNode* m_free;
 	int m_lkhd;
 	int m_leaves;
 	unsigned m_opath;
+	unsigned m_topology;  // changes whenever nodes are created or deleted
 
 	btAlignedObjectArray<sStkNN> m_stkStack;
+	btAlignedObjectArray<btDbvtNode*> m_refitTop;  // nodes above the subtrees, parents first
+	btAlignedObjectArray<sRefitSubtree> m_refitSubtrees;
+	unsigned m_refitTopology;  // m_topology when the subtrees were chosen
 
 	// Methods
 	btDbvt();
@@ -315,6 +329,12 @@ struct btDbvt
 	void optimizeBottomUp();
 	void optimizeTopDown(int bu_treshold = 128);
 	void optimizeIncremental(int passes);
+	///refit recomputes the volumes of all internal nodes bottom-up, after the leaf volumes were written directly instead of
+	///calling update for each leaf. The tree is split into subtrees that are refit with btParallelFor when a task scheduler is
+	///set in a BT_THREADSAFE build. The first refit rebuilds every subtree with a binned SAH split, reusing its nodes, and later
+	///refits rebuild a subtree whose cost grew by more than rebuildThreshold times since it was chosen or last rebuilt. The
+	///subtrees are chosen again after insert or remove. Returns the number of rebuilt subtrees, 0 never rebuilds.
+	int refit(btScalar rebuildThreshold = 0);
 	btDbvtNode* insert(const btDbvtVolume& box, void* data);
 	void update(btDbvtNode* leaf, int lookahead = -1);
 	void update(btDbvtNode* leaf, btDbvtVolume& volume);
@@ -402,6 +422,15 @@ struct btDbvt
 						 btAlignedObjectArray<const btDbvtNode*>& stack,
 						 DBVT_IPOLICY) const;
 
+	///rayTestPacket walks the tree once for all rays of a packet, and calls policy.ProcessRays for each leaf with the mask of
+	///the rays that hit it. The nearer child is visited first, and the policy may lower the lambda_max of a ray in the packet
+	///as hits are found to skip the nodes behind them
+	DBVT_PREFIX
+	void rayTestPacket(const btDbvtNode* root,
+					   btRayPacket& packet,
+					   btAlignedObjectArray<const btDbvtNode*>& stack,
+					   DBVT_IPOLICY) const;
+
 	DBVT_PREFIX
 	static void collideKDOP(const btDbvtNode* root,
 							const btVector3* normals,
@@ -1271,6 +1300,50 @@ inline void btDbvt::rayTestInternal(const btDbvtNode* root,
 	}
 }
 
+//
+DBVT_PREFIX
+inline void btDbvt::rayTestPacket(const btDbvtNode* root,
+								  btRayPacket& packet,
+								  btAlignedObjectArray<const btDbvtNode*>& stack,
+								  DBVT_IPOLICY) const
+{
+	DBVT_CHECKTYPE
+	if (root)
+	{
+		// the children are ordered along the direction of the first ray
+		const btVector3 direction(packet.m_rayDirectionInverse[0][0] < 0 ? btScalar(-1) : btScalar(1),
+								  packet.m_rayDirectionInverse[1][0] < 0 ? btScalar(-1) : btScalar(1),
+								  packet.m_rayDirectionInverse[2][0] < 0 ? btScalar(-1) : btScalar(1));
+		int depth = 1;
+		int treshold = DOUBLE_STACKSIZE - 2;
+		stack.resize(DOUBLE_STACKSIZE);
+		stack[0] = root;
+		do
+		{
+			const btDbvtNode* node = stack[--depth];
+			const int rayMask = btRayPacketAabb(packet, node->volume.Mins(), node->volume.Maxs(), 0);
+			if (rayMask)
+			{
+				if (node->isinternal())
+				{
+					if (depth > treshold)
+					{
+						stack.resize(stack.size() * 2);
+						treshold = stack.size() - 2;
+					}
+					const int nearer = direction.dot(node->childs[1]->volume.Center() - node->childs[0]->volume.Center()) < 0 ? 1 : 0;
+					stack[depth++] = node->childs[1 - nearer];
+					stack[depth++] = node->childs[nearer];
+				}
+				else
+				{
+					policy.ProcessRays(node, rayMask);
+				}
+			}
+		} while (depth);
+	}
+}
+
 //
 DBVT_PREFIX
 inline void btDbvt::rayTest(const btDbvtNode* root,
@@ -123,6 +123,173 @@ struct btDbvtTreeCollider : btDbvt::ICollide
 	}
 };
 
+/* Tree collider that runs on several threads at once	*/
+struct btDbvtConcurrentTreeCollider : btDbvt::ICollide
+{
+	btOverlappingPairCache* m_paircache;
+	int m_numPairs;
+	btDbvtConcurrentTreeCollider(btOverlappingPairCache* paircache) : m_paircache(paircache), m_numPairs(0) {}
+	void Process(const btDbvtNode* na, const btDbvtNode* nb)
+	{
+		if (na != nb)
+		{
+			m_paircache->addOverlappingPairConcurrent((btDbvtProxy*)na->data, (btDbvtProxy*)nb->data);
+			++m_numPairs;
+		}
+	}
+};
+
+/* Overlaps reported by one thread, padded so that threads do not share a cache line	*/
+struct btDbvtThreadPairCount
+{
+	int m_count;
+	char m_padding[64 - sizeof(int)];
+};
+
+/* Writes the volume of a leaf like btDbvt::update, but leaves the tree to btDbvt::refit	*/
+static bool setleafvolume(btDbvtNode* leaf, btDbvtVolume& volume, const btVector3& velocity, btScalar margin)
+{
+	if (leaf->volume.Contain(volume)) return (false);
+	volume.Expand(btVector3(margin, margin, margin));
+	volume.SignedExpand(velocity);
+	leaf->volume = volume;
+	return (true);
+}
+
+/* The wide copy of the fixed set, if it is enabled and up to date	*/
+static inline const btDbvtWide* widefixed(const btDbvtBroadphase* pbp)
+{
+	if (pbp->m_widefixed && pbp->m_widefixedset.m_topology == pbp->m_sets[1].m_topology)
+		return (&pbp->m_widefixedset);
+	return (0);
+}
+
+/* Splits collideTT(root0,root1) into node pairs that can be collided independently	*/
+static void splitCollideTT(const btDbvtNode* root0, const btDbvtNode* root1, int minJobs, btAlignedObjectArray<btDbvt::sStkNN>& jobs)
+{
+	jobs.resize(0);
+	if (!root0 || !root1)
+	{
+		return;
+	}
+	btAlignedObjectArray<btDbvt::sStkNN> next;
+	jobs.push_back(btDbvt::sStkNN(root0, root1));
+	bool expanded = true;
+	while (expanded && jobs.size() < minJobs)
+	{
+		expanded = false;
+		next.resize(0);
+		for (int i = 0; i < jobs.size(); ++i)
+		{
+			const btDbvt::sStkNN& p = jobs[i];
+			if (p.a == p.b)
+			{
+				if (p.a->isinternal())
+				{
+					next.push_back(btDbvt::sStkNN(p.a->childs[0], p.a->childs[0]));
+					next.push_back(btDbvt::sStkNN(p.a->childs[1], p.a->childs[1]));
+					next.push_back(btDbvt::sStkNN(p.a->childs[0], p.a->childs[1]));
+					expanded = true;
+				}
+			}
+			else if (Intersect(p.a->volume, p.b->volume))
+			{
+				if (p.a->isinternal() && p.b->isinternal())
+				{
+					next.push_back(btDbvt::sStkNN(p.a->childs[0], p.b->childs[0]));
+					next.push_back(btDbvt::sStkNN(p.a->childs[1], p.b->childs[0]));
+					next.push_back(btDbvt::sStkNN(p.a->childs[0], p.b->childs[1]));
+					next.push_back(btDbvt::sStkNN(p.a->childs[1], p.b->childs[1]));
+					expanded = true;
+				}
+				else if (p.a->isinternal())
+				{
+					next.push_back(btDbvt::sStkNN(p.a->childs[0], p.b));
+					next.push_back(btDbvt::sStkNN(p.a->childs[1], p.b));
+					expanded = true;
+				}
+				else if (p.b->isinternal())
+				{
+					next.push_back(btDbvt::sStkNN(p.a, p.b->childs[0]));
+					next.push_back(btDbvt::sStkNN(p.a, p.b->childs[1]));
+					expanded = true;
+				}
+				else
+				{
+					next.push_back(p);
+				}
+			}
+		}
+		jobs.copyFromArray(next);
+	}
+}
+
+struct btDbvtCollideTTLoop : public btIParallelForBody
+{
+	btDbvt* m_tree;
+	const btAlignedObjectArray<btDbvt::sStkNN>* m_jobs;
+	btOverlappingPairCache* m_paircache;
+	btDbvtThreadPairCount* m_counts;
+
+	btDbvtCollideTTLoop(btDbvt* tree, const btAlignedObjectArray<btDbvt::sStkNN>* jobs, btOverlappingPairCache* paircache, btDbvtThreadPairCount* counts)
+		: m_tree(tree),
+		  m_jobs(jobs),
+		  m_paircache(paircache),
+		  m_counts(counts)
+	{
+	}
+	void forLoop(int iBegin, int iEnd) const
+	{
+		btDbvtConcurrentTreeCollider collider(m_paircache);
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			// collideTT keeps its stack on the stack, unlike collideTTpersistentStack
+			m_tree->collideTT((*m_jobs)[i].a, (*m_jobs)[i].b, collider);
+		}
+		m_counts[btGetCurrentThreadIndex()].m_count += collider.m_numPairs;
+	}
+};
+
+/* Sums the overlaps reported by each thread	*/
+static int sumPairCounts(const btDbvtThreadPairCount* counts)
+{
+	int sum = 0;
+	for (unsigned int i = 0; i < BT_MAX_THREAD_COUNT; ++i)
+	{
+		sum += counts[i].m_count;
+	}
+	return (sum);
+}
+
+struct btDbvtCleanupLoop : public btIParallelForBody
+{
+	btBroadphasePairArray* m_pairs;
+	btOverlappingPairCache* m_paircache;
+	btDispatcher* m_dispatcher;
+	int m_first;
+
+	btDbvtCleanupLoop(btBroadphasePairArray* pairs, btOverlappingPairCache* paircache, btDispatcher* dispatcher, int first)
+		: m_pairs(pairs),
+		  m_paircache(paircache),
+		  m_dispatcher(dispatcher),
+		  m_first(first)
+	{
+	}
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			const btBroadphasePair& p = (*m_pairs)[(m_first + i) % m_pairs->size()];
+			btDbvtProxy* pa = (btDbvtProxy*)p.m_pProxy0;
+			btDbvtProxy* pb = (btDbvtProxy*)p.m_pProxy1;
+			if (!Intersect(pa->leaf->volume, pb->leaf->volume))
+			{
+				m_paircache->removeOverlappingPairConcurrent(pa, pb, m_dispatcher);
+			}
+		}
+	}
+};
+
 //
 // btDbvtBroadphase
 //
@@ -133,6 +300,11 @@ btDbvtBroadphase::btDbvtBroadphase(btOverlappingPairCache* paircache)
 	m_deferedcollide = false;
 	m_needcleanup = true;
 	m_releasepaircache = (paircache != 0) ? false : true;
+	m_parallelcollide = false;
+	m_bulkrefit = false;
+	m_needrefit = false;
+	m_rebuildthreshold = btScalar(1.5);
+	m_widefixed = false;
 	m_prediction = 0;
 	m_stageCurrent = 0;
 	m_fixedleft = 0;
@@ -191,12 +363,15 @@ btBroadphaseProxy* btDbvtBroadphase::createProxy(const btVector3& aabbMin,
 	proxy->m_uniqueId = ++m_gid;
 	proxy->leaf = m_sets[0].insert(aabb, proxy);
 	listappend(proxy, m_stageRoots[m_stageCurrent]);
-	if (!m_deferedcollide)
+	if (!m_deferedcollide && !m_paircache->rebuildsPairs())
 	{
 		btDbvtTreeCollider collider(this);
 		collider.proxy = proxy;
 		m_sets[0].collideTV(m_sets[0].m_root, aabb, collider);
-		m_sets[1].collideTV(m_sets[1].m_root, aabb, collider);
+		if (const btDbvtWide* wide = widefixed(this))
+			wide->collideTV(aabb, collider);
+		else
+			m_sets[1].collideTV(m_sets[1].m_root, aabb, collider);
 	}
 	return (proxy);
 }
@@ -271,16 +446,86 @@ void btDbvtBroadphase::rayTest(const btVector3& rayFrom, const btVector3& rayTo,
 							  *stack,
 							  callback);
 
-	m_sets[1].rayTestInternal(m_sets[1].m_root,
-							  rayFrom,
-							  rayTo,
-							  rayCallback.m_rayDirectionInverse,
-							  rayCallback.m_signs,
-							  rayCallback.m_lambda_max,
-							  aabbMin,
-							  aabbMax,
-							  *stack,
-							  callback);
+	if (const btDbvtWide* wide = widefixed(this))
+	{
+		wide->rayTest(rayFrom,
+					  rayCallback.m_rayDirectionInverse,
+					  rayCallback.m_signs,
+					  rayCallback.m_lambda_max,
+					  aabbMin,
+					  aabbMax,
+					  callback);
+	}
+	else
+	{
+		m_sets[1].rayTestInternal(m_sets[1].m_root,
+								  rayFrom,
+								  rayTo,
+								  rayCallback.m_rayDirectionInverse,
+								  rayCallback.m_signs,
+								  rayCallback.m_lambda_max,
+								  aabbMin,
+								  aabbMax,
+								  *stack,
+								  callback);
+	}
+}
+
+struct BroadphaseRayPacketTester : btDbvt::ICollide
+{
+	btBroadphaseRayPacketCallback& m_packetCallback;
+	int m_lane;  // the single ray of the packet that Process(leaf) reports for
+	BroadphaseRayPacketTester(btBroadphaseRayPacketCallback& packetCallback)
+		: m_packetCallback(packetCallback),
+		  m_lane(0)
+	{
+	}
+	void ProcessRays(const btDbvtNode* leaf, int rayMask)
+	{
+		btDbvtProxy* proxy = (btDbvtProxy*)leaf->data;
+		m_packetCallback.processPacket(proxy, rayMask);
+	}
+	void Process(const btDbvtNode* leaf)
+	{
+		btDbvtProxy* proxy = (btDbvtProxy*)leaf->data;
+		m_packetCallback.processPacket(proxy, 1 << m_lane);
+	}
+};
+
+void btDbvtBroadphase::rayTestPacket(btBroadphaseRayPacketCallback& packetCallback)
+{
+	BroadphaseRayPacketTester callback(packetCallback);
+	btAlignedObjectArray<const btDbvtNode*>* stack = &m_rayTestStacks[0];
+#if BT_THREADSAFE
+	// see rayTest
+	btAlignedObjectArray<const btDbvtNode*> localStack;
+	stack = &localStack;
+#endif
+
+	btRayPacket& packet = packetCallback.m_packet;
+	m_sets[0].rayTestPacket(m_sets[0].m_root, packet, *stack, callback);
+
+	if (const btDbvtWide* wide = widefixed(this))
+	{
+		// the wide tree takes the rays one at a time
+		for (int lane = 0; lane < packet.m_numRays; lane++)
+		{
+			const btVector3 rayDirectionInverse = packet.getRayDirectionInverse(lane);
+			const unsigned int signs[3] = {rayDirectionInverse[0] < 0.0, rayDirectionInverse[1] < 0.0, rayDirectionInverse[2] < 0.0};
+			callback.m_lane = lane;
+			wide->rayTest(packet.getRayFrom(lane),
+						  rayDirectionInverse,
+						  signs,
+						  packet.m_lambda_max[lane],
+						  btVector3(0, 0, 0),
+						  btVector3(0, 0, 0),
+						  callback);
+		}
+	}
+	else
+	{
+		m_sets[1].rayTestPacket(m_sets[1].m_root, packet, *stack, callback);
+	}
 }
 
 struct BroadphaseAabbTester : btDbvt::ICollide
@@ -304,7 +549,10 @@ void btDbvtBroadphase::aabbTest(const btVector3& aabbMin, const btVector3& aabbM
 	const ATTRIBUTE_ALIGNED16(btDbvtVolume) bounds = btDbvtVolume::FromMM(aabbMin, aabbMax);
 	//process all children, that overlap with  the given AABB bounds
 	m_sets[0].collideTV(m_sets[0].m_root, bounds, callback);
-	m_sets[1].collideTV(m_sets[1].m_root, bounds, callback);
+	if (const btDbvtWide* wide = widefixed(this))
+		wide->collideTV(bounds, callback);
+	else
+		m_sets[1].collideTV(m_sets[1].m_root, bounds, callback);
 }
 
 //
@@ -320,6 +568,7 @@ void btDbvtBroadphase::setAabb(btBroadphaseProxy* absproxy,
 	if (NotEqual(aabb, proxy->leaf->volume))
 #endif
 	{
+		const bool bulk = m_bulkrefit && m_deferedcollide;
 		bool docollide = false;
 		if (proxy->stage == STAGECOUNT)
 		{ /* fixed -> dynamic set	*/
@@ -339,7 +588,7 @@ void btDbvtBroadphase::setAabb(btBroadphaseProxy* absproxy,
 				if (delta[1] < 0) velocity[1] = -velocity[1];
 				if (delta[2] < 0) velocity[2] = -velocity[2];
 				if (
-					m_sets[0].update(proxy->leaf, aabb, velocity, gDbvtMargin)
+					bulk ? setleafvolume(proxy->leaf, aabb, velocity, gDbvtMargin) : m_sets[0].update(proxy->leaf, aabb, velocity, gDbvtMargin)
 
 				)
 				{
@@ -349,10 +598,14 @@ void btDbvtBroadphase::setAabb(btBroadphaseProxy* absproxy,
 			}
 			else
 			{ /* Teleporting			*/
-				m_sets[0].update(proxy->leaf, aabb);
+				if (bulk)
+					proxy->leaf->volume = aabb;
+				else
+					m_sets[0].update(proxy->leaf, aabb);
 				++m_updates_done;
 				docollide = true;
 			}
+			m_needrefit = m_needrefit || (bulk && docollide);
 		}
 		listremove(proxy, m_stageRoots[proxy->stage]);
 		proxy->m_aabbMin = aabbMin;
@@ -362,10 +615,14 @@ void btDbvtBroadphase::setAabb(btBroadphaseProxy* absproxy,
 		if (docollide)
 		{
 			m_needcleanup = true;
-			if (!m_deferedcollide)
+			if (!m_deferedcollide && !m_paircache->rebuildsPairs())
 			{
 				btDbvtTreeCollider collider(this);
-				m_sets[1].collideTTpersistentStack(m_sets[1].m_root, proxy->leaf, collider);
+				collider.proxy = proxy;
+				if (const btDbvtWide* wide = widefixed(this))
+					wide->collideTV(proxy->leaf->volume, collider);
+				else
+					m_sets[1].collideTTpersistentStack(m_sets[1].m_root, proxy->leaf, collider);
 				m_sets[0].collideTTpersistentStack(m_sets[0].m_root, proxy->leaf, collider);
 			}
 		}
@@ -392,7 +649,13 @@ void btDbvtBroadphase::setAabbForceUpdate(btBroadphaseProxy* absproxy,
 	{ /* dynamic set				*/
 		++m_updates_call;
 		/* Teleporting			*/
-		m_sets[0].update(proxy->leaf, aabb);
+		if (m_bulkrefit && m_deferedcollide)
+		{
+			proxy->leaf->volume = aabb;
+			m_needrefit = true;
+		}
+		else
+			m_sets[0].update(proxy->leaf, aabb);
 		++m_updates_done;
 		docollide = true;
 	}
@@ -404,10 +667,14 @@ void btDbvtBroadphase::setAabbForceUpdate(btBroadphaseProxy* absproxy,
 	if (docollide)
 	{
 		m_needcleanup = true;
-		if (!m_deferedcollide)
+		if (!m_deferedcollide && !m_paircache->rebuildsPairs())
 		{
 			btDbvtTreeCollider collider(this);
-			m_sets[1].collideTTpersistentStack(m_sets[1].m_root, proxy->leaf, collider);
+			collider.proxy = proxy;
+			if (const btDbvtWide* wide = widefixed(this))
+				wide->collideTV(proxy->leaf->volume, collider);
+			else
+				m_sets[1].collideTTpersistentStack(m_sets[1].m_root, proxy->leaf, collider);
 			m_sets[0].collideTTpersistentStack(m_sets[0].m_root, proxy->leaf, collider);
 		}
 	}
@@ -528,7 +795,15 @@ void btDbvtBroadphase::collide(btDispatcher* dispatcher)
 
 	SPC(m_profiling.m_total);
 	/* optimize				*/
-	m_sets[0].optimizeIncremental(1 + (m_sets[0].m_leaves * m_dupdates) / 100);
+	if (m_needrefit)
+	{
+		m_sets[0].refit(m_rebuildthreshold);
+		m_needrefit = false;
+	}
+	if (!(m_bulkrefit && m_deferedcollide))
+	{
+		m_sets[0].optimizeIncremental(1 + (m_sets[0].m_leaves * m_dupdates) / 100);
+	}
 	if (m_fixedleft)
 	{
 		const int count = 1 + (m_sets[1].m_leaves * m_fupdates) / 100;
@@ -564,13 +839,79 @@ void btDbvtBroadphase::collide(btDispatcher* dispatcher)
 		m_fixedleft = m_sets[1].m_leaves;
 		m_needcleanup = true;
 	}
+	if (m_widefixed && m_widefixedset.m_topology != m_sets[1].m_topology)
+	{
+		m_widefixedset.build(m_sets[1]);
+	}
+#if BT_THREADSAFE
+	const bool parallel = m_parallelcollide && m_paircache->supportsConcurrentPairs();
+#else
+	const bool parallel = false;
+#endif
+	if (m_paircache->rebuildsPairs())
+	{
+		/* report every overlapping pair, the cache drops the pairs that are not reported again	*/
+		SPC(m_profiling.m_fdcollide);
+		const btDbvtNode* roots[][2] = {{m_sets[0].m_root, m_sets[1].m_root},
+										{m_sets[0].m_root, m_sets[0].m_root},
+										{m_sets[1].m_root, m_sets[1].m_root}};
+		if (parallel)
+		{
+			const int minJobs = 16 * btGetTaskScheduler()->getNumThreads();
+			btAlignedObjectArray<btDbvt::sStkNN> jobs;
+			btDbvtThreadPairCount counts[BT_MAX_THREAD_COUNT] = {};
+			for (int i = 0; i < 3; i++)
+			{
+				splitCollideTT(roots[i][0], roots[i][1], minJobs, jobs);
+				btParallelFor(0, jobs.size(), 1, btDbvtCollideTTLoop(&m_sets[0], &jobs, m_paircache, counts));
+			}
+			m_newpairs += sumPairCounts(counts);
+		}
+		else
+		{
+			btDbvtConcurrentTreeCollider collider(m_paircache);
+			const btDbvtWide* wide = widefixed(this);
+			for (int i = 0; i < 3; i++)
+			{
+				if (i == 0 && wide)
+					wide->collideTT(m_sets[0].m_root, collider);
+				else
+					m_sets[0].collideTTpersistentStack(roots[i][0], roots[i][1], collider);
+			}
+			m_newpairs += collider.m_numPairs;
+		}
+		m_paircache->flushConcurrentPairs(dispatcher);
+		m_needcleanup = false;
+	}
 	/* collide dynamics		*/
+	else if (parallel)
+	{
+		if (m_deferedcollide)
+		{
+			SPC(m_profiling.m_fdcollide);
+			// a few jobs per thread, so that threads which get small subtrees pick up more
+			const int minJobs = 16 * btGetTaskScheduler()->getNumThreads();
+			btAlignedObjectArray<btDbvt::sStkNN> jobs;
+			btDbvtThreadPairCount counts[BT_MAX_THREAD_COUNT] = {};
+			splitCollideTT(m_sets[0].m_root, m_sets[1].m_root, minJobs, jobs);
+			btParallelFor(0, jobs.size(), 1, btDbvtCollideTTLoop(&m_sets[0], &jobs, m_paircache, counts));
+			splitCollideTT(m_sets[0].m_root, m_sets[0].m_root, minJobs, jobs);
+			btParallelFor(0, jobs.size(), 1, btDbvtCollideTTLoop(&m_sets[0], &jobs, m_paircache, counts));
+			// count every reported overlap like btDbvtTreeCollider does, not just the new pairs, so the cleanup window matches the serial path
+			m_newpairs += sumPairCounts(counts);
+			m_paircache->flushConcurrentPairs(dispatcher);
+		}
+	}
+	else
 	{
 		btDbvtTreeCollider collider(this);
 		if (m_deferedcollide)
 		{
 			SPC(m_profiling.m_fdcollide);
-			m_sets[0].collideTTpersistentStack(m_sets[0].m_root, m_sets[1].m_root, collider);
+			if (const btDbvtWide* wide = widefixed(this))
+				wide->collideTT(m_sets[0].m_root, collider);
+			else
+				m_sets[0].collideTTpersistentStack(m_sets[0].m_root, m_sets[1].m_root, collider);
 		}
 		if (m_deferedcollide)
 		{
@@ -583,7 +924,17 @@ void btDbvtBroadphase::collide(btDispatcher* dispatcher)
 	{
 		SPC(m_profiling.m_cleanup);
 		btBroadphasePairArray& pairs = m_paircache->getOverlappingPairArray();
-		if (pairs.size() > 0)
+		if (parallel && pairs.size() > 0)
+		{
+			int ni = btMin(pairs.size(), btMax<int>(m_newpairs, (pairs.size() * m_cupdates) / 100));
+			btParallelFor(0, ni, 256, btDbvtCleanupLoop(&pairs, m_paircache, dispatcher, m_cid));
+			int numPairs = pairs.size();
+			m_paircache->flushConcurrentPairs(dispatcher);
+			// the pairs that stayed move the window on
+			ni -= numPairs - pairs.size();
+			m_cid = pairs.size() > 0 ? (m_cid + ni) % pairs.size() : 0;
+		}
+		else if (pairs.size() > 0)
 		{
 			int ni = btMin(pairs.size(), btMax<int>(m_newpairs, (pairs.size() * m_cupdates) / 100));
 			for (int i = 0; i < ni; ++i)
@@ -670,9 +1021,11 @@ void btDbvtBroadphase::resetPool(btDispatcher* dispatcher)
 		//reset internal dynamic tree data structures
 		m_sets[0].clear();
 		m_sets[1].clear();
+		m_widefixedset.clear();
 
 		m_deferedcollide = false;
 		m_needcleanup = true;
+		m_needrefit = false;
 		m_stageCurrent = 0;
 		m_fixedleft = 0;
 		m_fupdates = 1;
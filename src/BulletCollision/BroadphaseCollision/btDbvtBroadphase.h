@@ -18,6 +18,7 @@ subject to the following restrictions:
 #define BT_DBVT_BROADPHASE_H
 
 #include "BulletCollision/BroadphaseCollision/btDbvt.h"
+#include "BulletCollision/BroadphaseCollision/btDbvtWide.h"
 #include "BulletCollision/BroadphaseCollision/btOverlappingPairCache.h"
 
 //
@@ -88,6 +89,12 @@ struct btDbvtBroadphase : btBroadphaseInterface
 	bool m_releasepaircache;                    // Release pair cache on delete
 	bool m_deferedcollide;                      // Defere dynamic/static collision to collide call
 	bool m_needcleanup;                         // Need to run cleanup?
+	bool m_parallelcollide;                     // Collide and clean up with btParallelFor, needs BT_THREADSAFE and a pair cache with concurrent pairs
+	bool m_bulkrefit;                           // Write dynamic leaves in setAabb and refit the dynamic set in collide, needs m_deferedcollide. Ray and aabb tests see the old tree until then
+	bool m_needrefit;                           // Need to refit the dynamic set?
+	btScalar m_rebuildthreshold;                // Cost growth that rebuilds a dynamic subtree in the refit, 0 to never rebuild
+	bool m_widefixed;                           // Query the fixed set through m_widefixedset, for scenes where the fixed set rarely changes
+	btDbvtWide m_widefixedset;                  // 4-wide copy of the fixed set, built again in collide after the fixed set changed
 	btAlignedObjectArray<btAlignedObjectArray<const btDbvtNode*> > m_rayTestStacks;
 #if DBVT_BP_PROFILE
 	btClock m_clock;
@@ -111,6 +118,7 @@ struct btDbvtBroadphase : btBroadphaseInterface
 	virtual void destroyProxy(btBroadphaseProxy* proxy, btDispatcher* dispatcher);
 	virtual void setAabb(btBroadphaseProxy* proxy, const btVector3& aabbMin, const btVector3& aabbMax, btDispatcher* dispatcher);
 	virtual void rayTest(const btVector3& rayFrom, const btVector3& rayTo, btBroadphaseRayCallback& rayCallback, const btVector3& aabbMin = btVector3(0, 0, 0), const btVector3& aabbMax = btVector3(0, 0, 0));
+	virtual void rayTestPacket(btBroadphaseRayPacketCallback& packetCallback);
 	virtual void aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback);
 
 	virtual void getAabb(btBroadphaseProxy* proxy, btVector3& aabbMin, btVector3& aabbMax) const;
@@ -0,0 +1,319 @@
+/*
+Copyright (c) 2003-2020 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btDbvtWide.h"
+
+#if !defined(BT_USE_DOUBLE_PRECISION) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+#define BT_DBVT_WIDE_USE_SSE 1
+#include <xmmintrin.h>
+#endif
+
+// queries keep their stack on the stack up to this size
+#define BT_DBVT_WIDE_STACKSIZE 256
+
+struct btDbvtWideStack
+{
+	int m_local[BT_DBVT_WIDE_STACKSIZE];
+	btAlignedObjectArray<int> m_heap;
+	int* m_stack;
+
+	btDbvtWideStack(int size) : m_stack(m_local)
+	{
+		if (size > BT_DBVT_WIDE_STACKSIZE)
+		{
+			m_heap.resize(size);
+			m_stack = &m_heap[0];
+		}
+	}
+};
+
+// half the surface area
+static SIMD_FORCE_INLINE btScalar wideArea(const btDbvtVolume& volume)
+{
+	const btVector3 edges = volume.Lengths();
+	return edges.x() * edges.y() + edges.y() * edges.z() + edges.z() * edges.x();
+}
+
+static int buildWideNode(btDbvtWide& wide, const btDbvtNode* node, int depth, int& maxDepth)
+{
+	const btDbvtNode* children[BT_DBVT_WIDE_WIDTH];
+	int count = 1;
+	children[0] = node;
+	// open the largest internal child until the node is full
+	while (count < BT_DBVT_WIDE_WIDTH)
+	{
+		int best = -1;
+		btScalar bestArea = -1;
+		for (int i = 0; i < count; i++)
+		{
+			if (children[i]->isinternal() && wideArea(children[i]->volume) > bestArea)
+			{
+				best = i;
+				bestArea = wideArea(children[i]->volume);
+			}
+		}
+		if (best < 0)
+		{
+			break;
+		}
+		const btDbvtNode* opened = children[best];
+		children[best] = opened->childs[0];
+		children[count++] = opened->childs[1];
+	}
+
+	const int index = wide.m_nodes.size();
+	wide.m_nodes.expandNonInitializing();
+	maxDepth = btMax(maxDepth, depth);
+	int childIndices[BT_DBVT_WIDE_WIDTH];
+	for (int i = 0; i < count; i++)
+	{
+		if (children[i]->isleaf())
+		{
+			childIndices[i] = ~wide.m_leaves.size();
+			wide.m_leaves.push_back(children[i]);
+		}
+		else
+		{
+			childIndices[i] = buildWideNode(wide, children[i], depth + 1, maxDepth);
+		}
+	}
+
+	// the recursion may have moved the nodes
+	btDbvtWideNode& wideNode = wide.m_nodes[index];
+	for (int i = 0; i < BT_DBVT_WIDE_WIDTH; i++)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			wideNode.m_mins[axis][i] = i < count ? children[i]->volume.Mins()[axis] : SIMD_INFINITY;
+			wideNode.m_maxs[axis][i] = i < count ? children[i]->volume.Maxs()[axis] : -SIMD_INFINITY;
+		}
+		wideNode.m_children[i] = i < count ? childIndices[i] : 0;
+	}
+	return index;
+}
+
+// one bit for each child that overlaps volume, the same test as Intersect
+static SIMD_FORCE_INLINE int overlapMask(const btDbvtWideNode& node, const btDbvtVolume& volume)
+{
+	const btVector3& mi = volume.Mins();
+	const btVector3& mx = volume.Maxs();
+#if BT_DBVT_WIDE_USE_SSE
+	__m128 result = _mm_and_ps(_mm_cmple_ps(_mm_set1_ps(mi.x()), _mm_load_ps(node.m_maxs[0])),
+							   _mm_cmpge_ps(_mm_set1_ps(mx.x()), _mm_load_ps(node.m_mins[0])));
+	result = _mm_and_ps(result, _mm_cmple_ps(_mm_set1_ps(mi.y()), _mm_load_ps(node.m_maxs[1])));
+	result = _mm_and_ps(result, _mm_cmpge_ps(_mm_set1_ps(mx.y()), _mm_load_ps(node.m_mins[1])));
+	result = _mm_and_ps(result, _mm_cmple_ps(_mm_set1_ps(mi.z()), _mm_load_ps(node.m_maxs[2])));
+	result = _mm_and_ps(result, _mm_cmpge_ps(_mm_set1_ps(mx.z()), _mm_load_ps(node.m_mins[2])));
+	return _mm_movemask_ps(result);
+#else
+	int mask = 0;
+	for (int i = 0; i < BT_DBVT_WIDE_WIDTH; i++)
+	{
+		if ((mi.x() <= node.m_maxs[0][i]) && (mx.x() >= node.m_mins[0][i]) &&
+			(mi.y() <= node.m_maxs[1][i]) && (mx.y() >= node.m_mins[1][i]) &&
+			(mi.z() <= node.m_maxs[2][i]) && (mx.z() >= node.m_mins[2][i]))
+		{
+			mask |= 1 << i;
+		}
+	}
+	return mask;
+#endif
+}
+
+// one bit for each child hit by the ray, the same test as btRayAabb2 on the bounds of btDbvt::rayTestInternal
+static SIMD_FORCE_INLINE int rayMask(const btDbvtWideNode& node,
+									 const btVector3& rayFrom,
+									 const btVector3& rayDirectionInverse,
+									 const unsigned int signs[3],
+									 btScalar lambda_max,
+									 const btVector3& aabbMin,
+									 const btVector3& aabbMax)
+{
+#if BT_DBVT_WIDE_USE_SSE
+	__m128 tmin = _mm_set1_ps(-SIMD_INFINITY);
+	__m128 tmax = _mm_set1_ps(SIMD_INFINITY);
+	for (int axis = 0; axis < 3; axis++)
+	{
+		// bounds[0] is mins-aabbMax and bounds[1] is maxs-aabbMin, the sign picks the near one
+		__m128 lower = _mm_sub_ps(_mm_load_ps(node.m_mins[axis]), _mm_set1_ps(aabbMax[axis]));
+		__m128 upper = _mm_sub_ps(_mm_load_ps(node.m_maxs[axis]), _mm_set1_ps(aabbMin[axis]));
+		const __m128 from = _mm_set1_ps(rayFrom[axis]);
+		const __m128 inv = _mm_set1_ps(rayDirectionInverse[axis]);
+		lower = _mm_mul_ps(_mm_sub_ps(lower, from), inv);
+		upper = _mm_mul_ps(_mm_sub_ps(upper, from), inv);
+		tmin = _mm_max_ps(tmin, signs[axis] ? upper : lower);
+		tmax = _mm_min_ps(tmax, signs[axis] ? lower : upper);
+	}
+	__m128 result = _mm_cmple_ps(tmin, tmax);
+	result = _mm_and_ps(result, _mm_cmplt_ps(tmin, _mm_set1_ps(lambda_max)));
+	result = _mm_and_ps(result, _mm_cmpgt_ps(tmax, _mm_setzero_ps()));
+	return _mm_movemask_ps(result);
+#else
+	int mask = 0;
+	for (int i = 0; i < BT_DBVT_WIDE_WIDTH; i++)
+	{
+		btScalar tmin = -SIMD_INFINITY;
+		btScalar tmax = SIMD_INFINITY;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			const btScalar lower = (node.m_mins[axis][i] - aabbMax[axis] - rayFrom[axis]) * rayDirectionInverse[axis];
+			const btScalar upper = (node.m_maxs[axis][i] - aabbMin[axis] - rayFrom[axis]) * rayDirectionInverse[axis];
+			tmin = btMax(tmin, signs[axis] ? upper : lower);
+			tmax = btMin(tmax, signs[axis] ? lower : upper);
+		}
+		if ((tmin <= tmax) && (tmin < lambda_max) && (tmax > 0))
+		{
+			mask |= 1 << i;
+		}
+	}
+	return mask;
+#endif
+}
+
+// reports the leaves of the wide tree that overlap one leaf of another tree
+struct btDbvtWideLeafCollider : btDbvt::ICollide
+{
+	const btDbvtNode* m_leaf;
+	btDbvt::ICollide& m_policy;
+	btDbvtWideLeafCollider(btDbvt::ICollide& policy) : m_leaf(0), m_policy(policy) {}
+	void Process(const btDbvtNode* n)
+	{
+		m_policy.Process(m_leaf, n);
+	}
+};
+
+btDbvtWide::btDbvtWide()
+	: m_stackSize(0),
+	  m_topology(0)
+{
+}
+
+void btDbvtWide::clear()
+{
+	m_nodes.resize(0);
+	m_leaves.resize(0);
+	m_stackSize = 0;
+}
+
+void btDbvtWide::build(const btDbvt& tree)
+{
+	clear();
+	m_topology = tree.m_topology;
+	if (tree.m_root)
+	{
+		m_nodes.reserve(tree.m_leaves / 2 + 1);
+		m_leaves.reserve(tree.m_leaves);
+		int maxDepth = 0;
+		buildWideNode(*this, tree.m_root, 1, maxDepth);
+		// each visited node replaces itself with up to all its children
+		m_stackSize = maxDepth * (BT_DBVT_WIDE_WIDTH - 1) + 1;
+	}
+}
+
+void btDbvtWide::collideTV(const btDbvtVolume& volume, btDbvt::ICollide& policy) const
+{
+	if (empty())
+	{
+		return;
+	}
+	btDbvtWideStack wideStack(m_stackSize);
+	int* stack = wideStack.m_stack;
+	int depth = 0;
+	stack[depth++] = 0;
+	do
+	{
+		const btDbvtWideNode& node = m_nodes[stack[--depth]];
+		const int mask = overlapMask(node, volume);
+		for (int i = 0; i < BT_DBVT_WIDE_WIDTH; i++)
+		{
+			if (mask & (1 << i))
+			{
+				const int child = node.m_children[i];
+				if (child < 0)
+				{
+					policy.Process(m_leaves[~child]);
+				}
+				else
+				{
+					stack[depth++] = child;
+				}
+			}
+		}
+	} while (depth);
+}
+
+void btDbvtWide::collideTT(const btDbvtNode* root, btDbvt::ICollide& policy) const
+{
+	if (!root || empty())
+	{
+		return;
+	}
+	// one wide query per leaf is cheaper than descending both trees together, the wide tree culls four boxes a step
+	btDbvtWideLeafCollider collider(policy);
+	btAlignedObjectArray<const btDbvtNode*> stack;
+	stack.push_back(root);
+	do
+	{
+		const btDbvtNode* n = stack[stack.size() - 1];
+		stack.pop_back();
+		if (n->isinternal())
+		{
+			stack.push_back(n->childs[0]);
+			stack.push_back(n->childs[1]);
+		}
+		else
+		{
+			collider.m_leaf = n;
+			collideTV(n->volume, collider);
+		}
+	} while (stack.size());
+}
+
+void btDbvtWide::rayTest(const btVector3& rayFrom,
+						 const btVector3& rayDirectionInverse,
+						 const unsigned int signs[3],
+						 btScalar lambda_max,
+						 const btVector3& aabbMin,
+						 const btVector3& aabbMax,
+						 btDbvt::ICollide& policy) const
+{
+	if (empty())
+	{
+		return;
+	}
+	btDbvtWideStack wideStack(m_stackSize);
+	int* stack = wideStack.m_stack;
+	int depth = 0;
+	stack[depth++] = 0;
+	do
+	{
+		const btDbvtWideNode& node = m_nodes[stack[--depth]];
+		const int mask = rayMask(node, rayFrom, rayDirectionInverse, signs, lambda_max, aabbMin, aabbMax);
+		for (int i = 0; i < BT_DBVT_WIDE_WIDTH; i++)
+		{
+			if (mask & (1 << i))
+			{
+				const int child = node.m_children[i];
+				if (child < 0)
+				{
+					policy.Process(m_leaves[~child]);
+				}
+				else
+				{
+					stack[depth++] = child;
+				}
+			}
+		}
+	} while (depth);
+}
@@ -0,0 +1,66 @@
+/*
+Copyright (c) 2003-2020 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_DBVT_WIDE_H
+#define BT_DBVT_WIDE_H
+
+#include "btDbvt.h"
+
+#define BT_DBVT_WIDE_WIDTH 4
+
+///a node of btDbvtWide, the child bounds are stored per axis so that one SIMD compare tests all children
+ATTRIBUTE_ALIGNED16(struct)
+btDbvtWideNode
+{
+	btScalar m_mins[3][BT_DBVT_WIDE_WIDTH];
+	btScalar m_maxs[3][BT_DBVT_WIDE_WIDTH];
+	///a node index, or ~index into the leaves for a leaf. Unused children have empty bounds that never overlap.
+	int m_children[BT_DBVT_WIDE_WIDTH];
+};
+
+///btDbvtWide is a read only copy of a btDbvt with 4 children per node, built by collapsing the binary tree. The nodes
+///are stored in one array in depth first order and a node visit tests all its children at once with SSE in single
+///precision builds, which saves most of the pointer chasing of the binary tree. The queries report the leaves of the
+///source btDbvt to the same ICollide callbacks. It suits trees that rarely change, such as the fixed set of
+///btDbvtBroadphase: build it again after the source tree changed, m_topology tells when.
+struct btDbvtWide
+{
+	btAlignedObjectArray<btDbvtWideNode> m_nodes;
+	btAlignedObjectArray<const btDbvtNode*> m_leaves;
+	int m_stackSize;      // stack entries needed by the queries
+	unsigned m_topology;  // btDbvt::m_topology of the source tree when it was built
+
+	btDbvtWide();
+
+	void build(const btDbvt& tree);
+	void clear();
+	bool empty() const { return m_nodes.size() == 0; }
+
+	///calls policy.Process(leaf) for each leaf that overlaps volume, like btDbvt::collideTV
+	void collideTV(const btDbvtVolume& volume, btDbvt::ICollide& policy) const;
+
+	///calls policy.Process(node, leaf) for each leaf below root that overlaps a leaf of this tree, like btDbvt::collideTT
+	void collideTT(const btDbvtNode* root, btDbvt::ICollide& policy) const;
+
+	///the same test as btDbvt::rayTestInternal, four children at a time
+	void rayTest(const btVector3& rayFrom,
+				 const btVector3& rayDirectionInverse,
+				 const unsigned int signs[3],
+				 btScalar lambda_max,
+				 const btVector3& aabbMin,
+				 const btVector3& aabbMax,
+				 btDbvt::ICollide& policy) const;
+};
+
+#endif  //BT_DBVT_WIDE_H
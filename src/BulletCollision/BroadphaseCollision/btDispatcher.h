@@ -47,7 +47,8 @@ struct btDispatcherInfo
 		  m_allowedCcdPenetration(btScalar(0.04)),
 		  m_useConvexConservativeDistanceUtil(false),
 		  m_convexConservativeDistanceThreshold(0.0f),
-		  m_deterministicOverlappingPairs(false)
+		  m_deterministicOverlappingPairs(false),
+		  m_frameArena(0)
 	{
 	}
 	btScalar m_timeStep;
@@ -63,6 +64,8 @@ struct btDispatcherInfo
 	bool m_useConvexConservativeDistanceUtil;
 	btScalar m_convexConservativeDistanceThreshold;
 	bool m_deterministicOverlappingPairs;
+	///transient memory for the current step, see btFrameArena. May be null
+	class btFrameArena* m_frameArena;
 };
 
 enum ebtDispatcherQueryType
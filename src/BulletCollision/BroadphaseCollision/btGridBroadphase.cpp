@@ -0,0 +1,400 @@
+/*
+Copyright (c) 2003-2020 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btGridBroadphase.h"
+#include "LinearMath/btAabbUtil2.h"
+#include "LinearMath/btThreads.h"
+#include "LinearMath/btQuickprof.h"
+
+#include <new>
+
+static int log2Of(int powerOfTwo)
+{
+	int bits = 0;
+	while ((1 << bits) < powerOfTwo)
+	{
+		bits++;
+	}
+	return bits;
+}
+
+// hashes the cell of the center of each small proxy, a large or free handle gets a key past the last cell
+struct btGridHashLoop : public btIParallelForBody
+{
+	btGridBroadphase* m_broadphase;
+	unsigned long long m_noCell;
+	btGridHashLoop(btGridBroadphase* broadphase, unsigned long long noCell) : m_broadphase(broadphase), m_noCell(noCell) {}
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int handle = iBegin; handle < iEnd; handle++)
+		{
+			const btGridBroadphaseProxy* proxy = m_broadphase->getProxy(handle);
+			btRadixSortEntry& entry = m_broadphase->m_entries[handle];
+			entry.m_value = handle;
+			if (!proxy || proxy->m_leaf)
+			{
+				entry.m_key = m_noCell;
+				continue;
+			}
+			const btVector3 center = (proxy->m_aabbMin + proxy->m_aabbMax) * btScalar(0.5);
+			entry.m_key = (unsigned long long)m_broadphase->getCellHash(m_broadphase->getCellCoord(center.x()), m_broadphase->getCellCoord(center.y()), m_broadphase->getCellCoord(center.z()));
+		}
+	}
+};
+
+// finds the first entry of each cell and copies the aabbs of the sorted entries
+struct btGridCellStartLoop : public btIParallelForBody
+{
+	btGridBroadphase* m_broadphase;
+	btGridCellStartLoop(btGridBroadphase* broadphase) : m_broadphase(broadphase) {}
+	void forLoop(int iBegin, int iEnd) const
+	{
+		const btAlignedObjectArray<btRadixSortEntry>& entries = m_broadphase->m_entries;
+		for (int i = iBegin; i < iEnd; i++)
+		{
+			if (i == 0 || entries[i].m_key != entries[i - 1].m_key)
+			{
+				m_broadphase->m_cellStart[int(entries[i].m_key)] = i;
+			}
+			const btHandleBroadphaseProxy* proxy = m_broadphase->m_proxies[entries[i].m_value];
+			m_broadphase->m_entryBounds[i * 2] = proxy->m_aabbMin;
+			m_broadphase->m_entryBounds[i * 2 + 1] = proxy->m_aabbMax;
+		}
+	}
+};
+
+// tests each small proxy against the later entries of the 27 cells around its own
+struct btGridPairLoop : public btIParallelForBody
+{
+	btGridBroadphase* m_broadphase;
+	btGridPairLoop(btGridBroadphase* broadphase) : m_broadphase(broadphase) {}
+	void forLoop(int iBegin, int iEnd) const
+	{
+		const btAlignedObjectArray<btRadixSortEntry>& entries = m_broadphase->m_entries;
+		const btAlignedObjectArray<int>& cellStart = m_broadphase->m_cellStart;
+		const btVector3* bounds = &m_broadphase->m_entryBounds[0];
+		const int numEntries = entries.size();
+		for (int i = iBegin; i < iEnd; i++)
+		{
+			const btVector3& aabbMin = bounds[i * 2];
+			const btVector3& aabbMax = bounds[i * 2 + 1];
+			const btVector3 center = (aabbMin + aabbMax) * btScalar(0.5);
+			const int x = m_broadphase->getCellCoord(center.x());
+			const int y = m_broadphase->getCellCoord(center.y());
+			const int z = m_broadphase->getCellCoord(center.z());
+			for (int dz = -1; dz <= 1; dz++)
+			{
+				for (int dy = -1; dy <= 1; dy++)
+				{
+					for (int dx = -1; dx <= 1; dx++)
+					{
+						const int hash = m_broadphase->getCellHash(x + dx, y + dy, z + dz);
+						const int start = cellStart[hash];
+						if (start < 0)
+						{
+							continue;
+						}
+						// each pair is reported by its first entry, cells that wrap onto the same hash fail the aabb test
+						for (int j = btMax(start, i + 1); j < numEntries && int(entries[j].m_key) == hash; j++)
+						{
+							if (TestAabbAgainstAabb2(aabbMin, aabbMax, bounds[j * 2], bounds[j * 2 + 1]))
+							{
+								m_broadphase->reportPair(m_broadphase->m_proxies[entries[i].m_value], m_broadphase->m_proxies[entries[j].m_value]);
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+};
+
+struct btGridLargeCollider : btDbvt::ICollide
+{
+	btGridBroadphase* m_broadphase;
+	btBroadphaseProxy* m_proxy;
+	btGridLargeCollider(btGridBroadphase* broadphase) : m_broadphase(broadphase), m_proxy(0) {}
+	void Process(const btDbvtNode* leaf)
+	{
+		m_broadphase->reportPair((btBroadphaseProxy*)leaf->data, m_proxy);
+	}
+	void Process(const btDbvtNode* leaf0, const btDbvtNode* leaf1)
+	{
+		m_broadphase->reportPair((btBroadphaseProxy*)leaf0->data, (btBroadphaseProxy*)leaf1->data);
+	}
+};
+
+// tests the small proxies against the tree of large proxies
+struct btGridLargeLoop : public btIParallelForBody
+{
+	btGridBroadphase* m_broadphase;
+	btGridLargeLoop(btGridBroadphase* broadphase) : m_broadphase(broadphase) {}
+	void forLoop(int iBegin, int iEnd) const
+	{
+		btGridLargeCollider collider(m_broadphase);
+		for (int i = iBegin; i < iEnd; i++)
+		{
+			collider.m_proxy = m_broadphase->m_proxies[m_broadphase->m_entries[i].m_value];
+			btDbvtVolume volume = btDbvtVolume::FromMM(m_broadphase->m_entryBounds[i * 2], m_broadphase->m_entryBounds[i * 2 + 1]);
+			m_broadphase->m_largeTree.collideTV(m_broadphase->m_largeTree.m_root, volume, collider);
+		}
+	}
+};
+
+template <typename Tester>
+struct btGridQueryCollider : btDbvt::ICollide
+{
+	Tester& m_tester;
+	btGridQueryCollider(Tester& tester) : m_tester(tester) {}
+	void Process(const btDbvtNode* leaf)
+	{
+		m_tester.process((btBroadphaseProxy*)leaf->data);
+	}
+};
+
+btGridBroadphase::btGridBroadphase(btScalar cellSize, int gridSize, btOverlappingPairCache* pairCache)
+	: btHandleBroadphase(pairCache),
+	  m_cellSize(cellSize),
+	  m_gridSize(4)
+{
+	// at least 4 cells per axis, so that the 27 cells around a cell have distinct hashes, and at most 256 to bound m_cellStart
+	while (m_gridSize < gridSize && m_gridSize < 256)
+	{
+		m_gridSize *= 2;
+	}
+	m_cellStart.resize(m_gridSize * m_gridSize * m_gridSize, -1);
+}
+
+btGridBroadphase::~btGridBroadphase()
+{
+}
+
+int btGridBroadphase::getCellCoord(btScalar x) const
+{
+	// the grid wraps, so only the low bits of the coordinate matter
+	btScalar coord = btScalar(floor(x / m_cellSize));
+	btClamp(coord, btScalar(-(1 << 30)), btScalar(1 << 30));
+	return int(coord);
+}
+
+btBroadphaseProxy* btGridBroadphase::createProxy(const btVector3& aabbMin, const btVector3& aabbMax, int /*shapeType*/, void* userPtr, int collisionFilterGroup, int collisionFilterMask, btDispatcher* /*dispatcher*/)
+{
+	btGridBroadphaseProxy* proxy = new (btAlignedAlloc(sizeof(btGridBroadphaseProxy), 16)) btGridBroadphaseProxy(aabbMin, aabbMax, userPtr, collisionFilterGroup, collisionFilterMask);
+	addHandle(proxy);
+	if (isSmall(aabbMin, aabbMax))
+	{
+		addMoved(proxy);
+	}
+	else
+	{
+		proxy->m_leaf = m_largeTree.insert(btDbvtVolume::FromMM(aabbMin, aabbMax), proxy);
+	}
+	return proxy;
+}
+
+void btGridBroadphase::destroyProxy(btBroadphaseProxy* absproxy, btDispatcher* dispatcher)
+{
+	btGridBroadphaseProxy* proxy = static_cast<btGridBroadphaseProxy*>(absproxy);
+	if (proxy->m_leaf)
+	{
+		m_largeTree.remove(proxy->m_leaf);
+	}
+	// a new proxy that takes the handle is moved or large, so the grid skips its entry
+	removeHandle(proxy, dispatcher);
+}
+
+void btGridBroadphase::setAabb(btBroadphaseProxy* absproxy, const btVector3& aabbMin, const btVector3& aabbMax, btDispatcher* /*dispatcher*/)
+{
+	btGridBroadphaseProxy* proxy = static_cast<btGridBroadphaseProxy*>(absproxy);
+	proxy->m_aabbMin = aabbMin;
+	proxy->m_aabbMax = aabbMax;
+	if (isSmall(aabbMin, aabbMax))
+	{
+		if (proxy->m_leaf)
+		{
+			m_largeTree.remove(proxy->m_leaf);
+			proxy->m_leaf = 0;
+		}
+		addMoved(proxy);
+	}
+	else
+	{
+		removeMoved(proxy);
+		btDbvtVolume volume = btDbvtVolume::FromMM(aabbMin, aabbMax);
+		if (proxy->m_leaf)
+		{
+			m_largeTree.update(proxy->m_leaf, volume);
+		}
+		else
+		{
+			proxy->m_leaf = m_largeTree.insert(volume, proxy);
+		}
+	}
+}
+
+void btGridBroadphase::buildGrid()
+{
+	BT_PROFILE("btGridBroadphase::buildGrid");
+	clearMoved();
+
+	// only the cells of the last grid hold entries
+	for (int i = 0; i < m_entries.size(); i++)
+	{
+		m_cellStart[int(m_entries[i].m_key)] = -1;
+	}
+
+	const int numHandles = m_proxies.size();
+	const int numCellBits = 3 * log2Of(m_gridSize);
+	const unsigned long long noCell = 1ULL << numCellBits;
+	m_entries.resize(numHandles);
+	btParallelForOrSerial(0, numHandles, 1024, btGridHashLoop(this, noCell));
+	btRadixSort(m_entries, m_sortScratch, numCellBits + 1);
+
+	// the large and free handles sort last
+	int numEntries = numHandles;
+	while (numEntries > 0 && m_entries[numEntries - 1].m_key == noCell)
+	{
+		numEntries--;
+	}
+	m_entries.resize(numEntries);
+	m_entryBounds.resize(numEntries * 2);
+	btParallelForOrSerial(0, numEntries, 1024, btGridCellStartLoop(this));
+}
+
+void btGridBroadphase::calculateOverlappingPairs(btDispatcher* dispatcher)
+{
+	BT_PROFILE("btGridBroadphase::calculateOverlappingPairs");
+	beginPairs(dispatcher);
+
+	buildGrid();
+	m_largeTree.optimizeIncremental(1);
+
+	btParallelForOrSerial(0, m_entries.size(), 256, btGridPairLoop(this));
+	if (m_largeTree.m_root)
+	{
+		btParallelForOrSerial(0, m_entries.size(), 256, btGridLargeLoop(this));
+		btGridLargeCollider collider(this);
+		m_largeTree.collideTT(m_largeTree.m_root, m_largeTree.m_root, collider);
+	}
+
+	endPairs(dispatcher);
+}
+
+template <typename Tester>
+void btGridBroadphase::queryGrid(const btVector3& boxMin, const btVector3& boxMax, Tester& tester) const
+{
+	// the large proxies are always current, the small proxies that moved since the last update are not in the grid
+	if (m_largeTree.m_root)
+	{
+		btGridQueryCollider<Tester> collider(tester);
+		m_largeTree.collideTV(m_largeTree.m_root, btDbvtVolume::FromMM(boxMin, boxMax), collider);
+	}
+	for (int i = 0; i < m_movedProxies.size(); i++)
+	{
+		if (TestAabbAgainstAabb2(boxMin, boxMax, m_movedProxies[i]->m_aabbMin, m_movedProxies[i]->m_aabbMax))
+		{
+			tester.process(m_movedProxies[i]);
+		}
+	}
+	if (!m_entries.size())
+	{
+		return;
+	}
+
+	// a small proxy that overlaps the box has its center within half a cell of it
+	const btVector3 half(m_cellSize * btScalar(0.5), m_cellSize * btScalar(0.5), m_cellSize * btScalar(0.5));
+	int lo[3];
+	int hi[3];
+	long long numCells = 1;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		lo[axis] = getCellCoord(boxMin[axis] - half[axis]);
+		hi[axis] = getCellCoord(boxMax[axis] + half[axis]);
+		// a range that wraps around the grid would visit cells twice
+		numCells *= btMin(hi[axis] - lo[axis] + 1, m_gridSize + 1);
+	}
+	const bool walkCells = hi[0] - lo[0] < m_gridSize && hi[1] - lo[1] < m_gridSize && hi[2] - lo[2] < m_gridSize && numCells <= m_entries.size();
+
+	// look the cells up when there are fewer of them than entries, otherwise test all entries
+	for (long long cellIndex = 0; cellIndex < (walkCells ? numCells : 1); cellIndex++)
+	{
+		int first = 0;
+		int end = m_entries.size();
+		if (walkCells)
+		{
+			long long cell = cellIndex;
+			int coords[3];
+			for (int axis = 2; axis >= 0; axis--)
+			{
+				const int size = hi[axis] - lo[axis] + 1;
+				coords[axis] = lo[axis] + int(cell % size);
+				cell /= size;
+			}
+			const int hash = getCellHash(coords[0], coords[1], coords[2]);
+			first = m_cellStart[hash];
+			if (first < 0)
+			{
+				continue;
+			}
+			end = first;
+			while (end < m_entries.size() && int(m_entries[end].m_key) == hash)
+			{
+				end++;
+			}
+		}
+		for (int i = first; i < end; i++)
+		{
+			btGridBroadphaseProxy* proxy = getProxy(m_entries[i].m_value);
+			if (!proxy || proxy->m_movedIndex >= 0 || proxy->m_leaf)
+			{
+				continue;
+			}
+			if (TestAabbAgainstAabb2(boxMin, boxMax, proxy->m_aabbMin, proxy->m_aabbMax))
+			{
+				tester.process(proxy);
+			}
+		}
+	}
+}
+
+void btGridBroadphase::rayTest(const btVector3& rayFrom, const btVector3& rayTo, btBroadphaseRayCallback& rayCallback, const btVector3& aabbMin, const btVector3& aabbMax)
+{
+	btVector3 boxMin = rayFrom;
+	btVector3 boxMax = rayFrom;
+	boxMin.setMin(rayTo);
+	boxMax.setMax(rayTo);
+	boxMin += aabbMin;
+	boxMax += aabbMax;
+	btHandleBroadphaseRayTester tester(rayFrom, aabbMin, aabbMax, rayCallback);
+	queryGrid(boxMin, boxMax, tester);
+}
+
+void btGridBroadphase::aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback)
+{
+	btHandleBroadphaseAabbTester tester(callback);
+	queryGrid(aabbMin, aabbMax, tester);
+}
+
+void btGridBroadphase::resetPool(btDispatcher* /*dispatcher*/)
+{
+	if (resetHandles())
+	{
+		for (int i = 0; i < m_entries.size(); i++)
+		{
+			m_cellStart[int(m_entries[i].m_key)] = -1;
+		}
+		m_entries.clear();
+		m_entryBounds.clear();
+	}
+}
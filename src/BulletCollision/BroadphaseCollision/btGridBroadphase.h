@@ -0,0 +1,97 @@
+/*
+Copyright (c) 2003-2020 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_GRID_BROADPHASE_H
+#define BT_GRID_BROADPHASE_H
+
+#include "btHandleBroadphase.h"
+#include "btDbvt.h"
+#include "LinearMath/btRadixSort.h"
+
+struct btGridBroadphaseProxy : public btHandleBroadphaseProxy
+{
+	btDbvtNode* m_leaf;  // the leaf in btGridBroadphase::m_largeTree, for a proxy larger than a cell
+
+	btGridBroadphaseProxy(const btVector3& aabbMin, const btVector3& aabbMax, void* userPtr, int collisionFilterGroup, int collisionFilterMask)
+		: btHandleBroadphaseProxy(aabbMin, aabbMax, userPtr, collisionFilterGroup, collisionFilterMask),
+		  m_leaf(0)
+	{
+	}
+};
+
+///btGridBroadphase is the CPU version of b3GpuGridBroadphase, a hashed uniform grid for many objects of similar size, such
+///as particles, debris and granular media. Each proxy that fits in a cell is hashed by the cell of its center, with the
+///grid wrapped around every m_gridSize cells. The entries are radix sorted by hash (see btRadixSort), and each proxy tests
+///the proxies of the 27 cells around its own. Hashing, sorting and the pair search run with btParallelFor when a task
+///scheduler is set in a BT_THREADSAFE build. Proxies larger than a cell live in a btDbvt that the small proxies query.
+///The proxies and pairs are kept by btHandleBroadphase, where the moved proxies are the small ones.
+class btGridBroadphase : public btHandleBroadphase
+{
+public:
+	btScalar m_cellSize;
+	int m_gridSize;  // cells along each axis before the grid wraps, a power of two from 4 to 256
+	btDbvt m_largeTree;
+
+	// the grid of the last calculateOverlappingPairs
+	btAlignedObjectArray<btRadixSortEntry> m_entries;  // a small proxy handle and the hash of its cell, by hash
+	btAlignedObjectArray<int> m_cellStart;             // the first entry of each hash, -1 for an empty cell
+	btAlignedObjectArray<btVector3> m_entryBounds;     // the aabb of each entry, lower and upper bound
+
+	// scratch
+	btAlignedObjectArray<btRadixSortEntry> m_sortScratch;
+
+	btGridBroadphase(btScalar cellSize = btScalar(1), int gridSize = 128, btOverlappingPairCache* pairCache = 0);
+	virtual ~btGridBroadphase();
+
+	virtual btBroadphaseProxy* createProxy(const btVector3& aabbMin, const btVector3& aabbMax, int shapeType, void* userPtr, int collisionFilterGroup, int collisionFilterMask, btDispatcher* dispatcher);
+	virtual void destroyProxy(btBroadphaseProxy* proxy, btDispatcher* dispatcher);
+	virtual void setAabb(btBroadphaseProxy* proxy, const btVector3& aabbMin, const btVector3& aabbMax, btDispatcher* dispatcher);
+
+	virtual void rayTest(const btVector3& rayFrom, const btVector3& rayTo, btBroadphaseRayCallback& rayCallback, const btVector3& aabbMin = btVector3(0, 0, 0), const btVector3& aabbMax = btVector3(0, 0, 0));
+	virtual void aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback);
+
+	virtual void calculateOverlappingPairs(btDispatcher* dispatcher);
+
+	virtual void resetPool(btDispatcher* dispatcher);
+
+	btGridBroadphaseProxy* getProxy(int handle) const
+	{
+		return static_cast<btGridBroadphaseProxy*>(m_proxies[handle]);
+	}
+
+	///the cell coordinate of a position along one axis, before wrapping
+	int getCellCoord(btScalar x) const;
+
+	int getCellHash(int x, int y, int z) const
+	{
+		const int mask = m_gridSize - 1;
+		return ((z & mask) * m_gridSize + (y & mask)) * m_gridSize + (x & mask);
+	}
+
+	///a proxy is small when it fits in a cell along every axis
+	bool isSmall(const btVector3& aabbMin, const btVector3& aabbMax) const
+	{
+		const btVector3 extents = aabbMax - aabbMin;
+		return extents.x() <= m_cellSize && extents.y() <= m_cellSize && extents.z() <= m_cellSize;
+	}
+
+private:
+	///calls tester.process for each proxy that overlaps the box, with the grid of the last calculateOverlappingPairs
+	template <typename Tester>
+	void queryGrid(const btVector3& boxMin, const btVector3& boxMax, Tester& tester) const;
+
+	void buildGrid();
+};
+
+#endif  //BT_GRID_BROADPHASE_H
@@ -0,0 +1,202 @@
+/*
+Copyright (c) 2003-2020 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btHandleBroadphase.h"
+#include "BulletCollision/BroadphaseCollision/btDispatcher.h"
+#include "LinearMath/btThreads.h"
+
+#include <new>
+
+// removes the pairs that stopped overlapping
+struct btHandleRemovePairCallback : public btOverlapCallback
+{
+	virtual bool processOverlap(btBroadphasePair& pair)
+	{
+		return !TestAabbAgainstAabb2(pair.m_pProxy0->m_aabbMin, pair.m_pProxy0->m_aabbMax, pair.m_pProxy1->m_aabbMin, pair.m_pProxy1->m_aabbMax);
+	}
+};
+
+btHandleBroadphase::btHandleBroadphase(btOverlappingPairCache* pairCache)
+	: m_pairCache(pairCache),
+	  m_ownsPairCache(false),
+	  m_uid(0),
+	  m_concurrentPairs(false)
+{
+	if (!m_pairCache)
+	{
+		void* mem = btAlignedAlloc(sizeof(btHashedOverlappingPairCache), 16);
+		m_pairCache = new (mem) btHashedOverlappingPairCache();
+		m_ownsPairCache = true;
+	}
+#if BT_THREADSAFE
+	m_threadPairs.resize(BT_MAX_THREAD_COUNT);
+#else
+	m_threadPairs.resize(1);
+#endif
+}
+
+btHandleBroadphase::~btHandleBroadphase()
+{
+	for (int i = 0; i < m_proxies.size(); i++)
+	{
+		if (m_proxies[i])
+		{
+			btAlignedFree(m_proxies[i]);
+		}
+	}
+	if (m_ownsPairCache)
+	{
+		m_pairCache->~btOverlappingPairCache();
+		btAlignedFree(m_pairCache);
+	}
+}
+
+void btHandleBroadphase::addHandle(btHandleBroadphaseProxy* proxy)
+{
+	proxy->m_uniqueId = ++m_uid;
+	if (m_freeHandles.size())
+	{
+		proxy->m_handle = m_freeHandles[m_freeHandles.size() - 1];
+		m_freeHandles.pop_back();
+		m_proxies[proxy->m_handle] = proxy;
+	}
+	else
+	{
+		proxy->m_handle = m_proxies.size();
+		m_proxies.push_back(proxy);
+	}
+}
+
+void btHandleBroadphase::removeHandle(btHandleBroadphaseProxy* proxy, btDispatcher* dispatcher)
+{
+	removeMoved(proxy);
+	m_pairCache->removeOverlappingPairsContainingProxy(proxy, dispatcher);
+	// the structure may still refer to the handle until the next calculateOverlappingPairs, and skips it while it is 0
+	m_proxies[proxy->m_handle] = 0;
+	m_freeHandles.push_back(proxy->m_handle);
+	btAlignedFree(proxy);
+}
+
+bool btHandleBroadphase::resetHandles()
+{
+	if (m_proxies.size() != m_freeHandles.size())
+	{
+		return false;
+	}
+	m_proxies.clear();
+	m_freeHandles.clear();
+	m_movedProxies.clear();
+	m_uid = 0;
+	return true;
+}
+
+void btHandleBroadphase::addMoved(btHandleBroadphaseProxy* proxy)
+{
+	if (proxy->m_movedIndex < 0)
+	{
+		proxy->m_movedIndex = m_movedProxies.size();
+		m_movedProxies.push_back(proxy);
+	}
+}
+
+void btHandleBroadphase::removeMoved(btHandleBroadphaseProxy* proxy)
+{
+	if (proxy->m_movedIndex >= 0)
+	{
+		btHandleBroadphaseProxy* last = m_movedProxies[m_movedProxies.size() - 1];
+		m_movedProxies[proxy->m_movedIndex] = last;
+		last->m_movedIndex = proxy->m_movedIndex;
+		m_movedProxies.pop_back();
+		proxy->m_movedIndex = -1;
+	}
+}
+
+void btHandleBroadphase::clearMoved()
+{
+	for (int i = 0; i < m_movedProxies.size(); i++)
+	{
+		m_movedProxies[i]->m_movedIndex = -1;
+	}
+	m_movedProxies.resize(0);
+}
+
+void btHandleBroadphase::getAabb(btBroadphaseProxy* proxy, btVector3& aabbMin, btVector3& aabbMax) const
+{
+	aabbMin = proxy->m_aabbMin;
+	aabbMax = proxy->m_aabbMax;
+}
+
+void btHandleBroadphase::getBroadphaseAabb(btVector3& aabbMin, btVector3& aabbMax) const
+{
+	aabbMin.setValue(BT_LARGE_FLOAT, BT_LARGE_FLOAT, BT_LARGE_FLOAT);
+	aabbMax.setValue(-BT_LARGE_FLOAT, -BT_LARGE_FLOAT, -BT_LARGE_FLOAT);
+	bool empty = true;
+	for (int i = 0; i < m_proxies.size(); i++)
+	{
+		if (m_proxies[i])
+		{
+			aabbMin.setMin(m_proxies[i]->m_aabbMin);
+			aabbMax.setMax(m_proxies[i]->m_aabbMax);
+			empty = false;
+		}
+	}
+	if (empty)
+	{
+		aabbMin.setValue(0, 0, 0);
+		aabbMax.setValue(0, 0, 0);
+	}
+}
+
+void btHandleBroadphase::reportPair(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1)
+{
+	if (m_concurrentPairs)
+	{
+		m_pairCache->addOverlappingPairConcurrent(proxy0, proxy1);
+	}
+	else
+	{
+		m_threadPairs[btGetCurrentThreadIndex()].push_back(btBroadphasePair(*proxy0, *proxy1));
+	}
+}
+
+void btHandleBroadphase::beginPairs(btDispatcher* dispatcher)
+{
+	if (!m_pairCache->rebuildsPairs())
+	{
+		btHandleRemovePairCallback removeCallback;
+		m_pairCache->processAllOverlappingPairs(&removeCallback, dispatcher);
+	}
+	m_concurrentPairs = m_pairCache->supportsConcurrentPairs();
+}
+
+void btHandleBroadphase::endPairs(btDispatcher* dispatcher)
+{
+	if (m_concurrentPairs)
+	{
+		m_pairCache->flushConcurrentPairs(dispatcher);
+		return;
+	}
+	for (int t = 0; t < m_threadPairs.size(); t++)
+	{
+		btBroadphasePairArray& pairs = m_threadPairs[t];
+		for (int i = 0; i < pairs.size(); i++)
+		{
+			if (!m_pairCache->findPair(pairs[i].m_pProxy0, pairs[i].m_pProxy1))
+			{
+				m_pairCache->addOverlappingPair(pairs[i].m_pProxy0, pairs[i].m_pProxy1);
+			}
+		}
+		pairs.resize(0);
+	}
+}
@@ -0,0 +1,129 @@
+/*
+Copyright (c) 2003-2020 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_HANDLE_BROADPHASE_H
+#define BT_HANDLE_BROADPHASE_H
+
+#include "btBroadphaseInterface.h"
+#include "btOverlappingPairCache.h"
+#include "LinearMath/btAabbUtil2.h"
+#include "LinearMath/btAlignedObjectArray.h"
+
+struct btHandleBroadphaseProxy : public btBroadphaseProxy
+{
+	int m_handle;      // index into btHandleBroadphase::m_proxies
+	int m_movedIndex;  // index into btHandleBroadphase::m_movedProxies, -1 while the broadphase holds the current aabb
+
+	btHandleBroadphaseProxy(const btVector3& aabbMin, const btVector3& aabbMax, void* userPtr, int collisionFilterGroup, int collisionFilterMask)
+		: btBroadphaseProxy(aabbMin, aabbMax, userPtr, collisionFilterGroup, collisionFilterMask),
+		  m_handle(-1),
+		  m_movedIndex(-1)
+	{
+	}
+};
+
+///btHandleBroadphase is the base of btRegionBroadphase and btGridBroadphase, which rebuild their structure from all proxies
+///in each calculateOverlappingPairs. It keeps the proxies by handle, so that the structure can refer to them by index, and
+///the proxies that were created or moved since the last update. The pair loops of the derived class call reportPair from
+///any thread, between beginPairs and endPairs, and the pair cache sees new and vanished pairs as with the other broadphases.
+class btHandleBroadphase : public btBroadphaseInterface
+{
+public:
+	btOverlappingPairCache* m_pairCache;
+	bool m_ownsPairCache;
+	int m_uid;
+	bool m_concurrentPairs;  // the pair cache supports concurrent pairs, set by beginPairs
+
+	btAlignedObjectArray<btHandleBroadphaseProxy*> m_proxies;  // by handle, 0 for a free handle
+	btAlignedObjectArray<int> m_freeHandles;
+	btAlignedObjectArray<btHandleBroadphaseProxy*> m_movedProxies;  // created or moved since the last calculateOverlappingPairs
+	btAlignedObjectArray<btBroadphasePairArray> m_threadPairs;
+
+	btHandleBroadphase(btOverlappingPairCache* pairCache);
+	virtual ~btHandleBroadphase();
+
+	virtual void getAabb(btBroadphaseProxy* proxy, btVector3& aabbMin, btVector3& aabbMax) const;
+
+	virtual btOverlappingPairCache* getOverlappingPairCache()
+	{
+		return m_pairCache;
+	}
+	virtual const btOverlappingPairCache* getOverlappingPairCache() const
+	{
+		return m_pairCache;
+	}
+
+	virtual void getBroadphaseAabb(btVector3& aabbMin, btVector3& aabbMax) const;
+
+	virtual void printStats()
+	{
+	}
+
+	///called from the pair loops, possibly on several threads at once
+	void reportPair(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1);
+
+protected:
+	///gives a new proxy its unique id and a handle
+	void addHandle(btHandleBroadphaseProxy* proxy);
+	///removes the pairs of the proxy, frees its handle and the proxy
+	void removeHandle(btHandleBroadphaseProxy* proxy, btDispatcher* dispatcher);
+	///clears the handles when all proxies are destroyed, returns false otherwise
+	bool resetHandles();
+
+	void addMoved(btHandleBroadphaseProxy* proxy);
+	void removeMoved(btHandleBroadphaseProxy* proxy);
+	///called when the structure holds the current aabbs of all proxies
+	void clearMoved();
+
+	///removes the pairs that stopped overlapping, unless the pair cache rebuilds its pairs
+	void beginPairs(btDispatcher* dispatcher);
+	///hands the reported pairs to the pair cache
+	void endPairs(btDispatcher* dispatcher);
+};
+
+///calls the callback for each proxy that it is given
+struct btHandleBroadphaseAabbTester
+{
+	btBroadphaseAabbCallback& m_callback;
+	btHandleBroadphaseAabbTester(btBroadphaseAabbCallback& callback) : m_callback(callback) {}
+	void process(btBroadphaseProxy* proxy)
+	{
+		m_callback.process(proxy);
+	}
+};
+
+///calls the callback for each proxy that it is given and that the ray hits
+struct btHandleBroadphaseRayTester
+{
+	const btVector3& m_rayFrom;
+	const btVector3& m_aabbMin;
+	const btVector3& m_aabbMax;
+	btBroadphaseRayCallback& m_callback;
+	btHandleBroadphaseRayTester(const btVector3& rayFrom, const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseRayCallback& callback)
+		: m_rayFrom(rayFrom), m_aabbMin(aabbMin), m_aabbMax(aabbMax), m_callback(callback) {}
+	void process(btBroadphaseProxy* proxy)
+	{
+		// the same test as btDbvt::rayTestInternal
+		btVector3 bounds[2];
+		bounds[0] = proxy->m_aabbMin - m_aabbMax;
+		bounds[1] = proxy->m_aabbMax - m_aabbMin;
+		btScalar tmin = 1.f;
+		if (btRayAabb2(m_rayFrom, m_callback.m_rayDirectionInverse, m_callback.m_signs, bounds, tmin, 0.f, m_callback.m_lambda_max))
+		{
+			m_callback.process(proxy);
+		}
+	}
+};
+
+#endif  //BT_HANDLE_BROADPHASE_H
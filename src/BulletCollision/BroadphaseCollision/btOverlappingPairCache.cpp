@@ -18,6 +18,8 @@ subject to the following restrictions:
 #include "btDispatcher.h"
 #include "btCollisionAlgorithm.h"
 #include "LinearMath/btAabbUtil2.h"
+#include "LinearMath/btThreads.h"
+#include "LinearMath/btQuickprof.h"
 
 #include <stdio.h>
 
@@ -26,7 +28,13 @@ btHashedOverlappingPairCache::btHashedOverlappingPairCache() : m_overlapFilterCa
 {
 	int initialAllocatedSize = 2;
 	m_overlappingPairArray.reserve(initialAllocatedSize);
-	growTables();
+#if BT_THREADSAFE
+	m_concurrentAdds.resize(BT_MAX_THREAD_COUNT + 1);
+	m_concurrentRemoves.resize(BT_MAX_THREAD_COUNT + 1);
+#else
+	m_concurrentAdds.resize(1);
+	m_concurrentRemoves.resize(1);
+#endif
 }
 
 btHashedOverlappingPairCache::~btHashedOverlappingPairCache()
@@ -109,20 +117,8 @@ btBroadphasePair* btHashedOverlappingPairCache::findPair(btBroadphaseProxy* prox
 	/*if (proxyId1 > proxyId2)
 		btSwap(proxyId1, proxyId2);*/
 
-	int hash = static_cast<int>(getHash(static_cast<unsigned int>(proxyId1), static_cast<unsigned int>(proxyId2)) & (m_overlappingPairArray.capacity() - 1));
-
-	if (hash >= m_hashTable.size())
-	{
-		return NULL;
-	}
-
-	int index = m_hashTable[hash];
-	while (index != BT_NULL_PAIR && equalsPair(m_overlappingPairArray[index], proxyId1, proxyId2) == false)
-	{
-		index = m_next[index];
-	}
-
-	if (index == BT_NULL_PAIR)
+	int index = internalFindPairIndex(proxyId1, proxyId2, getHash(static_cast<unsigned int>(proxyId1), static_cast<unsigned int>(proxyId2)));
+	if (index == BT_HASH_NULL)
 	{
 		return NULL;
 	}
@@ -132,45 +128,6 @@ btBroadphasePair* btHashedOverlappingPairCache::findPair(btBroadphaseProxy* prox
 	return &m_overlappingPairArray[index];
 }
 
-//#include <stdio.h>
-
-void btHashedOverlappingPairCache::growTables()
-{
-	int newCapacity = m_overlappingPairArray.capacity();
-
-	if (m_hashTable.size() < newCapacity)
-	{
-		//grow hashtable and next table
-		int curHashtableSize = m_hashTable.size();
-
-		m_hashTable.resize(newCapacity);
-		m_next.resize(newCapacity);
-
-		int i;
-
-		for (i = 0; i < newCapacity; ++i)
-		{
-			m_hashTable[i] = BT_NULL_PAIR;
-		}
-		for (i = 0; i < newCapacity; ++i)
-		{
-			m_next[i] = BT_NULL_PAIR;
-		}
-
-		for (i = 0; i < curHashtableSize; i++)
-		{
-			const btBroadphasePair& pair = m_overlappingPairArray[i];
-			int proxyId1 = pair.m_pProxy0->getUid();
-			int proxyId2 = pair.m_pProxy1->getUid();
-			/*if (proxyId1 > proxyId2) 
-				btSwap(proxyId1, proxyId2);*/
-			int hashValue = static_cast<int>(getHash(static_cast<unsigned int>(proxyId1), static_cast<unsigned int>(proxyId2)) & (m_overlappingPairArray.capacity() - 1));  // New hash value with new mask
-			m_next[i] = m_hashTable[hashValue];
-			m_hashTable[hashValue] = i;
-		}
-	}
-}
-
 btBroadphasePair* btHashedOverlappingPairCache::internalAddPair(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1)
 {
 	if (proxy0->m_uniqueId > proxy1->m_uniqueId)
@@ -181,47 +138,28 @@ btBroadphasePair* btHashedOverlappingPairCache::internalAddPair(btBroadphaseProx
 	/*if (proxyId1 > proxyId2) 
 		btSwap(proxyId1, proxyId2);*/
 
-	int hash = static_cast<int>(getHash(static_cast<unsigned int>(proxyId1), static_cast<unsigned int>(proxyId2)) & (m_overlappingPairArray.capacity() - 1));  // New hash value with new mask
+	unsigned int hash = getHash(static_cast<unsigned int>(proxyId1), static_cast<unsigned int>(proxyId2));
 
-	btBroadphasePair* pair = internalFindPair(proxy0, proxy1, hash);
-	if (pair != NULL)
+	int index = internalFindPairIndex(proxyId1, proxyId2, hash);
+	if (index != BT_HASH_NULL)
 	{
-		return pair;
+		return &m_overlappingPairArray[index];
 	}
-	/*for(int i=0;i<m_overlappingPairArray.size();++i)
-		{
-		if(	(m_overlappingPairArray[i].m_pProxy0==proxy0)&&
-			(m_overlappingPairArray[i].m_pProxy1==proxy1))
-			{
-			printf("Adding duplicated %u<>%u\r\n",proxyId1,proxyId2);
-			internalFindPair(proxy0, proxy1, hash);
-			}
-		}*/
+
 	int count = m_overlappingPairArray.size();
-	int oldCapacity = m_overlappingPairArray.capacity();
 	void* mem = &m_overlappingPairArray.expandNonInitializing();
 
 	//this is where we add an actual pair, so also call the 'ghost'
 	if (m_ghostPairCallback)
 		m_ghostPairCallback->addOverlappingPair(proxy0, proxy1);
 
-	int newCapacity = m_overlappingPairArray.capacity();
-
-	if (oldCapacity < newCapacity)
-	{
-		growTables();
-		//hash with new capacity
-		hash = static_cast<int>(getHash(static_cast<unsigned int>(proxyId1), static_cast<unsigned int>(proxyId2)) & (m_overlappingPairArray.capacity() - 1));
-	}
-
-	pair = new (mem) btBroadphasePair(*proxy0, *proxy1);
+	btBroadphasePair* pair = new (mem) btBroadphasePair(*proxy0, *proxy1);
 	//	pair->m_pProxy0 = proxy0;
 	//	pair->m_pProxy1 = proxy1;
 	pair->m_algorithm = 0;
 	pair->m_internalTmpValue = 0;
 
-	m_next[count] = m_hashTable[hash];
-	m_hashTable[hash] = count;
+	m_hashTable.insert(hash, count);
 
 	return pair;
 }
@@ -236,14 +174,16 @@ void* btHashedOverlappingPairCache::removeOverlappingPair(btBroadphaseProxy* pro
 	/*if (proxyId1 > proxyId2)
 		btSwap(proxyId1, proxyId2);*/
 
-	int hash = static_cast<int>(getHash(static_cast<unsigned int>(proxyId1), static_cast<unsigned int>(proxyId2)) & (m_overlappingPairArray.capacity() - 1));
+	unsigned int hash = getHash(static_cast<unsigned int>(proxyId1), static_cast<unsigned int>(proxyId2));
 
-	btBroadphasePair* pair = internalFindPair(proxy0, proxy1, hash);
-	if (pair == NULL)
+	int pairIndex = internalFindPairIndex(proxyId1, proxyId2, hash);
+	if (pairIndex == BT_HASH_NULL)
 	{
 		return 0;
 	}
+	btAssert(pairIndex < m_overlappingPairArray.size());
 
+	btBroadphasePair* pair = &m_overlappingPairArray[pairIndex];
 	cleanOverlappingPair(*pair, dispatcher);
 
 	void* userData = pair->m_internalInfo1;
@@ -251,29 +191,8 @@ void* btHashedOverlappingPairCache::removeOverlappingPair(btBroadphaseProxy* pro
 	btAssert(pair->m_pProxy0->getUid() == proxyId1);
 	btAssert(pair->m_pProxy1->getUid() == proxyId2);
 
-	int pairIndex = int(pair - &m_overlappingPairArray[0]);
-	btAssert(pairIndex < m_overlappingPairArray.size());
-
 	// Remove the pair from the hash table.
-	int index = m_hashTable[hash];
-	btAssert(index != BT_NULL_PAIR);
-
-	int previous = BT_NULL_PAIR;
-	while (index != pairIndex)
-	{
-		previous = index;
-		index = m_next[index];
-	}
-
-	if (previous != BT_NULL_PAIR)
-	{
-		btAssert(m_next[previous] == pairIndex);
-		m_next[previous] = m_next[pairIndex];
-	}
-	else
-	{
-		m_hashTable[hash] = m_next[pairIndex];
-	}
+	m_hashTable.remove(hash, pairIndex);
 
 	// We now move the last pair into spot of the
 	// pair being removed. We need to fix the hash
@@ -291,44 +210,106 @@ void* btHashedOverlappingPairCache::removeOverlappingPair(btBroadphaseProxy* pro
 		return userData;
 	}
 
-	// Remove the last pair from the hash table.
+	// The last pair now lives at pairIndex.
 	const btBroadphasePair* last = &m_overlappingPairArray[lastPairIndex];
 	/* missing swap here too, Nat. */
-	int lastHash = static_cast<int>(getHash(static_cast<unsigned int>(last->m_pProxy0->getUid()), static_cast<unsigned int>(last->m_pProxy1->getUid())) & (m_overlappingPairArray.capacity() - 1));
+	unsigned int lastHash = getHash(static_cast<unsigned int>(last->m_pProxy0->getUid()), static_cast<unsigned int>(last->m_pProxy1->getUid()));
+	m_hashTable.move(lastHash, lastPairIndex, pairIndex);
+
+	// Copy the last pair into the remove pair's spot.
+	m_overlappingPairArray[pairIndex] = m_overlappingPairArray[lastPairIndex];
+
+	m_overlappingPairArray.pop_back();
+
+	return userData;
+}
+
+// appends the pair to the array of the current thread. A thread that the thread counter wrapped onto may share its index
+// with another live thread, its pairs go to the last array under the lock
+static void pushConcurrentPair(btAlignedObjectArray<btBroadphasePairArray>& perThread, btSpinMutex& sharedMutex, btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1)
+{
+	int index = btGetUniqueThreadIndex();
+	if (index >= 0 && index < perThread.size() - 1)
+	{
+		perThread[index].push_back(btBroadphasePair(*proxy0, *proxy1));
+		return;
+	}
+	btMutexLock(&sharedMutex);
+	perThread[perThread.size() - 1].push_back(btBroadphasePair(*proxy0, *proxy1));
+	btMutexUnlock(&sharedMutex);
+}
+
+void btHashedOverlappingPairCache::addOverlappingPairConcurrent(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1)
+{
+	if (!needsBroadphaseCollision(proxy0, proxy1))
+		return;
 
-	index = m_hashTable[lastHash];
-	btAssert(index != BT_NULL_PAIR);
+	pushConcurrentPair(m_concurrentAdds, m_sharedPairsMutex, proxy0, proxy1);
+}
+
+void btHashedOverlappingPairCache::removeOverlappingPairConcurrent(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1, btDispatcher* /*dispatcher*/)
+{
+	pushConcurrentPair(m_concurrentRemoves, m_sharedPairsMutex, proxy0, proxy1);
+}
 
-	previous = BT_NULL_PAIR;
-	while (index != lastPairIndex)
+class btUidPairSortPredicate
+{
+public:
+	bool operator()(const btBroadphasePair& a, const btBroadphasePair& b) const
 	{
-		previous = index;
-		index = m_next[index];
+		return a.m_pProxy0->m_uniqueId < b.m_pProxy0->m_uniqueId ||
+			   (a.m_pProxy0->m_uniqueId == b.m_pProxy0->m_uniqueId && a.m_pProxy1->m_uniqueId < b.m_pProxy1->m_uniqueId);
 	}
+};
 
-	if (previous != BT_NULL_PAIR)
+// gathers the pairs of all threads, sorted by uid and without duplicates
+static void gatherConcurrentPairs(btAlignedObjectArray<btBroadphasePairArray>& perThread, btBroadphasePairArray& pairs)
+{
+	pairs.resize(0);
+	for (int i = 0; i < perThread.size(); i++)
 	{
-		btAssert(m_next[previous] == lastPairIndex);
-		m_next[previous] = m_next[lastPairIndex];
+		btBroadphasePairArray& threadPairs = perThread[i];
+		for (int j = 0; j < threadPairs.size(); j++)
+		{
+			pairs.push_back(threadPairs[j]);
+		}
+		threadPairs.resize(0);
 	}
-	else
+	if (pairs.size() > 1)
 	{
-		m_hashTable[lastHash] = m_next[lastPairIndex];
+		pairs.quickSort(btUidPairSortPredicate());
+		int numUnique = 1;
+		for (int i = 1; i < pairs.size(); i++)
+		{
+			if (!(pairs[i] == pairs[numUnique - 1]))
+			{
+				pairs[numUnique++] = pairs[i];
+			}
+		}
+		pairs.resize(numUnique);
 	}
+}
 
-	// Copy the last pair into the remove pair's spot.
-	m_overlappingPairArray[pairIndex] = m_overlappingPairArray[lastPairIndex];
-
-	// Insert the last pair into the hash table
-	m_next[pairIndex] = m_hashTable[lastHash];
-	m_hashTable[lastHash] = pairIndex;
-
-	m_overlappingPairArray.pop_back();
+int btHashedOverlappingPairCache::flushConcurrentPairs(btDispatcher* dispatcher)
+{
+	BT_PROFILE("btHashedOverlappingPairCache::flushConcurrentPairs");
+	gatherConcurrentPairs(m_concurrentRemoves, m_flushPairs);
+	for (int i = 0; i < m_flushPairs.size(); i++)
+	{
+		removeOverlappingPair(m_flushPairs[i].m_pProxy0, m_flushPairs[i].m_pProxy1, dispatcher);
+	}
 
-	return userData;
+	gatherConcurrentPairs(m_concurrentAdds, m_flushPairs);
+	int numPairs = m_overlappingPairArray.size();
+	m_hashTable.reserve(numPairs + m_flushPairs.size());
+	for (int i = 0; i < m_flushPairs.size(); i++)
+	{
+		internalAddPair(m_flushPairs[i].m_pProxy0, m_flushPairs[i].m_pProxy1);
+	}
+	return m_overlappingPairArray.size() - numPairs;
 }
+
 //#include <stdio.h>
-#include "LinearMath/btQuickprof.h"
 void btHashedOverlappingPairCache::processAllOverlappingPairs(btOverlapCallback* callback, btDispatcher* dispatcher)
 {
 	BT_PROFILE("btHashedOverlappingPairCache::processAllOverlappingPairs");
@@ -428,11 +409,6 @@ void btHashedOverlappingPairCache::sortOverlappingPairs(btDispatcher* dispatcher
 		removeOverlappingPair(tmpPairs[i].m_pProxy0, tmpPairs[i].m_pProxy1, dispatcher);
 	}
 
-	for (i = 0; i < m_next.size(); i++)
-	{
-		m_next[i] = BT_NULL_PAIR;
-	}
-
 	tmpPairs.quickSort(btBroadphasePairSortPredicate());
 
 	for (i = 0; i < tmpPairs.size(); i++)
@@ -609,3 +585,270 @@ void btSortedOverlappingPairCache::sortOverlappingPairs(btDispatcher* dispatcher
 {
 	//should already be sorted
 }
+
+btRadixSortedOverlappingPairCache::btRadixSortedOverlappingPairCache() : m_overlapFilterCallback(0),
+																		 m_ghostPairCallback(0)
+{
+	int initialAllocatedSize = 2;
+	m_overlappingPairArray.reserve(initialAllocatedSize);
+#if BT_THREADSAFE
+	m_reportedPairs.resize(BT_MAX_THREAD_COUNT + 1);
+#else
+	m_reportedPairs.resize(1);
+#endif
+}
+
+btRadixSortedOverlappingPairCache::~btRadixSortedOverlappingPairCache()
+{
+}
+
+// the order of the pair array
+static SIMD_FORCE_INLINE bool uidPairLess(const btBroadphasePair& a, const btBroadphasePair& b)
+{
+	return a.m_pProxy0->m_uniqueId < b.m_pProxy0->m_uniqueId ||
+		   (a.m_pProxy0->m_uniqueId == b.m_pProxy0->m_uniqueId && a.m_pProxy1->m_uniqueId < b.m_pProxy1->m_uniqueId);
+}
+
+int btRadixSortedOverlappingPairCache::findPairIndex(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1) const
+{
+	btBroadphasePair key(*proxy0, *proxy1);
+	int first = 0;
+	int last = m_overlappingPairArray.size();
+	while (first < last)
+	{
+		int mid = (first + last) / 2;
+		if (uidPairLess(m_overlappingPairArray[mid], key))
+		{
+			first = mid + 1;
+		}
+		else
+		{
+			last = mid;
+		}
+	}
+	if (first < m_overlappingPairArray.size() && m_overlappingPairArray[first] == key)
+	{
+		return first;
+	}
+	return -1;
+}
+
+void btRadixSortedOverlappingPairCache::cleanOverlappingPair(btBroadphasePair& pair, btDispatcher* dispatcher)
+{
+	if (pair.m_algorithm && dispatcher)
+	{
+		{
+			pair.m_algorithm->~btCollisionAlgorithm();
+			dispatcher->freeCollisionAlgorithm(pair.m_algorithm);
+			pair.m_algorithm = 0;
+		}
+	}
+}
+
+btBroadphasePair* btRadixSortedOverlappingPairCache::addOverlappingPair(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1)
+{
+	addOverlappingPairConcurrent(proxy0, proxy1);
+	return 0;
+}
+
+void btRadixSortedOverlappingPairCache::addOverlappingPairConcurrent(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1)
+{
+	if (!needsBroadphaseCollision(proxy0, proxy1))
+		return;
+
+	pushConcurrentPair(m_reportedPairs, m_sharedPairsMutex, proxy0, proxy1);
+}
+
+void btRadixSortedOverlappingPairCache::removeOverlappingPairConcurrent(btBroadphaseProxy* /*proxy0*/, btBroadphaseProxy* /*proxy1*/, btDispatcher* /*dispatcher*/)
+{
+}
+
+btBroadphasePair* btRadixSortedOverlappingPairCache::findPair(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1)
+{
+	int index = findPairIndex(proxy0, proxy1);
+	return index < 0 ? 0 : &m_overlappingPairArray[index];
+}
+
+void* btRadixSortedOverlappingPairCache::removeOverlappingPair(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1, btDispatcher* dispatcher)
+{
+	int index = findPairIndex(proxy0, proxy1);
+	if (index < 0)
+	{
+		return 0;
+	}
+	btBroadphasePair& pair = m_overlappingPairArray[index];
+	void* userData = pair.m_internalInfo1;
+	cleanOverlappingPair(pair, dispatcher);
+	if (m_ghostPairCallback)
+		m_ghostPairCallback->removeOverlappingPair(proxy0, proxy1, dispatcher);
+
+	// keep the array sorted
+	for (int i = index + 1; i < m_overlappingPairArray.size(); i++)
+	{
+		m_overlappingPairArray[i - 1] = m_overlappingPairArray[i];
+	}
+	m_overlappingPairArray.pop_back();
+	return userData;
+}
+
+void btRadixSortedOverlappingPairCache::processAllOverlappingPairs(btOverlapCallback* callback, btDispatcher* dispatcher)
+{
+	BT_PROFILE("btRadixSortedOverlappingPairCache::processAllOverlappingPairs");
+	// the callback may look up pairs, so the pairs to remove are only marked in the first pass
+	btAlignedObjectArray<int> removed;
+	for (int i = 0; i < m_overlappingPairArray.size(); i++)
+	{
+		if (callback->processOverlap(m_overlappingPairArray[i]))
+		{
+			removed.push_back(i);
+		}
+	}
+	if (removed.size() == 0)
+	{
+		return;
+	}
+	int numKept = 0;
+	for (int i = 0, r = 0; i < m_overlappingPairArray.size(); i++)
+	{
+		btBroadphasePair& pair = m_overlappingPairArray[i];
+		if (r < removed.size() && removed[r] == i)
+		{
+			r++;
+			cleanOverlappingPair(pair, dispatcher);
+			if (m_ghostPairCallback)
+				m_ghostPairCallback->removeOverlappingPair(pair.m_pProxy0, pair.m_pProxy1, dispatcher);
+		}
+		else
+		{
+			m_overlappingPairArray[numKept++] = pair;
+		}
+	}
+	m_overlappingPairArray.resize(numKept);
+}
+
+void btRadixSortedOverlappingPairCache::cleanProxyFromPairs(btBroadphaseProxy* proxy, btDispatcher* dispatcher)
+{
+	for (int i = 0; i < m_overlappingPairArray.size(); i++)
+	{
+		btBroadphasePair& pair = m_overlappingPairArray[i];
+		if (pair.m_pProxy0 == proxy || pair.m_pProxy1 == proxy)
+		{
+			cleanOverlappingPair(pair, dispatcher);
+		}
+	}
+}
+
+void btRadixSortedOverlappingPairCache::removeOverlappingPairsContainingProxy(btBroadphaseProxy* proxy, btDispatcher* dispatcher)
+{
+	class RemovePairCallback : public btOverlapCallback
+	{
+		btBroadphaseProxy* m_obsoleteProxy;
+
+	public:
+		RemovePairCallback(btBroadphaseProxy* obsoleteProxy)
+			: m_obsoleteProxy(obsoleteProxy)
+		{
+		}
+		virtual bool processOverlap(btBroadphasePair& pair)
+		{
+			return ((pair.m_pProxy0 == m_obsoleteProxy) ||
+					(pair.m_pProxy1 == m_obsoleteProxy));
+		}
+	};
+
+	RemovePairCallback removeCallback(proxy);
+
+	processAllOverlappingPairs(&removeCallback, dispatcher);
+
+	// the proxy is going away, so drop its reports too
+	for (int t = 0; t < m_reportedPairs.size(); t++)
+	{
+		btBroadphasePairArray& reported = m_reportedPairs[t];
+		int numKept = 0;
+		for (int i = 0; i < reported.size(); i++)
+		{
+			if (reported[i].m_pProxy0 != proxy && reported[i].m_pProxy1 != proxy)
+			{
+				reported[numKept++] = reported[i];
+			}
+		}
+		reported.resize(numKept);
+	}
+}
+
+void btRadixSortedOverlappingPairCache::sortOverlappingPairs(btDispatcher* /*dispatcher*/)
+{
+	//always sorted
+}
+
+int btRadixSortedOverlappingPairCache::flushConcurrentPairs(btDispatcher* dispatcher)
+{
+	BT_PROFILE("btRadixSortedOverlappingPairCache::flushConcurrentPairs");
+	m_flushPairs.resize(0);
+	int maxUid = 0;
+	for (int t = 0; t < m_reportedPairs.size(); t++)
+	{
+		btBroadphasePairArray& reported = m_reportedPairs[t];
+		for (int i = 0; i < reported.size(); i++)
+		{
+			m_flushPairs.push_back(reported[i]);
+			maxUid = btMax(maxUid, reported[i].m_pProxy1->m_uniqueId);
+		}
+		reported.resize(0);
+	}
+
+	// the key only needs as many bits as the largest uid, which saves radix passes
+	int uidBits = 1;
+	while (uidBits < 31 && (maxUid >> uidBits))
+	{
+		uidBits++;
+	}
+	m_sortEntries.resizeNoInitialize(m_flushPairs.size());
+	for (int i = 0; i < m_flushPairs.size(); i++)
+	{
+		m_sortEntries[i].m_key = ((unsigned long long)m_flushPairs[i].m_pProxy0->m_uniqueId << uidBits) | (unsigned long long)m_flushPairs[i].m_pProxy1->m_uniqueId;
+		m_sortEntries[i].m_value = i;
+	}
+	btRadixSort(m_sortEntries, m_sortScratch, 2 * uidBits);
+
+	// merge the sorted reports with the sorted pairs of the previous frame
+	m_mergedPairs.resize(0);
+	m_mergedPairs.reserve(m_flushPairs.size());
+	int numAdded = 0;
+	int i = 0;
+	int j = 0;
+	while (i < m_overlappingPairArray.size() || j < m_sortEntries.size())
+	{
+		const btBroadphasePair* reported = j < m_sortEntries.size() ? &m_flushPairs[m_sortEntries[j].m_value] : 0;
+		btBroadphasePair* previous = i < m_overlappingPairArray.size() ? &m_overlappingPairArray[i] : 0;
+		if (!reported || (previous && uidPairLess(*previous, *reported)))
+		{
+			// not reported again
+			cleanOverlappingPair(*previous, dispatcher);
+			if (m_ghostPairCallback)
+				m_ghostPairCallback->removeOverlappingPair(previous->m_pProxy0, previous->m_pProxy1, dispatcher);
+			i++;
+			continue;
+		}
+		if (previous && *previous == *reported)
+		{
+			m_mergedPairs.push_back(*previous);
+			i++;
+		}
+		else
+		{
+			if (m_ghostPairCallback)
+				m_ghostPairCallback->addOverlappingPair(reported->m_pProxy0, reported->m_pProxy1);
+			m_mergedPairs.push_back(*reported);
+			numAdded++;
+		}
+		// skip the pairs that were reported more than once
+		unsigned long long key = m_sortEntries[j].m_key;
+		while (j < m_sortEntries.size() && m_sortEntries[j].m_key == key)
+		{
+			j++;
+		}
+	}
+	m_overlappingPairArray.copyFromArray(m_mergedPairs);
+	return numAdded;
+}
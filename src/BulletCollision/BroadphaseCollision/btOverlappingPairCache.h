@@ -21,6 +21,9 @@ subject to the following restrictions:
 #include "btOverlappingPairCallback.h"
 
 #include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btFlatHashMap.h"
+#include "LinearMath/btRadixSort.h"
+#include "LinearMath/btThreads.h"
 class btDispatcher;
 
 typedef btAlignedObjectArray<btBroadphasePair> btBroadphasePairArray;
@@ -80,6 +83,38 @@ public:
 	virtual void setInternalGhostPairCallback(btOverlappingPairCallback* ghostPairCallback) = 0;
 
 	virtual void sortOverlappingPairs(btDispatcher* dispatcher) = 0;
+
+	///Pair caches that support concurrent pairs take addOverlappingPairConcurrent and removeOverlappingPairConcurrent calls
+	///from several threads at once, for example from a parallel broadphase traversal. The calls only take effect in
+	///flushConcurrentPairs, which applies them in sorted order, so the pair array does not depend on how the work was split.
+	///The default implementation adds and removes the pair right away and must be called from one thread.
+	virtual bool supportsConcurrentPairs() const
+	{
+		return false;
+	}
+
+	virtual void addOverlappingPairConcurrent(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1)
+	{
+		addOverlappingPair(proxy0, proxy1);
+	}
+
+	virtual void removeOverlappingPairConcurrent(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1, btDispatcher* dispatcher)
+	{
+		removeOverlappingPair(proxy0, proxy1, dispatcher);
+	}
+
+	///applies the buffered removals and then the buffered additions, returns the number of pairs that were added
+	virtual int flushConcurrentPairs(btDispatcher* /*dispatcher*/)
+	{
+		return 0;
+	}
+
+	///Pair caches that rebuild their pairs expect the broadphase to report every overlapping pair each frame through
+	///addOverlappingPairConcurrent, and drop the pairs that were not reported in flushConcurrentPairs.
+	virtual bool rebuildsPairs() const
+	{
+		return false;
+	}
 };
 
 /// Hash-space based Pair Cache, thanks to Erin Catto, Box2D, http://www.box2d.org, and Pierre Terdiman, Codercorner, http://codercorner.com
@@ -91,10 +126,16 @@ btHashedOverlappingPairCache : public btOverlappingPairCache
 	btOverlapFilterCallback* m_overlapFilterCallback;
 
 protected:
-	btAlignedObjectArray<int> m_hashTable;
-	btAlignedObjectArray<int> m_next;
+	btFlatHashTable m_hashTable;
 	btOverlappingPairCallback* m_ghostPairCallback;
 
+	///pairs buffered by addOverlappingPairConcurrent and removeOverlappingPairConcurrent, one array per thread index plus
+	///a last one for threads that may share their index, which is only used under m_sharedPairsMutex
+	btAlignedObjectArray<btBroadphasePairArray> m_concurrentAdds;
+	btAlignedObjectArray<btBroadphasePairArray> m_concurrentRemoves;
+	btSpinMutex m_sharedPairsMutex;
+	btBroadphasePairArray m_flushPairs;
+
 public:
 	BT_DECLARE_ALIGNED_ALLOCATOR();
 
@@ -174,15 +215,41 @@ public:
 		return m_overlappingPairArray.size();
 	}
 
+	virtual bool supportsConcurrentPairs() const
+	{
+		return true;
+	}
+
+	///thread safe, the pair is added by flushConcurrentPairs. A custom btOverlapFilterCallback is called from the calling thread.
+	virtual void addOverlappingPairConcurrent(btBroadphaseProxy * proxy0, btBroadphaseProxy * proxy1);
+
+	///thread safe, the pair is removed by flushConcurrentPairs
+	virtual void removeOverlappingPairConcurrent(btBroadphaseProxy * proxy0, btBroadphaseProxy * proxy1, btDispatcher * dispatcher);
+
+	virtual int flushConcurrentPairs(btDispatcher * dispatcher);
+
 private:
 	btBroadphasePair* internalAddPair(btBroadphaseProxy * proxy0, btBroadphaseProxy * proxy1);
 
-	void growTables();
-
-	SIMD_FORCE_INLINE bool equalsPair(const btBroadphasePair& pair, int proxyId1, int proxyId2)
+	struct btEqualsPair
 	{
-		return pair.m_pProxy0->getUid() == proxyId1 && pair.m_pProxy1->getUid() == proxyId2;
-	}
+		const btBroadphasePairArray& m_pairs;
+		int m_proxyId1;
+		int m_proxyId2;
+
+		btEqualsPair(const btBroadphasePairArray& pairs, int proxyId1, int proxyId2)
+			: m_pairs(pairs),
+			  m_proxyId1(proxyId1),
+			  m_proxyId2(proxyId2)
+		{
+		}
+
+		bool operator()(int index) const
+		{
+			const btBroadphasePair& pair = m_pairs[index];
+			return pair.m_pProxy0->getUid() == m_proxyId1 && pair.m_pProxy1->getUid() == m_proxyId2;
+		}
+	};
 
 	/*
 	// Thomas Wang's hash, see: http://www.concentric.net/~Ttwang/tech/inthash.htm
@@ -214,30 +281,9 @@ private:
 		return key;
 	}
 
-	SIMD_FORCE_INLINE btBroadphasePair* internalFindPair(btBroadphaseProxy * proxy0, btBroadphaseProxy * proxy1, int hash)
+	SIMD_FORCE_INLINE int internalFindPairIndex(int proxyId1, int proxyId2, unsigned int hash) const
 	{
-		int proxyId1 = proxy0->getUid();
-		int proxyId2 = proxy1->getUid();
-#if 0  // wrong, 'equalsPair' use unsorted uids, copy-past devil striked again. Nat.
-		if (proxyId1 > proxyId2) 
-			btSwap(proxyId1, proxyId2);
-#endif
-
-		int index = m_hashTable[hash];
-
-		while (index != BT_NULL_PAIR && equalsPair(m_overlappingPairArray[index], proxyId1, proxyId2) == false)
-		{
-			index = m_next[index];
-		}
-
-		if (index == BT_NULL_PAIR)
-		{
-			return NULL;
-		}
-
-		btAssert(index < m_overlappingPairArray.size());
-
-		return &m_overlappingPairArray[index];
+		return m_hashTable.findIndex(hash, btEqualsPair(m_overlappingPairArray, proxyId1, proxyId2));
 	}
 
 	virtual bool hasDeferredRemoval()
@@ -349,6 +395,126 @@ public:
 	virtual void sortOverlappingPairs(btDispatcher* dispatcher);
 };
 
+///The btRadixSortedOverlappingPairCache rebuilds its pairs each frame from the pairs that the broadphase reports, instead of
+///adding and removing them one by one. flushConcurrentPairs radix sorts the reported pairs by proxy uids (see btRadixSort)
+///and merges them with the pairs of the previous frame: pairs that stay keep their collision algorithm, new pairs are
+///added and pairs that were not reported again are removed. The pair array is always sorted by uid, so the order does not
+///depend on the broadphase or on the number of threads. Use it with a broadphase that reports all overlapping pairs every
+///frame, such as btDbvtBroadphase, and not with the incremental btAxisSweep3.
+class btRadixSortedOverlappingPairCache : public btOverlappingPairCache
+{
+	btBroadphasePairArray m_overlappingPairArray;
+	btOverlapFilterCallback* m_overlapFilterCallback;
+	btOverlappingPairCallback* m_ghostPairCallback;
+
+	///pairs reported since the last flush, one array per thread index plus a shared one (see btHashedOverlappingPairCache)
+	btAlignedObjectArray<btBroadphasePairArray> m_reportedPairs;
+	btSpinMutex m_sharedPairsMutex;
+	btBroadphasePairArray m_flushPairs;
+	btBroadphasePairArray m_mergedPairs;
+	btAlignedObjectArray<btRadixSortEntry> m_sortEntries;
+	btAlignedObjectArray<btRadixSortEntry> m_sortScratch;
+
+	int findPairIndex(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1) const;
+
+public:
+	btRadixSortedOverlappingPairCache();
+	virtual ~btRadixSortedOverlappingPairCache();
+
+	virtual void processAllOverlappingPairs(btOverlapCallback*, btDispatcher* dispatcher);
+
+	///removes the pair right away, unlike a pair that is not reported
+	void* removeOverlappingPair(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1, btDispatcher* dispatcher);
+
+	void cleanOverlappingPair(btBroadphasePair& pair, btDispatcher* dispatcher);
+
+	///reports the pair for the next flushConcurrentPairs, the pair array does not change until then so this returns 0
+	btBroadphasePair* addOverlappingPair(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1);
+
+	btBroadphasePair* findPair(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1);
+
+	void cleanProxyFromPairs(btBroadphaseProxy* proxy, btDispatcher* dispatcher);
+
+	void removeOverlappingPairsContainingProxy(btBroadphaseProxy* proxy, btDispatcher* dispatcher);
+
+	inline bool needsBroadphaseCollision(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1) const
+	{
+		if (m_overlapFilterCallback)
+			return m_overlapFilterCallback->needBroadphaseCollision(proxy0, proxy1);
+
+		bool collides = (proxy0->m_collisionFilterGroup & proxy1->m_collisionFilterMask) != 0;
+		collides = collides && (proxy1->m_collisionFilterGroup & proxy0->m_collisionFilterMask);
+
+		return collides;
+	}
+
+	btBroadphasePairArray& getOverlappingPairArray()
+	{
+		return m_overlappingPairArray;
+	}
+
+	const btBroadphasePairArray& getOverlappingPairArray() const
+	{
+		return m_overlappingPairArray;
+	}
+
+	btBroadphasePair* getOverlappingPairArrayPtr()
+	{
+		return &m_overlappingPairArray[0];
+	}
+
+	const btBroadphasePair* getOverlappingPairArrayPtr() const
+	{
+		return &m_overlappingPairArray[0];
+	}
+
+	int getNumOverlappingPairs() const
+	{
+		return m_overlappingPairArray.size();
+	}
+
+	btOverlapFilterCallback* getOverlapFilterCallback()
+	{
+		return m_overlapFilterCallback;
+	}
+
+	void setOverlapFilterCallback(btOverlapFilterCallback* callback)
+	{
+		m_overlapFilterCallback = callback;
+	}
+
+	virtual bool hasDeferredRemoval()
+	{
+		return false;
+	}
+
+	virtual void setInternalGhostPairCallback(btOverlappingPairCallback* ghostPairCallback)
+	{
+		m_ghostPairCallback = ghostPairCallback;
+	}
+
+	virtual void sortOverlappingPairs(btDispatcher* dispatcher);
+
+	virtual bool supportsConcurrentPairs() const
+	{
+		return true;
+	}
+
+	virtual bool rebuildsPairs() const
+	{
+		return true;
+	}
+
+	///thread safe, the same as addOverlappingPair
+	virtual void addOverlappingPairConcurrent(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1);
+
+	///pairs are removed by not reporting them, so this does nothing
+	virtual void removeOverlappingPairConcurrent(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1, btDispatcher* dispatcher);
+
+	///replaces the pairs with the pairs reported since the last flush
+	virtual int flushConcurrentPairs(btDispatcher* dispatcher);
+};
+
 ///btNullPairCache skips add/removal of overlapping pairs. Userful for benchmarking and unit testing.
 class btNullPairCache : public btOverlappingPairCache
 {
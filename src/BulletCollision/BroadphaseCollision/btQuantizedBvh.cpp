@@ -765,6 +765,59 @@ void btQuantizedBvh::reportBoxCastOverlappingNodex(btNodeOverlapCallback* nodeCa
 	*/
 }
 
+void btQuantizedBvh::reportRayPacketOverlappingNodex(btNodeOverlapPacketCallback* nodeCallback, btRayPacket& packet) const
+{
+	//stackless, as walkStacklessQuantizedTreeAgainstRay and walkStacklessTreeAgainstRay
+	int curIndex = 0;
+	while (curIndex < m_curNodeIndex)
+	{
+		btVector3 aabbMin, aabbMax;
+		bool isLeafNode;
+		int escapeIndex, partId = 0, triangleIndex = 0;
+		if (m_useQuantization)
+		{
+			const btQuantizedBvhNode& node = m_quantizedContiguousNodes[curIndex];
+			aabbMin = unQuantize(node.m_quantizedAabbMin);
+			aabbMax = unQuantize(node.m_quantizedAabbMax);
+			isLeafNode = node.isLeafNode();
+			if (isLeafNode)
+			{
+				escapeIndex = 1;
+				partId = node.getPartId();
+				triangleIndex = node.getTriangleIndex();
+			}
+			else
+			{
+				escapeIndex = node.getEscapeIndex();
+			}
+		}
+		else
+		{
+			const btOptimizedBvhNode& node = m_contiguousNodes[curIndex];
+			aabbMin = node.m_aabbMinOrg;
+			aabbMax = node.m_aabbMaxOrg;
+			isLeafNode = node.m_escapeIndex == -1;
+			escapeIndex = isLeafNode ? 1 : node.m_escapeIndex;
+			partId = node.m_subPart;
+			triangleIndex = node.m_triangleIndex;
+		}
+
+		const int rayMask = btRayPacketAabb(packet, aabbMin, aabbMax, 0);
+		if (isLeafNode && rayMask)
+		{
+			nodeCallback->processNode(partId, triangleIndex, rayMask);
+		}
+		if (rayMask || isLeafNode)
+		{
+			curIndex++;
+		}
+		else
+		{
+			curIndex += escapeIndex;
+		}
+	}
+}
+
 void btQuantizedBvh::swapLeafNodes(int i, int splitIndex)
 {
 	if (m_useQuantization)
@@ -17,6 +17,7 @@ subject to the following restrictions:
 #define BT_QUANTIZED_BVH_H
 
 class btSerializer;
+struct btRayPacket;
 
 //#define DEBUG_CHECK_DEQUANTIZATION 1
 #ifdef DEBUG_CHECK_DEQUANTIZATION
@@ -154,6 +155,16 @@ public:
 	virtual void processNode(int subPart, int triangleIndex) = 0;
 };
 
+///btNodeOverlapPacketCallback receives the leaf nodes hit by a packet of rays, see btQuantizedBvh::reportRayPacketOverlappingNodex
+class btNodeOverlapPacketCallback
+{
+public:
+	virtual ~btNodeOverlapPacketCallback(){};
+
+	///rayMask has bit i set for each ray i of the packet that hits the node
+	virtual void processNode(int subPart, int triangleIndex, int rayMask) = 0;
+};
+
 #include "LinearMath/btAlignedAllocator.h"
 #include "LinearMath/btAlignedObjectArray.h"
 
@@ -324,6 +335,9 @@ public:
 	void reportAabbOverlappingNodex(btNodeOverlapCallback * nodeCallback, const btVector3& aabbMin, const btVector3& aabbMax) const;
 	void reportRayOverlappingNodex(btNodeOverlapCallback * nodeCallback, const btVector3& raySource, const btVector3& rayTarget) const;
 	void reportBoxCastOverlappingNodex(btNodeOverlapCallback * nodeCallback, const btVector3& raySource, const btVector3& rayTarget, const btVector3& aabbMin, const btVector3& aabbMax) const;
+	///reportRayPacketOverlappingNodex walks the tree once for all rays of the packet. The callback may lower the lambda_max of
+	///a ray in the packet as hits are found, to skip the nodes behind them
+	void reportRayPacketOverlappingNodex(btNodeOverlapPacketCallback * nodeCallback, btRayPacket & packet) const;
 
 	SIMD_FORCE_INLINE void quantize(unsigned short* out, const btVector3& point, int isMax) const
 	{
@@ -0,0 +1,548 @@
+/*
+Copyright (c) 2003-2020 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btRegionBroadphase.h"
+#include "LinearMath/btAabbUtil2.h"
+#include "LinearMath/btThreads.h"
+#include "LinearMath/btQuickprof.h"
+
+#include <new>
+#include <string.h>
+
+#if !defined(BT_USE_DOUBLE_PRECISION) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+#define BT_REGION_BROADPHASE_USE_SSE 1
+#include <xmmintrin.h>
+#endif
+
+// region coordinates are clamped to this, so that a region key holds 21 bits per axis
+#define BT_REGION_COORD_LIMIT (1 << 20)
+
+// a key that sorts like the scalar
+static SIMD_FORCE_INLINE unsigned long long sortableKey(btScalar x)
+{
+#ifdef BT_USE_DOUBLE_PRECISION
+	unsigned long long bits;
+	memcpy(&bits, &x, sizeof(bits));
+	return (bits >> 63) ? ~bits : bits | (1ULL << 63);
+#else
+	unsigned int bits;
+	memcpy(&bits, &x, sizeof(bits));
+	return (bits >> 31) ? ~bits : bits | 0x80000000u;
+#endif
+}
+
+static int bitsFor(int range)
+{
+	int bits = 0;
+	while ((1 << bits) <= range)
+	{
+		bits++;
+	}
+	return bits;
+}
+
+static SIMD_FORCE_INLINE unsigned long long regionKey(const btRegionBroadphase* bp, const int coords[3])
+{
+	return ((unsigned long long)(coords[0] - bp->m_coordMin[0]) << (bp->m_coordBits[1] + bp->m_coordBits[2])) |
+		   ((unsigned long long)(coords[1] - bp->m_coordMin[1]) << bp->m_coordBits[2]) |
+		   (unsigned long long)(coords[2] - bp->m_coordMin[2]);
+}
+
+static int findRegion(const btAlignedObjectArray<btBroadphaseRegion>& regions, unsigned long long key)
+{
+	int lo = 0;
+	int hi = regions.size();
+	while (lo < hi)
+	{
+		int mid = (lo + hi) / 2;
+		if (regions[mid].m_key < key)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return (lo < regions.size() && regions[lo].m_key == key) ? lo : -1;
+}
+
+// computes the region range of each proxy, and the number of regions it overlaps or -1 for a large proxy
+struct btRegionCountLoop : public btIParallelForBody
+{
+	btRegionBroadphase* m_broadphase;
+	btRegionCountLoop(btRegionBroadphase* broadphase) : m_broadphase(broadphase) {}
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int handle = iBegin; handle < iEnd; handle++)
+		{
+			const btHandleBroadphaseProxy* proxy = m_broadphase->m_proxies[handle];
+			if (!proxy)
+			{
+				m_broadphase->m_entryOffsets[handle] = 0;
+				continue;
+			}
+			int* coords = &m_broadphase->m_proxyCoords[handle * 6];
+			long long count = 1;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				coords[axis] = m_broadphase->getRegionCoord(proxy->m_aabbMin[axis]);
+				coords[3 + axis] = m_broadphase->getRegionCoord(proxy->m_aabbMax[axis]);
+				count *= coords[3 + axis] - coords[axis] + 1;
+				if (count > m_broadphase->m_maxRegionsPerProxy)
+				{
+					break;
+				}
+			}
+			m_broadphase->m_entryOffsets[handle] = count > m_broadphase->m_maxRegionsPerProxy ? -1 : int(count);
+		}
+	}
+};
+
+// writes the entries of each proxy, in the order of m_proxyOrder
+struct btRegionFillLoop : public btIParallelForBody
+{
+	btRegionBroadphase* m_broadphase;
+	btRegionFillLoop(btRegionBroadphase* broadphase) : m_broadphase(broadphase) {}
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int i = iBegin; i < iEnd; i++)
+		{
+			const int handle = m_broadphase->m_proxyOrder[i].m_value;
+			const int* range = &m_broadphase->m_proxyCoords[handle * 6];
+			btRadixSortEntry* entry = &m_broadphase->m_entries[m_broadphase->m_entryOffsets[handle]];
+			int coords[3];
+			for (coords[0] = range[0]; coords[0] <= range[3]; coords[0]++)
+			{
+				for (coords[1] = range[1]; coords[1] <= range[4]; coords[1]++)
+				{
+					for (coords[2] = range[2]; coords[2] <= range[5]; coords[2]++)
+					{
+						entry->m_key = regionKey(m_broadphase, coords);
+						entry->m_value = handle;
+						entry++;
+					}
+				}
+			}
+		}
+	}
+};
+
+// copies the aabbs of the sorted entries into m_entryBounds
+struct btRegionBoundsLoop : public btIParallelForBody
+{
+	btRegionBroadphase* m_broadphase;
+	btRegionBoundsLoop(btRegionBroadphase* broadphase) : m_broadphase(broadphase) {}
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int i = iBegin; i < iEnd; i++)
+		{
+			const btHandleBroadphaseProxy* proxy = m_broadphase->m_proxies[m_broadphase->m_entries[i].m_value];
+			for (int axis = 0; axis < 3; axis++)
+			{
+				m_broadphase->m_entryBounds[axis][i] = proxy->m_aabbMin[axis];
+				m_broadphase->m_entryBounds[3 + axis][i] = proxy->m_aabbMax[axis];
+			}
+		}
+	}
+};
+
+// reports the pair of two entries of a region, if the region holds the lower corner of their overlap
+static SIMD_FORCE_INLINE void reportRegionPair(btRegionBroadphase* bp, const btBroadphaseRegion& region, int entry0, int entry1)
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		const btScalar lower = btMax(bp->m_entryBounds[axis][entry0], bp->m_entryBounds[axis][entry1]);
+		if (bp->getRegionCoord(lower) != region.m_coords[axis])
+		{
+			return;
+		}
+	}
+	bp->reportPair(bp->m_proxies[bp->m_entries[entry0].m_value], bp->m_proxies[bp->m_entries[entry1].m_value]);
+}
+
+// sweep and prune along x inside each region
+struct btRegionSweepLoop : public btIParallelForBody
+{
+	btRegionBroadphase* m_broadphase;
+	btRegionSweepLoop(btRegionBroadphase* broadphase) : m_broadphase(broadphase) {}
+	void forLoop(int iBegin, int iEnd) const
+	{
+		const btScalar* minX = &m_broadphase->m_entryBounds[0][0];
+		const btScalar* minY = &m_broadphase->m_entryBounds[1][0];
+		const btScalar* minZ = &m_broadphase->m_entryBounds[2][0];
+		const btScalar* maxX = &m_broadphase->m_entryBounds[3][0];
+		const btScalar* maxY = &m_broadphase->m_entryBounds[4][0];
+		const btScalar* maxZ = &m_broadphase->m_entryBounds[5][0];
+		for (int r = iBegin; r < iEnd; r++)
+		{
+			const btBroadphaseRegion& region = m_broadphase->m_regions[r];
+			const int end = region.m_firstEntry + region.m_numEntries;
+			for (int i = region.m_firstEntry; i < end; i++)
+			{
+				int j = i + 1;
+#if BT_REGION_BROADPHASE_USE_SSE
+				const __m128 maxXi = _mm_set1_ps(maxX[i]);
+				const __m128 minYi = _mm_set1_ps(minY[i]);
+				const __m128 maxYi = _mm_set1_ps(maxY[i]);
+				const __m128 minZi = _mm_set1_ps(minZ[i]);
+				const __m128 maxZi = _mm_set1_ps(maxZ[i]);
+				bool swept = false;
+				for (; j + 4 <= end; j += 4)
+				{
+					// the entries are sorted by lower x bound, so the lanes inside the x range come first
+					const int inX = _mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(minX + j), maxXi));
+					__m128 overlap = _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(minY + j), maxYi), _mm_cmpge_ps(_mm_loadu_ps(maxY + j), minYi));
+					overlap = _mm_and_ps(overlap, _mm_cmple_ps(_mm_loadu_ps(minZ + j), maxZi));
+					overlap = _mm_and_ps(overlap, _mm_cmpge_ps(_mm_loadu_ps(maxZ + j), minZi));
+					const int mask = _mm_movemask_ps(overlap) & inX;
+					for (int k = 0; k < 4; k++)
+					{
+						if (mask & (1 << k))
+						{
+							reportRegionPair(m_broadphase, region, i, j + k);
+						}
+					}
+					if (inX != 0xf)
+					{
+						swept = true;
+						break;
+					}
+				}
+				if (swept)
+				{
+					continue;
+				}
+#endif
+				for (; j < end && minX[j] <= maxX[i]; j++)
+				{
+					if (minY[j] <= maxY[i] && maxY[j] >= minY[i] && minZ[j] <= maxZ[i] && maxZ[j] >= minZ[i])
+					{
+						reportRegionPair(m_broadphase, region, i, j);
+					}
+				}
+			}
+		}
+	}
+};
+
+// tests the large proxies against all proxies
+struct btRegionLargeLoop : public btIParallelForBody
+{
+	btRegionBroadphase* m_broadphase;
+	btRegionLargeLoop(btRegionBroadphase* broadphase) : m_broadphase(broadphase) {}
+	void forLoop(int iBegin, int iEnd) const
+	{
+		const btAlignedObjectArray<btHandleBroadphaseProxy*>& largeProxies = m_broadphase->m_largeProxies;
+		for (int handle = iBegin; handle < iEnd; handle++)
+		{
+			btHandleBroadphaseProxy* proxy = m_broadphase->m_proxies[handle];
+			if (!proxy)
+			{
+				continue;
+			}
+			const bool large = m_broadphase->m_entryOffsets[handle] < 0;
+			for (int i = 0; i < largeProxies.size(); i++)
+			{
+				// a pair of large proxies is tested once
+				if (large && largeProxies[i]->m_handle >= handle)
+				{
+					continue;
+				}
+				if (TestAabbAgainstAabb2(proxy->m_aabbMin, proxy->m_aabbMax, largeProxies[i]->m_aabbMin, largeProxies[i]->m_aabbMax))
+				{
+					m_broadphase->reportPair(largeProxies[i], proxy);
+				}
+			}
+		}
+	}
+};
+
+btRegionBroadphase::btRegionBroadphase(btScalar regionSize, btOverlappingPairCache* pairCache)
+	: btHandleBroadphase(pairCache),
+	  m_regionSize(regionSize),
+	  m_maxRegionsPerProxy(64)
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		m_coordMin[axis] = 0;
+		m_coordMax[axis] = -1;
+		m_coordBits[axis] = 0;
+	}
+}
+
+btRegionBroadphase::~btRegionBroadphase()
+{
+}
+
+int btRegionBroadphase::getRegionCoord(btScalar x) const
+{
+	btScalar coord = btScalar(floor(x / m_regionSize));
+	btClamp(coord, btScalar(-BT_REGION_COORD_LIMIT), btScalar(BT_REGION_COORD_LIMIT - 1));
+	return int(coord);
+}
+
+btBroadphaseProxy* btRegionBroadphase::createProxy(const btVector3& aabbMin, const btVector3& aabbMax, int /*shapeType*/, void* userPtr, int collisionFilterGroup, int collisionFilterMask, btDispatcher* /*dispatcher*/)
+{
+	btHandleBroadphaseProxy* proxy = new (btAlignedAlloc(sizeof(btHandleBroadphaseProxy), 16)) btHandleBroadphaseProxy(aabbMin, aabbMax, userPtr, collisionFilterGroup, collisionFilterMask);
+	addHandle(proxy);
+	addMoved(proxy);
+	return proxy;
+}
+
+void btRegionBroadphase::destroyProxy(btBroadphaseProxy* absproxy, btDispatcher* dispatcher)
+{
+	btHandleBroadphaseProxy* proxy = static_cast<btHandleBroadphaseProxy*>(absproxy);
+	if (m_largeProxies.findLinearSearch(proxy) < m_largeProxies.size())
+	{
+		m_largeProxies.remove(proxy);
+	}
+	// a new proxy that takes the handle is moved, so the regions skip its entries
+	removeHandle(proxy, dispatcher);
+}
+
+void btRegionBroadphase::setAabb(btBroadphaseProxy* absproxy, const btVector3& aabbMin, const btVector3& aabbMax, btDispatcher* /*dispatcher*/)
+{
+	btHandleBroadphaseProxy* proxy = static_cast<btHandleBroadphaseProxy*>(absproxy);
+	proxy->m_aabbMin = aabbMin;
+	proxy->m_aabbMax = aabbMax;
+	addMoved(proxy);
+}
+
+void btRegionBroadphase::buildRegions()
+{
+	BT_PROFILE("btRegionBroadphase::buildRegions");
+	clearMoved();
+	m_largeProxies.resize(0);
+	m_regions.resize(0);
+
+	const int numHandles = m_proxies.size();
+	m_proxyCoords.resize(numHandles * 6);
+	m_entryOffsets.resize(numHandles);
+	btParallelForOrSerial(0, numHandles, 1024, btRegionCountLoop(this));
+
+	// order the proxies by lower x bound, the stable sort by region below keeps that order inside each region
+	m_proxyOrder.resize(0);
+	for (int handle = 0; handle < numHandles; handle++)
+	{
+		if (m_entryOffsets[handle] < 0)
+		{
+			m_largeProxies.push_back(m_proxies[handle]);
+		}
+		else if (m_entryOffsets[handle] > 0)
+		{
+			btRadixSortEntry& entry = m_proxyOrder.expandNonInitializing();
+			entry.m_key = sortableKey(m_proxies[handle]->m_aabbMin[0]);
+			entry.m_value = handle;
+		}
+	}
+	btRadixSort(m_proxyOrder, m_sortScratch, int(sizeof(btScalar) * 8));
+
+	int numEntries = 0;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		m_coordMin[axis] = BT_REGION_COORD_LIMIT;
+		m_coordMax[axis] = -BT_REGION_COORD_LIMIT;
+	}
+	for (int i = 0; i < m_proxyOrder.size(); i++)
+	{
+		const int handle = m_proxyOrder[i].m_value;
+		const int count = m_entryOffsets[handle];
+		m_entryOffsets[handle] = numEntries;
+		numEntries += count;
+		const int* coords = &m_proxyCoords[handle * 6];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			m_coordMin[axis] = btMin(m_coordMin[axis], coords[axis]);
+			m_coordMax[axis] = btMax(m_coordMax[axis], coords[3 + axis]);
+		}
+	}
+	m_entries.resize(numEntries);
+	if (!numEntries)
+	{
+		return;
+	}
+	int numKeyBits = 0;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		m_coordBits[axis] = bitsFor(m_coordMax[axis] - m_coordMin[axis]);
+		numKeyBits += m_coordBits[axis];
+	}
+	btParallelForOrSerial(0, m_proxyOrder.size(), 256, btRegionFillLoop(this));
+	btRadixSort(m_entries, m_sortScratch, numKeyBits);
+
+	for (int i = 0; i < 6; i++)
+	{
+		m_entryBounds[i].resize(numEntries);
+	}
+	btParallelForOrSerial(0, numEntries, 1024, btRegionBoundsLoop(this));
+
+	for (int i = 0; i < numEntries; i++)
+	{
+		if (i == 0 || m_entries[i].m_key != m_entries[i - 1].m_key)
+		{
+			const unsigned long long key = m_entries[i].m_key;
+			btBroadphaseRegion& region = m_regions.expandNonInitializing();
+			region.m_key = key;
+			region.m_coords[0] = m_coordMin[0] + int(key >> (m_coordBits[1] + m_coordBits[2]));
+			region.m_coords[1] = m_coordMin[1] + int((key >> m_coordBits[2]) & ((1ULL << m_coordBits[1]) - 1));
+			region.m_coords[2] = m_coordMin[2] + int(key & ((1ULL << m_coordBits[2]) - 1));
+			region.m_firstEntry = i;
+			region.m_numEntries = 0;
+		}
+		m_regions[m_regions.size() - 1].m_numEntries++;
+	}
+}
+
+void btRegionBroadphase::calculateOverlappingPairs(btDispatcher* dispatcher)
+{
+	BT_PROFILE("btRegionBroadphase::calculateOverlappingPairs");
+	beginPairs(dispatcher);
+
+	buildRegions();
+
+	btParallelForOrSerial(0, m_regions.size(), 16, btRegionSweepLoop(this));
+	if (m_largeProxies.size())
+	{
+		btParallelForOrSerial(0, m_proxies.size(), 1024, btRegionLargeLoop(this));
+	}
+
+	endPairs(dispatcher);
+}
+
+template <typename Tester>
+void btRegionBroadphase::queryRegions(const btVector3& boxMin, const btVector3& boxMax, Tester& tester) const
+{
+	// the proxies that moved since the last update and the large ones are not in the regions
+	for (int i = 0; i < m_movedProxies.size(); i++)
+	{
+		if (TestAabbAgainstAabb2(boxMin, boxMax, m_movedProxies[i]->m_aabbMin, m_movedProxies[i]->m_aabbMax))
+		{
+			tester.process(m_movedProxies[i]);
+		}
+	}
+	for (int i = 0; i < m_largeProxies.size(); i++)
+	{
+		if (m_largeProxies[i]->m_movedIndex < 0 && TestAabbAgainstAabb2(boxMin, boxMax, m_largeProxies[i]->m_aabbMin, m_largeProxies[i]->m_aabbMax))
+		{
+			tester.process(m_largeProxies[i]);
+		}
+	}
+	if (!m_regions.size())
+	{
+		return;
+	}
+
+	int lo[3];
+	int hi[3];
+	long long numCells = 1;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		lo[axis] = btMax(getRegionCoord(boxMin[axis]), m_coordMin[axis]);
+		hi[axis] = btMin(getRegionCoord(boxMax[axis]), m_coordMax[axis]);
+		if (lo[axis] > hi[axis])
+		{
+			return;
+		}
+		numCells = btMin(numCells * (hi[axis] - lo[axis] + 1), (long long)m_regions.size() + 1);
+	}
+
+	// look the cells up when there are fewer of them than regions, otherwise walk the regions
+	int coords[3];
+	int cellIndex = 0;
+	int regionIndex = 0;
+	for (;;)
+	{
+		const btBroadphaseRegion* region = 0;
+		if (numCells <= m_regions.size())
+		{
+			if (cellIndex == numCells)
+			{
+				break;
+			}
+			int cell = cellIndex++;
+			for (int axis = 2; axis >= 0; axis--)
+			{
+				const int size = hi[axis] - lo[axis] + 1;
+				coords[axis] = lo[axis] + cell % size;
+				cell /= size;
+			}
+			const int found = findRegion(m_regions, regionKey(this, coords));
+			if (found < 0)
+			{
+				continue;
+			}
+			region = &m_regions[found];
+		}
+		else
+		{
+			if (regionIndex == m_regions.size())
+			{
+				break;
+			}
+			region = &m_regions[regionIndex++];
+			if (region->m_coords[0] < lo[0] || region->m_coords[0] > hi[0] ||
+				region->m_coords[1] < lo[1] || region->m_coords[1] > hi[1] ||
+				region->m_coords[2] < lo[2] || region->m_coords[2] > hi[2])
+			{
+				continue;
+			}
+		}
+
+		const int end = region->m_firstEntry + region->m_numEntries;
+		for (int i = region->m_firstEntry; i < end; i++)
+		{
+			const btHandleBroadphaseProxy* proxy = m_proxies[m_entries[i].m_value];
+			if (!proxy || proxy->m_movedIndex >= 0)
+			{
+				continue;
+			}
+			if (!TestAabbAgainstAabb2(boxMin, boxMax, proxy->m_aabbMin, proxy->m_aabbMax))
+			{
+				continue;
+			}
+			// report the proxy once, from the region that holds the lower corner of the overlap
+			if (getRegionCoord(btMax(boxMin[0], proxy->m_aabbMin[0])) == region->m_coords[0] &&
+				getRegionCoord(btMax(boxMin[1], proxy->m_aabbMin[1])) == region->m_coords[1] &&
+				getRegionCoord(btMax(boxMin[2], proxy->m_aabbMin[2])) == region->m_coords[2])
+			{
+				tester.process(m_proxies[m_entries[i].m_value]);
+			}
+		}
+	}
+}
+
+void btRegionBroadphase::rayTest(const btVector3& rayFrom, const btVector3& rayTo, btBroadphaseRayCallback& rayCallback, const btVector3& aabbMin, const btVector3& aabbMax)
+{
+	btVector3 boxMin = rayFrom;
+	btVector3 boxMax = rayFrom;
+	boxMin.setMin(rayTo);
+	boxMax.setMax(rayTo);
+	boxMin += aabbMin;
+	boxMax += aabbMax;
+	btHandleBroadphaseRayTester tester(rayFrom, aabbMin, aabbMax, rayCallback);
+	queryRegions(boxMin, boxMax, tester);
+}
+
+void btRegionBroadphase::aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback)
+{
+	btHandleBroadphaseAabbTester tester(callback);
+	queryRegions(aabbMin, aabbMax, tester);
+}
+
+void btRegionBroadphase::resetPool(btDispatcher* /*dispatcher*/)
+{
+	if (resetHandles())
+	{
+		m_largeProxies.clear();
+		m_regions.clear();
+		m_entries.clear();
+	}
+}
@@ -0,0 +1,86 @@
+/*
+Copyright (c) 2003-2020 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_REGION_BROADPHASE_H
+#define BT_REGION_BROADPHASE_H
+
+#include "btHandleBroadphase.h"
+#include "LinearMath/btRadixSort.h"
+
+///a cell of the region grid that holds at least one proxy, its entries are a range of btRegionBroadphase::m_entries
+struct btBroadphaseRegion
+{
+	unsigned long long m_key;
+	int m_coords[3];
+	int m_firstEntry;
+	int m_numEntries;
+};
+
+///btRegionBroadphase is a broadphase for very large worlds. btAxisSweep3 needs the world bounds up front and its insertions
+///get slow with many objects, and btDbvtBroadphase traversals become cache unfriendly. This broadphase partitions space
+///into a grid of cubic regions. calculateOverlappingPairs inserts every proxy into the regions its aabb overlaps, radix
+///sorts the entries by region and then by lower x bound (see btRadixSort), and runs sweep and prune inside each region.
+///The sweep tests four candidates at once with SSE in single precision builds. A pair that overlaps in several regions is
+///only reported by the region that holds the lower corner of the overlap, so there is no merge step. The regions run with
+///btParallelFor when a task scheduler is set in a BT_THREADSAFE build. Proxies that overlap more than m_maxRegionsPerProxy
+///regions, such as the ground, are tested against all other proxies.
+///The proxies and pairs are kept by btHandleBroadphase. Pair caches with concurrent pairs take the new pairs from all
+///threads at once, and a btRadixSortedOverlappingPairCache gets all pairs without the removal pass.
+class btRegionBroadphase : public btHandleBroadphase
+{
+public:
+	btScalar m_regionSize;
+	int m_maxRegionsPerProxy;  // proxies that overlap more regions are tested against all proxies
+	btAlignedObjectArray<btHandleBroadphaseProxy*> m_largeProxies;
+
+	// the grid of the last calculateOverlappingPairs
+	btAlignedObjectArray<btBroadphaseRegion> m_regions;  // by key
+	btAlignedObjectArray<btRadixSortEntry> m_entries;    // a proxy handle in a region, by region and lower x bound
+	btAlignedObjectArray<btScalar> m_entryBounds[6];     // the aabb of each entry, one array per lower and upper bound axis
+	int m_coordMin[3];
+	int m_coordMax[3];
+	int m_coordBits[3];
+
+	// scratch
+	btAlignedObjectArray<btRadixSortEntry> m_sortScratch;
+	btAlignedObjectArray<btRadixSortEntry> m_proxyOrder;
+	btAlignedObjectArray<int> m_proxyCoords;   // 6 per handle, the lower and upper region coordinates
+	btAlignedObjectArray<int> m_entryOffsets;  // per handle
+
+	btRegionBroadphase(btScalar regionSize = btScalar(32), btOverlappingPairCache* pairCache = 0);
+	virtual ~btRegionBroadphase();
+
+	virtual btBroadphaseProxy* createProxy(const btVector3& aabbMin, const btVector3& aabbMax, int shapeType, void* userPtr, int collisionFilterGroup, int collisionFilterMask, btDispatcher* dispatcher);
+	virtual void destroyProxy(btBroadphaseProxy* proxy, btDispatcher* dispatcher);
+	virtual void setAabb(btBroadphaseProxy* proxy, const btVector3& aabbMin, const btVector3& aabbMax, btDispatcher* dispatcher);
+
+	virtual void rayTest(const btVector3& rayFrom, const btVector3& rayTo, btBroadphaseRayCallback& rayCallback, const btVector3& aabbMin = btVector3(0, 0, 0), const btVector3& aabbMax = btVector3(0, 0, 0));
+	virtual void aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback);
+
+	virtual void calculateOverlappingPairs(btDispatcher* dispatcher);
+
+	virtual void resetPool(btDispatcher* dispatcher);
+
+	///the region coordinate of a position along one axis, clamped to the range that region keys can hold
+	int getRegionCoord(btScalar x) const;
+
+private:
+	///calls tester.process for each proxy that overlaps the box, with the grid of the last calculateOverlappingPairs
+	template <typename Tester>
+	void queryRegions(const btVector3& boxMin, const btVector3& boxMax, Tester& tester) const;
+
+	void buildRegions();
+};
+
+#endif  //BT_REGION_BROADPHASE_H
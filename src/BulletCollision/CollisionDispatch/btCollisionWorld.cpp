@@ -33,6 +33,9 @@ subject to the following restrictions:
 #include "BulletCollision/BroadphaseCollision/btDbvt.h"
 #include "LinearMath/btAabbUtil2.h"
 #include "LinearMath/btQuickprof.h"
+#include "LinearMath/btBatchedMath.h"
+#include "LinearMath/btFrameArena.h"
+#include "LinearMath/btRadixSort.h"
 #include "LinearMath/btSerializer.h"
 #include "BulletCollision/CollisionShapes/btConvexPolyhedron.h"
 #include "BulletCollision/CollisionDispatch/btCollisionObjectWrapper.h"
@@ -68,8 +71,13 @@ btCollisionWorld::btCollisionWorld(btDispatcher* dispatcher, btBroadphaseInterfa
 	: m_dispatcher1(dispatcher),
 	  m_broadphasePairCache(pairCache),
 	  m_debugDrawer(0),
-	  m_forceUpdateAllAabbs(true)
+	  m_forceUpdateAllAabbs(true),
+	  m_batchedUpdates(false),
+	  m_ownsFrameArena(true)
 {
+	void* mem = btAlignedAlloc(sizeof(btFrameArena), 16);
+	m_frameArena = new (mem) btFrameArena();
+	m_dispatchInfo.m_frameArena = m_frameArena;
 }
 
 btCollisionWorld::~btCollisionWorld()
@@ -91,6 +99,19 @@ btCollisionWorld::~btCollisionWorld()
 			collisionObject->setBroadphaseHandle(0);
 		}
 	}
+	setFrameArena(0);
+}
+
+void btCollisionWorld::setFrameArena(btFrameArena* frameArena)
+{
+	if (m_ownsFrameArena)
+	{
+		m_frameArena->~btFrameArena();
+		btAlignedFree(m_frameArena);
+	}
+	m_ownsFrameArena = false;
+	m_frameArena = frameArena;
+	m_dispatchInfo.m_frameArena = frameArena;
 }
 
 void btCollisionWorld::refreshBroadphaseProxy(btCollisionObject* collisionObject)
@@ -110,6 +131,7 @@ void btCollisionWorld::refreshBroadphaseProxy(btCollisionObject* collisionObject
 		collisionObject->getCollisionShape()->getAabb(trans, minAabb, maxAabb);
 
 		int type = collisionObject->getCollisionShape()->getShapeType();
+		BT_MEMORY_TAG(BT_MEMORY_TAG_BROADPHASE);
 		collisionObject->setBroadphaseHandle(getBroadphase()->createProxy(
 			minAabb,
 			maxAabb,
@@ -140,6 +162,7 @@ void btCollisionWorld::addCollisionObject(btCollisionObject* collisionObject, in
 	collisionObject->getCollisionShape()->getAabb(trans, minAabb, maxAabb);
 
 	int type = collisionObject->getCollisionShape()->getShapeType();
+	BT_MEMORY_TAG(BT_MEMORY_TAG_BROADPHASE);
 	collisionObject->setBroadphaseHandle(getBroadphase()->createProxy(
 		minAabb,
 		maxAabb,
@@ -169,6 +192,11 @@ void btCollisionWorld::updateSingleAabb(btCollisionObject* colObj)
 		maxAabb.setMax(maxAabb2);
 	}
 
+	setBroadphaseAabb(colObj, minAabb, maxAabb);
+}
+
+void btCollisionWorld::setBroadphaseAabb(btCollisionObject* colObj, const btVector3& minAabb, const btVector3& maxAabb)
+{
 	btBroadphaseInterface* bp = (btBroadphaseInterface*)m_broadphasePairCache;
 
 	//moving objects should be moderately sized, probably something wrong if not
@@ -194,9 +222,126 @@ void btCollisionWorld::updateSingleAabb(btCollisionObject* colObj)
 	}
 }
 
+///the number of objects the batched updates gather at a time, their structure of arrays lives on the stack
+#define BT_AABB_BATCH_SIZE 64
+
+struct btAabbBatch
+{
+	btCollisionObject* m_objects[BT_AABB_BATCH_SIZE];
+	//the world transform and the interpolation transform, for the continuous objects
+	btScalar m_basis[2][9][BT_AABB_BATCH_SIZE];
+	btScalar m_origin[2][3][BT_AABB_BATCH_SIZE];
+	btScalar m_halfExtents[3][BT_AABB_BATCH_SIZE];
+	btScalar m_aabbMin[2][3][BT_AABB_BATCH_SIZE];
+	btScalar m_aabbMax[2][3][BT_AABB_BATCH_SIZE];
+	int m_count;
+
+	void add(btCollisionObject* colObj, const btTransform& trans, const btTransform& interpolationTrans, bool identityBasis, const btVector3& halfExtents)
+	{
+		int i = m_count++;
+		m_objects[i] = colObj;
+		const btTransform* transforms[2] = {&trans, &interpolationTrans};
+		for (int t = 0; t < 2; t++)
+		{
+			for (int row = 0; row < 3; row++)
+			{
+				for (int column = 0; column < 3; column++)
+				{
+					m_basis[t][3 * row + column][i] = identityBasis ? btScalar(row == column ? 1 : 0) : transforms[t]->getBasis()[row][column];
+				}
+				m_origin[t][row][i] = transforms[t]->getOrigin()[row];
+			}
+		}
+		for (int j = 0; j < 3; j++)
+		{
+			m_halfExtents[j][i] = halfExtents[j];
+		}
+	}
+
+	void computeAabbs()
+	{
+		btScalar* halfExtents[3] = {m_halfExtents[0], m_halfExtents[1], m_halfExtents[2]};
+		for (int t = 0; t < 2; t++)
+		{
+			btTransformSoa transforms;
+			for (int j = 0; j < 9; j++)
+			{
+				transforms.m_basis[j] = m_basis[t][j];
+			}
+			btScalar* aabbMin[3];
+			btScalar* aabbMax[3];
+			for (int j = 0; j < 3; j++)
+			{
+				transforms.m_origin[j] = m_origin[t][j];
+				aabbMin[j] = m_aabbMin[t][j];
+				aabbMax[j] = m_aabbMax[t][j];
+			}
+			btTransformAabbs(transforms, halfExtents, gContactBreakingThreshold, aabbMin, aabbMax, m_count);
+		}
+	}
+};
+
+void btCollisionWorld::updateAabbsBatched()
+{
+	btAabbBatch batch;
+	batch.m_count = 0;
+	bool useContinuous = getDispatchInfo().m_useContinuous;
+	for (int i = 0; i < m_collisionObjects.size(); i++)
+	{
+		btCollisionObject* colObj = m_collisionObjects[i];
+		btAssert(colObj->getWorldArrayIndex() == i);
+
+		//only update aabb of active objects
+		if (m_forceUpdateAllAabbs || colObj->isActive())
+		{
+			const btCollisionShape* shape = colObj->getCollisionShape();
+			bool continuous = useContinuous && colObj->getInternalType() == btCollisionObject::CO_RIGID_BODY && !colObj->isStaticOrKinematicObject();
+			const btTransform& interpolationTrans = continuous ? colObj->getInterpolationWorldTransform() : colObj->getWorldTransform();
+			switch (shape->getShapeType())
+			{
+				case SPHERE_SHAPE_PROXYTYPE:
+				{
+					btScalar radius = shape->getMargin();  //the sphere radius, see btSphereShape::getAabb
+					batch.add(colObj, colObj->getWorldTransform(), interpolationTrans, true, btVector3(radius, radius, radius));
+					break;
+				}
+				case BOX_SHAPE_PROXYTYPE:
+				{
+					const btBoxShape* box = static_cast<const btBoxShape*>(shape);
+					batch.add(colObj, colObj->getWorldTransform(), interpolationTrans, false, box->getHalfExtentsWithMargin());
+					break;
+				}
+				default:
+					updateSingleAabb(colObj);
+			}
+		}
+
+		if (batch.m_count == BT_AABB_BATCH_SIZE || (batch.m_count && i == m_collisionObjects.size() - 1))
+		{
+			batch.computeAabbs();
+			for (int j = 0; j < batch.m_count; j++)
+			{
+				btVector3 minAabb(batch.m_aabbMin[0][0][j], batch.m_aabbMin[0][1][j], batch.m_aabbMin[0][2][j]);
+				btVector3 maxAabb(batch.m_aabbMax[0][0][j], batch.m_aabbMax[0][1][j], batch.m_aabbMax[0][2][j]);
+				minAabb.setMin(btVector3(batch.m_aabbMin[1][0][j], batch.m_aabbMin[1][1][j], batch.m_aabbMin[1][2][j]));
+				maxAabb.setMax(btVector3(batch.m_aabbMax[1][0][j], batch.m_aabbMax[1][1][j], batch.m_aabbMax[1][2][j]));
+				setBroadphaseAabb(batch.m_objects[j], minAabb, maxAabb);
+			}
+			batch.m_count = 0;
+		}
+	}
+}
+
 void btCollisionWorld::updateAabbs()
 {
 	BT_PROFILE("updateAabbs");
+	BT_MEMORY_TAG(BT_MEMORY_TAG_BROADPHASE);
+
+	if (m_batchedUpdates)
+	{
+		updateAabbsBatched();
+		return;
+	}
 
 	for (int i = 0; i < m_collisionObjects.size(); i++)
 	{
@@ -214,6 +359,7 @@ void btCollisionWorld::updateAabbs()
 void btCollisionWorld::computeOverlappingPairs()
 {
 	BT_PROFILE("calculateOverlappingPairs");
+	BT_MEMORY_TAG(BT_MEMORY_TAG_BROADPHASE);
 	m_broadphasePairCache->calculateOverlappingPairs(m_dispatcher1);
 }
 
@@ -223,6 +369,11 @@ void btCollisionWorld::performDiscreteCollisionDetection()
 
 	btDispatcherInfo& dispatchInfo = getDispatchInfo();
 
+	if (m_frameArena)
+	{
+		m_frameArena->reset();
+	}
+
 	updateAabbs();
 
 	computeOverlappingPairs();
@@ -230,6 +381,7 @@ void btCollisionWorld::performDiscreteCollisionDetection()
 	btDispatcher* dispatcher = getDispatcher();
 	{
 		BT_PROFILE("dispatchAllCollisionPairs");
+		BT_MEMORY_TAG(BT_MEMORY_TAG_NARROWPHASE);
 		if (dispatcher)
 			dispatcher->dispatchAllCollisionPairs(m_broadphasePairCache->getOverlappingPairCache(), dispatchInfo, m_dispatcher1);
 	}
@@ -1017,6 +1169,244 @@ void btCollisionWorld::rayTest(const btVector3& rayFromWorld, const btVector3& r
 #endif  //USE_BRUTEFORCE_RAYBROADPHASE
 }
 
+struct btPacketTriangleRaycastCallback : public btTriangleRaycastCallback
+{
+	btCollisionWorld::RayResultCallback* m_resultCallback;
+	const btCollisionObject* m_collisionObject;
+	const btTransform* m_colObjWorldTransform;
+
+	btPacketTriangleRaycastCallback()
+		: btTriangleRaycastCallback(btVector3(0, 0, 0), btVector3(0, 0, 0)),
+		  m_resultCallback(0),
+		  m_collisionObject(0),
+		  m_colObjWorldTransform(0)
+	{
+	}
+
+	virtual btScalar reportHit(const btVector3& hitNormalLocal, btScalar hitFraction, int partId, int triangleIndex)
+	{
+		btCollisionWorld::LocalShapeInfo shapeInfo;
+		shapeInfo.m_shapePart = partId;
+		shapeInfo.m_triangleIndex = triangleIndex;
+
+		btVector3 hitNormalWorld = m_colObjWorldTransform->getBasis() * hitNormalLocal;
+
+		btCollisionWorld::LocalRayResult rayResult(m_collisionObject,
+												   &shapeInfo,
+												   hitNormalWorld,
+												   hitFraction);
+
+		bool normalInWorldSpace = true;
+		return m_resultCallback->addSingleResult(rayResult, normalInWorldSpace);
+	}
+};
+
+struct btPacketRayCallback : public btBroadphaseRayPacketCallback
+{
+	const btCollisionWorld* m_world;
+	btCollisionWorld::RayResultCallback* m_resultCallbacks[BT_RAY_PACKET_SIZE];
+	btTransform m_rayFromTrans[BT_RAY_PACKET_SIZE];
+	btTransform m_rayToTrans[BT_RAY_PACKET_SIZE];
+	btScalar m_rayLength[BT_RAY_PACKET_SIZE];
+
+	btPacketRayCallback(const btCollisionWorld* world)
+		: m_world(world)
+	{
+	}
+
+	void addRay(const btVector3& rayFromWorld, const btVector3& rayToWorld, btCollisionWorld::RayResultCallback* resultCallback)
+	{
+		btVector3 rayDir = rayToWorld - rayFromWorld;
+		const btScalar rayLength = rayDir.length();
+		rayDir /= rayLength;
+		///what about division by zero? --> just set rayDirection[i] to INF/BT_LARGE_FLOAT
+		btVector3 rayDirectionInverse;
+		rayDirectionInverse[0] = rayDir[0] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDir[0];
+		rayDirectionInverse[1] = rayDir[1] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDir[1];
+		rayDirectionInverse[2] = rayDir[2] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDir[2];
+
+		// the closest hit so far bounds the walk
+		const int lane = m_packet.addRay(rayFromWorld, rayDirectionInverse, rayLength * resultCallback->m_closestHitFraction);
+		m_rayTo[lane] = rayToWorld;
+		m_resultCallbacks[lane] = resultCallback;
+		m_rayFromTrans[lane].setIdentity();
+		m_rayFromTrans[lane].setOrigin(rayFromWorld);
+		m_rayToTrans[lane].setIdentity();
+		m_rayToTrans[lane].setOrigin(rayToWorld);
+		m_rayLength[lane] = rayLength;
+	}
+
+	virtual void processPacket(const btBroadphaseProxy* proxy, int rayMask)
+	{
+		btCollisionObject* collisionObject = (btCollisionObject*)proxy->m_clientObject;
+
+		int testMask = 0;
+		int numTests = 0;
+		for (int lane = 0; lane < m_packet.m_numRays; lane++)
+		{
+			///terminate further ray tests, once the closestHitFraction reached zero
+			if ((rayMask & (1 << lane)) && m_resultCallbacks[lane]->m_closestHitFraction != btScalar(0.f) &&
+				m_resultCallbacks[lane]->needsCollision(collisionObject->getBroadphaseHandle()))
+			{
+				testMask |= 1 << lane;
+				numTests++;
+			}
+		}
+		if (!testMask)
+		{
+			return;
+		}
+
+		const btCollisionShape* collisionShape = collisionObject->getCollisionShape();
+		if (numTests > 1 && (collisionShape->getShapeType() == TRIANGLE_MESH_SHAPE_PROXYTYPE || collisionShape->getShapeType() == SCALED_TRIANGLE_MESH_SHAPE_PROXYTYPE))
+		{
+			rayTestTriangleMesh(collisionObject, testMask);
+		}
+		else
+		{
+			for (int lane = 0; lane < m_packet.m_numRays; lane++)
+			{
+				if (testMask & (1 << lane))
+				{
+					m_world->rayTestSingle(m_rayFromTrans[lane], m_rayToTrans[lane],
+										   collisionObject,
+										   collisionShape,
+										   collisionObject->getWorldTransform(),
+										   *m_resultCallbacks[lane]);
+				}
+			}
+		}
+		for (int lane = 0; lane < m_packet.m_numRays; lane++)
+		{
+			if (testMask & (1 << lane))
+			{
+				m_packet.m_lambda_max[lane] = m_rayLength[lane] * m_resultCallbacks[lane]->m_closestHitFraction;
+			}
+		}
+	}
+
+	///the rays of the packet walk the bvh of the mesh together, see btCollisionWorld::rayTestSingleInternal for a single ray
+	void rayTestTriangleMesh(const btCollisionObject* collisionObject, int testMask)
+	{
+		const btCollisionShape* collisionShape = collisionObject->getCollisionShape();
+		const btTransform& colObjWorldTransform = collisionObject->getWorldTransform();
+		btBvhTriangleMeshShape* triangleMesh;
+		btVector3 scale(1, 1, 1);
+		if (collisionShape->getShapeType() == SCALED_TRIANGLE_MESH_SHAPE_PROXYTYPE)
+		{
+			btScaledBvhTriangleMeshShape* scaledTriangleMesh = (btScaledBvhTriangleMeshShape*)collisionShape;
+			triangleMesh = (btBvhTriangleMeshShape*)scaledTriangleMesh->getChildShape();
+			scale = scaledTriangleMesh->getLocalScaling();
+		}
+		else
+		{
+			triangleMesh = (btBvhTriangleMeshShape*)collisionShape;
+		}
+
+		btTransform worldTocollisionObject = colObjWorldTransform.inverse();
+		btPacketTriangleRaycastCallback triangleCallbacks[BT_RAY_PACKET_SIZE];
+		btTriangleRaycastCallback* callbacks[BT_RAY_PACKET_SIZE];
+		int numRays = 0;
+		for (int lane = 0; lane < m_packet.m_numRays; lane++)
+		{
+			if (testMask & (1 << lane))
+			{
+				btPacketTriangleRaycastCallback& rcb = triangleCallbacks[numRays];
+				rcb.m_from = (worldTocollisionObject * m_rayFromTrans[lane].getOrigin()) / scale;
+				rcb.m_to = (worldTocollisionObject * m_rayToTrans[lane].getOrigin()) / scale;
+				rcb.m_flags = m_resultCallbacks[lane]->m_flags;
+				rcb.m_hitFraction = m_resultCallbacks[lane]->m_closestHitFraction;
+				rcb.m_resultCallback = m_resultCallbacks[lane];
+				rcb.m_collisionObject = collisionObject;
+				rcb.m_colObjWorldTransform = &colObjWorldTransform;
+				callbacks[numRays++] = &rcb;
+			}
+		}
+		triangleMesh->performRaycastPacket(callbacks, numRays);
+	}
+};
+
+// interleaves the low 10 bits of x with two zero bits
+static SIMD_FORCE_INLINE unsigned long long spreadBits(unsigned long long x)
+{
+	x &= 0x3ff;
+	x = (x | (x << 16)) & 0x030000ff;
+	x = (x | (x << 8)) & 0x0300f00f;
+	x = (x | (x << 4)) & 0x030c30c3;
+	x = (x | (x << 2)) & 0x09249249;
+	return x;
+}
+
+// the morton code of a point in [0, 1023]^3
+static SIMD_FORCE_INLINE unsigned long long mortonKey(const btVector3& p)
+{
+	unsigned long long coords[3];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		coords[axis] = (unsigned long long)btClamped(p[axis], btScalar(0), btScalar(1023));
+	}
+	return spreadBits(coords[0]) | (spreadBits(coords[1]) << 1) | (spreadBits(coords[2]) << 2);
+}
+
+void btCollisionWorld::rayTestBatch(const btVector3* rayFromWorld, const btVector3* rayToWorld, RayResultCallback** resultCallbacks, int numRays) const
+{
+	BT_PROFILE("rayTestBatch");
+	if (numRays <= 0)
+	{
+		return;
+	}
+
+	// sort the rays by origin and then by direction, so that the rays of a packet take similar paths through the trees
+	btVector3 originMin = rayFromWorld[0];
+	btVector3 originMax = rayFromWorld[0];
+	for (int i = 1; i < numRays; i++)
+	{
+		originMin.setMin(rayFromWorld[i]);
+		originMax.setMax(rayFromWorld[i]);
+	}
+	btVector3 originScale(0, 0, 0);
+	for (int axis = 0; axis < 3; axis++)
+	{
+		const btScalar extent = originMax[axis] - originMin[axis];
+		if (extent > btScalar(0))
+		{
+			originScale[axis] = btScalar(1023) / extent;
+		}
+	}
+	btAlignedObjectArray<btRadixSortEntry> order;
+	btAlignedObjectArray<btRadixSortEntry> scratch;
+	order.resize(numRays);
+	for (int i = 0; i < numRays; i++)
+	{
+		btVector3 rayDir = rayToWorld[i] - rayFromWorld[i];
+		rayDir.safeNormalize();
+		order[i].m_key = (mortonKey((rayFromWorld[i] - originMin) * originScale) << 30) | mortonKey((rayDir + btVector3(1, 1, 1)) * btScalar(511.5));
+		order[i].m_value = i;
+	}
+	btRadixSort(order, scratch, 60);
+
+	btPacketRayCallback packetCallback(this);
+	for (int i = 0; i < numRays; i++)
+	{
+		const int ray = order[i].m_value;
+		// a ray without length hits nothing
+		if (rayFromWorld[ray] == rayToWorld[ray])
+		{
+			continue;
+		}
+		packetCallback.addRay(rayFromWorld[ray], rayToWorld[ray], resultCallbacks[ray]);
+		if (packetCallback.m_packet.m_numRays == BT_RAY_PACKET_SIZE)
+		{
+			m_broadphasePairCache->rayTestPacket(packetCallback);
+			packetCallback.m_packet.clear();
+		}
+	}
+	if (packetCallback.m_packet.m_numRays)
+	{
+		m_broadphasePairCache->rayTestPacket(packetCallback);
+	}
+}
+
 struct btSingleSweepCallback : public btBroadphaseRayCallback
 {
 	btTransform m_convexFromTrans;
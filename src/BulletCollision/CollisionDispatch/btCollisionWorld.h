@@ -73,6 +73,7 @@ class btCollisionShape;
 class btConvexShape;
 class btBroadphaseInterface;
 class btSerializer;
+class btFrameArena;
 
 #include "LinearMath/btVector3.h"
 #include "LinearMath/btTransform.h"
@@ -99,6 +100,18 @@ protected:
 	///it is true by default, because it is error-prone (setting the position of static objects wouldn't update their AABB)
 	bool m_forceUpdateAllAabbs;
 
+	///m_batchedUpdates gathers sphere and box objects into structures of arrays and computes their AABBs with the btBatchedMath kernels,
+	///btDiscreteDynamicsWorld also integrates the rigid body transforms that way. It pays off for large scenes, results match up to rounding
+	bool m_batchedUpdates;
+
+	///transient memory of the narrowphase and the solvers, reset at the start of performDiscreteCollisionDetection
+	btFrameArena* m_frameArena;
+	bool m_ownsFrameArena;
+
+	void updateAabbsBatched();
+
+	void setBroadphaseAabb(btCollisionObject* colObj, const btVector3& minAabb, const btVector3& maxAabb);
+
 	void serializeCollisionObjects(btSerializer* serializer);
 
 	void serializeContactManifolds(btSerializer* serializer);
@@ -433,6 +446,11 @@ public:
 	/// This allows for several queries: first hit, all hits, any hit, dependent on the value returned by the callback.
 	virtual void rayTest(const btVector3& rayFromWorld, const btVector3& rayToWorld, RayResultCallback& resultCallback) const;
 
+	/// rayTestBatch performs the ray tests of many rays, with the results of calling rayTest(rayFromWorld[i], rayToWorld[i], *resultCallbacks[i])
+	/// for each ray. The rays are sorted into packets of four nearby rays with similar directions, and each packet walks the
+	/// broadphase tree and the bvh of btBvhTriangleMeshShape objects at once. It is meant for many rays per frame, such as lidar sensors.
+	virtual void rayTestBatch(const btVector3* rayFromWorld, const btVector3* rayToWorld, RayResultCallback** resultCallbacks, int numRays) const;
+
 	/// convexTest performs a swept convex cast on all objects in the btCollisionWorld, and calls the resultCallback
 	/// This allows for several queries: first hit, all hits, any hit, dependent on the value return by the callback.
 	void convexSweepTest(const btConvexShape* castShape, const btTransform& from, const btTransform& to, ConvexResultCallback& resultCallback, btScalar allowedCcdPenetration = btScalar(0.)) const;
@@ -505,6 +523,23 @@ public:
 	{
 		m_forceUpdateAllAabbs = forceUpdateAllAabbs;
 	}
+	bool getBatchedUpdates() const
+	{
+		return m_batchedUpdates;
+	}
+	void setBatchedUpdates(bool batchedUpdates)
+	{
+		m_batchedUpdates = batchedUpdates;
+	}
+
+	btFrameArena* getFrameArena()
+	{
+		return m_frameArena;
+	}
+
+	///replaces the arena the world created, for example to share one between worlds that step one after the other.
+	///The world does not own the new arena, null turns it off so transient data goes to the heap again
+	void setFrameArena(btFrameArena* frameArena);
 
 	///Preliminary serialization test for Bullet 2.76. Loading those files requires a separate parser (Bullet/Demos/SerializeDemo)
 	virtual void serialize(btSerializer* serializer);
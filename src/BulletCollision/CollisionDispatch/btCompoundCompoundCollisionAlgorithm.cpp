@@ -402,7 +402,8 @@ void btCompoundCompoundCollisionAlgorithm::processCollision(const btCollisionObj
 		{
 			m_childCollisionAlgorithmCache->removeOverlappingPair(m_removePairs[i].m_indexA, m_removePairs[i].m_indexB);
 		}
-		m_removePairs.clear();
+		// keep the capacity, so steady state stepping does not allocate
+		m_removePairs.resizeNoInitialize(0);
 	}
 }
 
@@ -15,6 +15,7 @@ subject to the following restrictions:
 
 #include "btConvexConcaveCollisionAlgorithm.h"
 #include "LinearMath/btQuickprof.h"
+#include "LinearMath/btFrameArena.h"
 #include "BulletCollision/CollisionDispatch/btCollisionObject.h"
 #include "BulletCollision/CollisionShapes/btMultiSphereShape.h"
 #include "BulletCollision/BroadphaseCollision/btBroadphaseProxy.h"
@@ -233,11 +234,16 @@ void btConvexConcaveCollisionAlgorithm::processCollision(const btCollisionObject
 			if (convexBodyWrap->getCollisionShape()->isConvex())
 			{
 				btConvexShape* convex = (btConvexShape*)convexBodyWrap->getCollisionShape();
+				btFrameArenaScope arenaScope(dispatchInfo.m_frameArena);
 				btAlignedObjectArray<btVector3> queryVertices;
 
 				if (convex->isPolyhedral())
 				{
 					btPolyhedralConvexShape* poly = (btPolyhedralConvexShape*)convex;
+					if (dispatchInfo.m_frameArena)
+					{
+						dispatchInfo.m_frameArena->initializeArray(queryVertices, poly->getNumVertices());
+					}
 					for (int v = 0; v < poly->getNumVertices(); v++)
 					{
 						btVector3 vtx;
@@ -37,6 +37,8 @@ subject to the following restrictions:
 btDefaultCollisionConfiguration::btDefaultCollisionConfiguration(const btDefaultCollisionConstructionInfo& constructionInfo)
 //btDefaultCollisionConfiguration::btDefaultCollisionConfiguration(btStackAlloc*	stackAlloc,btPoolAllocator*	persistentManifoldPool,btPoolAllocator*	collisionAlgorithmPool)
 {
+	// the algorithm create functions and the manifold and algorithm pools
+	BT_MEMORY_TAG(BT_MEMORY_TAG_NARROWPHASE);
 	void* mem = NULL;
 	if (constructionInfo.m_useEpaPenetrationAlgorithm)
 	{
@@ -113,7 +115,8 @@ btDefaultCollisionConfiguration::btDefaultCollisionConfiguration(const btDefault
 	{
 		m_ownsPersistentManifoldPool = true;
 		void* mem = btAlignedAlloc(sizeof(btPoolAllocator), 16);
-		m_persistentManifoldPool = new (mem) btPoolAllocator(sizeof(btPersistentManifold), constructionInfo.m_defaultMaxPersistentManifoldPoolSize);
+		m_persistentManifoldPool = new (mem) btPoolAllocator(sizeof(btPersistentManifold), constructionInfo.m_defaultMaxPersistentManifoldPoolSize, constructionInfo.m_usePoolThreadCaches);
+		m_persistentManifoldPool->setGrowable(constructionInfo.m_growablePools);
 	}
 
 	collisionAlgorithmMaxElementSize = (collisionAlgorithmMaxElementSize + 16) & 0xffffffffffff0;
@@ -126,7 +129,8 @@ btDefaultCollisionConfiguration::btDefaultCollisionConfiguration(const btDefault
 	{
 		m_ownsCollisionAlgorithmPool = true;
 		void* mem = btAlignedAlloc(sizeof(btPoolAllocator), 16);
-		m_collisionAlgorithmPool = new (mem) btPoolAllocator(collisionAlgorithmMaxElementSize, constructionInfo.m_defaultMaxCollisionAlgorithmPoolSize);
+		m_collisionAlgorithmPool = new (mem) btPoolAllocator(collisionAlgorithmMaxElementSize, constructionInfo.m_defaultMaxCollisionAlgorithmPoolSize, constructionInfo.m_usePoolThreadCaches);
+		m_collisionAlgorithmPool->setGrowable(constructionInfo.m_growablePools);
 	}
 }
 
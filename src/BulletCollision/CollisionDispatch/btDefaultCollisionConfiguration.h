@@ -28,6 +28,13 @@ struct btDefaultCollisionConstructionInfo
 	int m_defaultMaxCollisionAlgorithmPoolSize;
 	int m_customCollisionAlgorithmMaxElementSize;
 	int m_useEpaPenetrationAlgorithm;
+	///per-thread caches for the default pools, so btCollisionDispatcherMt workers rarely contend for them (BT_THREADSAFE builds only).
+	///Off by default, since a pool can run out while other threads' caches still hold free elements
+	bool m_usePoolThreadCaches;
+	///the default pools add memory when they are full instead of falling back to btAlignedAlloc per element. Their btPoolAllocatorStatistics
+	///report the high-water mark to pre-size them with, and the allocations that still fell back to the heap. Off by default, since a grown
+	///pool keeps its memory until the configuration is destroyed
+	bool m_growablePools;
 
 	btDefaultCollisionConstructionInfo()
 		: m_persistentManifoldPool(0),
@@ -35,7 +42,9 @@ struct btDefaultCollisionConstructionInfo
 		  m_defaultMaxPersistentManifoldPoolSize(4096),
 		  m_defaultMaxCollisionAlgorithmPoolSize(4096),
 		  m_customCollisionAlgorithmMaxElementSize(0),
-		  m_useEpaPenetrationAlgorithm(true)
+		  m_useEpaPenetrationAlgorithm(true),
+		  m_usePoolThreadCaches(false),
+		  m_growablePools(false)
 	{
 	}
 };
@@ -28,7 +28,6 @@ btHashedSimplePairCache::btHashedSimplePairCache()
 {
 	int initialAllocatedSize = 2;
 	m_overlappingPairArray.reserve(initialAllocatedSize);
-	growTables();
 }
 
 btHashedSimplePairCache::~btHashedSimplePairCache()
@@ -39,11 +38,9 @@ void btHashedSimplePairCache::removeAllPairs()
 {
 	m_overlappingPairArray.clear();
 	m_hashTable.clear();
-	m_next.clear();
 
 	int initialAllocatedSize = 2;
 	m_overlappingPairArray.reserve(initialAllocatedSize);
-	growTables();
 }
 
 btSimplePair* btHashedSimplePairCache::findPair(int indexA, int indexB)
@@ -55,20 +52,8 @@ btSimplePair* btHashedSimplePairCache::findPair(int indexA, int indexB)
 	/*if (indexA > indexB) 
 		btSwap(indexA, indexB);*/
 
-	int hash = static_cast<int>(getHash(static_cast<unsigned int>(indexA), static_cast<unsigned int>(indexB)) & (m_overlappingPairArray.capacity() - 1));
-
-	if (hash >= m_hashTable.size())
-	{
-		return NULL;
-	}
-
-	int index = m_hashTable[hash];
-	while (index != BT_SIMPLE_NULL_PAIR && equalsPair(m_overlappingPairArray[index], indexA, indexB) == false)
-	{
-		index = m_next[index];
-	}
-
-	if (index == BT_SIMPLE_NULL_PAIR)
+	int index = internalFindPairIndex(indexA, indexB, getHash(static_cast<unsigned int>(indexA), static_cast<unsigned int>(indexB)));
+	if (index == BT_HASH_NULL)
 	{
 		return NULL;
 	}
@@ -78,73 +63,24 @@ btSimplePair* btHashedSimplePairCache::findPair(int indexA, int indexB)
 	return &m_overlappingPairArray[index];
 }
 
-//#include <stdio.h>
-
-void btHashedSimplePairCache::growTables()
-{
-	int newCapacity = m_overlappingPairArray.capacity();
-
-	if (m_hashTable.size() < newCapacity)
-	{
-		//grow hashtable and next table
-		int curHashtableSize = m_hashTable.size();
-
-		m_hashTable.resize(newCapacity);
-		m_next.resize(newCapacity);
-
-		int i;
-
-		for (i = 0; i < newCapacity; ++i)
-		{
-			m_hashTable[i] = BT_SIMPLE_NULL_PAIR;
-		}
-		for (i = 0; i < newCapacity; ++i)
-		{
-			m_next[i] = BT_SIMPLE_NULL_PAIR;
-		}
-
-		for (i = 0; i < curHashtableSize; i++)
-		{
-			const btSimplePair& pair = m_overlappingPairArray[i];
-			int indexA = pair.m_indexA;
-			int indexB = pair.m_indexB;
-
-			int hashValue = static_cast<int>(getHash(static_cast<unsigned int>(indexA), static_cast<unsigned int>(indexB)) & (m_overlappingPairArray.capacity() - 1));  // New hash value with new mask
-			m_next[i] = m_hashTable[hashValue];
-			m_hashTable[hashValue] = i;
-		}
-	}
-}
-
 btSimplePair* btHashedSimplePairCache::internalAddPair(int indexA, int indexB)
 {
-	int hash = static_cast<int>(getHash(static_cast<unsigned int>(indexA), static_cast<unsigned int>(indexB)) & (m_overlappingPairArray.capacity() - 1));  // New hash value with new mask
+	unsigned int hash = getHash(static_cast<unsigned int>(indexA), static_cast<unsigned int>(indexB));
 
-	btSimplePair* pair = internalFindPair(indexA, indexB, hash);
-	if (pair != NULL)
+	int index = internalFindPairIndex(indexA, indexB, hash);
+	if (index != BT_HASH_NULL)
 	{
-		return pair;
+		return &m_overlappingPairArray[index];
 	}
 
 	int count = m_overlappingPairArray.size();
-	int oldCapacity = m_overlappingPairArray.capacity();
 	void* mem = &m_overlappingPairArray.expandNonInitializing();
 
-	int newCapacity = m_overlappingPairArray.capacity();
-
-	if (oldCapacity < newCapacity)
-	{
-		growTables();
-		//hash with new capacity
-		hash = static_cast<int>(getHash(static_cast<unsigned int>(indexA), static_cast<unsigned int>(indexB)) & (m_overlappingPairArray.capacity() - 1));
-	}
-
-	pair = new (mem) btSimplePair(indexA, indexB);
+	btSimplePair* pair = new (mem) btSimplePair(indexA, indexB);
 
 	pair->m_userPointer = 0;
 
-	m_next[count] = m_hashTable[hash];
-	m_hashTable[hash] = count;
+	m_hashTable.insert(hash, count);
 
 	return pair;
 }
@@ -158,39 +94,19 @@ void* btHashedSimplePairCache::removeOverlappingPair(int indexA, int indexB)
 	/*if (indexA > indexB) 
 		btSwap(indexA, indexB);*/
 
-	int hash = static_cast<int>(getHash(static_cast<unsigned int>(indexA), static_cast<unsigned int>(indexB)) & (m_overlappingPairArray.capacity() - 1));
+	unsigned int hash = getHash(static_cast<unsigned int>(indexA), static_cast<unsigned int>(indexB));
 
-	btSimplePair* pair = internalFindPair(indexA, indexB, hash);
-	if (pair == NULL)
+	int pairIndex = internalFindPairIndex(indexA, indexB, hash);
+	if (pairIndex == BT_HASH_NULL)
 	{
 		return 0;
 	}
-
-	void* userData = pair->m_userPointer;
-
-	int pairIndex = int(pair - &m_overlappingPairArray[0]);
 	btAssert(pairIndex < m_overlappingPairArray.size());
 
-	// Remove the pair from the hash table.
-	int index = m_hashTable[hash];
-	btAssert(index != BT_SIMPLE_NULL_PAIR);
-
-	int previous = BT_SIMPLE_NULL_PAIR;
-	while (index != pairIndex)
-	{
-		previous = index;
-		index = m_next[index];
-	}
+	void* userData = m_overlappingPairArray[pairIndex].m_userPointer;
 
-	if (previous != BT_SIMPLE_NULL_PAIR)
-	{
-		btAssert(m_next[previous] == pairIndex);
-		m_next[previous] = m_next[pairIndex];
-	}
-	else
-	{
-		m_hashTable[hash] = m_next[pairIndex];
-	}
+	// Remove the pair from the hash table.
+	m_hashTable.remove(hash, pairIndex);
 
 	// We now move the last pair into spot of the
 	// pair being removed. We need to fix the hash
@@ -205,40 +121,15 @@ void* btHashedSimplePairCache::removeOverlappingPair(int indexA, int indexB)
 		return userData;
 	}
 
-	// Remove the last pair from the hash table.
+	// The last pair now lives at pairIndex.
 	const btSimplePair* last = &m_overlappingPairArray[lastPairIndex];
-	/* missing swap here too, Nat. */
-	int lastHash = static_cast<int>(getHash(static_cast<unsigned int>(last->m_indexA), static_cast<unsigned int>(last->m_indexB)) & (m_overlappingPairArray.capacity() - 1));
-
-	index = m_hashTable[lastHash];
-	btAssert(index != BT_SIMPLE_NULL_PAIR);
-
-	previous = BT_SIMPLE_NULL_PAIR;
-	while (index != lastPairIndex)
-	{
-		previous = index;
-		index = m_next[index];
-	}
-
-	if (previous != BT_SIMPLE_NULL_PAIR)
-	{
-		btAssert(m_next[previous] == lastPairIndex);
-		m_next[previous] = m_next[lastPairIndex];
-	}
-	else
-	{
-		m_hashTable[lastHash] = m_next[lastPairIndex];
-	}
+	unsigned int lastHash = getHash(static_cast<unsigned int>(last->m_indexA), static_cast<unsigned int>(last->m_indexB));
+	m_hashTable.move(lastHash, lastPairIndex, pairIndex);
 
 	// Copy the last pair into the remove pair's spot.
 	m_overlappingPairArray[pairIndex] = m_overlappingPairArray[lastPairIndex];
 
-	// Insert the last pair into the hash table
-	m_next[pairIndex] = m_hashTable[lastHash];
-	m_hashTable[lastHash] = pairIndex;
-
 	m_overlappingPairArray.pop_back();
 
 	return userData;
 }
-//#include <stdio.h>
@@ -17,6 +17,7 @@ subject to the following restrictions:
 #define BT_HASHED_SIMPLE_PAIR_CACHE_H
 
 #include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btFlatHashMap.h"
 
 const int BT_SIMPLE_NULL_PAIR = 0xffffffff;
 
@@ -51,8 +52,7 @@ class btHashedSimplePairCache
 	btSimplePairArray m_overlappingPairArray;
 
 protected:
-	btAlignedObjectArray<int> m_hashTable;
-	btAlignedObjectArray<int> m_next;
+	btFlatHashTable m_hashTable;
 
 public:
 	btHashedSimplePairCache();
@@ -105,12 +105,24 @@ public:
 private:
 	btSimplePair* internalAddPair(int indexA, int indexB);
 
-	void growTables();
-
-	SIMD_FORCE_INLINE bool equalsPair(const btSimplePair& pair, int indexA, int indexB)
+	struct btEqualsPair
 	{
-		return pair.m_indexA == indexA && pair.m_indexB == indexB;
-	}
+		const btSimplePairArray& m_pairs;
+		int m_indexA;
+		int m_indexB;
+
+		btEqualsPair(const btSimplePairArray& pairs, int indexA, int indexB)
+			: m_pairs(pairs),
+			  m_indexA(indexA),
+			  m_indexB(indexB)
+		{
+		}
+
+		bool operator()(int index) const
+		{
+			return m_pairs[index].m_indexA == m_indexA && m_pairs[index].m_indexB == m_indexB;
+		}
+	};
 
 	SIMD_FORCE_INLINE unsigned int getHash(unsigned int indexA, unsigned int indexB)
 	{
@@ -126,23 +138,9 @@ private:
 		return key;
 	}
 
-	SIMD_FORCE_INLINE btSimplePair* internalFindPair(int proxyIdA, int proxyIdB, int hash)
+	SIMD_FORCE_INLINE int internalFindPairIndex(int indexA, int indexB, unsigned int hash) const
 	{
-		int index = m_hashTable[hash];
-
-		while (index != BT_SIMPLE_NULL_PAIR && equalsPair(m_overlappingPairArray[index], proxyIdA, proxyIdB) == false)
-		{
-			index = m_next[index];
-		}
-
-		if (index == BT_SIMPLE_NULL_PAIR)
-		{
-			return NULL;
-		}
-
-		btAssert(index < m_overlappingPairArray.size());
-
-		return &m_overlappingPairArray[index];
+		return m_hashTable.findIndex(hash, btEqualsPair(m_overlappingPairArray, indexA, indexB));
 	}
 };
 
@@ -17,6 +17,8 @@ subject to the following restrictions:
 
 #include "BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h"
 #include "BulletCollision/CollisionShapes/btOptimizedBvh.h"
+#include "BulletCollision/NarrowPhaseCollision/btRaycastCallback.h"
+#include "LinearMath/btAabbUtil2.h"
 #include "LinearMath/btSerializer.h"
 
 ///Bvh Concave triangle mesh is a static-triangle mesh shape with Bounding Volume Hierarchy optimization.
@@ -161,6 +163,117 @@ void btBvhTriangleMeshShape::performRaycast(btTriangleCallback* callback, const
 	m_bvh->reportRayOverlappingNodex(&myNodeCallback, raySource, rayTarget);
 }
 
+void btBvhTriangleMeshShape::performRaycastPacket(btTriangleRaycastCallback** callbacks, int numRays)
+{
+	struct MyNodeOverlapPacketCallback : public btNodeOverlapPacketCallback
+	{
+		btStridingMeshInterface* m_meshInterface;
+		btRayPacket& m_packet;
+		btTriangleRaycastCallback* m_callbacks[BT_RAY_PACKET_SIZE];
+		btScalar m_rayLength[BT_RAY_PACKET_SIZE];
+
+		MyNodeOverlapPacketCallback(btStridingMeshInterface* meshInterface, btRayPacket& packet)
+			: m_meshInterface(meshInterface),
+			  m_packet(packet)
+		{
+		}
+
+		virtual void processNode(int nodeSubPart, int nodeTriangleIndex, int rayMask)
+		{
+			btVector3 m_triangle[3];
+			const unsigned char* vertexbase;
+			int numverts;
+			PHY_ScalarType type;
+			int stride;
+			const unsigned char* indexbase;
+			int indexstride;
+			int numfaces;
+			PHY_ScalarType indicestype;
+
+			m_meshInterface->getLockedReadOnlyVertexIndexBase(
+				&vertexbase,
+				numverts,
+				type,
+				stride,
+				&indexbase,
+				indexstride,
+				numfaces,
+				indicestype,
+				nodeSubPart);
+
+			unsigned int* gfxbase = (unsigned int*)(indexbase + nodeTriangleIndex * indexstride);
+
+			const btVector3& meshScaling = m_meshInterface->getScaling();
+			for (int j = 2; j >= 0; j--)
+			{
+				int graphicsindex;
+				switch (indicestype)
+				{
+					case PHY_INTEGER: graphicsindex = gfxbase[j]; break;
+					case PHY_SHORT: graphicsindex = ((unsigned short*)gfxbase)[j]; break;
+					case PHY_UCHAR: graphicsindex = ((unsigned char*)gfxbase)[j]; break;
+					default: graphicsindex = 0; btAssert(0);
+				}
+
+				if (type == PHY_FLOAT)
+				{
+					float* graphicsbase = (float*)(vertexbase + graphicsindex * stride);
+
+					m_triangle[j] = btVector3(graphicsbase[0] * meshScaling.getX(), graphicsbase[1] * meshScaling.getY(), graphicsbase[2] * meshScaling.getZ());
+				}
+				else
+				{
+					double* graphicsbase = (double*)(vertexbase + graphicsindex * stride);
+
+					m_triangle[j] = btVector3(btScalar(graphicsbase[0]) * meshScaling.getX(), btScalar(graphicsbase[1]) * meshScaling.getY(), btScalar(graphicsbase[2]) * meshScaling.getZ());
+				}
+			}
+
+			/* Perform ray vs. triangle collision here, for each ray of the packet that hits the node */
+			for (int lane = 0; lane < m_packet.m_numRays; lane++)
+			{
+				if (rayMask & (1 << lane))
+				{
+					m_callbacks[lane]->processTriangle(m_triangle, nodeSubPart, nodeTriangleIndex);
+					m_packet.m_lambda_max[lane] = m_rayLength[lane] * m_callbacks[lane]->m_hitFraction;
+				}
+			}
+			m_meshInterface->unLockReadOnlyVertexBase(nodeSubPart);
+		}
+	};
+
+	btRayPacket packet;
+	MyNodeOverlapPacketCallback myNodeCallback(m_meshInterface, packet);
+	for (int i = 0; i < numRays; i++)
+	{
+		btVector3 rayDirection = callbacks[i]->m_to - callbacks[i]->m_from;
+		const btScalar rayLength = rayDirection.length();
+		if (rayLength == btScalar(0.0))
+		{
+			continue;
+		}
+		rayDirection /= rayLength;
+		///what about division by zero? --> just set rayDirection[i] to INF/BT_LARGE_FLOAT
+		btVector3 rayDirectionInverse;
+		rayDirectionInverse[0] = rayDirection[0] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDirection[0];
+		rayDirectionInverse[1] = rayDirection[1] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDirection[1];
+		rayDirectionInverse[2] = rayDirection[2] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDirection[2];
+
+		const int lane = packet.addRay(callbacks[i]->m_from, rayDirectionInverse, rayLength * callbacks[i]->m_hitFraction);
+		myNodeCallback.m_callbacks[lane] = callbacks[i];
+		myNodeCallback.m_rayLength[lane] = rayLength;
+		if (packet.m_numRays == BT_RAY_PACKET_SIZE)
+		{
+			m_bvh->reportRayPacketOverlappingNodex(&myNodeCallback, packet);
+			packet.clear();
+		}
+	}
+	if (packet.m_numRays)
+	{
+		m_bvh->reportRayPacketOverlappingNodex(&myNodeCallback, packet);
+	}
+}
+
 void btBvhTriangleMeshShape::performConvexcast(btTriangleCallback* callback, const btVector3& raySource, const btVector3& rayTarget, const btVector3& aabbMin, const btVector3& aabbMax)
 {
 	struct MyNodeOverlapCallback : public btNodeOverlapCallback
@@ -21,6 +21,8 @@ subject to the following restrictions:
 #include "LinearMath/btAlignedAllocator.h"
 #include "btTriangleInfoMap.h"
 
+class btTriangleRaycastCallback;
+
 ///The btBvhTriangleMeshShape is a static-triangle mesh shape, it can only be used for fixed/non-moving objects.
 ///If you required moving concave triangle meshes, it is recommended to perform convex decomposition
 ///using HACD, see Bullet/Demos/ConvexDecompositionDemo.
@@ -62,6 +64,9 @@ public:
 
 	void performRaycast(btTriangleCallback * callback, const btVector3& raySource, const btVector3& rayTarget);
 	void performConvexcast(btTriangleCallback * callback, const btVector3& boxSource, const btVector3& boxTarget, const btVector3& boxMin, const btVector3& boxMax);
+	///performRaycastPacket is performRaycast for many rays, each callback holds its ray in m_from and m_to. The rays walk the
+	///bvh together in packets of four, and the nodes behind the closest hit of a ray so far are skipped
+	void performRaycastPacket(btTriangleRaycastCallback * *callbacks, int numRays);
 
 	virtual void processAllTriangles(btTriangleCallback * callback, const btVector3& aabbMin, const btVector3& aabbMax) const;
 
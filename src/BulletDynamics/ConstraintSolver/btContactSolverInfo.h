@@ -72,8 +72,13 @@ struct btContactSolverInfoData
 	int m_numNonContactInnerIterations;
 };
 
+class btFrameArena;
+
 struct btContactSolverInfo : public btContactSolverInfoData
 {
+	///transient memory for the current step, set by the dynamics world. May be null, it is not serialized
+	btFrameArena* m_frameArena;
+
 	inline btContactSolverInfo()
 	{
 		m_tau = btScalar(0.6);
@@ -110,6 +115,7 @@ struct btContactSolverInfo : public btContactSolverInfoData
 		m_jointFeedbackInJointFrame = false;
 		m_reportSolverAnalytics = 0;
 		m_numNonContactInnerIterations = 1;   // the number of inner iterations for solving motor constraint in a single iteration of the constraint solve
+		m_frameArena = 0;
 	}
 };
 
@@ -16,6 +16,7 @@ subject to the following restrictions:
 #include "btSequentialImpulseConstraintSolverMt.h"
 
 #include "LinearMath/btQuickprof.h"
+#include "LinearMath/btFrameArena.h"
 
 #include "BulletCollision/NarrowPhaseCollision/btPersistentManifold.h"
 
@@ -513,7 +514,12 @@ struct AllocContactConstraintsLoop : public btIParallelForBody
 void btSequentialImpulseConstraintSolverMt::allocAllContactConstraints(btPersistentManifold** manifoldPtr, int numManifolds, const btContactSolverInfo& infoGlobal)
 {
 	BT_PROFILE("allocAllContactConstraints");
+	btFrameArenaScope arenaScope(infoGlobal.m_frameArena);
 	btAlignedObjectArray<btContactManifoldCachedInfo> cachedInfoArray;  // = m_manifoldCachedInfoArray;
+	if (infoGlobal.m_frameArena)
+	{
+		infoGlobal.m_frameArena->initializeArray(cachedInfoArray, numManifolds);
+	}
 	cachedInfoArray.resizeNoInitialize(numManifolds);
 	if (/* DISABLES CODE */ (false))
 	{
@@ -705,7 +711,12 @@ void btSequentialImpulseConstraintSolverMt::convertJoints(btTypedConstraint** co
 	}
 
 	int totalNumRows = 0;
+	btFrameArenaScope arenaScope(infoGlobal.m_frameArena);
 	btAlignedObjectArray<JointParams> jointParamsArray;
+	if (infoGlobal.m_frameArena)
+	{
+		infoGlobal.m_frameArena->initializeArray(jointParamsArray, numConstraints);
+	}
 	jointParamsArray.resizeNoInitialize(numConstraints);
 
 	//calculate the total number of contraint rows
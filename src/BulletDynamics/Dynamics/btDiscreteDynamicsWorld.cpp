@@ -23,6 +23,7 @@ subject to the following restrictions:
 #include "BulletCollision/CollisionDispatch/btSimulationIslandManager.h"
 #include "LinearMath/btTransformUtil.h"
 #include "LinearMath/btQuickprof.h"
+#include "LinearMath/btBatchedMath.h"
 
 //rigidbody & constraints
 #include "BulletDynamics/Dynamics/btRigidBody.h"
@@ -475,6 +476,7 @@ void btDiscreteDynamicsWorld::internalSingleStepSimulation(btScalar timeStep)
 	calculateSimulationIslands();
 
 	getSolverInfo().m_timeStep = timeStep;
+	getSolverInfo().m_frameArena = getFrameArena();
 
 	///solve contact and other joint constraints
 	solveConstraints(getSolverInfo());
@@ -485,6 +487,17 @@ void btDiscreteDynamicsWorld::internalSingleStepSimulation(btScalar timeStep)
 
 	integrateTransforms(timeStep);
 
+	if (btProfileHardwareCountersEnabled())
+	{
+		// lets profile dumps report cache misses per body and per contact
+		int numContacts = 0;
+		for (int i = 0; i < m_dispatcher1->getNumManifolds(); i++)
+		{
+			numContacts += m_dispatcher1->getManifoldByIndexInternal(i)->getNumContacts();
+		}
+		btSetProfileWorkUnits(m_nonStaticRigidBodies.size(), numContacts);
+	}
+
 	///update vehicle simulation
 	updateActions(timeStep);
 
@@ -681,6 +694,7 @@ void btDiscreteDynamicsWorld::removeCharacter(btActionInterface* character)
 void btDiscreteDynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
 {
 	BT_PROFILE("solveConstraints");
+	BT_MEMORY_TAG(BT_MEMORY_TAG_SOLVER);
 
 	m_sortedConstraints.resize(m_constraints.size());
 	int i;
@@ -709,6 +723,7 @@ void btDiscreteDynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
 void btDiscreteDynamicsWorld::calculateSimulationIslands()
 {
 	BT_PROFILE("calculateSimulationIslands");
+	BT_MEMORY_TAG(BT_MEMORY_TAG_SOLVER);
 
 	getSimulationIslandManager()->updateActivationState(getCollisionWorld(), getCollisionWorld()->getDispatcher());
 
@@ -941,6 +956,7 @@ void btDiscreteDynamicsWorld::releasePredictiveContacts()
 void btDiscreteDynamicsWorld::createPredictiveContacts(btScalar timeStep)
 {
 	BT_PROFILE("createPredictiveContacts");
+	BT_MEMORY_TAG(BT_MEMORY_TAG_NARROWPHASE);
 	releasePredictiveContacts();
 	if (m_nonStaticRigidBodies.size() > 0)
 	{
@@ -948,17 +964,94 @@ void btDiscreteDynamicsWorld::createPredictiveContacts(btScalar timeStep)
 	}
 }
 
+///the number of bodies the batched updates gather at a time, their structure of arrays lives on the stack
+#define BT_INTEGRATE_BATCH_SIZE 64
+
+///predictIntegratedTransform for up to BT_INTEGRATE_BATCH_SIZE bodies, with the btBatchedMath kernel
+static void btPredictIntegratedTransforms(btRigidBody* const* bodies, int numBodies, btScalar timeStep, btTransform* const* predictedTransforms)
+{
+	btAssert(numBodies <= BT_INTEGRATE_BATCH_SIZE);
+	btScalar origin[3][BT_INTEGRATE_BATCH_SIZE];
+	btScalar rotation[4][BT_INTEGRATE_BATCH_SIZE];
+	btScalar linearVelocity[3][BT_INTEGRATE_BATCH_SIZE];
+	btScalar angularVelocity[3][BT_INTEGRATE_BATCH_SIZE];
+	btScalar predictedBasis[9][BT_INTEGRATE_BATCH_SIZE];
+	btScalar predictedOrigin[3][BT_INTEGRATE_BATCH_SIZE];
+	for (int i = 0; i < numBodies; i++)
+	{
+		const btRigidBody* body = bodies[i];
+		btQuaternion orn = body->getWorldTransform().getRotation();
+		for (int j = 0; j < 3; j++)
+		{
+			origin[j][i] = body->getWorldTransform().getOrigin()[j];
+			rotation[j][i] = orn[j];
+			linearVelocity[j][i] = body->getLinearVelocity()[j];
+			angularVelocity[j][i] = body->getAngularVelocity()[j];
+		}
+		rotation[3][i] = orn.getW();
+	}
+
+	btScalar* originArrays[3] = {origin[0], origin[1], origin[2]};
+	btScalar* rotationArrays[4] = {rotation[0], rotation[1], rotation[2], rotation[3]};
+	btScalar* linearVelocityArrays[3] = {linearVelocity[0], linearVelocity[1], linearVelocity[2]};
+	btScalar* angularVelocityArrays[3] = {angularVelocity[0], angularVelocity[1], angularVelocity[2]};
+	btTransformSoa predicted;
+	for (int j = 0; j < 9; j++)
+	{
+		predicted.m_basis[j] = predictedBasis[j];
+	}
+	for (int j = 0; j < 3; j++)
+	{
+		predicted.m_origin[j] = predictedOrigin[j];
+	}
+	btIntegrateTransforms(originArrays, rotationArrays, linearVelocityArrays, angularVelocityArrays, timeStep, predicted, numBodies);
+
+	for (int i = 0; i < numBodies; i++)
+	{
+		btTransform& trans = *predictedTransforms[i];
+		trans.getBasis().setValue(predictedBasis[0][i], predictedBasis[1][i], predictedBasis[2][i],
+								  predictedBasis[3][i], predictedBasis[4][i], predictedBasis[5][i],
+								  predictedBasis[6][i], predictedBasis[7][i], predictedBasis[8][i]);
+		trans.getOrigin().setValue(predictedOrigin[0][i], predictedOrigin[1][i], predictedOrigin[2][i]);
+	}
+}
+
 void btDiscreteDynamicsWorld::integrateTransformsInternal(btRigidBody** bodies, int numBodies, btScalar timeStep)
 {
 	btTransform predictedTrans;
+	btTransform batchedTransforms[BT_INTEGRATE_BATCH_SIZE];
 	for (int i = 0; i < numBodies; i++)
 	{
+		if (m_batchedUpdates && (i % BT_INTEGRATE_BATCH_SIZE) == 0)
+		{
+			//predict the transforms of the next batch of moving bodies
+			btRigidBody* batch[BT_INTEGRATE_BATCH_SIZE];
+			btTransform* predicted[BT_INTEGRATE_BATCH_SIZE];
+			int count = 0;
+			for (int j = i; j < numBodies && j < i + BT_INTEGRATE_BATCH_SIZE; j++)
+			{
+				if (bodies[j]->isActive() && (!bodies[j]->isStaticOrKinematicObject()))
+				{
+					batch[count] = bodies[j];
+					predicted[count++] = &batchedTransforms[j - i];
+				}
+			}
+			btPredictIntegratedTransforms(batch, count, timeStep, predicted);
+		}
+
 		btRigidBody* body = bodies[i];
 		body->setHitFraction(1.f);
 
 		if (body->isActive() && (!body->isStaticOrKinematicObject()))
 		{
-			body->predictIntegratedTransform(timeStep, predictedTrans);
+			if (m_batchedUpdates)
+			{
+				predictedTrans = batchedTransforms[i % BT_INTEGRATE_BATCH_SIZE];
+			}
+			else
+			{
+				body->predictIntegratedTransform(timeStep, predictedTrans);
+			}
 
 			btScalar squareMotion = (predictedTrans.getOrigin() - body->getWorldTransform().getOrigin()).length2();
 
@@ -1088,21 +1181,49 @@ void btDiscreteDynamicsWorld::integrateTransforms(btScalar timeStep)
 	}
 }
 
-void btDiscreteDynamicsWorld::predictUnconstraintMotion(btScalar timeStep)
+void btDiscreteDynamicsWorld::predictUnconstraintMotionInternal(btRigidBody** bodies, int numBodies, btScalar timeStep)
 {
-	BT_PROFILE("predictUnconstraintMotion");
-	for (int i = 0; i < m_nonStaticRigidBodies.size(); i++)
+	btRigidBody* batch[BT_INTEGRATE_BATCH_SIZE];
+	btTransform* predicted[BT_INTEGRATE_BATCH_SIZE];
+	int count = 0;
+	for (int i = 0; i < numBodies; i++)
 	{
-		btRigidBody* body = m_nonStaticRigidBodies[i];
+		btRigidBody* body = bodies[i];
 		if (!body->isStaticOrKinematicObject())
 		{
 			//don't integrate/update velocities here, it happens in the constraint solver
 
 			body->applyDamping(timeStep);
 
-			body->predictIntegratedTransform(timeStep, body->getInterpolationWorldTransform());
+			if (m_batchedUpdates)
+			{
+				batch[count] = body;
+				predicted[count++] = &body->getInterpolationWorldTransform();
+				if (count == BT_INTEGRATE_BATCH_SIZE)
+				{
+					btPredictIntegratedTransforms(batch, count, timeStep, predicted);
+					count = 0;
+				}
+			}
+			else
+			{
+				body->predictIntegratedTransform(timeStep, body->getInterpolationWorldTransform());
+			}
 		}
 	}
+	if (count)
+	{
+		btPredictIntegratedTransforms(batch, count, timeStep, predicted);
+	}
+}
+
+void btDiscreteDynamicsWorld::predictUnconstraintMotion(btScalar timeStep)
+{
+	BT_PROFILE("predictUnconstraintMotion");
+	if (m_nonStaticRigidBodies.size() > 0)
+	{
+		predictUnconstraintMotionInternal(&m_nonStaticRigidBodies[0], m_nonStaticRigidBodies.size(), timeStep);
+	}
 }
 
 void btDiscreteDynamicsWorld::startProfiling(btScalar timeStep)
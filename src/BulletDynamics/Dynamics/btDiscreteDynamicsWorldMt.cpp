@@ -45,6 +45,7 @@ subject to the following restrictions:
 #include "LinearMath/btMotionState.h"
 
 #include "LinearMath/btSerializer.h"
+#include "LinearMath/btFrameArena.h"
 
 ///
 /// btConstraintSolverPoolMt
@@ -164,6 +165,7 @@ btDiscreteDynamicsWorldMt::btDiscreteDynamicsWorldMt(btDispatcher* dispatcher,
 		m_islandManager = im;
 	}
 	m_constraintSolverMt = constraintSolverMt;
+	m_simulationIslandsCalculated = false;
 }
 
 btDiscreteDynamicsWorldMt::~btDiscreteDynamicsWorldMt()
@@ -189,32 +191,13 @@ void btDiscreteDynamicsWorldMt::solveConstraints(btContactSolverInfo& solverInfo
 	m_constraintSolver->allSolved(solverInfo, m_debugDrawer);
 }
 
-struct UpdaterUnconstrainedMotion : public btIParallelForBody
-{
-	btScalar timeStep;
-	btRigidBody** rigidBodies;
-
-	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
-	{
-		for (int i = iBegin; i < iEnd; ++i)
-		{
-			btRigidBody* body = rigidBodies[i];
-			if (!body->isStaticOrKinematicObject())
-			{
-				//don't integrate/update velocities here, it happens in the constraint solver
-				body->applyDamping(timeStep);
-				body->predictIntegratedTransform(timeStep, body->getInterpolationWorldTransform());
-			}
-		}
-	}
-};
-
 void btDiscreteDynamicsWorldMt::predictUnconstraintMotion(btScalar timeStep)
 {
 	BT_PROFILE("predictUnconstraintMotion");
 	if (m_nonStaticRigidBodies.size() > 0)
 	{
 		UpdaterUnconstrainedMotion update;
+		update.world = this;
 		update.timeStep = timeStep;
 		update.rigidBodies = &m_nonStaticRigidBodies[0];
 		int grainSize = 50;  // num of iterations per task for task scheduler
@@ -251,6 +234,57 @@ void btDiscreteDynamicsWorldMt::integrateTransforms(btScalar timeStep)
 	}
 }
 
+void btDiscreteDynamicsWorldMt::dispatchAllCollisionPairs()
+{
+	BT_PROFILE("dispatchAllCollisionPairs");
+	BT_MEMORY_TAG(BT_MEMORY_TAG_NARROWPHASE);
+	getDispatcher()->dispatchAllCollisionPairs(m_broadphasePairCache->getOverlappingPairCache(), getDispatchInfo(), m_dispatcher1);
+}
+
+void btDiscreteDynamicsWorldMt::performDiscreteCollisionDetection()
+{
+	m_simulationIslandsCalculated = false;
+	btITaskScheduler* scheduler = btGetTaskScheduler();
+	if (!(scheduler && scheduler->supportsNestedParallelism() && getDispatcher()))
+	{
+		btDiscreteDynamicsWorld::performDiscreteCollisionDetection();
+		return;
+	}
+	BT_PROFILE("performDiscreteCollisionDetection");
+
+	if (m_frameArena)
+	{
+		m_frameArena->reset();
+	}
+
+	// the narrowphase needs the pairs of the broadphase, so those two stay in order
+	updateAabbs();
+
+	computeOverlappingPairs();
+
+	// the union find of the islands only reads the pairs, and the narrowphase neither reads the island tags
+	// nor adds or removes pairs, so both run at the same time (the narrowphase's own parallelFor runs nested)
+	NarrowphaseTask narrowphase;
+	narrowphase.world = this;
+	SimulationIslandsTask islands;
+	islands.world = this;
+	btTaskGraph graph;
+	graph.addTask(narrowphase);
+	graph.addTask(islands);
+	btRunTaskGraph(graph);
+	m_simulationIslandsCalculated = true;
+}
+
+void btDiscreteDynamicsWorldMt::calculateSimulationIslands()
+{
+	if (m_simulationIslandsCalculated)
+	{
+		m_simulationIslandsCalculated = false;
+		return;
+	}
+	btDiscreteDynamicsWorld::calculateSimulationIslands();
+}
+
 int btDiscreteDynamicsWorldMt::stepSimulation(btScalar timeStep, int maxSubSteps, btScalar fixedTimeStep)
 {
 	int numSubSteps = btDiscreteDynamicsWorld::stepSimulation(timeStep, maxSubSteps, fixedTimeStep);
@@ -78,6 +78,8 @@ private:
 ///     - predictUnconstraintMotion
 ///     - integrateTransforms
 ///     - createPredictiveContacts
+///  And with a task scheduler that supports nested parallelism, calculateSimulationIslands runs alongside
+///  the narrowphase, since the islands only depend on the overlapping pairs of the broadphase.
 ///
 ATTRIBUTE_ALIGNED16(class)
 btDiscreteDynamicsWorldMt : public btDiscreteDynamicsWorld
@@ -87,6 +89,17 @@ protected:
 
 	virtual void solveConstraints(btContactSolverInfo & solverInfo) BT_OVERRIDE;
 
+	struct UpdaterUnconstrainedMotion : public btIParallelForBody
+	{
+		btScalar timeStep;
+		btRigidBody** rigidBodies;
+		btDiscreteDynamicsWorldMt* world;
+
+		void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+		{
+			world->predictUnconstraintMotionInternal(&rigidBodies[iBegin], iEnd - iBegin, timeStep);
+		}
+	};
 	virtual void predictUnconstraintMotion(btScalar timeStep) BT_OVERRIDE;
 
 	struct UpdaterCreatePredictiveContacts : public btIParallelForBody
@@ -115,6 +128,29 @@ protected:
 	};
 	virtual void integrateTransforms(btScalar timeStep) BT_OVERRIDE;
 
+	bool m_simulationIslandsCalculated;  // set when performDiscreteCollisionDetection already calculated the islands of this step
+
+	struct NarrowphaseTask : public btITaskBody
+	{
+		btDiscreteDynamicsWorldMt* world;
+
+		void run() const BT_OVERRIDE
+		{
+			world->dispatchAllCollisionPairs();
+		}
+	};
+	struct SimulationIslandsTask : public btITaskBody
+	{
+		btDiscreteDynamicsWorldMt* world;
+
+		void run() const BT_OVERRIDE
+		{
+			world->btDiscreteDynamicsWorld::calculateSimulationIslands();
+		}
+	};
+	void dispatchAllCollisionPairs();
+	virtual void calculateSimulationIslands() BT_OVERRIDE;
+
 public:
 	BT_DECLARE_ALIGNED_ALLOCATOR();
 
@@ -126,6 +162,8 @@ public:
 	virtual ~btDiscreteDynamicsWorldMt();
 
 	virtual int stepSimulation(btScalar timeStep, int maxSubSteps, btScalar fixedTimeStep) BT_OVERRIDE;
+
+	virtual void performDiscreteCollisionDetection() BT_OVERRIDE;
 };
 
 #endif  //BT_DISCRETE_DYNAMICS_WORLD_H
@@ -573,6 +573,44 @@ struct UpdateIslandDispatcher : public btIParallelForBody
 	}
 };
 
+// solves the first islands one after the other with the parallel solver
+struct LargeIslandsTask : public btITaskBody
+{
+	btAlignedObjectArray<btSimulationIslandManagerMt::Island*>& m_islandsPtr;
+	const btSimulationIslandManagerMt::SolverParams& m_solverParams;
+	int m_numIslands;
+
+	LargeIslandsTask(btAlignedObjectArray<btSimulationIslandManagerMt::Island*>& islandsPtr, const btSimulationIslandManagerMt::SolverParams& solverParams, int numIslands)
+		: m_islandsPtr(islandsPtr), m_solverParams(solverParams), m_numIslands(numIslands)
+	{
+	}
+
+	void run() const BT_OVERRIDE
+	{
+		for (int i = 0; i < m_numIslands; ++i)
+		{
+			btSimulationIslandManagerMt::solveIsland(m_solverParams.m_solverMt, *m_islandsPtr[i], m_solverParams);
+		}
+	}
+};
+
+struct SmallIslandsTask : public btITaskBody
+{
+	const UpdateIslandDispatcher& m_dispatcher;
+	int m_begin;
+	int m_end;
+
+	SmallIslandsTask(const UpdateIslandDispatcher& dispatcher, int iBegin, int iEnd)
+		: m_dispatcher(dispatcher), m_begin(iBegin), m_end(iEnd)
+	{
+	}
+
+	void run() const BT_OVERRIDE
+	{
+		btParallelFor(m_begin, m_end, 1, m_dispatcher);
+	}
+};
+
 void btSimulationIslandManagerMt::parallelIslandDispatch(btAlignedObjectArray<Island*>* islandsPtr, const SolverParams& solverParams)
 {
 	BT_PROFILE("parallelIslandDispatch");
@@ -599,6 +637,12 @@ void btSimulationIslandManagerMt::parallelIslandDispatch(btAlignedObjectArray<Is
 	// any gains from parallelism.
 	//
 
+	// With a task scheduler that supports nested parallelism, the large islands and the small
+	// islands are solved at the same time: one task hands the large islands to the parallel
+	// solver (whose own parallelFor loops then run nested), the other solves the small islands
+	// in parallel.
+	//
+
 	UpdateIslandDispatcher dispatcher(*islandsPtr, solverParams);
 	// We take advantage of the fact the islands are sorted in order of decreasing size
 	int iBegin = 0;
@@ -612,11 +656,25 @@ void btSimulationIslandManagerMt::parallelIslandDispatch(btAlignedObjectArray<Is
 				// OK to submit the rest of the array in parallel
 				break;
 			}
-			// serial dispatch to parallel solver for large islands (if any)
-			solveIsland(solverParams.m_solverMt, *island, solverParams);
 			++iBegin;
 		}
 	}
+	btITaskScheduler* taskScheduler = btGetTaskScheduler();
+	if (iBegin > 0 && iBegin < islandsPtr->size() && taskScheduler && taskScheduler->supportsNestedParallelism())
+	{
+		LargeIslandsTask largeIslands(*islandsPtr, solverParams, iBegin);
+		SmallIslandsTask smallIslands(dispatcher, iBegin, islandsPtr->size());
+		btTaskGraph graph;
+		graph.addTask(largeIslands);
+		graph.addTask(smallIslands);
+		btRunTaskGraph(graph);
+		return;
+	}
+	// serial dispatch to parallel solver for large islands (if any)
+	for (int i = 0; i < iBegin; ++i)
+	{
+		solveIsland(solverParams.m_solverMt, *(*islandsPtr)[i], solverParams);
+	}
 	// parallel dispatch to sequential solvers for rest
 	btParallelFor(iBegin, islandsPtr->size(), 1, dispatcher);
 }
@@ -131,6 +131,7 @@ btMultiBody::btMultiBody(int n_links,
 	  m_internalNeedsJointFeedback(false),
 		m_kinematic_calculate_velocity(false)
 {
+	BT_MEMORY_TAG(BT_MEMORY_TAG_MULTIBODY);
 	m_cachedInertiaTopLeft.setValue(0, 0, 0, 0, 0, 0, 0, 0, 0);
 	m_cachedInertiaTopRight.setValue(0, 0, 0, 0, 0, 0, 0, 0, 0);
 	m_cachedInertiaLowerLeft.setValue(0, 0, 0, 0, 0, 0, 0, 0, 0);
@@ -346,6 +347,7 @@ void btMultiBody::setupPlanar(int i,
 
 void btMultiBody::finalizeMultiDof()
 {
+	BT_MEMORY_TAG(BT_MEMORY_TAG_MULTIBODY);
 	m_deltaV.resize(0);
 	m_deltaV.resize(6 + m_dofCount);
     m_splitV.resize(0);
@@ -19,12 +19,14 @@ subject to the following restrictions:
 #include "btMultiBodyLinkCollider.h"
 #include "BulletCollision/CollisionDispatch/btSimulationIslandManager.h"
 #include "LinearMath/btQuickprof.h"
+#include "LinearMath/btFrameArena.h"
 #include "btMultiBodyConstraint.h"
 #include "LinearMath/btIDebugDraw.h"
 #include "LinearMath/btSerializer.h"
 
 void btMultiBodyDynamicsWorld::addMultiBody(btMultiBody* body, int group, int mask)
 {
+	BT_MEMORY_TAG(BT_MEMORY_TAG_MULTIBODY);
 	m_multiBodies.push_back(body);
 }
 
@@ -42,6 +44,7 @@ void btMultiBodyDynamicsWorld::predictUnconstraintMotion(btScalar timeStep)
 void btMultiBodyDynamicsWorld::calculateSimulationIslands()
 {
 	BT_PROFILE("calculateSimulationIslands");
+	BT_MEMORY_TAG(BT_MEMORY_TAG_SOLVER);
 
 	getSimulationIslandManager()->updateActivationState(getCollisionWorld(), getCollisionWorld()->getDispatcher());
 
@@ -222,6 +225,7 @@ void btMultiBodyDynamicsWorld::forwardKinematics()
 }
 void btMultiBodyDynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
 {
+    BT_MEMORY_TAG(BT_MEMORY_TAG_SOLVER);
     solveExternalForces(solverInfo);
     buildIslands();
     solveInternalConstraints(solverInfo);
@@ -239,6 +243,7 @@ void btMultiBodyDynamicsWorld::solveInternalConstraints(btContactSolverInfo& sol
 	m_constraintSolver->allSolved(solverInfo, m_debugDrawer);
     {
         BT_PROFILE("btMultiBody stepVelocities");
+        BT_MEMORY_TAG(BT_MEMORY_TAG_MULTIBODY);
         for (int i = 0; i < this->m_multiBodies.size(); i++)
         {
             btMultiBody* bod = m_multiBodies[i];
@@ -290,6 +295,7 @@ void btMultiBodyDynamicsWorld::solveExternalForces(btContactSolverInfo& solverIn
     forwardKinematics();
     
     BT_PROFILE("solveConstraints");
+    BT_MEMORY_TAG(BT_MEMORY_TAG_SOLVER);
     
     clearMultiBodyConstraintForces();
     
@@ -317,6 +323,7 @@ void btMultiBodyDynamicsWorld::solveExternalForces(btContactSolverInfo& solverIn
 #ifndef BT_USE_VIRTUAL_CLEARFORCES_AND_GRAVITY
     {
         BT_PROFILE("btMultiBody addForce");
+        BT_MEMORY_TAG(BT_MEMORY_TAG_MULTIBODY);
         for (int i = 0; i < this->m_multiBodies.size(); i++)
         {
             btMultiBody* bod = m_multiBodies[i];
@@ -353,6 +360,7 @@ void btMultiBodyDynamicsWorld::solveExternalForces(btContactSolverInfo& solverIn
     
     {
         BT_PROFILE("btMultiBody stepVelocities");
+        BT_MEMORY_TAG(BT_MEMORY_TAG_MULTIBODY);
         for (int i = 0; i < this->m_multiBodies.size(); i++)
         {
             btMultiBody* bod = m_multiBodies[i];
@@ -390,7 +398,16 @@ void btMultiBodyDynamicsWorld::solveExternalForces(btContactSolverInfo& solverIn
                         //
                         int numDofs = bod->getNumDofs() + 6;
                         int numPosVars = bod->getNumPosVars() + 7;
+                        btFrameArenaScope arenaScope(getFrameArena());
                         btAlignedObjectArray<btScalar> scratch_r2;
+                        btAlignedObjectArray<btScalar> delta_q;
+                        btAlignedObjectArray<btScalar> delta_qd;
+                        if (getFrameArena())
+                        {
+                            getFrameArena()->initializeArray(scratch_r2, 2 * numPosVars + 8 * numDofs);
+                            getFrameArena()->initializeArray(delta_q, numDofs);
+                            getFrameArena()->initializeArray(delta_qd, numDofs);
+                        }
                         scratch_r2.resize(2 * numPosVars + 8 * numDofs);
                         //convenience
                         btScalar* pMem = &scratch_r2[0];
@@ -525,9 +542,7 @@ void btMultiBodyDynamicsWorld::solveExternalForces(btContactSolverInfo& solverIn
                         //
                         //calc q = q0 + h/6(qd0 + 2*(qd1 + qd2) + qd3)
                         //calc qd = qd0 + h/6(qdd0 + 2*(qdd1 + qdd2) + qdd3)
-                        btAlignedObjectArray<btScalar> delta_q;
                         delta_q.resize(numDofs);
-                        btAlignedObjectArray<btScalar> delta_qd;
                         delta_qd.resize(numDofs);
                         for (int i = 0; i < numDofs; ++i)
                         {
@@ -581,6 +596,7 @@ void btMultiBodyDynamicsWorld::integrateTransforms(btScalar timeStep)
 void btMultiBodyDynamicsWorld::integrateMultiBodyTransforms(btScalar timeStep)
 {
 		BT_PROFILE("btMultiBody stepPositions");
+		BT_MEMORY_TAG(BT_MEMORY_TAG_MULTIBODY);
 		//integrate and update the Featherstone hierarchies
 
 		for (int b = 0; b < m_multiBodies.size(); b++)
@@ -630,6 +646,7 @@ void btMultiBodyDynamicsWorld::integrateMultiBodyTransforms(btScalar timeStep)
 void btMultiBodyDynamicsWorld::predictMultiBodyTransforms(btScalar timeStep)
 {
     BT_PROFILE("btMultiBody stepPositions");
+    BT_MEMORY_TAG(BT_MEMORY_TAG_MULTIBODY);
     //integrate and update the Featherstone hierarchies
     
     for (int b = 0; b < m_multiBodies.size(); b++)
@@ -757,6 +774,7 @@ void btMultiBodyDynamicsWorld::applyGravity()
 	btDiscreteDynamicsWorld::applyGravity();
 #ifdef BT_USE_VIRTUAL_CLEARFORCES_AND_GRAVITY
 	BT_PROFILE("btMultiBody addGravity");
+	BT_MEMORY_TAG(BT_MEMORY_TAG_MULTIBODY);
 	for (int i = 0; i < this->m_multiBodies.size(); i++)
 	{
 		btMultiBody* bod = m_multiBodies[i];
@@ -19,6 +19,7 @@ subject to the following restrictions:
 #include "BulletDynamics/Featherstone/btMultiBodyLinkCollider.h"
 #include "BulletDynamics/Featherstone/btMultiBodyConstraint.h"
 #include "BulletDynamics/MLCPSolvers/btMLCPSolverInterface.h"
+#include "LinearMath/btFrameArena.h"
 
 #define DIRECTLY_UPDATE_VELOCITY_DURING_SOLVER_ITERATIONS
 
@@ -296,12 +297,18 @@ void btMultiBodyMLCPConstraintSolver::createMLCPFastRigidBody(const btContactSol
 	int m = m_allConstraintPtrArray.size();
 
 	int numBodies = m_tmpSolverBodyPool.size();
+	btFrameArenaScope arenaScope(infoGlobal.m_frameArena);
 	btAlignedObjectArray<int> bodyJointNodeArray;
+	btAlignedObjectArray<btJointNode1> jointNodeArray;
+	if (infoGlobal.m_frameArena)
+	{
+		infoGlobal.m_frameArena->initializeArray(bodyJointNodeArray, numBodies);
+		infoGlobal.m_frameArena->initializeArray(jointNodeArray, 2 * m_allConstraintPtrArray.size());
+	}
 	{
 		BT_PROFILE("bodyJointNodeArray.resize");
 		bodyJointNodeArray.resize(numBodies, -1);
 	}
-	btAlignedObjectArray<btJointNode1> jointNodeArray;
 	{
 		BT_PROFILE("jointNodeArray.reserve");
 		jointNodeArray.reserve(2 * m_allConstraintPtrArray.size());
@@ -17,6 +17,7 @@ subject to the following restrictions:
 #include "btMLCPSolver.h"
 #include "LinearMath/btMatrixX.h"
 #include "LinearMath/btQuickprof.h"
+#include "LinearMath/btFrameArena.h"
 #include "btSolveProjectedGaussSeidel.h"
 
 btMLCPSolver::btMLCPSolver(btMLCPSolverInterface* solver)
@@ -198,12 +199,18 @@ void btMLCPSolver::createMLCPFast(const btContactSolverInfo& infoGlobal)
 	int m = m_allConstraintPtrArray.size();
 
 	int numBodies = m_tmpSolverBodyPool.size();
+	btFrameArenaScope arenaScope(infoGlobal.m_frameArena);
 	btAlignedObjectArray<int> bodyJointNodeArray;
+	btAlignedObjectArray<btJointNode> jointNodeArray;
+	if (infoGlobal.m_frameArena)
+	{
+		infoGlobal.m_frameArena->initializeArray(bodyJointNodeArray, numBodies);
+		infoGlobal.m_frameArena->initializeArray(jointNodeArray, 2 * m_allConstraintPtrArray.size());
+	}
 	{
 		BT_PROFILE("bodyJointNodeArray.resize");
 		bodyJointNodeArray.resize(numBodies, -1);
 	}
-	btAlignedObjectArray<btJointNode> jointNodeArray;
 	{
 		BT_PROFILE("jointNodeArray.reserve");
 		jointNodeArray.reserve(2 * m_allConstraintPtrArray.size());
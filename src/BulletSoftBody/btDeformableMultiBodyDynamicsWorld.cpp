@@ -163,6 +163,7 @@ void btDeformableMultiBodyDynamicsWorld::updateActivationState(btScalar timeStep
 void btDeformableMultiBodyDynamicsWorld::applyRepulsionForce(btScalar timeStep)
 {
 	BT_PROFILE("btDeformableMultiBodyDynamicsWorld::applyRepulsionForce");
+	BT_MEMORY_TAG(BT_MEMORY_TAG_SOFTBODY);
 	for (int i = 0; i < m_softBodies.size(); i++)
 	{
 		btSoftBody* psb = m_softBodies[i];
@@ -176,6 +177,7 @@ void btDeformableMultiBodyDynamicsWorld::applyRepulsionForce(btScalar timeStep)
 void btDeformableMultiBodyDynamicsWorld::performGeometricCollisions(btScalar timeStep)
 {
 	BT_PROFILE("btDeformableMultiBodyDynamicsWorld::performGeometricCollisions");
+	BT_MEMORY_TAG(BT_MEMORY_TAG_SOFTBODY);
 	// refit the BVH tree for CCD
 	for (int i = 0; i < m_softBodies.size(); ++i)
 	{
@@ -261,6 +263,7 @@ void btDeformableMultiBodyDynamicsWorld::performGeometricCollisions(btScalar tim
 void btDeformableMultiBodyDynamicsWorld::softBodySelfCollision()
 {
 	BT_PROFILE("btDeformableMultiBodyDynamicsWorld::softBodySelfCollision");
+	BT_MEMORY_TAG(BT_MEMORY_TAG_SOFTBODY);
 	for (int i = 0; i < m_softBodies.size(); i++)
 	{
 		btSoftBody* psb = m_softBodies[i];
@@ -304,6 +307,7 @@ void btDeformableMultiBodyDynamicsWorld::integrateTransforms(btScalar timeStep)
 void btDeformableMultiBodyDynamicsWorld::solveConstraints(btScalar timeStep)
 {
 	BT_PROFILE("btDeformableMultiBodyDynamicsWorld::solveConstraints");
+	BT_MEMORY_TAG(BT_MEMORY_TAG_SOFTBODY);
 	// save v_{n+1}^* velocity after explicit forces
 	m_deformableBodySolver->backupVelocity();
 
@@ -440,6 +444,7 @@ void btDeformableMultiBodyDynamicsWorld::predictUnconstraintMotion(btScalar time
 {
 	BT_PROFILE("predictUnconstraintMotion");
 	btMultiBodyDynamicsWorld::predictUnconstraintMotion(timeStep);
+	BT_MEMORY_TAG(BT_MEMORY_TAG_SOFTBODY);
 	m_deformableBodySolver->predictMotion(timeStep);
 }
 
@@ -460,6 +465,7 @@ void btDeformableMultiBodyDynamicsWorld::reinitialize(btScalar timeStep)
 	dispatchInfo.m_stepCount = 0;
 	dispatchInfo.m_debugDraw = btMultiBodyDynamicsWorld::getDebugDrawer();
 	btMultiBodyDynamicsWorld::getSolverInfo().m_timeStep = timeStep;
+	btMultiBodyDynamicsWorld::getSolverInfo().m_frameArena = getFrameArena();
 	if (m_useProjection)
 	{
 		m_deformableBodySolver->m_useProjection = true;
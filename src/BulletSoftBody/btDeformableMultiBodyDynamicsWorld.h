@@ -266,6 +266,15 @@ public:
 #endif  //USE_BRUTEFORCE_RAYBROADPHASE
 	}
 
+	// deformable bodies need rayTest, one ray at a time
+	void rayTestBatch(const btVector3* rayFromWorld, const btVector3* rayToWorld, RayResultCallback** resultCallbacks, int numRays) const
+	{
+		for (int i = 0; i < numRays; i++)
+		{
+			rayTest(rayFromWorld[i], rayToWorld[i], *resultCallbacks[i]);
+		}
+	}
+
 	void rayTestSingle(const btTransform& rayFromTrans, const btTransform& rayToTrans,
 					   btCollisionObject* collisionObject,
 					   const btCollisionShape* collisionShape,
@@ -130,6 +130,7 @@ static inline btDbvtNode* buildTreeBottomUp(btAlignedObjectArray<btDbvtNode*>& l
 btSoftBody::btSoftBody(btSoftBodyWorldInfo* worldInfo, int node_count, const btVector3* x, const btScalar* m)
 	: m_softBodySolver(0), m_worldInfo(worldInfo)
 {
+	BT_MEMORY_TAG(BT_MEMORY_TAG_SOFTBODY);
 	/* Init		*/
 	initDefaults();
 
@@ -164,6 +165,7 @@ btSoftBody::btSoftBody(btSoftBodyWorldInfo* worldInfo, int node_count, const btV
 btSoftBody::btSoftBody(btSoftBodyWorldInfo* worldInfo)
 	: m_worldInfo(worldInfo)
 {
+	BT_MEMORY_TAG(BT_MEMORY_TAG_SOFTBODY);
 	initDefaults();
 }
 
@@ -65,7 +65,8 @@ btSoftBodyRigidBodyCollisionConfiguration::btSoftBodyRigidBodyCollisionConfigura
 			m_collisionAlgorithmPool->~btPoolAllocator();
 			btAlignedFree(m_collisionAlgorithmPool);
 			void* mem = btAlignedAlloc(sizeof(btPoolAllocator), 16);
-			m_collisionAlgorithmPool = new (mem) btPoolAllocator(collisionAlgorithmMaxElementSize, constructionInfo.m_defaultMaxCollisionAlgorithmPoolSize);
+			m_collisionAlgorithmPool = new (mem) btPoolAllocator(collisionAlgorithmMaxElementSize, constructionInfo.m_defaultMaxCollisionAlgorithmPoolSize, constructionInfo.m_usePoolThreadCaches);
+			m_collisionAlgorithmPool->setGrowable(constructionInfo.m_growablePools);
 		}
 	}
 }
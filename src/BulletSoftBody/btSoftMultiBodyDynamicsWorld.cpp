@@ -71,6 +71,7 @@ void btSoftMultiBodyDynamicsWorld::predictUnconstraintMotion(btScalar timeStep)
 	btDiscreteDynamicsWorld::predictUnconstraintMotion(timeStep);
 	{
 		BT_PROFILE("predictUnconstraintMotionSoftBody");
+		BT_MEMORY_TAG(BT_MEMORY_TAG_SOFTBODY);
 		m_softBodySolver->predictMotion(float(timeStep));
 	}
 }
@@ -87,6 +88,7 @@ void btSoftMultiBodyDynamicsWorld::internalSingleStepSimulation(btScalar timeSte
 
 	btDiscreteDynamicsWorld::internalSingleStepSimulation(timeStep);
 
+	BT_MEMORY_TAG(BT_MEMORY_TAG_SOFTBODY);
 	///solve soft bodies constraints
 	solveSoftBodiesConstraints(timeStep);
 
@@ -112,6 +114,7 @@ void btSoftMultiBodyDynamicsWorld::internalSingleStepSimulation(btScalar timeSte
 void btSoftMultiBodyDynamicsWorld::solveSoftBodiesConstraints(btScalar timeStep)
 {
 	BT_PROFILE("solveSoftConstraints");
+	BT_MEMORY_TAG(BT_MEMORY_TAG_SOFTBODY);
 
 	if (m_softBodies.size())
 	{
@@ -268,6 +271,14 @@ void btSoftMultiBodyDynamicsWorld::rayTest(const btVector3& rayFromWorld, const
 #endif  //USE_BRUTEFORCE_RAYBROADPHASE
 }
 
+void btSoftMultiBodyDynamicsWorld::rayTestBatch(const btVector3* rayFromWorld, const btVector3* rayToWorld, RayResultCallback** resultCallbacks, int numRays) const
+{
+	for (int i = 0; i < numRays; i++)
+	{
+		rayTest(rayFromWorld[i], rayToWorld[i], *resultCallbacks[i]);
+	}
+}
+
 void btSoftMultiBodyDynamicsWorld::rayTestSingle(const btTransform& rayFromTrans, const btTransform& rayToTrans,
 												 btCollisionObject* collisionObject,
 												 const btCollisionShape* collisionShape,
@@ -71,6 +71,7 @@ void btSoftRigidDynamicsWorld::predictUnconstraintMotion(btScalar timeStep)
 	btDiscreteDynamicsWorld::predictUnconstraintMotion(timeStep);
 	{
 		BT_PROFILE("predictUnconstraintMotionSoftBody");
+		BT_MEMORY_TAG(BT_MEMORY_TAG_SOFTBODY);
 		m_softBodySolver->predictMotion(float(timeStep));
 	}
 }
@@ -87,6 +88,7 @@ void btSoftRigidDynamicsWorld::internalSingleStepSimulation(btScalar timeStep)
 
 	btDiscreteDynamicsWorld::internalSingleStepSimulation(timeStep);
 
+	BT_MEMORY_TAG(BT_MEMORY_TAG_SOFTBODY);
 	///solve soft bodies constraints
 	solveSoftBodiesConstraints(timeStep);
 
@@ -107,6 +109,7 @@ void btSoftRigidDynamicsWorld::internalSingleStepSimulation(btScalar timeStep)
 void btSoftRigidDynamicsWorld::solveSoftBodiesConstraints(btScalar timeStep)
 {
 	BT_PROFILE("solveSoftConstraints");
+	BT_MEMORY_TAG(BT_MEMORY_TAG_SOFTBODY);
 
 	if (m_softBodies.size())
 	{
@@ -263,6 +266,14 @@ void btSoftRigidDynamicsWorld::rayTest(const btVector3& rayFromWorld, const btVe
 #endif  //USE_BRUTEFORCE_RAYBROADPHASE
 }
 
+void btSoftRigidDynamicsWorld::rayTestBatch(const btVector3* rayFromWorld, const btVector3* rayToWorld, RayResultCallback** resultCallbacks, int numRays) const
+{
+	for (int i = 0; i < numRays; i++)
+	{
+		rayTest(rayFromWorld[i], rayToWorld[i], *resultCallbacks[i]);
+	}
+}
+
 void btSoftRigidDynamicsWorld::rayTestSingle(const btTransform& rayFromTrans, const btTransform& rayToTrans,
 											 btCollisionObject* collisionObject,
 											 const btCollisionShape* collisionShape,
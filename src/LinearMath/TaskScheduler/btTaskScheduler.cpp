@@ -10,6 +10,12 @@
 
 #include "btThreadSupportInterface.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <thread>
+
 #if defined(_WIN32)
 
 #define WIN32_LEAN_AND_MEAN
@@ -93,7 +99,8 @@ ThreadLocalStorage
 	WorkerThreadDirectives* m_directive;
 	JobQueue* m_queue;
 	btClock* m_clock;
-	unsigned int m_cooldownTime;
+	unsigned int m_cooldownTime;  // spin this long before yielding
+	unsigned int m_yieldTime;     // then yield this long before going to sleep
 };
 
 struct IJob
@@ -401,13 +408,17 @@ static void WorkerThreadFunc(void* userPtr)
 						break;
 					}
 				}
-				// if no jobs incoming and queue has been empty for the cooldown time, sleep
+				// if no jobs incoming and queue has been empty for the cooldown and yield time, sleep
 				btU64 timeElapsed = localStorage->m_clock->getTimeMicroseconds() - clockStart;
-				if (timeElapsed > localStorage->m_cooldownTime)
+				if (timeElapsed > localStorage->m_cooldownTime + localStorage->m_yieldTime)
 				{
 					shouldSleep = true;
 					break;
 				}
+				if (timeElapsed > localStorage->m_cooldownTime)
+				{
+					std::this_thread::yield();
+				}
 			}
 		}
 	}
@@ -464,9 +475,11 @@ public:
 		}
 	}
 
-	void init()
+	void init(const btWorkerThreadInfo& info)
 	{
 		btThreadSupportInterface::ConstructionInfo constructionInfo("TaskScheduler", WorkerThreadFunc);
+		constructionInfo.m_workerAffinityMasks = info.m_affinityMasks;
+		constructionInfo.m_numWorkerAffinityMasks = info.m_numAffinityMasks;
 		m_threadSupport = btThreadSupportInterface::create(constructionInfo);
 		m_workerDirective = static_cast<WorkerThreadDirectives*>(btAlignedAlloc(sizeof(*m_workerDirective), 64));
 
@@ -509,7 +522,8 @@ public:
 			storage.m_threadId = i;
 			storage.m_directive = m_workerDirective;
 			storage.m_status = WorkerThreadStatus::kSleeping;
-			storage.m_cooldownTime = 100;  // 100 microseconds, threads go to sleep after this long if they have nothing to do
+			storage.m_cooldownTime = m_workerWaitPolicy.m_spinTime;  // threads go to sleep after this long if they have nothing to do
+			storage.m_yieldTime = m_workerWaitPolicy.m_yieldTime;
 			storage.m_clock = &m_clock;
 			storage.m_queue = m_perThreadJobQueues[i];
 		}
@@ -616,6 +630,10 @@ public:
 			ThreadLocalStorage& storage = m_threadLocalStorage[kFirstWorkerThreadId + iWorker];
 			if (storage.m_status == WorkerThreadStatus::kSleeping)
 			{
+				// a worker that has not got around to starting yet must not be started a second time
+				storage.m_mutex.lock();
+				storage.m_status = WorkerThreadStatus::kWaitingForWork;
+				storage.m_mutex.unlock();
 				m_threadSupport->runTask(iWorker, &storage);
 				numActiveWorkers++;
 			}
@@ -638,7 +656,22 @@ public:
 	{
 		BT_PROFILE("sleepWorkerThreadsHint");
 		// hint the task scheduler that we may not be using these threads for a little while
-		setWorkerDirectives(WorkerThreadDirectives::kGoToSleep);
+		if (m_workerWaitPolicy.m_parkOnSleepHint)
+		{
+			setWorkerDirectives(WorkerThreadDirectives::kGoToSleep);
+		}
+	}
+
+	virtual void setWorkerWaitPolicy(const btWorkerWaitPolicy& policy) BT_OVERRIDE
+	{
+		btITaskScheduler::setWorkerWaitPolicy(policy);
+		// workers read the times without locking, change them while they sleep
+		waitForWorkersToSleep();
+		for (int i = 0; i < m_threadLocalStorage.size(); ++i)
+		{
+			m_threadLocalStorage[i].m_cooldownTime = policy.m_spinTime;
+			m_threadLocalStorage[i].m_yieldTime = policy.m_yieldTime;
+		}
 	}
 
 	void prepareWorkerThreads()
@@ -776,12 +809,737 @@ public:
 };
 
 btITaskScheduler* btCreateDefaultTaskScheduler()
+{
+	return btCreateDefaultTaskScheduler(btWorkerThreadInfo());
+}
+
+btITaskScheduler* btCreateDefaultTaskScheduler(const btWorkerThreadInfo& info)
 {
 	btTaskSchedulerDefault* ts = new btTaskSchedulerDefault();
-	ts->init();
+	ts->init(info);
 	return ts;
 }
 
+//
+// Work-stealing scheduler
+//
+// Every thread (including the main thread) owns a Chase-Lev deque of ranges. A thread splits the range
+// it is working on in halves, keeps the left half and pushes the right half onto the bottom of its own
+// deque; idle threads steal from the top of other deques, so they always take the largest pending
+// ranges. Splitting is adaptive: a range is only split a limited number of times (enough for a few
+// chunks per thread) unless it was stolen, which means there are idle threads and it is worth splitting
+// further. Ranges are never split below the grain size.
+//
+// The scheduler is re-entrant. A parallelFor or task graph started from inside a loop body or a task
+// pushes its work onto the deque of the calling thread, which then keeps running (and stealing) work
+// until its own loop has finished instead of blocking.
+//
+
+class btTaskSchedulerWorkStealing;
+
+// parallelFor/parallelSum/task graph run that is being worked on
+struct StealingLoop
+{
+	const btIParallelForBody* m_forBody;
+	const btIParallelSumBody* m_sumBody;
+	const btTaskGraph* m_graph;
+	// per thread partial sums of a parallelSum
+	btScalar* m_sums;
+	// per task count of unfinished predecessors of a task graph
+	std::atomic<int>* m_pending;
+	int m_grainSize;
+	// iterations (or graph tasks) not yet executed, the run returns when this reaches 0
+	std::atomic<int> m_remaining;
+
+	StealingLoop()
+	{
+		m_forBody = NULL;
+		m_sumBody = NULL;
+		m_graph = NULL;
+		m_sums = NULL;
+		m_pending = NULL;
+		m_grainSize = 1;
+	}
+};
+
+// deque element, fields are atomic so that a thief can read an element the owner is overwriting (the
+// thief then fails to claim it anyway)
+struct StealingRange
+{
+	std::atomic<StealingLoop*> m_loop;
+	std::atomic<int> m_begin;
+	std::atomic<int> m_end;
+	std::atomic<int> m_splitDepth;
+};
+
+struct StealingTask
+{
+	StealingLoop* m_loop;
+	int m_begin;
+	int m_end;
+	int m_splitDepth;
+};
+
+struct StealingRangeArray
+{
+	btU64 m_capacity;  // power of 2
+	StealingRange* m_ranges;
+
+	StealingRange& at(btU64 index) const
+	{
+		return m_ranges[index & (m_capacity - 1)];
+	}
+};
+
+// Chase-Lev work-stealing deque (Le, Pop, Cohen, Zappa Nardelli: "Correct and Efficient Work-Stealing for
+// Weak Memory Models"). Ranges of a loop are split depth first, so a loop only needs about one element per
+// bit of its iteration count, but nested loops and task graphs can push more. The owner grows the array
+// when it is full; thieves may still be reading the old one, so old arrays are freed with the deque.
+ATTRIBUTE_ALIGNED64(class)
+StealingDeque
+{
+	static const int kInitialCapacity = 256;
+	std::atomic<btU64> m_top;
+	char m_cachePadding[kCacheLineSize];  // thieves write top, the owner writes bottom
+	std::atomic<btU64> m_bottom;
+	std::atomic<StealingRangeArray*> m_array;
+	btAlignedObjectArray<StealingRangeArray*> m_allArrays;
+
+	static StealingRangeArray* allocArray(btU64 capacity)
+	{
+		StealingRangeArray* array = new (btAlignedAlloc(sizeof(StealingRangeArray), 16)) StealingRangeArray();
+		array->m_capacity = capacity;
+		array->m_ranges = static_cast<StealingRange*>(btAlignedAlloc(sizeof(StealingRange) * capacity, kCacheLineSize));
+		for (btU64 i = 0; i < capacity; ++i)
+		{
+			new (&array->m_ranges[i]) StealingRange();
+		}
+		return array;
+	}
+
+	static void store(StealingRange & r, const StealingTask& task)
+	{
+		r.m_loop.store(task.m_loop, std::memory_order_relaxed);
+		r.m_begin.store(task.m_begin, std::memory_order_relaxed);
+		r.m_end.store(task.m_end, std::memory_order_relaxed);
+		r.m_splitDepth.store(task.m_splitDepth, std::memory_order_relaxed);
+	}
+	static void load(const StealingRange& r, StealingTask* task)
+	{
+		task->m_loop = r.m_loop.load(std::memory_order_relaxed);
+		task->m_begin = r.m_begin.load(std::memory_order_relaxed);
+		task->m_end = r.m_end.load(std::memory_order_relaxed);
+		task->m_splitDepth = r.m_splitDepth.load(std::memory_order_relaxed);
+	}
+
+	StealingRangeArray* grow(StealingRangeArray * array, btU64 top, btU64 bottom)
+	{
+		StealingRangeArray* bigger = allocArray(array->m_capacity * 2);
+		for (btU64 i = top; i < bottom; ++i)
+		{
+			StealingTask task;
+			load(array->at(i), &task);
+			store(bigger->at(i), task);
+		}
+		m_allArrays.push_back(bigger);
+		m_array.store(bigger, std::memory_order_release);
+		return bigger;
+	}
+
+public:
+	StealingDeque()
+	{
+		// start at 1 so that bottom - 1 in pop never wraps around
+		m_top.store(1, std::memory_order_relaxed);
+		m_bottom.store(1, std::memory_order_relaxed);
+		m_allArrays.push_back(allocArray(kInitialCapacity));
+		m_array.store(m_allArrays[0], std::memory_order_relaxed);
+	}
+	~StealingDeque()
+	{
+		for (int i = 0; i < m_allArrays.size(); ++i)
+		{
+			btAlignedFree(m_allArrays[i]->m_ranges);
+			btAlignedFree(m_allArrays[i]);
+		}
+	}
+
+	// owner only
+	void push(const StealingTask& task)
+	{
+		btU64 b = m_bottom.load(std::memory_order_relaxed);
+		btU64 t = m_top.load(std::memory_order_acquire);
+		StealingRangeArray* array = m_array.load(std::memory_order_relaxed);
+		if (b - t >= array->m_capacity)
+		{
+			array = grow(array, t, b);
+		}
+		store(array->at(b), task);
+		// publishes the range (and the loop it points to) to thieves
+		m_bottom.store(b + 1, std::memory_order_release);
+	}
+
+	// owner only, takes the most recently pushed range
+	bool pop(StealingTask * task)
+	{
+		btU64 b = m_bottom.load(std::memory_order_relaxed) - 1;
+		StealingRangeArray* array = m_array.load(std::memory_order_relaxed);
+		m_bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		btU64 t = m_top.load(std::memory_order_relaxed);
+		if (t > b)
+		{
+			// empty
+			m_bottom.store(b + 1, std::memory_order_relaxed);
+			return false;
+		}
+		load(array->at(b), task);
+		if (t == b)
+		{
+			// last element, race against thieves for it
+			bool won = m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+			m_bottom.store(b + 1, std::memory_order_relaxed);
+			return won;
+		}
+		return true;
+	}
+
+	// any thread, takes the oldest (largest) range
+	bool steal(StealingTask * task)
+	{
+		btU64 t = m_top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		btU64 b = m_bottom.load(std::memory_order_acquire);
+		if (t >= b)
+		{
+			return false;
+		}
+		StealingRangeArray* array = m_array.load(std::memory_order_acquire);
+		load(array->at(t), task);
+		return m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+	}
+};
+
+ATTRIBUTE_ALIGNED64(struct)
+StealingThreadStorage
+{
+	StealingDeque m_deque;
+	btTaskSchedulerWorkStealing* m_scheduler;
+	int m_threadId;
+	unsigned int m_randomSeed;
+};
+
+class btTaskSchedulerWorkStealing;
+
+struct StealingWorkerInfo
+{
+	btTaskSchedulerWorkStealing* m_scheduler;
+	int m_threadId;
+};
+
+// storage of the scheduler thread that runs on this thread, NULL outside of the scheduler
+static thread_local StealingThreadStorage* gCurrentStealingThread = NULL;
+
+static void StealingWorkerThreadFunc(void* userPtr);
+
+// Workers are started once and stay in their thread function until the scheduler is destroyed. When they
+// run out of work they spin and yield as the btWorkerWaitPolicy says and then park on a condition variable,
+// parallelFor wakes them up again. Each worker allocates its own storage, so a pinned worker gets its deque
+// from its own NUMA node.
+class btTaskSchedulerWorkStealing : public btITaskScheduler
+{
+	btThreadSupportInterface* m_threadSupport;
+	btAlignedObjectArray<StealingThreadStorage*> m_threadStorage;
+	btAlignedObjectArray<StealingWorkerInfo> m_workerInfo;
+	std::atomic<int> m_numWorkersStarted;
+	std::atomic<int> m_workerDirective;  // WorkerThreadDirectives::Type for all workers
+	btSpinMutex m_antiNestingLock;       // only one thread outside of the scheduler can start work at a time
+	btClock m_clock;
+	std::atomic<int> m_numThreads;
+	int m_maxNumThreads;
+	std::atomic<unsigned int> m_spinTime;   // microseconds
+	std::atomic<unsigned int> m_yieldTime;  // microseconds
+
+	// parked workers
+	std::mutex m_parkMutex;
+	std::condition_variable m_parkCondition;
+	std::atomic<int> m_numParked;
+	unsigned int m_wakeGeneration;
+	std::atomic<bool> m_shutdown;
+
+	static const int kFirstWorkerThreadId = 1;
+	// extra splits for a stolen range
+	static const int kStolenSplitDepth = 2;
+
+	// split a range down to the grain size or the split depth, pushing the right halves, then run it
+	void executeTask(StealingThreadStorage * storage, StealingTask task)
+	{
+		StealingLoop* loop = task.m_loop;
+		while (task.m_end - task.m_begin > loop->m_grainSize && task.m_splitDepth > 0)
+		{
+			int mid = task.m_begin + (task.m_end - task.m_begin) / 2;
+			task.m_splitDepth--;
+			StealingTask right = task;
+			right.m_begin = mid;
+			storage->m_deque.push(right);
+			task.m_end = mid;
+		}
+		if (loop->m_forBody)
+		{
+			loop->m_forBody->forLoop(task.m_begin, task.m_end);
+		}
+		else if (loop->m_sumBody)
+		{
+			loop->m_sums[storage->m_threadId] += loop->m_sumBody->sumLoop(task.m_begin, task.m_end);
+		}
+		else
+		{
+			const btTaskGraph& graph = *loop->m_graph;
+			for (int i = task.m_begin; i < task.m_end; ++i)
+			{
+				graph.getTaskBody(i).run();
+				// continuations that are now ready run on this thread unless they get stolen
+				for (int j = 0; j < graph.getNumSuccessors(i); ++j)
+				{
+					int successor = graph.getSuccessor(i, j);
+					if (loop->m_pending[successor].fetch_sub(1, std::memory_order_acq_rel) == 1)
+					{
+						StealingTask next = {loop, successor, successor + 1, 0};
+						storage->m_deque.push(next);
+					}
+				}
+			}
+		}
+		loop->m_remaining.fetch_sub(task.m_end - task.m_begin, std::memory_order_release);
+	}
+
+	bool stealTask(StealingThreadStorage * storage, StealingTask * task)
+	{
+		int numThreads = m_numThreads.load(std::memory_order_relaxed);
+		if (storage->m_threadId >= numThreads)
+		{
+			// disabled by setNumThreads, only finishes the ranges it has pushed itself
+			return false;
+		}
+		// start at a random victim so that thieves spread out
+		storage->m_randomSeed = storage->m_randomSeed * 1664525u + 1013904223u;
+		int first = int((storage->m_randomSeed >> 16) % unsigned(numThreads));
+		for (int i = 0; i < numThreads; ++i)
+		{
+			int victim = first + i;
+			if (victim >= numThreads)
+			{
+				victim -= numThreads;
+			}
+			if (victim != storage->m_threadId && m_threadStorage[victim]->m_deque.steal(task))
+			{
+				task->m_splitDepth += kStolenSplitDepth;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool runOneTask(StealingThreadStorage * storage)
+	{
+		StealingTask task;
+		if (storage->m_deque.pop(&task) || stealTask(storage, &task))
+		{
+			executeTask(storage, task);
+			return true;
+		}
+		return false;
+	}
+
+	// returns the storage of the calling thread if it is already working for this scheduler
+	StealingThreadStorage* getNestingThread() const
+	{
+		StealingThreadStorage* storage = gCurrentStealingThread;
+		return (storage && storage->m_scheduler == this) ? storage : NULL;
+	}
+
+	// pushes the initial ranges of a loop, then works until the loop has finished. For a nested loop
+	// the workers are already awake and the calling thread helps with other work while it waits.
+	void runLoop(StealingThreadStorage * storage, StealingLoop * loop, const StealingTask* tasks, int numTasks, bool nested)
+	{
+		for (int i = 0; i < numTasks; ++i)
+		{
+			storage->m_deque.push(tasks[i]);
+		}
+		if (!nested)
+		{
+			m_workerDirective.store(WorkerThreadDirectives::kScanForJobs, std::memory_order_seq_cst);
+			wakeWorkers();
+		}
+
+		while (loop->m_remaining.load(std::memory_order_acquire) > 0)
+		{
+			if (!runOneTask(storage))
+			{
+				btSpinPause();
+			}
+		}
+
+		if (!nested)
+		{
+			m_workerDirective.store(WorkerThreadDirectives::kStayAwakeButIdle, std::memory_order_release);
+		}
+	}
+
+	// runs a loop on the scheduler threads, returns false if the caller has to run it serially
+	bool runLoop(StealingLoop * loop, const StealingTask* tasks, int numTasks)
+	{
+		if (StealingThreadStorage* storage = getNestingThread())
+		{
+			runLoop(storage, loop, tasks, numTasks, true);
+			return true;
+		}
+		if (!m_antiNestingLock.tryLock())
+		{
+			// another thread outside of the scheduler is running a loop
+			return false;
+		}
+		StealingThreadStorage* storage = m_threadStorage[0];
+		gCurrentStealingThread = storage;
+		runLoop(storage, loop, tasks, numTasks, false);
+		gCurrentStealingThread = NULL;
+		m_antiNestingLock.unlock();
+		return true;
+	}
+
+	int getInitialSplitDepth() const
+	{
+		// split into about 4 ranges per thread up front, stolen ranges are split further
+		int splitDepth = 0;
+		while ((1 << splitDepth) < m_numThreads.load(std::memory_order_relaxed) * 4)
+		{
+			splitDepth++;
+		}
+		return splitDepth;
+	}
+
+	void wakeWorkers()
+	{
+		// pairs with the check in parkWorker: either the worker sees kScanForJobs or we see it parked
+		if (m_numParked.load(std::memory_order_seq_cst) > 0)
+		{
+			BT_PROFILE("wakeWorkers");
+			{
+				std::lock_guard<std::mutex> lock(m_parkMutex);
+				m_wakeGeneration++;
+			}
+			m_parkCondition.notify_all();
+		}
+	}
+
+	bool shouldPark(StealingThreadStorage * storage) const
+	{
+		return storage->m_threadId >= m_numThreads.load(std::memory_order_relaxed) ||
+			   m_workerDirective.load(std::memory_order_seq_cst) != WorkerThreadDirectives::kScanForJobs;
+	}
+
+	void parkWorker(StealingThreadStorage * storage)
+	{
+		BT_PROFILE("parkWorker");
+		std::unique_lock<std::mutex> lock(m_parkMutex);
+		m_numParked.fetch_add(1, std::memory_order_seq_cst);
+		unsigned int generation = m_wakeGeneration;
+		if (shouldPark(storage))
+		{
+			while (generation == m_wakeGeneration && !m_shutdown.load(std::memory_order_relaxed))
+			{
+				m_parkCondition.wait(lock);
+			}
+		}
+		m_numParked.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+public:
+	btTaskSchedulerWorkStealing() : btITaskScheduler("WorkStealing")
+	{
+		m_threadSupport = NULL;
+		m_workerDirective.store(WorkerThreadDirectives::kGoToSleep);
+		m_numThreads.store(1);
+		m_maxNumThreads = 1;
+		m_numWorkersStarted.store(0);
+		m_spinTime.store(m_workerWaitPolicy.m_spinTime);
+		m_yieldTime.store(m_workerWaitPolicy.m_yieldTime);
+		m_numParked.store(0);
+		m_wakeGeneration = 0;
+		m_shutdown.store(false);
+	}
+
+	virtual ~btTaskSchedulerWorkStealing()
+	{
+		if (m_threadSupport)
+		{
+			BT_PROFILE("waitForWorkersToExit");
+			{
+				std::lock_guard<std::mutex> lock(m_parkMutex);
+				m_shutdown.store(true);
+			}
+			m_parkCondition.notify_all();
+			m_threadSupport->waitForAllTasks();
+			delete m_threadSupport;
+			m_threadSupport = NULL;
+		}
+		for (int i = 0; i < m_threadStorage.size(); ++i)
+		{
+			m_threadStorage[i]->~StealingThreadStorage();
+			btAlignedFree(m_threadStorage[i]);
+		}
+		m_threadStorage.clear();
+	}
+
+	StealingThreadStorage* createThreadStorage(int threadId)
+	{
+		void* mem = btAlignedAlloc(sizeof(StealingThreadStorage), kCacheLineSize);
+		StealingThreadStorage* storage = new (mem) StealingThreadStorage();  // placement new
+		storage->m_scheduler = this;
+		storage->m_threadId = threadId;
+		storage->m_randomSeed = 0x9e3779b9u * unsigned(threadId + 1);
+		return storage;
+	}
+
+	// all workers have published their storage, so thieves can look at every deque
+	void waitForWorkersToStart() const
+	{
+		while (m_numWorkersStarted.load(std::memory_order_acquire) < m_maxNumThreads - kFirstWorkerThreadId)
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	void workerLoop(StealingThreadStorage * storage)
+	{
+		gCurrentStealingThread = storage;
+		btU64 clockStart = m_clock.getTimeMicroseconds();
+		while (!m_shutdown.load(std::memory_order_acquire))
+		{
+			if (runOneTask(storage))
+			{
+				clockStart = m_clock.getTimeMicroseconds();
+				continue;
+			}
+			if (!shouldPark(storage))
+			{
+				clockStart = m_clock.getTimeMicroseconds();  // jobs are incoming, reset clock
+			}
+			else
+			{
+				btU64 timeElapsed = m_clock.getTimeMicroseconds() - clockStart;
+				unsigned int spinTime = m_spinTime.load(std::memory_order_relaxed);
+				if (m_workerDirective.load(std::memory_order_relaxed) == WorkerThreadDirectives::kGoToSleep ||
+					timeElapsed > spinTime + m_yieldTime.load(std::memory_order_relaxed))
+				{
+					parkWorker(storage);
+					clockStart = m_clock.getTimeMicroseconds();
+					continue;
+				}
+				if (timeElapsed > spinTime)
+				{
+					std::this_thread::yield();
+					continue;
+				}
+			}
+			for (int i = 0; i < 4; ++i)
+			{
+				btSpinPause();
+			}
+		}
+		gCurrentStealingThread = NULL;
+	}
+
+	void init(const btWorkerThreadInfo& info)
+	{
+		btThreadSupportInterface::ConstructionInfo constructionInfo("TaskSchedulerWorkStealing", StealingWorkerThreadFunc);
+		constructionInfo.m_workerAffinityMasks = info.m_affinityMasks;
+		constructionInfo.m_numWorkerAffinityMasks = info.m_numAffinityMasks;
+		m_threadSupport = btThreadSupportInterface::create(constructionInfo);
+		m_maxNumThreads = m_threadSupport->getNumWorkerThreads() + 1;
+
+		m_threadStorage.resize(m_maxNumThreads, NULL);
+		m_threadStorage[0] = createThreadStorage(0);
+		setNumThreads(m_threadSupport->getCacheFriendlyNumThreads());
+		m_workerInfo.resize(m_maxNumThreads);
+		for (int i = kFirstWorkerThreadId; i < m_maxNumThreads; ++i)
+		{
+			m_workerInfo[i].m_scheduler = this;
+			m_workerInfo[i].m_threadId = i;
+			m_threadSupport->runTask(i - kFirstWorkerThreadId, &m_workerInfo[i]);
+		}
+		waitForWorkersToStart();
+	}
+
+	// thread function of worker threads, returns when the scheduler is destroyed
+	void workerMain(int threadId)
+	{
+		// allocated on the worker thread, so it is local to the worker's NUMA node
+		m_threadStorage[threadId] = createThreadStorage(threadId);
+		m_numWorkersStarted.fetch_add(1, std::memory_order_release);
+		waitForWorkersToStart();
+		workerLoop(m_threadStorage[threadId]);
+	}
+
+	virtual int getMaxNumThreads() const BT_OVERRIDE
+	{
+		return m_maxNumThreads;
+	}
+
+	virtual int getNumThreads() const BT_OVERRIDE
+	{
+		return m_numThreads.load(std::memory_order_relaxed);
+	}
+
+	virtual void setNumThreads(int numThreads) BT_OVERRIDE
+	{
+		m_numThreads.store(btMax(btMin(numThreads, int(m_maxNumThreads)), 1));
+	}
+
+	virtual void sleepWorkerThreadsHint() BT_OVERRIDE
+	{
+		BT_PROFILE("sleepWorkerThreadsHint");
+		if (m_workerWaitPolicy.m_parkOnSleepHint)
+		{
+			m_workerDirective.store(WorkerThreadDirectives::kGoToSleep, std::memory_order_release);
+		}
+	}
+
+	virtual void setWorkerWaitPolicy(const btWorkerWaitPolicy& policy) BT_OVERRIDE
+	{
+		btITaskScheduler::setWorkerWaitPolicy(policy);
+		m_spinTime.store(policy.m_spinTime, std::memory_order_relaxed);
+		m_yieldTime.store(policy.m_yieldTime, std::memory_order_relaxed);
+	}
+
+	virtual bool supportsNestedParallelism() const BT_OVERRIDE
+	{
+		return true;
+	}
+
+	virtual void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body) BT_OVERRIDE
+	{
+		BT_PROFILE("parallelFor_WorkStealing");
+		btAssert(iEnd >= iBegin);
+		btAssert(grainSize >= 1);
+		int iterationCount = iEnd - iBegin;
+		if (iterationCount > grainSize && getNumThreads() > 1)
+		{
+			StealingLoop loop;
+			loop.m_forBody = &body;
+			loop.m_grainSize = grainSize;
+			loop.m_remaining.store(iterationCount, std::memory_order_relaxed);
+			StealingTask task = {&loop, iBegin, iEnd, getInitialSplitDepth()};
+			if (runLoop(&loop, &task, 1))
+			{
+				return;
+			}
+		}
+		{
+			BT_PROFILE("parallelFor_mainThread");
+			// just run on the calling thread
+			body.forLoop(iBegin, iEnd);
+		}
+	}
+
+	virtual btScalar parallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSumBody& body) BT_OVERRIDE
+	{
+		BT_PROFILE("parallelSum_WorkStealing");
+		btAssert(iEnd >= iBegin);
+		btAssert(grainSize >= 1);
+		int iterationCount = iEnd - iBegin;
+		if (iterationCount > grainSize && getNumThreads() > 1)
+		{
+			btScalar sums[BT_MAX_THREAD_COUNT];
+			for (int i = 0; i < m_maxNumThreads; ++i)
+			{
+				sums[i] = btScalar(0);
+			}
+			StealingLoop loop;
+			loop.m_sumBody = &body;
+			loop.m_sums = sums;
+			loop.m_grainSize = grainSize;
+			loop.m_remaining.store(iterationCount, std::memory_order_relaxed);
+			StealingTask task = {&loop, iBegin, iEnd, getInitialSplitDepth()};
+			if (runLoop(&loop, &task, 1))
+			{
+				// partial sums are added before m_remaining is decremented, so they are complete here
+				btScalar sum = btScalar(0);
+				for (int i = 0; i < m_maxNumThreads; ++i)
+				{
+					sum += sums[i];
+				}
+				return sum;
+			}
+		}
+		{
+			BT_PROFILE("parallelSum_mainThread");
+			// just run on the calling thread
+			return body.sumLoop(iBegin, iEnd);
+		}
+	}
+
+	virtual void runTaskGraph(const btTaskGraph& graph) BT_OVERRIDE
+	{
+		BT_PROFILE("runTaskGraph_WorkStealing");
+		int numTasks = graph.getNumTasks();
+		if (numTasks == 0)
+		{
+			return;
+		}
+		if (getNumThreads() <= 1)
+		{
+			btITaskScheduler::runTaskGraph(graph);
+			return;
+		}
+
+		std::atomic<int>* pending = static_cast<std::atomic<int>*>(btAlignedAlloc(sizeof(std::atomic<int>) * numTasks, 16));
+		btAlignedObjectArray<StealingTask> roots;
+		StealingLoop loop;
+		loop.m_graph = &graph;
+		loop.m_pending = pending;
+		loop.m_remaining.store(numTasks, std::memory_order_relaxed);
+		for (int i = 0; i < numTasks; ++i)
+		{
+			new (&pending[i]) std::atomic<int>(graph.getNumPredecessors(i));
+			if (graph.getNumPredecessors(i) == 0)
+			{
+				StealingTask task = {&loop, i, i + 1, 0};
+				roots.push_back(task);
+			}
+		}
+		btAssert(roots.size() > 0);  // the dependencies contain a cycle
+		if (!runLoop(&loop, &roots[0], roots.size()))
+		{
+			btITaskScheduler::runTaskGraph(graph);
+		}
+		btAlignedFree(pending);
+	}
+};
+
+static void StealingWorkerThreadFunc(void* userPtr)
+{
+	StealingWorkerInfo* info = (StealingWorkerInfo*)userPtr;
+	info->m_scheduler->workerMain(info->m_threadId);
+}
+
+btITaskScheduler* btCreateWorkStealingTaskScheduler()
+{
+	return btCreateWorkStealingTaskScheduler(btWorkerThreadInfo());
+}
+
+btITaskScheduler* btCreateWorkStealingTaskScheduler(const btWorkerThreadInfo& info)
+{
+	btTaskSchedulerWorkStealing* ts = new btTaskSchedulerWorkStealing();
+	ts->init(info);
+	return ts;
+}
+
+btAffinityMask btGetNumaNodeAffinityMask(int node)
+{
+	return btThreadSupportInterface::getNumaNodeAffinityMask(node);
+}
+
 #else  // #if BT_THREADSAFE
 
 btITaskScheduler* btCreateDefaultTaskScheduler()
@@ -789,4 +1547,24 @@ btITaskScheduler* btCreateDefaultTaskScheduler()
 	return NULL;
 }
 
+btITaskScheduler* btCreateDefaultTaskScheduler(const btWorkerThreadInfo&)
+{
+	return NULL;
+}
+
+btITaskScheduler* btCreateWorkStealingTaskScheduler()
+{
+	return NULL;
+}
+
+btITaskScheduler* btCreateWorkStealingTaskScheduler(const btWorkerThreadInfo&)
+{
+	return NULL;
+}
+
+btAffinityMask btGetNumaNodeAffinityMask(int)
+{
+	return btAffinityMask();
+}
+
 #endif  // #else // #if BT_THREADSAFE
@@ -16,6 +16,8 @@ subject to the following restrictions:
 #ifndef BT_THREAD_SUPPORT_INTERFACE_H
 #define BT_THREAD_SUPPORT_INTERFACE_H
 
+class btAffinityMask;
+
 class btCriticalSection
 {
 public:
@@ -49,16 +51,24 @@ public:
 						 int threadStackSize = 65535)
 			: m_uniqueName(uniqueName),
 			  m_userThreadFunc(userThreadFunc),
-			  m_threadStackSize(threadStackSize)
+			  m_threadStackSize(threadStackSize),
+			  m_workerAffinityMasks(0),
+			  m_numWorkerAffinityMasks(0)
 		{
 		}
 
 		const char* m_uniqueName;
 		ThreadFunc m_userThreadFunc;
 		int m_threadStackSize;
+		// worker thread i may only run on the logical processors in m_workerAffinityMasks[i % m_numWorkerAffinityMasks],
+		// an empty mask (or no masks) keeps the default placement
+		const btAffinityMask* m_workerAffinityMasks;
+		int m_numWorkerAffinityMasks;
 	};
 
 	static btThreadSupportInterface* create(const ConstructionInfo& info);
+	// the logical processors of a NUMA node, empty if the node does not exist or it is unknown
+	static btAffinityMask getNumaNodeAffinityMask(int node);
 };
 
 #endif  //BT_THREAD_SUPPORT_INTERFACE_H
@@ -30,6 +30,7 @@ subject to the following restrictions:
 #define _XOPEN_SOURCE 600  //for definition of pthread_barrier_t, see http://pages.cs.wisc.edu/~travitch/pthreads_primer.html
 #endif                     //_XOPEN_SOURCE
 #include <pthread.h>
+#include <sched.h>
 #include <semaphore.h>
 #include <unistd.h>  //for sysconf
 
@@ -116,7 +117,7 @@ public:
 	}
 
 // The number of threads should be equal to the number of available cores
-// Todo: each worker should be linked to a single core, using SetThreadIdealProcessor.
+// Workers are only pinned to cores if ConstructionInfo has affinity masks.
 
 btThreadSupportPosix::btThreadSupportPosix(const ConstructionInfo& threadConstructionInfo)
 {
@@ -212,6 +213,25 @@ void btThreadSupportPosix::runTask(int threadIndex, void* userData)
 	btThreadStatus& threadStatus = m_activeThreadStatus[threadIndex];
 	btAssert(threadIndex >= 0);
 	btAssert(threadIndex < m_activeThreadStatus.size());
+	if (m_startedThreadsMask & (UINT64(1) << threadIndex))
+	{
+		// the user function of the previous task may have returned while threadFunction has not yet
+		// reported it, collect that response first so that every task posts the main semaphore once
+		while (true)
+		{
+			m_cs->lock();
+			bool hasFinished = (2 == threadStatus.m_status);
+			m_cs->unlock();
+			if (hasFinished)
+			{
+				break;
+			}
+			sched_yield();
+		}
+		checkPThreadFunction(sem_wait(m_mainSemaphore));
+		threadStatus.m_status = 0;
+		m_startedThreadsMask &= ~(UINT64(1) << threadIndex);
+	}
 	threadStatus.m_cs = m_cs;
 	threadStatus.m_commandId = 1;
 	threadStatus.m_status = 1;
@@ -288,8 +308,43 @@ void btThreadSupportPosix::startThreads(const ConstructionInfo& threadConstructi
 		threadStatus.m_mainSemaphore = m_mainSemaphore;
 		threadStatus.m_userThreadFunc = threadConstructionInfo.m_userThreadFunc;
 		threadStatus.threadUsed = 0;
-		checkPThreadFunction(pthread_create(&threadStatus.thread, NULL, &threadFunction, (void*)&threadStatus));
 
+		pthread_attr_t attr;
+		checkPThreadFunction(pthread_attr_init(&attr));
+		const btAffinityMask* affinityMask = NULL;
+		if (threadConstructionInfo.m_numWorkerAffinityMasks > 0)
+		{
+			affinityMask = &threadConstructionInfo.m_workerAffinityMasks[i % threadConstructionInfo.m_numWorkerAffinityMasks];
+		}
+#if defined(__linux__)
+		cpu_set_t* cpuSet = NULL;
+		if (affinityMask && !affinityMask->isEmpty())
+		{
+			// pin before the thread starts, so that everything it allocates is placed on its NUMA node
+			int numCpus = affinityMask->getProcessorLimit();
+			size_t cpuSetSize = CPU_ALLOC_SIZE(numCpus);
+			cpuSet = CPU_ALLOC(numCpus);
+			CPU_ZERO_S(cpuSetSize, cpuSet);
+			for (int cpu = 0; cpu < numCpus; ++cpu)
+			{
+				if (affinityMask->hasProcessor(cpu))
+				{
+					CPU_SET_S(cpu, cpuSetSize, cpuSet);
+				}
+			}
+			checkPThreadFunction(pthread_attr_setaffinity_np(&attr, cpuSetSize, cpuSet));
+		}
+#else
+		(void)affinityMask;  // no affinity api, leave the placement to the OS
+#endif
+		checkPThreadFunction(pthread_create(&threadStatus.thread, &attr, &threadFunction, (void*)&threadStatus));
+		checkPThreadFunction(pthread_attr_destroy(&attr));
+#if defined(__linux__)
+		if (cpuSet)
+		{
+			CPU_FREE(cpuSet);
+		}
+#endif
 	}
 }
 
@@ -350,4 +405,43 @@ btThreadSupportInterface* btThreadSupportInterface::create(const ConstructionInf
 	return new btThreadSupportPosix(info);
 }
 
+btAffinityMask btThreadSupportInterface::getNumaNodeAffinityMask(int node)
+{
+	btAffinityMask mask;
+#if defined(__linux__)
+	// a list of ranges like "0-7,16-23"
+	char fileName[64];
+	snprintf(fileName, sizeof(fileName), "/sys/devices/system/node/node%d/cpulist", node);
+	if (FILE* file = fopen(fileName, "r"))
+	{
+		int first = 0;
+		while (fscanf(file, "%d", &first) == 1)
+		{
+			int last = first;
+			int separator = fgetc(file);
+			if (separator == '-')
+			{
+				if (fscanf(file, "%d", &last) != 1)
+				{
+					break;
+				}
+				separator = fgetc(file);
+			}
+			for (int cpu = btMax(first, 0); cpu <= last; ++cpu)
+			{
+				mask.setProcessor(cpu);
+			}
+			if (separator != ',')
+			{
+				break;
+			}
+		}
+		fclose(file);
+	}
+#else
+	(void)node;
+#endif
+	return mask;
+}
+
 #endif  // BT_THREADSAFE && !defined( _WIN32 )
@@ -373,6 +373,33 @@ void btThreadSupportWin32::startThreads(const ConstructionInfo& threadConstructi
 				}
 			}
 			SetThreadIdealProcessor(handle, processorId);
+			if (threadConstructionInfo.m_numWorkerAffinityMasks > 0)
+			{
+				// masks given by the user replace the team placement. A thread runs in one processor group,
+				// the first group the mask has processors in.
+				const btAffinityMask& affinityMask = threadConstructionInfo.m_workerAffinityMasks[i % threadConstructionInfo.m_numWorkerAffinityMasks];
+				int group = 0;
+				while (group < affinityMask.getNumWords() && !affinityMask.getWord(group))
+				{
+					group++;
+				}
+				if (group == 0)
+				{
+					DWORD_PTR mask = DWORD_PTR(affinityMask.getWord(0)) & dwProcessAffinityMask;
+					if (mask)
+					{
+						SetThreadAffinityMask(handle, mask);
+					}
+				}
+				else if (group < affinityMask.getNumWords())
+				{
+					GROUP_AFFINITY groupAffinity;
+					memset(&groupAffinity, 0, sizeof(groupAffinity));
+					groupAffinity.Mask = KAFFINITY(affinityMask.getWord(group));
+					groupAffinity.Group = WORD(group);
+					SetThreadGroupAffinity(handle, &groupAffinity, NULL);
+				}
+			}
 		}
 
 		threadStatus.m_taskId = i;
@@ -454,4 +481,15 @@ btThreadSupportInterface* btThreadSupportInterface::create(const ConstructionInf
 	return new btThreadSupportWin32(info);
 }
 
+btAffinityMask btThreadSupportInterface::getNumaNodeAffinityMask(int node)
+{
+	btAffinityMask mask;
+	GROUP_AFFINITY groupAffinity;
+	if (node >= 0 && node <= 0xffff && GetNumaNodeProcessorMaskEx(USHORT(node), &groupAffinity))
+	{
+		mask.setWord(groupAffinity.Group, groupAffinity.Mask);
+	}
+	return mask;
+}
+
 #endif  //defined(_WIN32) && BT_THREADSAFE
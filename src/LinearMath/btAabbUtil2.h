@@ -19,6 +19,11 @@ subject to the following restrictions:
 #include "btVector3.h"
 #include "btMinMax.h"
 
+#if !defined(BT_USE_DOUBLE_PRECISION) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+#define BT_RAY_PACKET_USE_SSE 1
+#include <xmmintrin.h>
+#endif
+
 SIMD_FORCE_INLINE void AabbExpand(btVector3& aabbMin,
 								  btVector3& aabbMax,
 								  const btVector3& expansionMin,
@@ -114,6 +119,107 @@ SIMD_FORCE_INLINE bool btRayAabb2(const btVector3& rayFrom,
 	return ((tmin < lambda_max) && (tmax > lambda_min));
 }
 
+#define BT_RAY_PACKET_SIZE 4
+
+///btRayPacket holds up to four rays in SoA layout, with the cached data of btRayAabb2, so that btRayPacketAabb tests them
+///against an aabb at once
+ATTRIBUTE_ALIGNED16(struct)
+btRayPacket
+{
+	btScalar m_rayFrom[3][BT_RAY_PACKET_SIZE];
+	btScalar m_rayDirectionInverse[3][BT_RAY_PACKET_SIZE];
+	btScalar m_lambda_max[BT_RAY_PACKET_SIZE];
+	int m_numRays;
+
+	btRayPacket()
+	{
+		clear();
+	}
+
+	void clear()
+	{
+		for (int lane = 0; lane < BT_RAY_PACKET_SIZE; lane++)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				m_rayFrom[axis][lane] = btScalar(0);
+				m_rayDirectionInverse[axis][lane] = btScalar(0);
+			}
+			m_lambda_max[lane] = btScalar(0);
+		}
+		m_numRays = 0;
+	}
+
+	///adds a ray that starts at rayFrom and runs lambda_max along its normalized direction, returns its lane
+	int addRay(const btVector3& rayFrom, const btVector3& rayDirectionInverse, btScalar lambda_max)
+	{
+		btAssert(m_numRays < BT_RAY_PACKET_SIZE);
+		const int lane = m_numRays++;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			m_rayFrom[axis][lane] = rayFrom[axis];
+			m_rayDirectionInverse[axis][lane] = rayDirectionInverse[axis];
+		}
+		m_lambda_max[lane] = lambda_max;
+		return lane;
+	}
+
+	btVector3 getRayFrom(int lane) const
+	{
+		return btVector3(m_rayFrom[0][lane], m_rayFrom[1][lane], m_rayFrom[2][lane]);
+	}
+
+	btVector3 getRayDirectionInverse(int lane) const
+	{
+		return btVector3(m_rayDirectionInverse[0][lane], m_rayDirectionInverse[1][lane], m_rayDirectionInverse[2][lane]);
+	}
+};
+
+///btRayPacketAabb is btRayAabb2 for all rays of a packet, it returns a mask with bit i set when ray i hits the aabb
+SIMD_FORCE_INLINE int btRayPacketAabb(const btRayPacket& packet,
+									  const btVector3& aabbMin,
+									  const btVector3& aabbMax,
+									  btScalar lambda_min)
+{
+#if BT_RAY_PACKET_USE_SSE
+	// unaligned loads, ATTRIBUTE_ALIGNED16 is empty on some platforms
+	__m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(aabbMin.getX()), _mm_loadu_ps(packet.m_rayFrom[0])), _mm_loadu_ps(packet.m_rayDirectionInverse[0]));
+	__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(aabbMax.getX()), _mm_loadu_ps(packet.m_rayFrom[0])), _mm_loadu_ps(packet.m_rayDirectionInverse[0]));
+	__m128 tmin = _mm_min_ps(t0, t1);
+	__m128 tmax = _mm_max_ps(t0, t1);
+	t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(aabbMin.getY()), _mm_loadu_ps(packet.m_rayFrom[1])), _mm_loadu_ps(packet.m_rayDirectionInverse[1]));
+	t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(aabbMax.getY()), _mm_loadu_ps(packet.m_rayFrom[1])), _mm_loadu_ps(packet.m_rayDirectionInverse[1]));
+	tmin = _mm_max_ps(tmin, _mm_min_ps(t0, t1));
+	tmax = _mm_min_ps(tmax, _mm_max_ps(t0, t1));
+	t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(aabbMin.getZ()), _mm_loadu_ps(packet.m_rayFrom[2])), _mm_loadu_ps(packet.m_rayDirectionInverse[2]));
+	t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(aabbMax.getZ()), _mm_loadu_ps(packet.m_rayFrom[2])), _mm_loadu_ps(packet.m_rayDirectionInverse[2]));
+	tmin = _mm_max_ps(tmin, _mm_min_ps(t0, t1));
+	tmax = _mm_min_ps(tmax, _mm_max_ps(t0, t1));
+	__m128 hit = _mm_and_ps(_mm_cmple_ps(tmin, tmax), _mm_cmplt_ps(tmin, _mm_loadu_ps(packet.m_lambda_max)));
+	hit = _mm_and_ps(hit, _mm_cmpgt_ps(tmax, _mm_set1_ps(lambda_min)));
+	return _mm_movemask_ps(hit) & ((1 << packet.m_numRays) - 1);
+#else
+	int mask = 0;
+	for (int lane = 0; lane < packet.m_numRays; lane++)
+	{
+		btScalar tmin = -SIMD_INFINITY;
+		btScalar tmax = SIMD_INFINITY;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			const btScalar t0 = (aabbMin[axis] - packet.m_rayFrom[axis][lane]) * packet.m_rayDirectionInverse[axis][lane];
+			const btScalar t1 = (aabbMax[axis] - packet.m_rayFrom[axis][lane]) * packet.m_rayDirectionInverse[axis][lane];
+			tmin = btMax(tmin, btMin(t0, t1));
+			tmax = btMin(tmax, btMax(t0, t1));
+		}
+		if (tmin <= tmax && tmin < packet.m_lambda_max[lane] && tmax > lambda_min)
+		{
+			mask |= 1 << lane;
+		}
+	}
+	return mask;
+#endif
+}
+
 SIMD_FORCE_INLINE bool btRayAabb(const btVector3& rayFrom,
 								 const btVector3& rayTo,
 								 const btVector3& aabbMin,
@@ -108,6 +108,119 @@ void btAlignedAllocSetCustom(btAllocFunc *allocFunc, btFreeFunc *freeFunc)
 	sFreeFunc = freeFunc ? freeFunc : btFreeDefault;
 }
 
+#if defined(_MSC_VER)
+#define BT_MEMORY_TAG_THREAD_LOCAL __declspec(thread) static
+#elif __cplusplus >= 201103L
+#define BT_MEMORY_TAG_THREAD_LOCAL thread_local static
+#else
+#define BT_MEMORY_TAG_THREAD_LOCAL static
+#endif
+
+BT_MEMORY_TAG_THREAD_LOCAL int sCurrentMemoryTag = BT_MEMORY_TAG_GENERAL;
+
+btMemoryTag btSetMemoryTag(btMemoryTag tag)
+{
+	btAssert(tag >= 0 && tag < BT_NUM_MEMORY_TAGS);
+	btMemoryTag previous = btMemoryTag(sCurrentMemoryTag);
+	sCurrentMemoryTag = tag;
+	return previous;
+}
+
+btMemoryTag btGetMemoryTag()
+{
+	return btMemoryTag(sCurrentMemoryTag);
+}
+
+const char *btGetMemoryTagName(btMemoryTag tag)
+{
+	static const char *names[BT_NUM_MEMORY_TAGS] = {
+		"general",
+		"broadphase",
+		"narrowphase",
+		"solver",
+		"softbody",
+		"multibody",
+		"serializer"};
+	return tag >= 0 && tag < BT_NUM_MEMORY_TAGS ? names[tag] : "unknown";
+}
+
+#if BT_USE_MEMORY_TAGS && !defined(BT_DEBUG_MEMORY_ALLOCATIONS)
+#define BT_TRACK_MEMORY_TAGS 1
+#endif
+
+#if BT_TRACK_MEMORY_TAGS
+// the counters are updated from all threads
+#include <atomic>
+
+struct btMemoryTagCounters
+{
+	std::atomic<size_t> m_liveBytes;
+	std::atomic<size_t> m_peakBytes;
+	std::atomic<unsigned long long> m_numAllocations;
+	std::atomic<unsigned long long> m_numFrees;
+	std::atomic<size_t> m_budget;
+	std::atomic<btMemoryBudgetFunc *> m_budgetFunc;
+	std::atomic<void *> m_budgetUserData;
+	// threads that allocate under different tags do not share a cache line
+	char m_padding[64];
+};
+
+// zero initialized before any static constructor can allocate
+static btMemoryTagCounters sMemoryTags[BT_NUM_MEMORY_TAGS];
+
+void btGetMemoryTagStatistics(btMemoryTag tag, btMemoryTagStatistics &stats)
+{
+	btAssert(tag >= 0 && tag < BT_NUM_MEMORY_TAGS);
+	const btMemoryTagCounters &counters = sMemoryTags[tag];
+	stats.m_liveBytes = counters.m_liveBytes.load(std::memory_order_relaxed);
+	stats.m_peakBytes = counters.m_peakBytes.load(std::memory_order_relaxed);
+	stats.m_numAllocations = counters.m_numAllocations.load(std::memory_order_relaxed);
+	stats.m_numFrees = counters.m_numFrees.load(std::memory_order_relaxed);
+	stats.m_budget = counters.m_budget.load(std::memory_order_relaxed);
+}
+
+void btResetMemoryTagPeaks()
+{
+	for (int i = 0; i < BT_NUM_MEMORY_TAGS; i++)
+	{
+		sMemoryTags[i].m_peakBytes.store(sMemoryTags[i].m_liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+}
+
+void btSetMemoryBudget(btMemoryTag tag, size_t budget, btMemoryBudgetFunc *budgetFunc, void *userData)
+{
+	btAssert(tag >= 0 && tag < BT_NUM_MEMORY_TAGS);
+	btMemoryTagCounters &counters = sMemoryTags[tag];
+	// an allocation that sees the new budget also sees its callback
+	counters.m_budgetFunc.store(budgetFunc, std::memory_order_relaxed);
+	counters.m_budgetUserData.store(userData, std::memory_order_relaxed);
+	counters.m_budget.store(budget, std::memory_order_release);
+}
+
+#else  //BT_TRACK_MEMORY_TAGS
+
+void btGetMemoryTagStatistics(btMemoryTag tag, btMemoryTagStatistics &stats)
+{
+	btAssert(tag >= 0 && tag < BT_NUM_MEMORY_TAGS);
+	(void)tag;
+	memset(&stats, 0, sizeof(stats));
+}
+
+void btResetMemoryTagPeaks()
+{
+}
+
+void btSetMemoryBudget(btMemoryTag tag, size_t budget, btMemoryBudgetFunc *budgetFunc, void *userData)
+{
+	btAssert(tag >= 0 && tag < BT_NUM_MEMORY_TAGS);
+	(void)tag;
+	(void)budget;
+	(void)budgetFunc;
+	(void)userData;
+}
+
+#endif  //BT_TRACK_MEMORY_TAGS
+
 #ifdef BT_DEBUG_MEMORY_ALLOCATIONS
 
 static int allocations_id[10241024];
@@ -244,7 +357,70 @@ void btAlignedFreeInternal(void *ptr, int line, const char *filename)
 	}
 }
 
-#else  //BT_DEBUG_MEMORY_ALLOCATIONS
+#elif BT_TRACK_MEMORY_TAGS
+
+///sits right in front of the memory returned by btAlignedAllocInternal
+struct btMemoryTagHeader
+{
+	size_t m_size;
+	int m_tag;
+	int m_offset;  // from the start of the real allocation
+};
+
+static inline void btMemoryTagAllocated(int tag, size_t size)
+{
+	btMemoryTagCounters &counters = sMemoryTags[tag];
+	size_t liveBytes = counters.m_liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+	size_t peakBytes = counters.m_peakBytes.load(std::memory_order_relaxed);
+	while (liveBytes > peakBytes && !counters.m_peakBytes.compare_exchange_weak(peakBytes, liveBytes, std::memory_order_relaxed))
+	{
+	}
+	counters.m_numAllocations.fetch_add(1, std::memory_order_relaxed);
+	size_t budget = counters.m_budget.load(std::memory_order_acquire);
+	if (budget && liveBytes > budget && liveBytes - size <= budget)
+	{
+		if (btMemoryBudgetFunc *budgetFunc = counters.m_budgetFunc.load(std::memory_order_relaxed))
+		{
+			budgetFunc(btMemoryTag(tag), liveBytes, budget, counters.m_budgetUserData.load(std::memory_order_relaxed));
+		}
+	}
+}
+
+void *btAlignedAllocInternal(size_t size, int alignment)
+{
+	// the header offset is a multiple of the alignment, so the returned memory stays aligned
+	int offset = alignment < 16 ? 16 : alignment;
+	char *real = (char *)sAlignedAllocFunc(size + offset, offset);
+	if (!real)
+	{
+		return 0;
+	}
+	void *ptr = real + offset;
+	btMemoryTagHeader *header = (btMemoryTagHeader *)ptr - 1;
+	header->m_size = size;
+	header->m_tag = sCurrentMemoryTag;
+	header->m_offset = offset;
+	btMemoryTagAllocated(header->m_tag, size);
+	//	printf("btAlignedAllocInternal %d, %x\n",size,ptr);
+	return ptr;
+}
+
+void btAlignedFreeInternal(void *ptr)
+{
+	if (!ptr)
+	{
+		return;
+	}
+
+	//	printf("btAlignedFreeInternal %x\n",ptr);
+	btMemoryTagHeader *header = (btMemoryTagHeader *)ptr - 1;
+	btMemoryTagCounters &counters = sMemoryTags[header->m_tag];
+	counters.m_liveBytes.fetch_sub(header->m_size, std::memory_order_relaxed);
+	counters.m_numFrees.fetch_add(1, std::memory_order_relaxed);
+	sAlignedFreeFunc((char *)ptr - header->m_offset);
+}
+
+#else  //BT_TRACK_MEMORY_TAGS
 
 void *btAlignedAllocInternal(size_t size, int alignment)
 {
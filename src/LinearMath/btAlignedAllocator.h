@@ -59,6 +59,74 @@ void btAlignedAllocSetCustom(btAllocFunc* allocFunc, btFreeFunc* freeFunc);
 ///If the developer has already an custom aligned allocator, then btAlignedAllocSetCustomAligned can be used. The default aligned allocator pre-allocates extra memory using the non-aligned allocator, and instruments it.
 void btAlignedAllocSetCustomAligned(btAlignedAllocFunc* allocFunc, btAlignedFreeFunc* freeFunc);
 
+///Memory tags attribute the btAlignedAlloc allocations to the subsystem that made them. Each thread has a current tag, set with
+///BT_MEMORY_TAG, and btParallelFor hands it on to the threads that run the loop. A small header in front of every allocation
+///remembers its tag and size, so btAlignedFree gives the bytes back to the right tag from any thread.
+///Tracking is only compiled in with BT_USE_MEMORY_TAGS (cmake option BULLET2_MEMORY_TAGS), which needs C++11 atomics. Without it
+///allocations carry no header, BT_MEMORY_TAG does nothing, the statistics stay 0 and budgets are never called. The tags are not
+///tracked in a BT_DEBUG_MEMORY_ALLOCATIONS build either, which keeps its own totals.
+enum btMemoryTag
+{
+	BT_MEMORY_TAG_GENERAL = 0,
+	BT_MEMORY_TAG_BROADPHASE,
+	BT_MEMORY_TAG_NARROWPHASE,
+	BT_MEMORY_TAG_SOLVER,
+	BT_MEMORY_TAG_SOFTBODY,
+	BT_MEMORY_TAG_MULTIBODY,
+	BT_MEMORY_TAG_SERIALIZER,
+	BT_NUM_MEMORY_TAGS
+};
+
+struct btMemoryTagStatistics
+{
+	size_t m_liveBytes;
+	size_t m_peakBytes;
+	///counted since the start of the process, the difference between two queries gives the allocation rate
+	unsigned long long m_numAllocations;
+	unsigned long long m_numFrees;
+	size_t m_budget;
+};
+
+///called by the allocation that takes the live bytes of a tag over its budget, on the allocating thread
+typedef void(btMemoryBudgetFunc)(btMemoryTag tag, size_t liveBytes, size_t budget, void* userData);
+
+///sets the tag of the calling thread and returns the previous one
+btMemoryTag btSetMemoryTag(btMemoryTag tag);
+btMemoryTag btGetMemoryTag();
+const char* btGetMemoryTagName(btMemoryTag tag);
+
+///the counters are shared by all worlds in the process
+void btGetMemoryTagStatistics(btMemoryTag tag, btMemoryTagStatistics& stats);
+
+///restarts the peak of every tag at its live bytes
+void btResetMemoryTagPeaks();
+
+///budgetFunc is called each time the live bytes of the tag go from within the budget to over it. The allocation itself still
+///succeeds, the callback decides what to do about it. A budget of 0 removes the budget. Set budgets while no other thread allocates.
+void btSetMemoryBudget(btMemoryTag tag, size_t budget, btMemoryBudgetFunc* budgetFunc, void* userData = 0);
+
+///btMemoryTagScope sets the tag of the calling thread for its lifetime
+class btMemoryTagScope
+{
+	btMemoryTag m_previous;
+
+public:
+	btMemoryTagScope(btMemoryTag tag)
+		: m_previous(btSetMemoryTag(tag))
+	{
+	}
+	~btMemoryTagScope()
+	{
+		btSetMemoryTag(m_previous);
+	}
+};
+
+#if BT_USE_MEMORY_TAGS
+#define BT_MEMORY_TAG(tag) btMemoryTagScope __memoryTag(tag)
+#else
+#define BT_MEMORY_TAG(tag)
+#endif
+
 ///The btAlignedAllocator is a portable class for aligned memory allocations.
 ///Default implementations for unaligned and aligned allocations can be overridden by a custom allocator using btAlignedAllocSetCustom and btAlignedAllocSetCustomAligned.
 template <typename T, unsigned Alignment>
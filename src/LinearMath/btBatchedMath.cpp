@@ -0,0 +1,648 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2020 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btBatchedMath.h"
+#include "btCpuFeatureUtility.h"
+#include "btTransformUtil.h"
+
+struct btBatchedMathFunctions
+{
+	void (*m_transformPoints)(const btTransform& transform, const btVector3* points, btVector3* out, int count);
+	void (*m_multiplyMatrices)(const btMatrix3x3* a, const btMatrix3x3* b, btMatrix3x3* out, int count);
+	void (*m_multiplyTransforms)(const btTransform* a, const btTransform* b, btTransform* out, int count);
+	void (*m_multiplyTransformsParent)(const btTransform& parent, const btTransform* children, btTransform* out, int count);
+	void (*m_addScaledVectors)(const btVector3* a, const btVector3* b, btScalar scale, btVector3* out, int count);
+	void (*m_dotVectors)(const btVector3* a, const btVector3* b, btScalar* out, int count);
+	void (*m_transformAabbs)(const btTransformSoa& transforms, btScalar* const halfExtents[3], btScalar padding, btScalar* const aabbMin[3], btScalar* const aabbMax[3], int count);
+	void (*m_integrateTransforms)(btScalar* const origin[3], btScalar* const rotation[4], btScalar* const linearVelocity[3], btScalar* const angularVelocity[3], btScalar timeStep, const btTransformSoa& predicted, int count);
+};
+
+//
+// scalar reference, the inline operators
+//
+
+static void transformPointsScalar(const btTransform& transform, const btVector3* points, btVector3* out, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		out[i] = transform(points[i]);
+	}
+}
+
+static void multiplyMatricesScalar(const btMatrix3x3* a, const btMatrix3x3* b, btMatrix3x3* out, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		out[i] = a[i] * b[i];
+	}
+}
+
+static void multiplyTransformsScalar(const btTransform* a, const btTransform* b, btTransform* out, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		out[i] = a[i] * b[i];
+	}
+}
+
+static void multiplyTransformsParentScalar(const btTransform& parent, const btTransform* children, btTransform* out, int count)
+{
+	// copy the parent, out may alias it
+	btTransform p = parent;
+	for (int i = 0; i < count; i++)
+	{
+		out[i] = p * children[i];
+	}
+}
+
+static void addScaledVectorsScalar(const btVector3* a, const btVector3* b, btScalar scale, btVector3* out, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		out[i] = a[i] + b[i] * scale;
+	}
+}
+
+static void dotVectorsScalar(const btVector3* a, const btVector3* b, btScalar* out, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		out[i] = a[i].dot(b[i]);
+	}
+}
+
+// one element of the structure of arrays kernels, also used for the remainder of the vectorized loops
+static inline void transformAabbScalar(const btTransformSoa& transforms, btScalar* const halfExtents[3], btScalar padding, btScalar* const aabbMin[3], btScalar* const aabbMax[3], int i)
+{
+	btScalar h0 = halfExtents[0][i], h1 = halfExtents[1][i], h2 = halfExtents[2][i];
+	for (int row = 0; row < 3; row++)
+	{
+		btScalar extent = h0 * btFabs(transforms.m_basis[3 * row][i]) + h1 * btFabs(transforms.m_basis[3 * row + 1][i]) + h2 * btFabs(transforms.m_basis[3 * row + 2][i]);
+		btScalar center = transforms.m_origin[row][i];
+		aabbMin[row][i] = (center - extent) - padding;
+		aabbMax[row][i] = (center + extent) + padding;
+	}
+}
+
+// quaternion (x, y, z, w) to basis, like btMatrix3x3::setRotation
+static inline void setRotationScalar(const btTransformSoa& transforms, int i, btScalar x, btScalar y, btScalar z, btScalar w)
+{
+	btScalar s = btScalar(2.0) / (x * x + y * y + z * z + w * w);
+	btScalar xs = x * s, ys = y * s, zs = z * s;
+	btScalar wx = w * xs, wy = w * ys, wz = w * zs;
+	btScalar xx = x * xs, xy = x * ys, xz = x * zs;
+	btScalar yy = y * ys, yz = y * zs, zz = z * zs;
+	transforms.m_basis[0][i] = btScalar(1.0) - (yy + zz);
+	transforms.m_basis[1][i] = xy - wz;
+	transforms.m_basis[2][i] = xz + wy;
+	transforms.m_basis[3][i] = xy + wz;
+	transforms.m_basis[4][i] = btScalar(1.0) - (xx + zz);
+	transforms.m_basis[5][i] = yz - wx;
+	transforms.m_basis[6][i] = xz - wy;
+	transforms.m_basis[7][i] = yz + wx;
+	transforms.m_basis[8][i] = btScalar(1.0) - (xx + yy);
+}
+
+static inline void integrateTransformScalar(btScalar* const origin[3], btScalar* const rotation[4], btScalar* const linearVelocity[3], btScalar* const angularVelocity[3], btScalar timeStep, const btTransformSoa& predicted, int i)
+{
+	for (int j = 0; j < 3; j++)
+	{
+		predicted.m_origin[j][i] = origin[j][i] + linearVelocity[j][i] * timeStep;
+	}
+
+	// the exponential map of btTransformUtil::integrateTransform
+	btScalar wx = angularVelocity[0][i], wy = angularVelocity[1][i], wz = angularVelocity[2][i];
+	btScalar fAngle2 = wx * wx + wy * wy + wz * wz;
+	btScalar fAngle = 0;
+	if (fAngle2 > SIMD_EPSILON)
+	{
+		fAngle = btSqrt(fAngle2);
+	}
+	if (fAngle * timeStep > ANGULAR_MOTION_THRESHOLD)
+	{
+		fAngle = ANGULAR_MOTION_THRESHOLD / timeStep;
+	}
+	btScalar sinc;
+	if (fAngle < btScalar(0.001))
+	{
+		sinc = btScalar(0.5) * timeStep - (timeStep * timeStep * timeStep) * (btScalar(0.020833333333)) * fAngle * fAngle;
+	}
+	else
+	{
+		sinc = btSin(btScalar(0.5) * fAngle * timeStep) / fAngle;
+	}
+	btScalar dx = wx * sinc, dy = wy * sinc, dz = wz * sinc, dw = btCos(fAngle * timeStep * btScalar(0.5));
+
+	btScalar qx = rotation[0][i], qy = rotation[1][i], qz = rotation[2][i], qw = rotation[3][i];
+	btScalar x = dw * qx + dx * qw + dy * qz - dz * qy;
+	btScalar y = dw * qy + dy * qw + dz * qx - dx * qz;
+	btScalar z = dw * qz + dz * qw + dx * qy - dy * qx;
+	btScalar w = dw * qw - dx * qx - dy * qy - dz * qz;
+	btScalar length2 = x * x + y * y + z * z + w * w;
+	if (length2 > SIMD_EPSILON)
+	{
+		btScalar invLength = btScalar(1.0) / btSqrt(length2);
+		setRotationScalar(predicted, i, x * invLength, y * invLength, z * invLength, w * invLength);
+	}
+	else
+	{
+		setRotationScalar(predicted, i, qx, qy, qz, qw);
+	}
+}
+
+static void transformAabbsScalar(const btTransformSoa& transforms, btScalar* const halfExtents[3], btScalar padding, btScalar* const aabbMin[3], btScalar* const aabbMax[3], int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		transformAabbScalar(transforms, halfExtents, padding, aabbMin, aabbMax, i);
+	}
+}
+
+static void integrateTransformsScalar(btScalar* const origin[3], btScalar* const rotation[4], btScalar* const linearVelocity[3], btScalar* const angularVelocity[3], btScalar timeStep, const btTransformSoa& predicted, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		integrateTransformScalar(origin, rotation, linearVelocity, angularVelocity, timeStep, predicted, i);
+	}
+}
+
+static const btBatchedMathFunctions gBatchedMathScalar = {
+	transformPointsScalar,
+	multiplyMatricesScalar,
+	multiplyTransformsScalar,
+	multiplyTransformsParentScalar,
+	addScaledVectorsScalar,
+	dotVectorsScalar,
+	transformAabbsScalar,
+	integrateTransformsScalar};
+
+//
+// AVX2/FMA, compiled for that target only, so the rest of the library keeps its baseline
+//
+
+#if (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)) && \
+	((defined(__GNUC__) && (__GNUC__ >= 5 || defined(__clang__))) || (defined(_MSC_VER) && _MSC_VER >= 1700))
+#define BT_HAVE_AVX2_BATCHED_MATH
+
+#include <immintrin.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define BT_AVX2_TARGET
+#else
+#define BT_AVX2_TARGET __attribute__((target("avx2,fma,tune=haswell")))
+#endif
+
+#ifdef BT_USE_DOUBLE_PRECISION
+// a btVector3 is four doubles, exactly one ymm register
+typedef __m256d btAvxVec;
+#define btAvxLoad(p) _mm256_loadu_pd(p)
+#define btAvxStore(p, v) _mm256_storeu_pd(p, v)
+#define btAvxSplat(s) _mm256_set1_pd(s)
+#define btAvxZero() _mm256_setzero_pd()
+#define btAvxAdd(a, b) _mm256_add_pd(a, b)
+#define btAvxMul(a, b) _mm256_mul_pd(a, b)
+#define btAvxMadd(a, b, c) _mm256_fmadd_pd(a, b, c)
+#define btAvxClearW(v) _mm256_blend_pd(v, _mm256_setzero_pd(), 8)
+
+// (a.x + a.y + a.z, b.x + b.y + b.z, c.x + c.y + c.z, d.x + d.y + d.z)
+static BT_AVX2_TARGET inline btAvxVec btAvxSum3(btAvxVec a, btAvxVec b, btAvxVec c, btAvxVec d)
+{
+	__m256d abLow = _mm256_unpacklo_pd(a, b);   // a.x b.x a.z b.z
+	__m256d abHigh = _mm256_unpackhi_pd(a, b);  // a.y b.y a.w b.w
+	__m256d cdLow = _mm256_unpacklo_pd(c, d);
+	__m256d cdHigh = _mm256_unpackhi_pd(c, d);
+	__m256d x = _mm256_permute2f128_pd(abLow, cdLow, 0x20);
+	__m256d y = _mm256_permute2f128_pd(abHigh, cdHigh, 0x20);
+	__m256d z = _mm256_permute2f128_pd(abLow, cdLow, 0x31);
+	return _mm256_add_pd(_mm256_add_pd(x, y), z);
+}
+#else
+// a btVector3 is four floats, the 128 bit forms of the AVX2/FMA instructions
+typedef __m128 btAvxVec;
+#define btAvxLoad(p) _mm_loadu_ps(p)
+#define btAvxStore(p, v) _mm_storeu_ps(p, v)
+#define btAvxSplat(s) _mm_set1_ps(s)
+#define btAvxZero() _mm_setzero_ps()
+#define btAvxAdd(a, b) _mm_add_ps(a, b)
+#define btAvxMul(a, b) _mm_mul_ps(a, b)
+#define btAvxMadd(a, b, c) _mm_fmadd_ps(a, b, c)
+#define btAvxClearW(v) _mm_blend_ps(v, _mm_setzero_ps(), 8)
+
+static BT_AVX2_TARGET inline btAvxVec btAvxSum3(btAvxVec a, btAvxVec b, btAvxVec c, btAvxVec d)
+{
+	_MM_TRANSPOSE4_PS(a, b, c, d);
+	return _mm_add_ps(_mm_add_ps(a, b), c);
+}
+#endif
+
+// The kernels below read the plain layout of the math classes (a btVector3 is 4 scalars, a btMatrix3x3 is
+// 3 rows, a btTransform is 3 rows and the origin) instead of calling their accessors, which the compiler
+// does not inline into functions compiled for another target.
+#define BT_AVX_ROW(m, j) (reinterpret_cast<const btScalar*>(m) + 4 * (j))
+#define BT_AVX_ORIGIN(t) (reinterpret_cast<const btScalar*>(t) + 12)
+
+// the columns of a basis, with w = 0
+static BT_AVX2_TARGET inline void btAvxLoadColumns(const btScalar* basis, btAvxVec& column0, btAvxVec& column1, btAvxVec& column2)
+{
+	btAvxVec row0 = btAvxLoad(basis);
+	btAvxVec row1 = btAvxLoad(basis + 4);
+	btAvxVec row2 = btAvxLoad(basis + 8);
+	btAvxVec zero = btAvxZero();
+#ifdef BT_USE_DOUBLE_PRECISION
+	__m256d lowPairs = _mm256_unpacklo_pd(row0, row1);   // r0.x r1.x r0.z r1.z
+	__m256d highPairs = _mm256_unpackhi_pd(row0, row1);  // r0.y r1.y r0.w r1.w
+	__m256d row2Low = _mm256_unpacklo_pd(row2, zero);
+	__m256d row2High = _mm256_unpackhi_pd(row2, zero);
+	column0 = _mm256_permute2f128_pd(lowPairs, row2Low, 0x20);
+	column1 = _mm256_permute2f128_pd(highPairs, row2High, 0x20);
+	column2 = _mm256_permute2f128_pd(lowPairs, row2Low, 0x31);
+#else
+	_MM_TRANSPOSE4_PS(row0, row1, row2, zero);
+	column0 = row0;
+	column1 = row1;
+	column2 = row2;
+#endif
+}
+
+// a * b, row by row: the rows of b weighted with the elements of a. Like the inline operators,
+// all results have w = 0
+static BT_AVX2_TARGET inline void btAvxMultiplyBasis(const btScalar* a, const btScalar* b, btScalar* out)
+{
+	btAvxVec b0 = btAvxLoad(b);
+	btAvxVec b1 = btAvxLoad(b + 4);
+	btAvxVec b2 = btAvxLoad(b + 8);
+	btAvxVec row0 = btAvxMadd(btAvxSplat(a[2]), b2, btAvxMadd(btAvxSplat(a[1]), b1, btAvxMul(btAvxSplat(a[0]), b0)));
+	btAvxVec row1 = btAvxMadd(btAvxSplat(a[6]), b2, btAvxMadd(btAvxSplat(a[5]), b1, btAvxMul(btAvxSplat(a[4]), b0)));
+	btAvxVec row2 = btAvxMadd(btAvxSplat(a[10]), b2, btAvxMadd(btAvxSplat(a[9]), b1, btAvxMul(btAvxSplat(a[8]), b0)));
+	// store after all loads, out may alias a or b
+	btAvxStore(out, btAvxClearW(row0));
+	btAvxStore(out + 4, btAvxClearW(row1));
+	btAvxStore(out + 8, btAvxClearW(row2));
+}
+
+static BT_AVX2_TARGET void transformPointsAvx2(const btTransform& transform, const btVector3* points, btVector3* out, int count)
+{
+	btAvxVec column0, column1, column2;
+	btAvxLoadColumns(BT_AVX_ROW(&transform, 0), column0, column1, column2);
+	btAvxVec origin = btAvxLoad(BT_AVX_ORIGIN(&transform));
+	for (int i = 0; i < count; i++)
+	{
+		const btScalar* p = BT_AVX_ROW(points + i, 0);
+		btAvxVec result = btAvxMadd(column0, btAvxSplat(p[0]), origin);
+		result = btAvxMadd(column1, btAvxSplat(p[1]), result);
+		result = btAvxMadd(column2, btAvxSplat(p[2]), result);
+		btAvxStore(reinterpret_cast<btScalar*>(out + i), btAvxClearW(result));
+	}
+}
+
+static BT_AVX2_TARGET void multiplyMatricesAvx2(const btMatrix3x3* a, const btMatrix3x3* b, btMatrix3x3* out, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		btAvxMultiplyBasis(BT_AVX_ROW(a + i, 0), BT_AVX_ROW(b + i, 0), reinterpret_cast<btScalar*>(out + i));
+	}
+}
+
+static BT_AVX2_TARGET void multiplyTransformsAvx2(const btTransform* a, const btTransform* b, btTransform* out, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		// a(b.origin): the dot products of the rows of a with b.origin
+		const btScalar* aRows = BT_AVX_ROW(a + i, 0);
+		btAvxVec bOrigin = btAvxLoad(BT_AVX_ORIGIN(b + i));
+		btAvxVec origin = btAvxSum3(btAvxMul(btAvxLoad(aRows), bOrigin), btAvxMul(btAvxLoad(aRows + 4), bOrigin),
+									btAvxMul(btAvxLoad(aRows + 8), bOrigin), btAvxZero());
+		origin = btAvxAdd(origin, btAvxLoad(BT_AVX_ORIGIN(a + i)));
+		btScalar* result = reinterpret_cast<btScalar*>(out + i);
+		btAvxMultiplyBasis(aRows, BT_AVX_ROW(b + i, 0), result);
+		btAvxStore(result + 12, btAvxClearW(origin));
+	}
+}
+
+static BT_AVX2_TARGET void multiplyTransformsParentAvx2(const btTransform& parent, const btTransform* children, btTransform* out, int count)
+{
+	btAvxVec column0, column1, column2;
+	btAvxLoadColumns(BT_AVX_ROW(&parent, 0), column0, column1, column2);
+	btAvxVec parentOrigin = btAvxLoad(BT_AVX_ORIGIN(&parent));
+	// copy the parent basis, out may alias it
+	btTransform parentCopy = parent;
+	const btScalar* parentRows = BT_AVX_ROW(&parentCopy, 0);
+	for (int i = 0; i < count; i++)
+	{
+		const btScalar* o = BT_AVX_ORIGIN(children + i);
+		btAvxVec origin = btAvxMadd(column0, btAvxSplat(o[0]), parentOrigin);
+		origin = btAvxMadd(column1, btAvxSplat(o[1]), origin);
+		origin = btAvxMadd(column2, btAvxSplat(o[2]), origin);
+		btScalar* result = reinterpret_cast<btScalar*>(out + i);
+		btAvxMultiplyBasis(parentRows, BT_AVX_ROW(children + i, 0), result);
+		btAvxStore(result + 12, btAvxClearW(origin));
+	}
+}
+
+static BT_AVX2_TARGET void addScaledVectorsAvx2(const btVector3* a, const btVector3* b, btScalar scale, btVector3* out, int count)
+{
+	btAvxVec s = btAvxSplat(scale);
+	for (int i = 0; i < count; i++)
+	{
+		btAvxVec result = btAvxMadd(btAvxLoad(BT_AVX_ROW(b + i, 0)), s, btAvxLoad(BT_AVX_ROW(a + i, 0)));
+		btAvxStore(reinterpret_cast<btScalar*>(out + i), btAvxClearW(result));
+	}
+}
+
+static BT_AVX2_TARGET void dotVectorsAvx2(const btVector3* a, const btVector3* b, btScalar* out, int count)
+{
+	int i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		btAvxVec p0 = btAvxMul(btAvxLoad(BT_AVX_ROW(a + i, 0)), btAvxLoad(BT_AVX_ROW(b + i, 0)));
+		btAvxVec p1 = btAvxMul(btAvxLoad(BT_AVX_ROW(a + i + 1, 0)), btAvxLoad(BT_AVX_ROW(b + i + 1, 0)));
+		btAvxVec p2 = btAvxMul(btAvxLoad(BT_AVX_ROW(a + i + 2, 0)), btAvxLoad(BT_AVX_ROW(b + i + 2, 0)));
+		btAvxVec p3 = btAvxMul(btAvxLoad(BT_AVX_ROW(a + i + 3, 0)), btAvxLoad(BT_AVX_ROW(b + i + 3, 0)));
+		btAvxStore(out + i, btAvxSum3(p0, p1, p2, p3));
+	}
+	for (; i < count; i++)
+	{
+		const btScalar* u = BT_AVX_ROW(a + i, 0);
+		const btScalar* v = BT_AVX_ROW(b + i, 0);
+		out[i] = u[0] * v[0] + u[1] * v[1] + u[2] * v[2];
+	}
+}
+
+// the structure of arrays kernels use full registers: 4 doubles or 8 floats, one transform per lane
+#ifdef BT_USE_DOUBLE_PRECISION
+typedef __m256d btSoaVec;
+#define BT_SOA_WIDTH 4
+#define btSoaLoad(p) _mm256_loadu_pd(p)
+#define btSoaStore(p, v) _mm256_storeu_pd(p, v)
+#define btSoaSplat(s) _mm256_set1_pd(s)
+#define btSoaAdd(a, b) _mm256_add_pd(a, b)
+#define btSoaSub(a, b) _mm256_sub_pd(a, b)
+#define btSoaMul(a, b) _mm256_mul_pd(a, b)
+#define btSoaDiv(a, b) _mm256_div_pd(a, b)
+#define btSoaMadd(a, b, c) _mm256_fmadd_pd(a, b, c)
+#define btSoaSqrt(a) _mm256_sqrt_pd(a)
+#define btSoaMax(a, b) _mm256_max_pd(a, b)
+#define btSoaAbs(a) _mm256_andnot_pd(_mm256_set1_pd(-0.0), a)
+#define btSoaGreater(a, b) _mm256_cmp_pd(a, b, _CMP_GT_OQ)
+#define btSoaLess(a, b) _mm256_cmp_pd(a, b, _CMP_LT_OQ)
+#define btSoaSelect(mask, a, b) _mm256_blendv_pd(b, a, mask)
+#else
+typedef __m256 btSoaVec;
+#define BT_SOA_WIDTH 8
+#define btSoaLoad(p) _mm256_loadu_ps(p)
+#define btSoaStore(p, v) _mm256_storeu_ps(p, v)
+#define btSoaSplat(s) _mm256_set1_ps(s)
+#define btSoaAdd(a, b) _mm256_add_ps(a, b)
+#define btSoaSub(a, b) _mm256_sub_ps(a, b)
+#define btSoaMul(a, b) _mm256_mul_ps(a, b)
+#define btSoaDiv(a, b) _mm256_div_ps(a, b)
+#define btSoaMadd(a, b, c) _mm256_fmadd_ps(a, b, c)
+#define btSoaSqrt(a) _mm256_sqrt_ps(a)
+#define btSoaMax(a, b) _mm256_max_ps(a, b)
+#define btSoaAbs(a) _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a)
+#define btSoaGreater(a, b) _mm256_cmp_ps(a, b, _CMP_GT_OQ)
+#define btSoaLess(a, b) _mm256_cmp_ps(a, b, _CMP_LT_OQ)
+#define btSoaSelect(mask, a, b) _mm256_blendv_ps(b, a, mask)
+#endif
+
+static BT_AVX2_TARGET void transformAabbsAvx2(const btTransformSoa& transforms, btScalar* const halfExtents[3], btScalar padding, btScalar* const aabbMin[3], btScalar* const aabbMax[3], int count)
+{
+	btSoaVec pad = btSoaSplat(padding);
+	int i = 0;
+	for (; i + BT_SOA_WIDTH <= count; i += BT_SOA_WIDTH)
+	{
+		btSoaVec h0 = btSoaLoad(halfExtents[0] + i);
+		btSoaVec h1 = btSoaLoad(halfExtents[1] + i);
+		btSoaVec h2 = btSoaLoad(halfExtents[2] + i);
+		for (int row = 0; row < 3; row++)
+		{
+			btSoaVec extent = btSoaMul(h0, btSoaAbs(btSoaLoad(transforms.m_basis[3 * row] + i)));
+			extent = btSoaMadd(h1, btSoaAbs(btSoaLoad(transforms.m_basis[3 * row + 1] + i)), extent);
+			extent = btSoaMadd(h2, btSoaAbs(btSoaLoad(transforms.m_basis[3 * row + 2] + i)), extent);
+			btSoaVec center = btSoaLoad(transforms.m_origin[row] + i);
+			btSoaStore(aabbMin[row] + i, btSoaSub(btSoaSub(center, extent), pad));
+			btSoaStore(aabbMax[row] + i, btSoaAdd(btSoaAdd(center, extent), pad));
+		}
+	}
+	for (; i < count; i++)
+	{
+		transformAabbScalar(transforms, halfExtents, padding, aabbMin, aabbMax, i);
+	}
+}
+
+// sin and cos of the half rotation angle, which the motion threshold limits to [0, pi/8]: the Taylor series
+// converge to full precision there
+static BT_AVX2_TARGET inline void btSoaSinCos(btSoaVec x, btSoaVec& sinX, btSoaVec& cosX)
+{
+	btSoaVec x2 = btSoaMul(x, x);
+	btSoaVec s = btSoaSplat(btScalar(1.0 / 6227020800.0));
+	s = btSoaMadd(s, x2, btSoaSplat(btScalar(-1.0 / 39916800.0)));
+	s = btSoaMadd(s, x2, btSoaSplat(btScalar(1.0 / 362880.0)));
+	s = btSoaMadd(s, x2, btSoaSplat(btScalar(-1.0 / 5040.0)));
+	s = btSoaMadd(s, x2, btSoaSplat(btScalar(1.0 / 120.0)));
+	s = btSoaMadd(s, x2, btSoaSplat(btScalar(-1.0 / 6.0)));
+	sinX = btSoaMadd(btSoaMul(s, x2), x, x);
+	btSoaVec c = btSoaSplat(btScalar(-1.0 / 87178291200.0));
+	c = btSoaMadd(c, x2, btSoaSplat(btScalar(1.0 / 479001600.0)));
+	c = btSoaMadd(c, x2, btSoaSplat(btScalar(-1.0 / 3628800.0)));
+	c = btSoaMadd(c, x2, btSoaSplat(btScalar(1.0 / 40320.0)));
+	c = btSoaMadd(c, x2, btSoaSplat(btScalar(-1.0 / 720.0)));
+	c = btSoaMadd(c, x2, btSoaSplat(btScalar(1.0 / 24.0)));
+	c = btSoaMadd(c, x2, btSoaSplat(btScalar(-0.5)));
+	cosX = btSoaMadd(c, x2, btSoaSplat(btScalar(1.0)));
+}
+
+static BT_AVX2_TARGET void integrateTransformsAvx2(btScalar* const origin[3], btScalar* const rotation[4], btScalar* const linearVelocity[3], btScalar* const angularVelocity[3], btScalar timeStep, const btTransformSoa& predicted, int count)
+{
+	int i = 0;
+	// the polynomials need the angle limit, which only works for positive time steps
+	if (timeStep >= btScalar(0.))
+	{
+		btSoaVec dt = btSoaSplat(timeStep);
+		btSoaVec halfDt = btSoaSplat(btScalar(0.5) * timeStep);
+		btSoaVec epsilon = btSoaSplat(SIMD_EPSILON);
+		btSoaVec zero = btSoaSplat(btScalar(0.));
+		btSoaVec one = btSoaSplat(btScalar(1.0));
+		btSoaVec two = btSoaSplat(btScalar(2.0));
+		btSoaVec threshold = btSoaSplat(ANGULAR_MOTION_THRESHOLD);
+		btSoaVec maxAngle = btSoaSplat(timeStep > btScalar(0.) ? ANGULAR_MOTION_THRESHOLD / timeStep : btScalar(0.));
+		btSoaVec taylorLimit = btSoaSplat(btScalar(0.001));
+		btSoaVec taylor3 = btSoaSplat((timeStep * timeStep * timeStep) * (btScalar(0.020833333333)));
+		for (; i + BT_SOA_WIDTH <= count; i += BT_SOA_WIDTH)
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				btSoaStore(predicted.m_origin[j] + i, btSoaMadd(btSoaLoad(linearVelocity[j] + i), dt, btSoaLoad(origin[j] + i)));
+			}
+
+			btSoaVec wx = btSoaLoad(angularVelocity[0] + i);
+			btSoaVec wy = btSoaLoad(angularVelocity[1] + i);
+			btSoaVec wz = btSoaLoad(angularVelocity[2] + i);
+			btSoaVec fAngle2 = btSoaMadd(wz, wz, btSoaMadd(wy, wy, btSoaMul(wx, wx)));
+			btSoaVec fAngle = btSoaSelect(btSoaGreater(fAngle2, epsilon), btSoaSqrt(fAngle2), zero);
+			fAngle = btSoaSelect(btSoaGreater(btSoaMul(fAngle, dt), threshold), maxAngle, fAngle);
+			btSoaVec sinHalf, cosHalf;
+			btSoaSinCos(btSoaMul(fAngle, halfDt), sinHalf, cosHalf);
+			btSoaVec sincTaylor = btSoaSub(halfDt, btSoaMul(taylor3, btSoaMul(fAngle, fAngle)));
+			// the divisions are clamped so the lanes that are not selected do not raise floating point exceptions either
+			btSoaVec sinc = btSoaSelect(btSoaLess(fAngle, taylorLimit), sincTaylor, btSoaDiv(sinHalf, btSoaMax(fAngle, taylorLimit)));
+			btSoaVec dx = btSoaMul(wx, sinc), dy = btSoaMul(wy, sinc), dz = btSoaMul(wz, sinc), dw = cosHalf;
+
+			btSoaVec qx = btSoaLoad(rotation[0] + i);
+			btSoaVec qy = btSoaLoad(rotation[1] + i);
+			btSoaVec qz = btSoaLoad(rotation[2] + i);
+			btSoaVec qw = btSoaLoad(rotation[3] + i);
+			btSoaVec x = btSoaSub(btSoaMadd(dw, qx, btSoaMadd(dx, qw, btSoaMul(dy, qz))), btSoaMul(dz, qy));
+			btSoaVec y = btSoaSub(btSoaMadd(dw, qy, btSoaMadd(dy, qw, btSoaMul(dz, qx))), btSoaMul(dx, qz));
+			btSoaVec z = btSoaSub(btSoaMadd(dw, qz, btSoaMadd(dz, qw, btSoaMul(dx, qy))), btSoaMul(dy, qx));
+			btSoaVec w = btSoaSub(btSoaMul(dw, qw), btSoaMadd(dz, qz, btSoaMadd(dy, qy, btSoaMul(dx, qx))));
+			btSoaVec length2 = btSoaMadd(w, w, btSoaMadd(z, z, btSoaMadd(y, y, btSoaMul(x, x))));
+			btSoaVec valid = btSoaGreater(length2, epsilon);
+			btSoaVec invLength = btSoaDiv(one, btSoaSqrt(btSoaMax(length2, epsilon)));
+			x = btSoaSelect(valid, btSoaMul(x, invLength), qx);
+			y = btSoaSelect(valid, btSoaMul(y, invLength), qy);
+			z = btSoaSelect(valid, btSoaMul(z, invLength), qz);
+			w = btSoaSelect(valid, btSoaMul(w, invLength), qw);
+
+			// btMatrix3x3::setRotation
+			btSoaVec s = btSoaDiv(two, btSoaMadd(w, w, btSoaMadd(z, z, btSoaMadd(y, y, btSoaMul(x, x)))));
+			btSoaVec xs = btSoaMul(x, s), ys = btSoaMul(y, s), zs = btSoaMul(z, s);
+			btSoaVec wxs = btSoaMul(w, xs), wys = btSoaMul(w, ys), wzs = btSoaMul(w, zs);
+			btSoaVec xx = btSoaMul(x, xs), xy = btSoaMul(x, ys), xz = btSoaMul(x, zs);
+			btSoaVec yy = btSoaMul(y, ys), yz = btSoaMul(y, zs), zz = btSoaMul(z, zs);
+			btSoaStore(predicted.m_basis[0] + i, btSoaSub(one, btSoaAdd(yy, zz)));
+			btSoaStore(predicted.m_basis[1] + i, btSoaSub(xy, wzs));
+			btSoaStore(predicted.m_basis[2] + i, btSoaAdd(xz, wys));
+			btSoaStore(predicted.m_basis[3] + i, btSoaAdd(xy, wzs));
+			btSoaStore(predicted.m_basis[4] + i, btSoaSub(one, btSoaAdd(xx, zz)));
+			btSoaStore(predicted.m_basis[5] + i, btSoaSub(yz, wxs));
+			btSoaStore(predicted.m_basis[6] + i, btSoaSub(xz, wys));
+			btSoaStore(predicted.m_basis[7] + i, btSoaAdd(yz, wxs));
+			btSoaStore(predicted.m_basis[8] + i, btSoaSub(one, btSoaAdd(xx, yy)));
+		}
+	}
+	for (; i < count; i++)
+	{
+		integrateTransformScalar(origin, rotation, linearVelocity, angularVelocity, timeStep, predicted, i);
+	}
+}
+
+static const btBatchedMathFunctions gBatchedMathAvx2 = {
+	transformPointsAvx2,
+	multiplyMatricesAvx2,
+	multiplyTransformsAvx2,
+	multiplyTransformsParentAvx2,
+	addScaledVectorsAvx2,
+	dotVectorsAvx2,
+	transformAabbsAvx2,
+	integrateTransformsAvx2};
+
+#endif  //BT_HAVE_AVX2_BATCHED_MATH
+
+static bool btCpuSupportsBatchedMathBackend(btBatchedMathBackend backend)
+{
+	switch (backend)
+	{
+		case BT_BATCHED_MATH_SCALAR:
+			return true;
+		case BT_BATCHED_MATH_AVX2:
+		{
+#ifdef BT_HAVE_AVX2_BATCHED_MATH
+			const int features = btCpuFeatureUtility::CPU_FEATURE_AVX2 | btCpuFeatureUtility::CPU_FEATURE_FMA3;
+			return (btCpuFeatureUtility::getCpuFeatures() & features) == features;
+#else
+			return false;
+#endif
+		}
+	}
+	return false;
+}
+
+static const btBatchedMathFunctions* gBatchedMath = 0;
+static btBatchedMathBackend gBatchedMathBackend = BT_BATCHED_MATH_SCALAR;
+
+bool btSetBatchedMathBackend(btBatchedMathBackend backend)
+{
+	if (!btCpuSupportsBatchedMathBackend(backend))
+	{
+		return false;
+	}
+	gBatchedMathBackend = backend;
+#ifdef BT_HAVE_AVX2_BATCHED_MATH
+	gBatchedMath = backend == BT_BATCHED_MATH_AVX2 ? &gBatchedMathAvx2 : &gBatchedMathScalar;
+#else
+	gBatchedMath = &gBatchedMathScalar;
+#endif
+	return true;
+}
+
+static const btBatchedMathFunctions* btGetBatchedMath()
+{
+	if (gBatchedMath == 0)
+	{
+		// the best backend the CPU supports
+		if (!btSetBatchedMathBackend(BT_BATCHED_MATH_AVX2))
+		{
+			btSetBatchedMathBackend(BT_BATCHED_MATH_SCALAR);
+		}
+	}
+	return gBatchedMath;
+}
+
+btBatchedMathBackend btGetBatchedMathBackend()
+{
+	btGetBatchedMath();
+	return gBatchedMathBackend;
+}
+
+void btTransformPoints(const btTransform& transform, const btVector3* points, btVector3* out, int count)
+{
+	btGetBatchedMath()->m_transformPoints(transform, points, out, count);
+}
+
+void btMultiplyMatrices(const btMatrix3x3* a, const btMatrix3x3* b, btMatrix3x3* out, int count)
+{
+	btGetBatchedMath()->m_multiplyMatrices(a, b, out, count);
+}
+
+void btMultiplyTransforms(const btTransform* a, const btTransform* b, btTransform* out, int count)
+{
+	btGetBatchedMath()->m_multiplyTransforms(a, b, out, count);
+}
+
+void btMultiplyTransforms(const btTransform& parent, const btTransform* children, btTransform* out, int count)
+{
+	btGetBatchedMath()->m_multiplyTransformsParent(parent, children, out, count);
+}
+
+void btAddScaledVectors(const btVector3* a, const btVector3* b, btScalar scale, btVector3* out, int count)
+{
+	btGetBatchedMath()->m_addScaledVectors(a, b, scale, out, count);
+}
+
+void btDotVectors(const btVector3* a, const btVector3* b, btScalar* out, int count)
+{
+	btGetBatchedMath()->m_dotVectors(a, b, out, count);
+}
+
+void btTransformAabbs(const btTransformSoa& transforms, btScalar* const halfExtents[3], btScalar padding, btScalar* const aabbMin[3], btScalar* const aabbMax[3], int count)
+{
+	btGetBatchedMath()->m_transformAabbs(transforms, halfExtents, padding, aabbMin, aabbMax, count);
+}
+
+void btIntegrateTransforms(btScalar* const origin[3], btScalar* const rotation[4], btScalar* const linearVelocity[3], btScalar* const angularVelocity[3], btScalar timeStep, const btTransformSoa& predicted, int count)
+{
+	btGetBatchedMath()->m_integrateTransforms(origin, rotation, linearVelocity, angularVelocity, timeStep, predicted, count);
+}
@@ -0,0 +1,72 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2020 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_BATCHED_MATH_H
+#define BT_BATCHED_MATH_H
+
+#include "btTransform.h"
+
+///The btBatchedMath functions apply btVector3, btMatrix3x3 and btTransform operations to whole arrays.
+///They pick an AVX2/FMA implementation at runtime when the CPU supports it (see btCpuFeatureUtility),
+///which vectorizes the double precision build where the inline operators fall back to scalar code.
+///Results match the inline operators up to rounding (fused multiply-add). Output arrays may alias inputs.
+
+enum btBatchedMathBackend
+{
+	BT_BATCHED_MATH_SCALAR,
+	BT_BATCHED_MATH_AVX2
+};
+
+///the backend the functions below currently use
+btBatchedMathBackend btGetBatchedMathBackend();
+
+///for testing and benchmarks, returns false (and keeps the current backend) if the CPU or the build does not support it
+bool btSetBatchedMathBackend(btBatchedMathBackend backend);
+
+///out[i] = transform(points[i])
+void btTransformPoints(const btTransform& transform, const btVector3* points, btVector3* out, int count);
+
+///out[i] = a[i] * b[i]
+void btMultiplyMatrices(const btMatrix3x3* a, const btMatrix3x3* b, btMatrix3x3* out, int count);
+
+///out[i] = a[i] * b[i], the composition of the transforms
+void btMultiplyTransforms(const btTransform* a, const btTransform* b, btTransform* out, int count);
+
+///out[i] = parent * children[i], for example the world transforms of the children of a compound
+void btMultiplyTransforms(const btTransform& parent, const btTransform* children, btTransform* out, int count);
+
+///out[i] = a[i] + b[i] * scale, for example to integrate positions or velocities
+void btAddScaledVectors(const btVector3* a, const btVector3* b, btScalar scale, btVector3* out, int count);
+
+///out[i] = a[i].dot(b[i])
+void btDotVectors(const btVector3* a, const btVector3* b, btScalar* out, int count);
+
+///Transforms as a structure of arrays, for the kernels below that work on 4 (double) or 8 (float) transforms at a time.
+///Element i of every array belongs to transform i, m_basis[3 * row + column] holds the basis elements.
+struct btTransformSoa
+{
+	btScalar* m_basis[9];
+	btScalar* m_origin[3];
+};
+
+///the world space aabbs of boxes, like btTransformAabb: aabbMin[i] = origin[i] - |basis[i]| halfExtents[i] - padding.
+///halfExtents include the collision margin, a sphere is a box with an identity basis and the radius as half extents
+void btTransformAabbs(const btTransformSoa& transforms, btScalar* const halfExtents[3], btScalar padding, btScalar* const aabbMin[3], btScalar* const aabbMax[3], int count);
+
+///btTransformUtil::integrateTransform for many bodies, with the rotations given as quaternions (x, y, z, w).
+///Where the predicted rotation degenerates, the predicted transform keeps the current rotation
+void btIntegrateTransforms(btScalar* const origin[3], btScalar* const rotation[4], btScalar* const linearVelocity[3], btScalar* const angularVelocity[3], btScalar timeStep, const btTransformSoa& predicted, int count);
+
+#endif  //BT_BATCHED_MATH_H
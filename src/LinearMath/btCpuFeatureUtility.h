@@ -19,7 +19,12 @@
 #include <sys/sysctl.h>  //for sysctlbyname
 #endif                   //BT_USE_NEON
 
-///Rudimentary btCpuFeatureUtility for CPU features: only report the features that Bullet actually uses (SSE4/FMA3, NEON_HPFP)
+#if !defined(BT_ALLOW_SSE4) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#define BT_HAVE_GNUC_CPUID
+#endif
+
+///Rudimentary btCpuFeatureUtility for CPU features: only report the features that Bullet actually uses (SSE4/FMA3, AVX, NEON_HPFP)
 ///We assume SSE2 in case BT_USE_SSE2 is defined in LinearMath/btScalar.h
 class btCpuFeatureUtility
 {
@@ -28,7 +33,10 @@ public:
 	{
 		CPU_FEATURE_FMA3 = 1,
 		CPU_FEATURE_SSE4_1 = 2,
-		CPU_FEATURE_NEON_HPFP = 4
+		CPU_FEATURE_NEON_HPFP = 4,
+		CPU_FEATURE_AVX = 8,
+		CPU_FEATURE_AVX2 = 16,
+		CPU_FEATURE_AVX512F = 32
 	};
 
 	static int getCpuFeatures()
@@ -77,12 +85,81 @@ public:
 			{
 				capabilities |= btCpuFeatureUtility::CPU_FEATURE_SSE4_1;
 			}
+
+			int cpuInfo7[4];
+			memset(cpuInfo7, 0, sizeof(cpuInfo7));
+			__cpuid(cpuInfo7, 0);
+			if (cpuInfo7[0] >= 7)
+			{
+				__cpuidex(cpuInfo7, 7, 0);
+			}
+			else
+			{
+				memset(cpuInfo7, 0, sizeof(cpuInfo7));
+			}
+			capabilities |= avxFeatures(cpuInfo[2], cpuInfo7[1], sseExt);
 		}
 #endif  //BT_ALLOW_SSE4
 
+#ifdef BT_HAVE_GNUC_CPUID
+		{
+			unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+			if (__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+			{
+				unsigned long long sseExt = 0;
+				if ((ecx & (1 << 27)) && (ecx & (1 << 28)))
+				{
+					unsigned int xcr0Low, xcr0High;
+					__asm__ __volatile__("xgetbv"
+										 : "=a"(xcr0Low), "=d"(xcr0High)
+										 : "c"(0));
+					sseExt = (unsigned long long)xcr0High << 32 | xcr0Low;
+				}
+				const unsigned int FMAFlag = (1U << 12) | (1U << 27) | (1U << 28);
+				if ((ecx & FMAFlag) == FMAFlag && (sseExt & 6) == 6)
+				{
+					capabilities |= btCpuFeatureUtility::CPU_FEATURE_FMA3;
+				}
+				if (ecx & (1 << 19))
+				{
+					capabilities |= btCpuFeatureUtility::CPU_FEATURE_SSE4_1;
+				}
+
+				unsigned int ecx1 = ecx;
+				ebx = 0;
+				if (__get_cpuid_max(0, 0) >= 7)
+				{
+					__cpuid_count(7, 0, eax, ebx, ecx, edx);
+				}
+				capabilities |= avxFeatures(ecx1, ebx, sseExt);
+			}
+		}
+#endif  //BT_HAVE_GNUC_CPUID
+
 		testedCapabilities = true;
 		return capabilities;
 	}
+
+private:
+	// AVX needs the OS to save the ymm registers (XCR0 bits 1-2), AVX-512 also the opmask and zmm state (bits 5-7)
+	static int avxFeatures(unsigned int cpuInfo1Ecx, unsigned int cpuInfo7Ebx, unsigned long long xcr0)
+	{
+		int features = 0;
+		const unsigned int AVXFlag = (1U << 27) | (1U << 28);
+		if ((cpuInfo1Ecx & AVXFlag) == AVXFlag && (xcr0 & 6) == 6)
+		{
+			features |= CPU_FEATURE_AVX;
+			if (cpuInfo7Ebx & (1U << 5))
+			{
+				features |= CPU_FEATURE_AVX2;
+			}
+			if ((cpuInfo7Ebx & (1U << 16)) && (xcr0 & 0xe6) == 0xe6)
+			{
+				features |= CPU_FEATURE_AVX512F;
+			}
+		}
+		return features;
+	}
 };
 
 #endif  //BT_CPU_UTILITY_H
@@ -0,0 +1,595 @@
+/*
+Copyright (c) 2003-2020 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_FLAT_HASH_MAP_H
+#define BT_FLAT_HASH_MAP_H
+
+#include "btHashMap.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BT_FLAT_HASH_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#define BT_FLAT_HASH_GROUP_SIZE 16
+#define BT_FLAT_HASH_EMPTY ((unsigned char)0x80)
+#define BT_FLAT_HASH_DELETED ((unsigned char)0xfe)
+
+SIMD_FORCE_INLINE int btFlatHashLowestBit(unsigned int mask)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return int(index);
+#elif defined(__GNUC__)
+	return __builtin_ctz(mask);
+#else
+	int index = 0;
+	while (!(mask & 1))
+	{
+		mask >>= 1;
+		index++;
+	}
+	return index;
+#endif
+}
+
+///the control byte of a full slot, the top 7 bits of the hash
+SIMD_FORCE_INLINE unsigned char btFlatHashControl(unsigned int hash)
+{
+	return (unsigned char)(hash >> 25);
+}
+
+///a bit for each of the 16 control bytes of the group that equals c
+SIMD_FORCE_INLINE unsigned int btFlatHashMatchByte(const unsigned char* group, unsigned char c)
+{
+#if BT_FLAT_HASH_USE_SSE2
+	__m128i ctrl = _mm_load_si128((const __m128i*)group);
+	return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)c)));
+#else
+	unsigned int mask = 0;
+	for (int i = 0; i < BT_FLAT_HASH_GROUP_SIZE; i++)
+	{
+		mask |= (unsigned int)(group[i] == c) << i;
+	}
+	return mask;
+#endif
+}
+
+SIMD_FORCE_INLINE unsigned int btFlatHashMatchEmptyOrDeleted(const unsigned char* group)
+{
+#if BT_FLAT_HASH_USE_SSE2
+	return (unsigned int)_mm_movemask_epi8(_mm_load_si128((const __m128i*)group));
+#else
+	unsigned int mask = 0;
+	for (int i = 0; i < BT_FLAT_HASH_GROUP_SIZE; i++)
+	{
+		mask |= (unsigned int)(group[i] >> 7) << i;
+	}
+	return mask;
+#endif
+}
+
+///an entry of the table: the index into the dense arrays of the container and its full hash, so growing the table needs no keys
+struct btFlatHashSlot
+{
+	int m_index;
+	unsigned int m_hash;
+};
+
+///btFlatHashTable is an open addressing index from hashes to the entries of dense arrays owned by a container, like
+///btFlatHashMap or btHashedSimplePairCache. One control byte per slot holds the top 7 bits of the hash, or marks the slot empty
+///or deleted. Lookups compare a group of 16 control bytes at once (with SSE2 where available) and only look at the slots
+///whose control byte matches, so a lookup usually touches one cache line of control bytes and one slot.
+class btFlatHashTable
+{
+	btAlignedObjectArray<unsigned char> m_control;
+	btAlignedObjectArray<btFlatHashSlot> m_slots;
+	int m_groupMask;
+	int m_numFull;
+	int m_numUsed;  // full and deleted slots, at least one slot per group probe sequence stays empty
+
+	int probeStart(unsigned int hash) const
+	{
+		return int(hash & (unsigned int)m_groupMask);
+	}
+
+	///the slot that refers to the entry, which must be in the table
+	int findSlot(unsigned int hash, int index) const
+	{
+		unsigned char c = btFlatHashControl(hash);
+		int group = probeStart(hash);
+		for (int probe = 1;; probe++)
+		{
+			const int first = group * BT_FLAT_HASH_GROUP_SIZE;
+			for (unsigned int match = btFlatHashMatchByte(&m_control[first], c); match; match &= match - 1)
+			{
+				int slot = first + btFlatHashLowestBit(match);
+				if (m_slots[slot].m_index == index)
+				{
+					return slot;
+				}
+			}
+			btAssert(probe <= m_groupMask + 1);
+			group = (group + probe) & m_groupMask;
+		}
+	}
+
+	void rehash(int numEntries)
+	{
+		int capacity = BT_FLAT_HASH_GROUP_SIZE;
+		while (capacity < numEntries * 2)
+		{
+			capacity *= 2;
+		}
+
+		btAlignedObjectArray<btFlatHashSlot> full;
+		full.reserve(m_numFull);
+		for (int i = 0; i < m_control.size(); i++)
+		{
+			if (!(m_control[i] & 0x80))
+			{
+				full.push_back(m_slots[i]);
+			}
+		}
+
+		m_control.resize(capacity);
+		m_slots.resize(capacity);
+		for (int i = 0; i < capacity; i++)
+		{
+			m_control[i] = BT_FLAT_HASH_EMPTY;
+		}
+		m_groupMask = capacity / BT_FLAT_HASH_GROUP_SIZE - 1;
+		m_numFull = 0;
+		m_numUsed = 0;
+		for (int i = 0; i < full.size(); i++)
+		{
+			insertSlot(full[i].m_hash, full[i].m_index);
+		}
+	}
+
+	void insertSlot(unsigned int hash, int index)
+	{
+		int group = probeStart(hash);
+		for (int probe = 1;; probe++)
+		{
+			const int first = group * BT_FLAT_HASH_GROUP_SIZE;
+			unsigned int match = btFlatHashMatchEmptyOrDeleted(&m_control[first]);
+			if (match)
+			{
+				int slot = first + btFlatHashLowestBit(match);
+				if (m_control[slot] == BT_FLAT_HASH_EMPTY)
+				{
+					m_numUsed++;
+				}
+				m_control[slot] = btFlatHashControl(hash);
+				m_slots[slot].m_index = index;
+				m_slots[slot].m_hash = hash;
+				m_numFull++;
+				return;
+			}
+			group = (group + probe) & m_groupMask;
+		}
+	}
+
+public:
+	btFlatHashTable()
+		: m_groupMask(0),
+		  m_numFull(0),
+		  m_numUsed(0)
+	{
+	}
+
+	int size() const
+	{
+		return m_numFull;
+	}
+
+	///returns the index of the entry for which equal(index) is true, or BT_HASH_NULL
+	template <typename Equal>
+	int findIndex(unsigned int hash, const Equal& equal) const
+	{
+		if (!m_numFull)
+		{
+			return BT_HASH_NULL;
+		}
+		unsigned char c = btFlatHashControl(hash);
+		int group = probeStart(hash);
+		for (int probe = 1;; probe++)
+		{
+			const int first = group * BT_FLAT_HASH_GROUP_SIZE;
+			const unsigned char* ctrl = &m_control[first];
+			for (unsigned int match = btFlatHashMatchByte(ctrl, c); match; match &= match - 1)
+			{
+				const btFlatHashSlot& slot = m_slots[first + btFlatHashLowestBit(match)];
+				if (slot.m_hash == hash && equal(slot.m_index))
+				{
+					return slot.m_index;
+				}
+			}
+			if (btFlatHashMatchByte(ctrl, BT_FLAT_HASH_EMPTY))
+			{
+				return BT_HASH_NULL;
+			}
+			group = (group + probe) & m_groupMask;
+		}
+	}
+
+	///adds an entry that is not in the table yet
+	void insert(unsigned int hash, int index)
+	{
+		if ((m_numUsed + 1) * 8 > m_control.size() * 7)
+		{
+			rehash(m_numFull + 1);
+		}
+		insertSlot(hash, index);
+	}
+
+	void remove(unsigned int hash, int index)
+	{
+		int slot = findSlot(hash, index);
+		const int first = slot & ~(BT_FLAT_HASH_GROUP_SIZE - 1);
+		// no lookup ever probed past a group that still has an empty slot, so the slot can become empty again
+		if (btFlatHashMatchByte(&m_control[first], BT_FLAT_HASH_EMPTY))
+		{
+			m_control[slot] = BT_FLAT_HASH_EMPTY;
+			m_numUsed--;
+		}
+		else
+		{
+			m_control[slot] = BT_FLAT_HASH_DELETED;
+		}
+		m_numFull--;
+	}
+
+	///the entry moved to another index of the dense arrays, such as the last entry taking the place of a removed one
+	void move(unsigned int hash, int oldIndex, int newIndex)
+	{
+		m_slots[findSlot(hash, oldIndex)].m_index = newIndex;
+	}
+
+	void reserve(int numEntries)
+	{
+		if (numEntries * 8 > m_control.size() * 7)
+		{
+			rehash(numEntries);
+		}
+	}
+
+	void clear()
+	{
+		m_control.clear();
+		m_slots.clear();
+		m_groupMask = 0;
+		m_numFull = 0;
+		m_numUsed = 0;
+	}
+};
+
+///The btFlatHashMap has the interface of btHashMap, for keys with getHash and equals, but stores the keys and values in an
+///open addressing table with control bytes instead of chaining them through m_hashTable and m_next. A lookup reads one
+///group of control bytes and then the entry itself, where btHashMap follows the hash table, the chain, the key array and
+///the value array. The order of getAtIndex is the order of btHashMap: insertion order, and remove moves the last entry
+///into the place of the removed one. Pointers to values stay valid until the table grows.
+template <class Key, class Value>
+class btFlatHashMap
+{
+	struct btEntry
+	{
+		Key m_key;
+		Value m_value;
+		unsigned int m_hash;
+		int m_index;  // into m_entrySlots
+
+		btEntry(const Key& key, const Value& value, unsigned int hash, int index)
+			: m_key(key),
+			  m_value(value),
+			  m_hash(hash),
+			  m_index(index)
+		{
+		}
+	};
+
+	unsigned char* m_control;  // followed by the entries in the same allocation
+	btEntry* m_entries;
+	int m_capacity;
+	int m_numUsed;  // full and deleted slots
+	btAlignedObjectArray<int> m_entrySlots;  // the slot of each index
+
+	int findSlot(const Key& key, unsigned int hash) const
+	{
+		if (!m_entrySlots.size())
+		{
+			return -1;
+		}
+		const int groupMask = m_capacity / BT_FLAT_HASH_GROUP_SIZE - 1;
+		const unsigned char c = btFlatHashControl(hash);
+		int group = int(hash & (unsigned int)groupMask);
+		for (int probe = 1;; probe++)
+		{
+			const int first = group * BT_FLAT_HASH_GROUP_SIZE;
+			for (unsigned int match = btFlatHashMatchByte(m_control + first, c); match; match &= match - 1)
+			{
+				const int slot = first + btFlatHashLowestBit(match);
+				if (m_entries[slot].m_hash == hash && key.equals(m_entries[slot].m_key))
+				{
+					return slot;
+				}
+			}
+			if (btFlatHashMatchByte(m_control + first, BT_FLAT_HASH_EMPTY))
+			{
+				return -1;
+			}
+			group = (group + probe) & groupMask;
+		}
+	}
+
+	int findFreeSlot(unsigned int hash) const
+	{
+		const int groupMask = m_capacity / BT_FLAT_HASH_GROUP_SIZE - 1;
+		int group = int(hash & (unsigned int)groupMask);
+		for (int probe = 1;; probe++)
+		{
+			const int first = group * BT_FLAT_HASH_GROUP_SIZE;
+			unsigned int match = btFlatHashMatchEmptyOrDeleted(m_control + first);
+			if (match)
+			{
+				return first + btFlatHashLowestBit(match);
+			}
+			group = (group + probe) & groupMask;
+		}
+	}
+
+	void rehash(int numEntries)
+	{
+		int capacity = BT_FLAT_HASH_GROUP_SIZE;
+		while (capacity < numEntries * 2)
+		{
+			capacity *= 2;
+		}
+
+		unsigned char* oldControl = m_control;
+		btEntry* oldEntries = m_entries;
+		int oldCapacity = m_capacity;
+		m_control = (unsigned char*)btAlignedAlloc(capacity * (1 + sizeof(btEntry)), 16);
+		m_entries = (btEntry*)(m_control + capacity);
+		m_capacity = capacity;
+		for (int i = 0; i < capacity; i++)
+		{
+			m_control[i] = BT_FLAT_HASH_EMPTY;
+		}
+		// walk the old slots in memory order rather than in index order
+		for (int i = 0; i < oldCapacity; i++)
+		{
+			if (oldControl[i] & BT_FLAT_HASH_EMPTY)
+			{
+				continue;
+			}
+			btEntry& entry = oldEntries[i];
+			int slot = findFreeSlot(entry.m_hash);
+			m_control[slot] = btFlatHashControl(entry.m_hash);
+			new (&m_entries[slot]) btEntry(entry);
+			m_entrySlots[m_entries[slot].m_index] = slot;
+			entry.~btEntry();
+		}
+		m_numUsed = m_entrySlots.size();
+		btAlignedFree(oldControl);
+	}
+
+	void init()
+	{
+		m_control = 0;
+		m_entries = 0;
+		m_capacity = 0;
+		m_numUsed = 0;
+	}
+
+public:
+	btFlatHashMap()
+	{
+		init();
+	}
+
+	btFlatHashMap(const btFlatHashMap& other)
+	{
+		init();
+		*this = other;
+	}
+
+	~btFlatHashMap()
+	{
+		clear();
+	}
+
+	btFlatHashMap& operator=(const btFlatHashMap& other)
+	{
+		if (this != &other)
+		{
+			clear();
+			reserve(other.size());
+			for (int i = 0; i < other.size(); i++)
+			{
+				const btEntry& entry = other.m_entries[other.m_entrySlots[i]];
+				insert(entry.m_key, entry.m_value);
+			}
+		}
+		return *this;
+	}
+
+	void insert(const Key& key, const Value& value)
+	{
+		unsigned int hash = key.getHash();
+
+		//replace value if the key is already there
+		int slot = findSlot(key, hash);
+		if (slot >= 0)
+		{
+			m_entries[slot].m_value = value;
+			return;
+		}
+
+		if ((m_numUsed + 1) * 8 > m_capacity * 7)
+		{
+			rehash(m_entrySlots.size() + 1);
+		}
+		slot = findFreeSlot(hash);
+		if (m_control[slot] == BT_FLAT_HASH_EMPTY)
+		{
+			m_numUsed++;
+		}
+		m_control[slot] = btFlatHashControl(hash);
+		new (&m_entries[slot]) btEntry(key, value, hash, m_entrySlots.size());
+		m_entrySlots.push_back(slot);
+	}
+
+	void remove(const Key& key)
+	{
+		int slot = findSlot(key, key.getHash());
+		if (slot < 0)
+		{
+			return;
+		}
+		int index = m_entries[slot].m_index;
+		m_entries[slot].~btEntry();
+
+		// no lookup ever probed past a group that still has an empty slot, so the slot can become empty again
+		const int first = slot & ~(BT_FLAT_HASH_GROUP_SIZE - 1);
+		if (btFlatHashMatchByte(m_control + first, BT_FLAT_HASH_EMPTY))
+		{
+			m_control[slot] = BT_FLAT_HASH_EMPTY;
+			m_numUsed--;
+		}
+		else
+		{
+			m_control[slot] = BT_FLAT_HASH_DELETED;
+		}
+
+		// the last entry takes the index of the removed one
+		int lastIndex = m_entrySlots.size() - 1;
+		if (index != lastIndex)
+		{
+			m_entrySlots[index] = m_entrySlots[lastIndex];
+			m_entries[m_entrySlots[index]].m_index = index;
+		}
+		m_entrySlots.pop_back();
+	}
+
+	int size() const
+	{
+		return m_entrySlots.size();
+	}
+
+	///avoids growing the table while inserting up to numEntries entries
+	void reserve(int numEntries)
+	{
+		if (numEntries * 8 > m_capacity * 7)
+		{
+			rehash(numEntries);
+		}
+		m_entrySlots.reserve(numEntries);
+	}
+
+	const Value* getAtIndex(int index) const
+	{
+		btAssert(index < m_entrySlots.size());
+		btAssert(index >= 0);
+		if (index >= 0 && index < m_entrySlots.size())
+		{
+			return &m_entries[m_entrySlots[index]].m_value;
+		}
+		return 0;
+	}
+
+	Value* getAtIndex(int index)
+	{
+		btAssert(index < m_entrySlots.size());
+		btAssert(index >= 0);
+		if (index >= 0 && index < m_entrySlots.size())
+		{
+			return &m_entries[m_entrySlots[index]].m_value;
+		}
+		return 0;
+	}
+
+	Key getKeyAtIndex(int index)
+	{
+		btAssert(index < m_entrySlots.size());
+		btAssert(index >= 0);
+		return m_entries[m_entrySlots[index]].m_key;
+	}
+
+	const Key getKeyAtIndex(int index) const
+	{
+		btAssert(index < m_entrySlots.size());
+		btAssert(index >= 0);
+		return m_entries[m_entrySlots[index]].m_key;
+	}
+
+	Value* operator[](const Key& key)
+	{
+		return find(key);
+	}
+
+	const Value* operator[](const Key& key) const
+	{
+		return find(key);
+	}
+
+	const Value* find(const Key& key) const
+	{
+		int slot = findSlot(key, key.getHash());
+		if (slot < 0)
+		{
+			return NULL;
+		}
+		return &m_entries[slot].m_value;
+	}
+
+	Value* find(const Key& key)
+	{
+		int slot = findSlot(key, key.getHash());
+		if (slot < 0)
+		{
+			return NULL;
+		}
+		return &m_entries[slot].m_value;
+	}
+
+	int findIndex(const Key& key) const
+	{
+		int slot = findSlot(key, key.getHash());
+		if (slot < 0)
+		{
+			return BT_HASH_NULL;
+		}
+		return m_entries[slot].m_index;
+	}
+
+	void clear()
+	{
+		for (int i = 0; i < m_entrySlots.size(); i++)
+		{
+			m_entries[m_entrySlots[i]].~btEntry();
+		}
+		m_entrySlots.clear();
+		btAlignedFree(m_control);
+		init();
+	}
+};
+
+#endif  //BT_FLAT_HASH_MAP_H
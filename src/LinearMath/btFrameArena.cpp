@@ -0,0 +1,141 @@
+/*
+Copyright (c) 2003-2020 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btFrameArena.h"
+#include "btMinMax.h"
+
+///the header in front of the memory of a block, the memory starts 16 byte aligned
+struct btFrameArenaBlock
+{
+	btFrameArenaBlock* m_next;
+	size_t m_size;
+};
+
+#define BT_FRAME_ARENA_HEADER_SIZE ((sizeof(btFrameArenaBlock) + 15) & ~size_t(15))
+
+static inline unsigned char* btFrameArenaBlockMemory(btFrameArenaBlock* block)
+{
+	return (unsigned char*)block + BT_FRAME_ARENA_HEADER_SIZE;
+}
+
+btFrameArena::btFrameArena(size_t initialBytesPerThread)
+	: m_initialBytes(initialBytesPerThread)
+{
+	for (unsigned int i = 0; i < BT_MAX_THREAD_COUNT; i++)
+	{
+		btFrameArenaLane& lane = m_lanes[i];
+		lane.m_block = 0;
+		lane.m_top = 0;
+		lane.m_frameBytes = 0;
+		lane.m_highWaterMark = 0;
+		lane.m_heapAllocationCount = 0;
+	}
+}
+
+btFrameArena::~btFrameArena()
+{
+	for (unsigned int i = 0; i < BT_MAX_THREAD_COUNT; i++)
+	{
+		freeBlocks(m_lanes[i]);
+	}
+}
+
+void btFrameArena::freeBlocks(btFrameArenaLane& lane)
+{
+	while (lane.m_block)
+	{
+		btFrameArenaBlock* next = lane.m_block->m_next;
+		btAlignedFree(lane.m_block);
+		lane.m_block = next;
+	}
+	lane.m_top = 0;
+}
+
+void* btFrameArena::allocate(size_t size, int alignment)
+{
+	btAssert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+	btFrameArenaLane& lane = getLane();
+	if (lane.m_block)
+	{
+		unsigned char* memory = btFrameArenaBlockMemory(lane.m_block);
+		size_t address = (size_t)(memory + lane.m_top);
+		size_t top = ((address + alignment - 1) & ~size_t(alignment - 1)) - (size_t)memory;
+		if (top + size <= lane.m_block->m_size)
+		{
+			lane.m_frameBytes += top + size - lane.m_top;
+			lane.m_highWaterMark = btMax(lane.m_highWaterMark, lane.m_frameBytes);
+			lane.m_top = top + size;
+			return memory + top;
+		}
+	}
+	return allocateOverflow(lane, size, alignment);
+}
+
+void* btFrameArena::allocateOverflow(btFrameArenaLane& lane, size_t size, int alignment)
+{
+	// chain a block at least twice as large as the current one, the older blocks stay valid until reset
+	size_t blockSize = btMax(m_initialBytes, size + alignment);
+	if (lane.m_block)
+	{
+		blockSize = btMax(blockSize, lane.m_block->m_size * 2);
+	}
+	btFrameArenaBlock* block = (btFrameArenaBlock*)btAlignedAlloc(BT_FRAME_ARENA_HEADER_SIZE + blockSize, 16);
+	block->m_next = lane.m_block;
+	block->m_size = blockSize;
+	lane.m_block = block;
+	lane.m_top = 0;
+	lane.m_heapAllocationCount++;
+	return allocate(size, alignment);
+}
+
+void btFrameArena::reset()
+{
+	for (unsigned int i = 0; i < BT_MAX_THREAD_COUNT; i++)
+	{
+		btFrameArenaLane& lane = m_lanes[i];
+		if (lane.m_block && lane.m_block->m_next)
+		{
+			// this frame did not fit in one block, so the next one gets a single block with some room to spare
+			size_t blockSize = lane.m_highWaterMark + lane.m_highWaterMark / 4;
+			freeBlocks(lane);
+			btFrameArenaBlock* block = (btFrameArenaBlock*)btAlignedAlloc(BT_FRAME_ARENA_HEADER_SIZE + blockSize, 16);
+			block->m_next = 0;
+			block->m_size = blockSize;
+			lane.m_block = block;
+			lane.m_heapAllocationCount++;
+		}
+		lane.m_top = 0;
+		lane.m_frameBytes = 0;
+	}
+}
+
+unsigned long long btFrameArena::getHeapAllocationCount() const
+{
+	unsigned long long count = 0;
+	for (unsigned int i = 0; i < BT_MAX_THREAD_COUNT; i++)
+	{
+		count += m_lanes[i].m_heapAllocationCount;
+	}
+	return count;
+}
+
+size_t btFrameArena::getHighWaterMark() const
+{
+	size_t highWaterMark = 0;
+	for (unsigned int i = 0; i < BT_MAX_THREAD_COUNT; i++)
+	{
+		highWaterMark = btMax(highWaterMark, m_lanes[i].m_highWaterMark);
+	}
+	return highWaterMark;
+}
@@ -0,0 +1,128 @@
+/*
+Copyright (c) 2003-2020 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_FRAME_ARENA_H
+#define BT_FRAME_ARENA_H
+
+#include "btScalar.h"
+#include "btAlignedAllocator.h"
+#include "btAlignedObjectArray.h"
+#include "btThreads.h"
+
+struct btFrameArenaBlock;
+
+///one bump allocator per thread, padded so threads do not share cache lines
+struct btFrameArenaLane
+{
+	btFrameArenaBlock* m_block;  // the block allocations come from, older blocks of this frame are chained behind it
+	size_t m_top;
+	size_t m_frameBytes;  // bytes allocated this frame, over all blocks
+	size_t m_highWaterMark;
+	unsigned long long m_heapAllocationCount;
+	char m_padding[24];
+};
+
+///The btFrameArena is a linear allocator for transient data that only lives during one simulation step, such as traversal stacks
+///and temporary arrays in the narrowphase and the solvers. Each thread bumps a pointer in its own block, so it is safe to use from
+///btParallelFor bodies. Nothing is freed individually: reset releases everything at once, and replaces a lane that needed more than
+///one block by a single block of its high-water mark, so a simulation with a steady workload stops allocating after a few steps.
+///The btCollisionWorld resets its arena at the start of performDiscreteCollisionDetection, and passes it on in btDispatcherInfo
+///and btContactSolverInfo. Memory from the arena must not be kept across steps.
+class btFrameArena
+{
+	btFrameArenaLane m_lanes[BT_MAX_THREAD_COUNT];
+	size_t m_initialBytes;
+
+	void* allocateOverflow(btFrameArenaLane& lane, size_t size, int alignment);
+	void freeBlocks(btFrameArenaLane& lane);
+
+	friend class btFrameArenaScope;
+
+	btFrameArenaLane& getLane()
+	{
+#if BT_THREADSAFE
+		return m_lanes[btGetCurrentThreadIndex()];
+#else
+		return m_lanes[0];
+#endif
+	}
+
+public:
+	///initialBytesPerThread is allocated when a thread first uses the arena
+	btFrameArena(size_t initialBytesPerThread = 16 * 1024);
+
+	~btFrameArena();
+
+	///returns memory of the calling thread's lane, valid until the next reset
+	void* allocate(size_t size, int alignment = 16);
+
+	///points the empty array at arena memory for capacity elements. Beyond that it reallocates on the heap like any other array.
+	///It must not outlive the frame
+	template <typename T>
+	void initializeArray(btAlignedObjectArray<T>& array, int capacity)
+	{
+		array.initializeFromBuffer(allocate(sizeof(T) * capacity, 16), 0, capacity);
+	}
+
+	///starts a new frame, only call it while no other thread uses the arena
+	void reset();
+
+	///blocks the arena took from btAlignedAlloc since it was created, constant in steady state
+	unsigned long long getHeapAllocationCount() const;
+
+	///the most bytes a single thread allocated in one frame
+	size_t getHighWaterMark() const;
+};
+
+///btFrameArenaScope gives back the arena memory the calling thread allocated during its lifetime, for transient data of a
+///function that runs many times per step, like a traversal stack per overlapping pair. Memory in blocks the thread had to add
+///meanwhile stays in use until the next reset. A null arena is allowed and does nothing
+class btFrameArenaScope
+{
+	btFrameArena* m_arena;
+	btFrameArenaBlock* m_block;
+	size_t m_top;
+	size_t m_frameBytes;
+
+public:
+	btFrameArenaScope(btFrameArena* arena)
+		: m_arena(arena),
+		  m_block(0),
+		  m_top(0),
+		  m_frameBytes(0)
+	{
+		if (m_arena)
+		{
+			const btFrameArenaLane& lane = m_arena->getLane();
+			m_block = lane.m_block;
+			m_top = lane.m_top;
+			m_frameBytes = lane.m_frameBytes;
+		}
+	}
+
+	~btFrameArenaScope()
+	{
+		if (m_arena)
+		{
+			btFrameArenaLane& lane = m_arena->getLane();
+			if (lane.m_block == m_block)
+			{
+				lane.m_top = m_top;
+				lane.m_frameBytes = m_frameBytes;
+			}
+		}
+	}
+};
+
+#endif  //BT_FRAME_ARENA_H
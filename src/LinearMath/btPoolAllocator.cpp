@@ -0,0 +1,330 @@
+/*
+Copyright (c) 2003-2020 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btPoolAllocator.h"
+#include "btMinMax.h"
+#include <limits.h>
+
+///the number of free elements a thread cache holds, it takes or returns half of them at a time from the shared free list
+#define BT_POOL_THREAD_CACHE_SIZE 14
+
+///a magazine of free elements, only touched by its own thread. 128 bytes on 64 bit platforms, so threads do not share cache lines
+struct btPoolThreadCache
+{
+	void* m_elements[BT_POOL_THREAD_CACHE_SIZE];
+	int m_count;
+	unsigned long long m_cacheHits;
+};
+
+btPoolAllocator::btPoolAllocator(int elemSize, int maxElements, bool useThreadCaches)
+	: m_elemSize(elemSize),
+	  m_maxElements(0),
+	  m_freeCount(0),
+	  m_firstFree(0),
+	  m_pool(0),
+	  m_numSlabs(0),
+	  m_growable(false),
+	  m_threadCaches(0),
+	  m_lockCount(0),
+	  m_contendedLockCount(0),
+	  m_failedAllocations(0),
+	  m_highWaterMark(0)
+{
+	addSlab(maxElements);
+
+#if BT_THREADSAFE
+	if (useThreadCaches)
+	{
+		m_threadCaches = (btPoolThreadCache*)btAlignedAlloc(sizeof(btPoolThreadCache) * BT_MAX_THREAD_COUNT, 128);
+		for (unsigned int i = 0; i < BT_MAX_THREAD_COUNT; i++)
+		{
+			m_threadCaches[i].m_count = 0;
+			m_threadCaches[i].m_cacheHits = 0;
+		}
+	}
+#else
+	(void)useThreadCaches;
+#endif
+}
+
+btPoolAllocator::~btPoolAllocator()
+{
+	if (m_threadCaches)
+	{
+		btAlignedFree(m_threadCaches);
+	}
+	for (int i = 0; i < m_numSlabs; i++)
+	{
+		btAlignedFree(m_slabs[i].m_memory);
+	}
+}
+
+///links a new slab of elements into the free list, the caller holds the lock
+bool btPoolAllocator::addSlab(int numElements)
+{
+	const int numSlabs = m_numSlabs;
+	if (numElements <= 0 || numSlabs == BT_POOL_MAX_SLABS || numElements > INT_MAX - m_maxElements)
+	{
+		return false;
+	}
+	unsigned char* mem = (unsigned char*)btAlignedAlloc(size_t(numElements) * m_elemSize, 16);
+	if (!mem)
+	{
+		return false;
+	}
+	unsigned char* p = mem;
+	int count = numElements;
+	while (--count)
+	{
+		*(void**)p = (p + m_elemSize);
+		p += m_elemSize;
+	}
+	*(void**)p = m_firstFree;
+	m_firstFree = mem;
+	m_freeCount += numElements;
+	m_maxElements += numElements;
+
+	m_slabs[numSlabs].m_memory = mem;
+	m_slabs[numSlabs].m_numElements = numElements;
+	if (numSlabs == 0)
+	{
+		m_pool = mem;
+	}
+#if BT_THREADSAFE
+	// publishes the slab to validPtr on other threads
+	m_numSlabs.store(numSlabs + 1, std::memory_order_release);
+#else
+	m_numSlabs = numSlabs + 1;
+#endif
+	return true;
+}
+
+///called with the lock held, doubles the capacity of a growable pool when the free list is empty
+bool btPoolAllocator::growIfEmpty()
+{
+	if (!m_firstFree && m_growable)
+	{
+		addSlab(btMax(m_maxElements, 16));
+	}
+	return m_firstFree != 0;
+}
+
+bool btPoolAllocator::reserve(int numElements)
+{
+	lockFreeList();
+	bool result = numElements <= m_maxElements || addSlab(numElements - m_maxElements);
+	btMutexUnlock(&m_mutex);
+	return result;
+}
+
+void btPoolAllocator::lockFreeList()
+{
+	if (!btMutexTryLock(&m_mutex))
+	{
+		btMutexLock(&m_mutex);
+		++m_contendedLockCount;
+	}
+	++m_lockCount;
+}
+
+void btPoolAllocator::refillThreadCache(btPoolThreadCache& cache)
+{
+	lockFreeList();
+	while (cache.m_count < BT_POOL_THREAD_CACHE_SIZE / 2)
+	{
+		// only grow when nothing could be taken, a partial refill will do otherwise
+		if (!m_firstFree && (cache.m_count || !growIfEmpty()))
+		{
+			break;
+		}
+		cache.m_elements[cache.m_count++] = m_firstFree;
+		m_firstFree = *(void**)m_firstFree;
+		--m_freeCount;
+	}
+	if (cache.m_count)
+	{
+		m_highWaterMark = btMax(m_highWaterMark, m_maxElements - m_freeCount);
+	}
+	else
+	{
+		++m_failedAllocations;
+	}
+	btMutexUnlock(&m_mutex);
+}
+
+void btPoolAllocator::flushThreadCache(btPoolThreadCache& cache, int count)
+{
+	btAssert(count <= cache.m_count);
+	// link the elements first, so the lock is only held for the splice
+	void* first = 0;
+	void* last = 0;
+	for (int i = 0; i < count; i++)
+	{
+		void* ptr = cache.m_elements[--cache.m_count];
+		*(void**)ptr = first;
+		first = ptr;
+		if (!last)
+		{
+			last = ptr;
+		}
+	}
+	if (first)
+	{
+		lockFreeList();
+		*(void**)last = m_firstFree;
+		m_firstFree = first;
+		m_freeCount += count;
+		btMutexUnlock(&m_mutex);
+	}
+}
+
+///the cache of the current thread, or null to take the locked path. A thread that the thread counter wrapped onto may share its
+///index with another live thread, and gets no cache
+btPoolThreadCache* btPoolAllocator::getThreadCache()
+{
+	if (!m_threadCaches)
+	{
+		return 0;
+	}
+	int index = btGetUniqueThreadIndex();
+	return index >= 0 ? &m_threadCaches[index] : 0;
+}
+
+void* btPoolAllocator::allocate(int size)
+{
+	// release mode fix
+	(void)size;
+	btAssert(!size || size <= m_elemSize);
+	btPoolThreadCache* threadCache = getThreadCache();
+	if (threadCache)
+	{
+		btPoolThreadCache& cache = *threadCache;
+		if (cache.m_count)
+		{
+			++cache.m_cacheHits;
+		}
+		else
+		{
+			refillThreadCache(cache);
+			if (cache.m_count == 0)
+			{
+				return NULL;
+			}
+		}
+		return cache.m_elements[--cache.m_count];
+	}
+
+	lockFreeList();
+	//btAssert(m_freeCount>0);  // should return null if all full
+	growIfEmpty();
+	void* result = m_firstFree;
+	if (NULL != m_firstFree)
+	{
+		m_firstFree = *(void**)m_firstFree;
+		--m_freeCount;
+		m_highWaterMark = btMax(m_highWaterMark, m_maxElements - m_freeCount);
+	}
+	else
+	{
+		++m_failedAllocations;
+	}
+	btMutexUnlock(&m_mutex);
+	return result;
+}
+
+void btPoolAllocator::freeMemory(void* ptr)
+{
+	if (ptr)
+	{
+		btAssert(validPtr(ptr));
+
+		btPoolThreadCache* threadCache = getThreadCache();
+		if (threadCache)
+		{
+			btPoolThreadCache& cache = *threadCache;
+			if (cache.m_count == BT_POOL_THREAD_CACHE_SIZE)
+			{
+				flushThreadCache(cache, BT_POOL_THREAD_CACHE_SIZE / 2);
+			}
+			else
+			{
+				++cache.m_cacheHits;
+			}
+			cache.m_elements[cache.m_count++] = ptr;
+			return;
+		}
+
+		lockFreeList();
+		*(void**)ptr = m_firstFree;
+		m_firstFree = ptr;
+		++m_freeCount;
+		btMutexUnlock(&m_mutex);
+	}
+}
+
+void btPoolAllocator::flushThreadCaches()
+{
+	if (m_threadCaches)
+	{
+		for (unsigned int i = 0; i < BT_MAX_THREAD_COUNT; i++)
+		{
+			flushThreadCache(m_threadCaches[i], m_threadCaches[i].m_count);
+		}
+	}
+}
+
+int btPoolAllocator::getFreeCount() const
+{
+	int freeCount = m_freeCount;
+	if (m_threadCaches)
+	{
+		for (unsigned int i = 0; i < BT_MAX_THREAD_COUNT; i++)
+		{
+			freeCount += m_threadCaches[i].m_count;
+		}
+	}
+	return freeCount;
+}
+
+void btPoolAllocator::getStatistics(btPoolAllocatorStatistics& stats) const
+{
+	stats.m_cacheHits = 0;
+	stats.m_lockCount = m_lockCount;
+	stats.m_contendedLockCount = m_contendedLockCount;
+	stats.m_failedAllocations = m_failedAllocations;
+	stats.m_highWaterMark = m_highWaterMark;
+	stats.m_numSlabs = m_numSlabs;
+	if (m_threadCaches)
+	{
+		for (unsigned int i = 0; i < BT_MAX_THREAD_COUNT; i++)
+		{
+			stats.m_cacheHits += m_threadCaches[i].m_cacheHits;
+		}
+	}
+}
+
+void btPoolAllocator::resetStatistics()
+{
+	m_lockCount = 0;
+	m_contendedLockCount = 0;
+	m_failedAllocations = 0;
+	m_highWaterMark = m_maxElements - m_freeCount;
+	if (m_threadCaches)
+	{
+		for (unsigned int i = 0; i < BT_MAX_THREAD_COUNT; i++)
+		{
+			m_threadCaches[i].m_cacheHits = 0;
+		}
+	}
+}
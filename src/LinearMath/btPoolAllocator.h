@@ -19,103 +19,143 @@ subject to the following restrictions:
 #include "btAlignedAllocator.h"
 #include "btThreads.h"
 
+#if BT_THREADSAFE
+#include <atomic>
+#endif
+
+///usage and contention statistics of a btPoolAllocator, see btPoolAllocator::getStatistics
+struct btPoolAllocatorStatistics
+{
+	unsigned long long m_cacheHits;           //allocations and frees served by a thread cache, without the shared free list
+	unsigned long long m_lockCount;           //acquisitions of the shared free list lock
+	unsigned long long m_contendedLockCount;  //acquisitions that found the lock taken by another thread
+	unsigned long long m_failedAllocations;   //allocations that returned null because the pool was full and could not grow, the dispatchers fall back to btAlignedAlloc for those
+	int m_highWaterMark;                      //the most elements in use at once (elements in thread caches count as used), a good size to reserve next time
+	int m_numSlabs;                           //the initial block of elements plus the blocks added by growing
+};
+
+struct btPoolThreadCache;
+
+///a pool grows by at most this many blocks, each as large as the pool was before
+#define BT_POOL_MAX_SLABS 24
+
 ///The btPoolAllocator class allows to efficiently allocate a large pool of objects, instead of dynamically allocating them separately.
+///With thread caches (only in BT_THREADSAFE builds), each thread keeps a small magazine of free elements that it allocates from and frees to
+///without locking, and moves elements between its magazine and the shared free list in batches. Elements in the magazines of other threads
+///are not available to a thread, so allocate may return null a little before the pool is full. Thread caches are off by default.
+///A growable pool chains another block (slab) of elements when it runs out, instead of returning null. Slabs are only released
+///by the destructor, so the memory stays at the high-water mark; use reserve to pre-size the pool from a previous run's statistics.
 class btPoolAllocator
 {
+	struct btPoolSlab
+	{
+		unsigned char* m_memory;
+		int m_numElements;
+	};
+
 	int m_elemSize;
-	int m_maxElements;
+	int m_maxElements;  // the total over all slabs
 	int m_freeCount;
 	void* m_firstFree;
-	unsigned char* m_pool;
+	unsigned char* m_pool;  // the first slab
+	btPoolSlab m_slabs[BT_POOL_MAX_SLABS];  // only ever appended to while the pool is alive
+#if BT_THREADSAFE
+	std::atomic<int> m_numSlabs;  // stored with release after the slab is filled in, validPtr loads it with acquire and no lock
+#else
+	int m_numSlabs;
+#endif
+	bool m_growable;
 	btSpinMutex m_mutex;  // only used if BT_THREADSAFE
+	btPoolThreadCache* m_threadCaches;  // one per thread index, null without thread caches
+	unsigned long long m_lockCount;
+	unsigned long long m_contendedLockCount;
+	unsigned long long m_failedAllocations;
+	int m_highWaterMark;
+
+	bool addSlab(int numElements);
+	bool growIfEmpty();
+	void lockFreeList();
+	btPoolThreadCache* getThreadCache();
+	void refillThreadCache(btPoolThreadCache& cache);
+	void flushThreadCache(btPoolThreadCache& cache, int count);
 
 public:
-	btPoolAllocator(int elemSize, int maxElements)
-		: m_elemSize(elemSize),
-		  m_maxElements(maxElements)
-	{
-		m_pool = (unsigned char*)btAlignedAlloc(static_cast<unsigned int>(m_elemSize * m_maxElements), 16);
+	btPoolAllocator(int elemSize, int maxElements, bool useThreadCaches = false);
 
-		unsigned char* p = m_pool;
-		m_firstFree = p;
-		m_freeCount = m_maxElements;
-		int count = m_maxElements;
-		while (--count)
-		{
-			*(void**)p = (p + m_elemSize);
-			p += m_elemSize;
-		}
-		*(void**)p = 0;
-	}
+	~btPoolAllocator();
 
-	~btPoolAllocator()
+	///the elements on the shared free list and in the thread caches, only exact while no other thread uses the pool
+	int getFreeCount() const;
+
+	int getUsedCount() const
 	{
-		btAlignedFree(m_pool);
+		return m_maxElements - getFreeCount();
 	}
 
-	int getFreeCount() const
+	///the capacity of all slabs together
+	int getMaxCount() const
 	{
-		return m_freeCount;
+		return m_maxElements;
 	}
 
-	int getUsedCount() const
+	///a growable pool adds a slab when it is full, instead of returning null. Off by default
+	void setGrowable(bool growable)
 	{
-		return m_maxElements - m_freeCount;
+		m_growable = growable;
 	}
 
-	int getMaxCount() const
+	bool isGrowable() const
 	{
-		return m_maxElements;
+		return m_growable;
 	}
 
-	void* allocate(int size)
+	///adds a slab so the pool holds at least numElements, whether it is growable or not. Returns false if that memory could not be added
+	bool reserve(int numElements);
+
+	bool hasThreadCaches() const
 	{
-		// release mode fix
-		(void)size;
-		btMutexLock(&m_mutex);
-		btAssert(!size || size <= m_elemSize);
-		//btAssert(m_freeCount>0);  // should return null if all full
-		void* result = m_firstFree;
-		if (NULL != m_firstFree)
-		{
-			m_firstFree = *(void**)m_firstFree;
-			--m_freeCount;
-		}
-		btMutexUnlock(&m_mutex);
-		return result;
+		return m_threadCaches != 0;
 	}
 
-	bool validPtr(void* ptr)
+	void* allocate(int size);
+
+	bool validPtr(void* ptr) const
 	{
 		if (ptr)
 		{
-			if (((unsigned char*)ptr >= m_pool && (unsigned char*)ptr < m_pool + m_maxElements * m_elemSize))
+#if BT_THREADSAFE
+			const int numSlabs = m_numSlabs.load(std::memory_order_acquire);
+#else
+			const int numSlabs = m_numSlabs;
+#endif
+			for (int i = 0; i < numSlabs; i++)
 			{
-				return true;
+				const btPoolSlab& slab = m_slabs[i];
+				if ((unsigned char*)ptr >= slab.m_memory && (unsigned char*)ptr < slab.m_memory + size_t(slab.m_numElements) * m_elemSize)
+				{
+					return true;
+				}
 			}
 		}
 		return false;
 	}
 
-	void freeMemory(void* ptr)
-	{
-		if (ptr)
-		{
-			btAssert((unsigned char*)ptr >= m_pool && (unsigned char*)ptr < m_pool + m_maxElements * m_elemSize);
+	void freeMemory(void* ptr);
 
-			btMutexLock(&m_mutex);
-			*(void**)ptr = m_firstFree;
-			m_firstFree = ptr;
-			++m_freeCount;
-			btMutexUnlock(&m_mutex);
-		}
-	}
+	///moves the elements of all thread caches back to the shared free list, call it while no other thread uses the pool
+	void flushThreadCaches();
+
+	///only exact while no other thread uses the pool
+	void getStatistics(btPoolAllocatorStatistics& stats) const;
+
+	void resetStatistics();
 
 	int getElementSize() const
 	{
 		return m_elemSize;
 	}
 
+	///the first slab
 	unsigned char* getPoolAddress()
 	{
 		return m_pool;
@@ -16,6 +16,12 @@
 #include "btQuickprof.h"
 #include "btThreads.h"
 
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1700)
+// the profile rings need C++11 atomics
+#define BT_HAVE_PROFILE_RINGS 1
+#include <atomic>
+#endif
+
 #ifdef __CELLOS_LV2__
 #include <sys/sys_time.h>
 #include <sys/time_util.h>
@@ -305,6 +311,7 @@ CProfileNode::CProfileNode(const char* name, CProfileNode* parent) : Name(name),
 																	 TotalTime(0),
 																	 StartTime(0),
 																	 RecursionCounter(0),
+																	 HasStartCounters(false),
 																	 Parent(parent),
 																	 Child(NULL),
 																	 Sibling(NULL),
@@ -359,6 +366,10 @@ void CProfileNode::Reset(void)
 {
 	TotalCalls = 0;
 	TotalTime = 0.0f;
+	for (int i = 0; i < BT_PROFILE_NUM_COUNTERS; i++)
+	{
+		TotalCounters.m_values[i] = 0;
+	}
 
 	if (Child)
 	{
@@ -376,6 +387,7 @@ void CProfileNode::Call(void)
 	if (RecursionCounter++ == 0)
 	{
 		Profile_Get_Ticks(&StartTime);
+		HasStartCounters = btProfileHardwareCountersEnabled() && btReadProfileHardwareCounters(StartCounters);
 	}
 }
 
@@ -388,6 +400,15 @@ bool CProfileNode::Return(void)
 
 		time -= StartTime;
 		TotalTime += (float)time / Profile_Get_Tick_Rate();
+
+		btProfileCounters counters;
+		if (HasStartCounters && btReadProfileHardwareCounters(counters))
+		{
+			for (int i = 0; i < BT_PROFILE_NUM_COUNTERS; i++)
+			{
+				TotalCounters.m_values[i] += counters.m_values[i] - StartCounters.m_values[i];
+			}
+		}
 	}
 	return (RecursionCounter == 0);
 }
@@ -665,6 +686,31 @@ void CProfileManager::dumpRecursive(CProfileIterator* profileIterator, int spaci
 			for (i = 0; i < spacing; i++) printf(".");
 		}
 		printf("%d -- %s (%.2f %%) :: %.3f ms / frame (%d calls)\n", i, profileIterator->Get_Current_Name(), fraction, (current_total_time / (double)frames_since_reset), profileIterator->Get_Current_Total_Calls());
+		const btProfileCounters& counters = profileIterator->Get_Current_Total_Counters();
+		if (counters.m_values[BT_PROFILE_CYCLES])
+		{
+			// per frame, and per body and contact of the last step
+			int numBodies, numContacts;
+			btGetProfileWorkUnits(numBodies, numContacts);
+			double frames = frames_since_reset > 0 ? double(frames_since_reset) : 1.0;
+			double l1dMisses = counters.m_values[BT_PROFILE_L1D_MISSES] / frames;
+			double llcMisses = counters.m_values[BT_PROFILE_LLC_MISSES] / frames;
+			{
+				int i;
+				for (i = 0; i < spacing; i++) printf(".");
+			}
+			printf("     IPC %.2f, %.0f L1D / %.0f LLC / %.0f branch misses per frame", double(counters.m_values[BT_PROFILE_INSTRUCTIONS]) / double(counters.m_values[BT_PROFILE_CYCLES]),
+				   l1dMisses, llcMisses, counters.m_values[BT_PROFILE_BRANCH_MISSES] / frames);
+			if (numBodies > 0)
+			{
+				printf(", %.2f L1D / %.2f LLC per body", l1dMisses / numBodies, llcMisses / numBodies);
+			}
+			if (numContacts > 0)
+			{
+				printf(", %.2f L1D / %.2f LLC per contact", l1dMisses / numContacts, llcMisses / numContacts);
+			}
+			printf("\n");
+		}
 		totalTime += current_total_time;
 		//recurse into children
 	}
@@ -754,7 +800,12 @@ unsigned int btQuickprofGetCurrentThreadIndex2()
 	return -1;
 #endif
 
+#if BT_HAVE_PROFILE_RINGS
+	// the profile rings rely on every thread getting its own index
+	static std::atomic<int> gThreadCounter(0);
+#else
 	static int gThreadCounter = 0;
+#endif
 
 	if (sThreadIndex == kNullIndex)
 	{
@@ -794,6 +845,476 @@ void btSetCustomLeaveProfileZoneFunc(btLeaveProfileZoneFunc* leaveFunc)
 	bts_leaveFunc = leaveFunc;
 }
 
+#if BT_HAVE_PROFILE_RINGS
+
+#include "btMinMax.h"
+#include <new>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define BT_PROFILE_RING_RDTSC 1
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define BT_PROFILE_RING_RDTSC 1
+#endif
+
+#define BT_PROFILE_RING_MAX_NESTING 256
+
+// single producer (the thread that owns it), single consumer (the thread that drains it)
+ATTRIBUTE_ALIGNED64(struct)
+btProfileRing
+{
+	btProfileRecord* m_records;
+	unsigned long long int m_mask;  // capacity - 1, the capacity is a power of 2
+	// owner only, the open scopes
+	unsigned int m_generation;
+	int m_depth;
+	const char* m_names[BT_PROFILE_RING_MAX_NESTING];
+	unsigned long long int m_startTicks[BT_PROFILE_RING_MAX_NESTING];
+
+	// records [tail, head) are ready to be drained
+	ATTRIBUTE_ALIGNED64(std::atomic<unsigned long long int> m_head);
+	ATTRIBUTE_ALIGNED64(std::atomic<unsigned long long int> m_tail);
+	std::atomic<unsigned int> m_numDropped;
+};
+
+static std::atomic<btProfileRing*> gProfileRings[BT_QUICKPROF_MAX_THREAD_COUNT];
+static std::atomic<unsigned int> gProfileRingGeneration(0);
+static unsigned long long int gProfileRingCapacity = 0;
+static unsigned long long int gProfileRingStartTicks = 0;
+static double gProfileRingNanosecondsPerTick = 1.0;
+static btClock gProfileRingClock;
+static btEnterProfileZoneFunc* gProfileRingSavedEnterFunc = 0;
+static btLeaveProfileZoneFunc* gProfileRingSavedLeaveFunc = 0;
+
+static inline unsigned long long int btReadProfileTicks()
+{
+#if BT_PROFILE_RING_RDTSC
+	return __rdtsc();
+#else
+	return gProfileRingClock.getTimeNanoseconds();
+#endif
+}
+
+static btProfileRing* btGetCurrentProfileRing()
+{
+	unsigned int threadIndex = btQuickprofGetCurrentThreadIndex2();
+	if (threadIndex >= BT_QUICKPROF_MAX_THREAD_COUNT)
+	{
+		return 0;
+	}
+	btProfileRing* ring = gProfileRings[threadIndex].load(std::memory_order_acquire);
+	if (!ring)
+	{
+		// only this thread creates its ring, so there is no race
+		void* mem = btAlignedAlloc(sizeof(btProfileRing), 64);
+		ring = new (mem) btProfileRing();
+		ring->m_records = static_cast<btProfileRecord*>(btAlignedAlloc(sizeof(btProfileRecord) * gProfileRingCapacity, 64));
+		ring->m_mask = gProfileRingCapacity - 1;
+		ring->m_generation = 0;
+		ring->m_depth = 0;
+		ring->m_head.store(0, std::memory_order_relaxed);
+		ring->m_tail.store(0, std::memory_order_relaxed);
+		ring->m_numDropped.store(0, std::memory_order_relaxed);
+		gProfileRings[threadIndex].store(ring, std::memory_order_release);
+	}
+	unsigned int generation = gProfileRingGeneration.load(std::memory_order_relaxed);
+	if (ring->m_generation != generation)
+	{
+		// scopes left open by the last stop are never closed
+		ring->m_generation = generation;
+		ring->m_depth = 0;
+	}
+	return ring;
+}
+
+static void btEnterProfileZoneRing(const char* name)
+{
+	btProfileRing* ring = btGetCurrentProfileRing();
+	if (!ring)
+	{
+		return;
+	}
+	if (ring->m_depth < BT_PROFILE_RING_MAX_NESTING)
+	{
+		ring->m_names[ring->m_depth] = name;
+		ring->m_startTicks[ring->m_depth] = btReadProfileTicks();
+	}
+	ring->m_depth++;
+}
+
+static void btLeaveProfileZoneRing()
+{
+	btProfileRing* ring = btGetCurrentProfileRing();
+	if (!ring || ring->m_depth <= 0)
+	{
+		// the scope was entered before the rings were started
+		return;
+	}
+	ring->m_depth--;
+	if (ring->m_depth >= BT_PROFILE_RING_MAX_NESTING)
+	{
+		return;
+	}
+	unsigned long long int endTicks = btReadProfileTicks();
+	unsigned long long int head = ring->m_head.load(std::memory_order_relaxed);
+	if (head - ring->m_tail.load(std::memory_order_acquire) > ring->m_mask)
+	{
+		ring->m_numDropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	btProfileRecord& record = ring->m_records[head & ring->m_mask];
+	record.m_name = ring->m_names[ring->m_depth];
+	record.m_startTicks = ring->m_startTicks[ring->m_depth];
+	record.m_endTicks = endTicks;
+	ring->m_head.store(head + 1, std::memory_order_release);
+}
+
+bool btStartProfileRings(int recordsPerThread)
+{
+	if (btGetCurrentEnterProfileZoneFunc() == btEnterProfileZoneRing)
+	{
+		return true;
+	}
+	if (gProfileRingCapacity == 0)
+	{
+		gProfileRingCapacity = 1;
+		while (gProfileRingCapacity < (unsigned long long int)btMax(recordsPerThread, 2))
+		{
+			gProfileRingCapacity *= 2;
+		}
+	}
+	// calibrate the tick rate against the clock for a millisecond
+	gProfileRingClock.reset();
+	unsigned long long int startNanoseconds = gProfileRingClock.getTimeNanoseconds();
+	gProfileRingStartTicks = btReadProfileTicks();
+	unsigned long long int elapsedNanoseconds = 0;
+	while (elapsedNanoseconds < 1000000)
+	{
+		elapsedNanoseconds = gProfileRingClock.getTimeNanoseconds() - startNanoseconds;
+	}
+	unsigned long long int elapsedTicks = btReadProfileTicks() - gProfileRingStartTicks;
+	gProfileRingNanosecondsPerTick = elapsedTicks ? double(elapsedNanoseconds) / double(elapsedTicks) : 1.0;
+
+	gProfileRingGeneration.fetch_add(1, std::memory_order_relaxed);
+	gProfileRingSavedEnterFunc = btGetCurrentEnterProfileZoneFunc();
+	gProfileRingSavedLeaveFunc = btGetCurrentLeaveProfileZoneFunc();
+	btSetCustomLeaveProfileZoneFunc(btLeaveProfileZoneRing);
+	btSetCustomEnterProfileZoneFunc(btEnterProfileZoneRing);
+	return true;
+}
+
+void btStopProfileRings()
+{
+	if (btGetCurrentEnterProfileZoneFunc() != btEnterProfileZoneRing)
+	{
+		return;
+	}
+	btSetCustomEnterProfileZoneFunc(gProfileRingSavedEnterFunc);
+	btSetCustomLeaveProfileZoneFunc(gProfileRingSavedLeaveFunc);
+}
+
+int btDrainProfileRing(int threadIndex, btProfileRecord* records, int maxRecords)
+{
+	if (threadIndex < 0 || threadIndex >= int(BT_QUICKPROF_MAX_THREAD_COUNT))
+	{
+		return 0;
+	}
+	btProfileRing* ring = gProfileRings[threadIndex].load(std::memory_order_acquire);
+	if (!ring)
+	{
+		return 0;
+	}
+	unsigned long long int tail = ring->m_tail.load(std::memory_order_relaxed);
+	unsigned long long int head = ring->m_head.load(std::memory_order_acquire);
+	int numRecords = int(btMin(head - tail, (unsigned long long int)btMax(maxRecords, 0)));
+	for (int i = 0; i < numRecords; ++i)
+	{
+		records[i] = ring->m_records[(tail + i) & ring->m_mask];
+	}
+	ring->m_tail.store(tail + numRecords, std::memory_order_release);
+	return numRecords;
+}
+
+unsigned int btGetProfileRingNumDropped(int threadIndex)
+{
+	if (threadIndex < 0 || threadIndex >= int(BT_QUICKPROF_MAX_THREAD_COUNT))
+	{
+		return 0;
+	}
+	btProfileRing* ring = gProfileRings[threadIndex].load(std::memory_order_acquire);
+	return ring ? ring->m_numDropped.load(std::memory_order_relaxed) : 0;
+}
+
+unsigned long long int btProfileTicksToNanoseconds(unsigned long long int ticks)
+{
+	if (ticks <= gProfileRingStartTicks)
+	{
+		return 0;
+	}
+	return (unsigned long long int)(double(ticks - gProfileRingStartTicks) * gProfileRingNanosecondsPerTick);
+}
+
+#else  //BT_HAVE_PROFILE_RINGS
+
+bool btStartProfileRings(int recordsPerThread)
+{
+	(void)recordsPerThread;
+	return false;
+}
+
+void btStopProfileRings()
+{
+}
+
+int btDrainProfileRing(int threadIndex, btProfileRecord* records, int maxRecords)
+{
+	(void)threadIndex;
+	(void)records;
+	(void)maxRecords;
+	return 0;
+}
+
+unsigned int btGetProfileRingNumDropped(int threadIndex)
+{
+	(void)threadIndex;
+	return 0;
+}
+
+unsigned long long int btProfileTicksToNanoseconds(unsigned long long int ticks)
+{
+	return ticks;
+}
+
+#endif  //BT_HAVE_PROFILE_RINGS
+
+#if defined(__linux__) && BT_HAVE_PROFILE_RINGS
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+#include <mutex>
+
+// one group of counters per thread. Its own thread opens and reads them, the mutex lets
+// btEnableProfileHardwareCounters(false) and the exit of the thread close them.
+struct btPerfEventThread
+{
+	std::mutex m_mutex;
+	int m_groupFd;
+	int m_fds[BT_PROFILE_NUM_COUNTERS];
+	int m_readIndex[BT_PROFILE_NUM_COUNTERS];  // position in the group read, -1 if not supported
+	unsigned int m_generation;                 // 0 until the thread first reads, the fds are not set up before
+	bool m_failed;
+};
+
+static btPerfEventThread gPerfEventThreads[BT_QUICKPROF_MAX_THREAD_COUNT];
+static std::atomic<bool> gPerfEventsEnabled(false);
+static std::atomic<unsigned int> gPerfEventGeneration(0);
+
+static int btOpenPerfEvent(unsigned int type, unsigned long long int config, int groupFd)
+{
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.read_format = PERF_FORMAT_GROUP;
+	attr.exclude_kernel = 1;  // permitted with perf_event_paranoid up to 2
+	attr.exclude_hv = 1;
+	// this thread, any cpu
+	return int(syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0));
+}
+
+static void btClosePerfEvents(btPerfEventThread& thread)
+{
+	for (int i = 0; i < BT_PROFILE_NUM_COUNTERS; i++)
+	{
+		if (thread.m_fds[i] >= 0)
+		{
+			close(thread.m_fds[i]);
+		}
+		thread.m_fds[i] = -1;
+		thread.m_readIndex[i] = -1;
+	}
+	thread.m_groupFd = -1;
+}
+
+static bool btOpenPerfEvents(btPerfEventThread& thread)
+{
+	const unsigned long long int cacheMiss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	const unsigned int types[BT_PROFILE_NUM_COUNTERS] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE};
+	const unsigned long long int configs[BT_PROFILE_NUM_COUNTERS] = {
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_L1D | cacheMiss,
+		PERF_COUNT_HW_CACHE_LL | cacheMiss,
+		PERF_COUNT_HW_BRANCH_MISSES};
+	btClosePerfEvents(thread);
+	int numOpened = 0;
+	for (int i = 0; i < BT_PROFILE_NUM_COUNTERS; i++)
+	{
+		// cycles lead the group, the others are optional
+		thread.m_fds[i] = btOpenPerfEvent(types[i], configs[i], thread.m_groupFd);
+		if (thread.m_fds[i] >= 0)
+		{
+			if (thread.m_groupFd < 0)
+			{
+				thread.m_groupFd = thread.m_fds[i];
+			}
+			thread.m_readIndex[i] = numOpened++;
+		}
+		else if (i == BT_PROFILE_CYCLES)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// closes the counters of a slot that has opened them, the caller holds the slot's mutex
+static void btResetPerfEventThread(btPerfEventThread& thread)
+{
+	if (thread.m_generation != 0)
+	{
+		btClosePerfEvents(thread);
+		thread.m_generation = 0;
+	}
+}
+
+// closes the counters of its thread when the thread exits
+struct btPerfEventThreadCloser
+{
+	unsigned int m_threadIndex;
+
+	btPerfEventThreadCloser() : m_threadIndex(~0U) {}
+	~btPerfEventThreadCloser()
+	{
+		if (m_threadIndex < BT_QUICKPROF_MAX_THREAD_COUNT)
+		{
+			btPerfEventThread& thread = gPerfEventThreads[m_threadIndex];
+			std::lock_guard<std::mutex> lock(thread.m_mutex);
+			btResetPerfEventThread(thread);
+		}
+	}
+};
+
+static thread_local btPerfEventThreadCloser gPerfEventThreadCloser;
+
+bool btEnableProfileHardwareCounters(bool enable)
+{
+	bool enabled = false;
+	if (enable)
+	{
+		// check that the counters can be opened at all
+		btPerfEventThread probe;
+		probe.m_groupFd = -1;
+		for (int i = 0; i < BT_PROFILE_NUM_COUNTERS; i++)
+		{
+			probe.m_fds[i] = -1;
+		}
+		enabled = btOpenPerfEvents(probe);
+		btClosePerfEvents(probe);
+	}
+	gPerfEventsEnabled.store(enabled, std::memory_order_relaxed);
+	// threads reopen or close their counters on their next read, and then see the new enabled state
+	gPerfEventGeneration.fetch_add(1, std::memory_order_release);
+	if (!enabled)
+	{
+		// threads may never read again, close their counters now
+		for (unsigned int i = 0; i < BT_QUICKPROF_MAX_THREAD_COUNT; i++)
+		{
+			std::lock_guard<std::mutex> lock(gPerfEventThreads[i].m_mutex);
+			btResetPerfEventThread(gPerfEventThreads[i]);
+		}
+	}
+	return enabled == enable;
+}
+
+bool btReadProfileHardwareCounters(btProfileCounters& counters)
+{
+	unsigned int threadIndex = btQuickprofGetCurrentThreadIndex2();
+	if (threadIndex >= BT_QUICKPROF_MAX_THREAD_COUNT)
+	{
+		return false;
+	}
+	btPerfEventThread& thread = gPerfEventThreads[threadIndex];
+	std::lock_guard<std::mutex> lock(thread.m_mutex);
+	unsigned int generation = gPerfEventGeneration.load(std::memory_order_acquire);
+	if (thread.m_generation != generation + 1)
+	{
+		// first read of this thread since the counters were enabled or disabled
+		if (thread.m_generation == 0)
+		{
+			thread.m_groupFd = -1;
+			for (int i = 0; i < BT_PROFILE_NUM_COUNTERS; i++)
+			{
+				thread.m_fds[i] = -1;
+			}
+			gPerfEventThreadCloser.m_threadIndex = threadIndex;
+		}
+		btClosePerfEvents(thread);
+		thread.m_generation = generation + 1;
+		thread.m_failed = !gPerfEventsEnabled.load(std::memory_order_relaxed) || !btOpenPerfEvents(thread);
+	}
+	if (thread.m_failed)
+	{
+		return false;
+	}
+	unsigned long long int values[1 + BT_PROFILE_NUM_COUNTERS];
+	if (read(thread.m_groupFd, values, sizeof(values)) < ssize_t(sizeof(values[0])))
+	{
+		return false;
+	}
+	for (int i = 0; i < BT_PROFILE_NUM_COUNTERS; i++)
+	{
+		int index = thread.m_readIndex[i];
+		counters.m_values[i] = (index >= 0 && index < int(values[0])) ? values[1 + index] : 0;
+	}
+	return true;
+}
+
+bool btProfileHardwareCountersEnabled()
+{
+	return gPerfEventsEnabled.load(std::memory_order_relaxed);
+}
+
+#else  //__linux__ && BT_HAVE_PROFILE_RINGS
+
+bool btEnableProfileHardwareCounters(bool enable)
+{
+	return !enable;
+}
+
+bool btProfileHardwareCountersEnabled()
+{
+	return false;
+}
+
+bool btReadProfileHardwareCounters(btProfileCounters& counters)
+{
+	(void)counters;
+	return false;
+}
+
+#endif  //__linux__ && BT_HAVE_PROFILE_RINGS
+
+static int gProfileNumBodies = 0;
+static int gProfileNumContacts = 0;
+
+void btSetProfileWorkUnits(int numBodies, int numContacts)
+{
+	gProfileNumBodies = numBodies;
+	gProfileNumContacts = numContacts;
+}
+
+void btGetProfileWorkUnits(int& numBodies, int& numContacts)
+{
+	numBodies = gProfileNumBodies;
+	numContacts = gProfileNumContacts;
+}
+
 CProfileSample::CProfileSample(const char* name)
 {
 	btEnterProfileZone(name);
@@ -71,6 +71,59 @@ const unsigned int BT_QUICKPROF_MAX_THREAD_COUNT = 64;
 //otherwise returns thread index in range [0..maxThreads]
 unsigned int btQuickprofGetCurrentThreadIndex2();
 
+///Low overhead profiling for live applications. While the profile rings run, every BT_PROFILE scope
+///appends a btProfileRecord to a lock-free ring buffer of its thread, instead of updating the
+///CProfileManager tree. Another thread drains the rings at any time without pausing the recording
+///threads; when a ring is full, new records are dropped and counted.
+struct btProfileRecord
+{
+	const char* m_name;  // the BT_PROFILE name, the pointer identifies the scope
+	unsigned long long int m_startTicks;
+	unsigned long long int m_endTicks;
+};
+
+///starts recording into the rings, returns false if they are not supported by this build.
+///Rings are allocated by each thread when it first records and are kept for the next start.
+bool btStartProfileRings(int recordsPerThread = 65536);
+///restores the enter/leave profile zone functions that were set before btStartProfileRings
+void btStopProfileRings();
+///copies up to maxRecords of the oldest records of a thread and removes them from its ring, returns
+///the number of records copied. Only one thread may drain a given ring at a time.
+int btDrainProfileRing(int threadIndex, btProfileRecord* records, int maxRecords);
+///the number of records a thread dropped because its ring was full
+unsigned int btGetProfileRingNumDropped(int threadIndex);
+///converts record ticks to nanoseconds since btStartProfileRings
+unsigned long long int btProfileTicksToNanoseconds(unsigned long long int ticks);
+
+///Hardware performance counters of the calling thread, read with Linux perf events. They show whether
+///a profiled scope is bound by cache misses or by compute.
+enum btProfileCounterType
+{
+	BT_PROFILE_CYCLES,
+	BT_PROFILE_INSTRUCTIONS,
+	BT_PROFILE_L1D_MISSES,
+	BT_PROFILE_LLC_MISSES,
+	BT_PROFILE_BRANCH_MISSES,
+	BT_PROFILE_NUM_COUNTERS
+};
+
+struct btProfileCounters
+{
+	unsigned long long int m_values[BT_PROFILE_NUM_COUNTERS];
+};
+
+///returns false (and stays disabled) where perf events are not available or not permitted, for example
+///because of /proc/sys/kernel/perf_event_paranoid. Each thread opens its counters when it first reads them,
+///they are closed when the thread exits or the counters are disabled.
+bool btEnableProfileHardwareCounters(bool enable);
+bool btProfileHardwareCountersEnabled();
+///the counts of the calling thread since it opened its counters, returns false if it has none.
+///Counters the CPU does not support stay 0.
+bool btReadProfileHardwareCounters(btProfileCounters& counters);
+///the amount of work of the last step, profile dumps report misses per body and per contact
+void btSetProfileWorkUnits(int numBodies, int numContacts);
+void btGetProfileWorkUnits(int& numBodies, int& numContacts);
+
 #ifndef BT_NO_PROFILE
 
 
@@ -100,6 +153,7 @@ public:
 	const char* Get_Name(void) { return Name; }
 	int Get_Total_Calls(void) { return TotalCalls; }
 	float Get_Total_Time(void) { return TotalTime; }
+	const btProfileCounters& Get_Total_Counters(void) { return TotalCounters; }
 	void* GetUserPointer() const { return m_userPtr; }
 	void SetUserPointer(void* ptr) { m_userPtr = ptr; }
 
@@ -109,6 +163,9 @@ protected:
 	float TotalTime;
 	unsigned long int StartTime;
 	int RecursionCounter;
+	btProfileCounters TotalCounters;
+	btProfileCounters StartCounters;
+	bool HasStartCounters;
 
 	CProfileNode* Parent;
 	CProfileNode* Child;
@@ -134,6 +191,7 @@ public:
 	const char* Get_Current_Name(void) { return CurrentChild->Get_Name(); }
 	int Get_Current_Total_Calls(void) { return CurrentChild->Get_Total_Calls(); }
 	float Get_Current_Total_Time(void) { return CurrentChild->Get_Total_Time(); }
+	const btProfileCounters& Get_Current_Total_Counters(void) { return CurrentChild->Get_Total_Counters(); }
 
 	void* Get_Current_UserPointer(void) { return CurrentChild->GetUserPointer(); }
 	void Set_Current_UserPointer(void* ptr) { CurrentChild->SetUserPointer(ptr); }
@@ -0,0 +1,156 @@
+/*
+Copyright (c) 2003-2020 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btRadixSort.h"
+#include "btThreads.h"
+#include "btQuickprof.h"
+#include "btMinMax.h"
+
+#define BT_RADIX_SORT_BITS 8
+#define BT_RADIX_SORT_BUCKETS (1 << BT_RADIX_SORT_BITS)
+
+// entries per block, each block counts and scatters its entries on one thread
+#define BT_RADIX_SORT_BLOCK_SIZE 16384
+
+struct btRadixSortCountLoop : public btIParallelForBody
+{
+	const btRadixSortEntry* m_src;
+	int m_numEntries;
+	int m_shift;
+	unsigned int* m_counts;  // BT_RADIX_SORT_BUCKETS per block
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int block = iBegin; block < iEnd; block++)
+		{
+			unsigned int* counts = m_counts + block * BT_RADIX_SORT_BUCKETS;
+			for (int i = 0; i < BT_RADIX_SORT_BUCKETS; i++)
+			{
+				counts[i] = 0;
+			}
+			int end = btMin(m_numEntries, (block + 1) * BT_RADIX_SORT_BLOCK_SIZE);
+			for (int i = block * BT_RADIX_SORT_BLOCK_SIZE; i < end; i++)
+			{
+				counts[(m_src[i].m_key >> m_shift) & (BT_RADIX_SORT_BUCKETS - 1)]++;
+			}
+		}
+	}
+};
+
+struct btRadixSortScatterLoop : public btIParallelForBody
+{
+	const btRadixSortEntry* m_src;
+	btRadixSortEntry* m_dst;
+	int m_numEntries;
+	int m_shift;
+	unsigned int* m_offsets;  // BT_RADIX_SORT_BUCKETS per block
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int block = iBegin; block < iEnd; block++)
+		{
+			unsigned int* offsets = m_offsets + block * BT_RADIX_SORT_BUCKETS;
+			int end = btMin(m_numEntries, (block + 1) * BT_RADIX_SORT_BLOCK_SIZE);
+			for (int i = block * BT_RADIX_SORT_BLOCK_SIZE; i < end; i++)
+			{
+				m_dst[offsets[(m_src[i].m_key >> m_shift) & (BT_RADIX_SORT_BUCKETS - 1)]++] = m_src[i];
+			}
+		}
+	}
+};
+
+struct btRadixSortCopyLoop : public btIParallelForBody
+{
+	const btRadixSortEntry* m_src;
+	btRadixSortEntry* m_dst;
+	int m_numEntries;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		int end = btMin(m_numEntries, iEnd * BT_RADIX_SORT_BLOCK_SIZE);
+		for (int i = iBegin * BT_RADIX_SORT_BLOCK_SIZE; i < end; i++)
+		{
+			m_dst[i] = m_src[i];
+		}
+	}
+};
+
+void btRadixSort(btAlignedObjectArray<btRadixSortEntry>& entries, btAlignedObjectArray<btRadixSortEntry>& scratch, int numKeyBits)
+{
+	BT_PROFILE("btRadixSort");
+	btAssert(numKeyBits <= 64);
+	const int numEntries = entries.size();
+	if (numEntries < 2)
+	{
+		return;
+	}
+	scratch.resizeNoInitialize(numEntries);
+
+	const int numBlocks = (numEntries + BT_RADIX_SORT_BLOCK_SIZE - 1) / BT_RADIX_SORT_BLOCK_SIZE;
+	btAlignedObjectArray<unsigned int> counts;
+	counts.resizeNoInitialize(numBlocks * BT_RADIX_SORT_BUCKETS);
+
+	btRadixSortEntry* src = &entries[0];
+	btRadixSortEntry* dst = &scratch[0];
+	for (int shift = 0; shift < numKeyBits; shift += BT_RADIX_SORT_BITS)
+	{
+		btRadixSortCountLoop countLoop;
+		countLoop.m_src = src;
+		countLoop.m_numEntries = numEntries;
+		countLoop.m_shift = shift;
+		countLoop.m_counts = &counts[0];
+		btParallelForOrSerial(0, numBlocks, 1, countLoop);
+
+		// turn the counts into the offset where each block writes each digit, digits first so the sort stays stable
+		unsigned int offset = 0;
+		bool singleDigit = false;
+		for (int digit = 0; digit < BT_RADIX_SORT_BUCKETS; digit++)
+		{
+			unsigned int digitBegin = offset;
+			for (int block = 0; block < numBlocks; block++)
+			{
+				unsigned int count = counts[block * BT_RADIX_SORT_BUCKETS + digit];
+				counts[block * BT_RADIX_SORT_BUCKETS + digit] = offset;
+				offset += count;
+			}
+			if (offset - digitBegin == (unsigned int)numEntries)
+			{
+				singleDigit = true;
+				break;
+			}
+		}
+		if (singleDigit)
+		{
+			continue;
+		}
+
+		btRadixSortScatterLoop scatterLoop;
+		scatterLoop.m_src = src;
+		scatterLoop.m_dst = dst;
+		scatterLoop.m_numEntries = numEntries;
+		scatterLoop.m_shift = shift;
+		scatterLoop.m_offsets = &counts[0];
+		btParallelForOrSerial(0, numBlocks, 1, scatterLoop);
+		btSwap(src, dst);
+	}
+
+	if (src != &entries[0])
+	{
+		btRadixSortCopyLoop copyLoop;
+		copyLoop.m_src = src;
+		copyLoop.m_dst = &entries[0];
+		copyLoop.m_numEntries = numEntries;
+		btParallelForOrSerial(0, numBlocks, 1, copyLoop);
+	}
+}
@@ -0,0 +1,35 @@
+/*
+Copyright (c) 2003-2020 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_RADIX_SORT_H
+#define BT_RADIX_SORT_H
+
+#include "btAlignedObjectArray.h"
+
+///a key with the value that travels along with it, usually the index of the sorted item
+struct btRadixSortEntry
+{
+	unsigned long long m_key;
+	int m_value;
+};
+
+///btRadixSort sorts the entries by key with a least significant digit radix sort, 8 bits per pass, the CPU counterpart of
+///b3RadixSort32CL. The sort is stable. numKeyBits (at most 64) is rounded up to whole 8 bit digits and only those low digits
+///of the keys take part, higher key bits are ignored. A pass is skipped when all entries share its digit, so small keys cost
+///few passes. Each pass counts and scatters blocks of entries with btParallelFor when a
+///task scheduler is set in a BT_THREADSAFE build. The result does not depend on the number of threads.
+///scratch is resized to the number of entries and can be kept between calls to avoid allocations.
+void btRadixSort(btAlignedObjectArray<btRadixSortEntry>& entries, btAlignedObjectArray<btRadixSortEntry>& scratch, int numKeyBits = 64);
+
+#endif  //BT_RADIX_SORT_H
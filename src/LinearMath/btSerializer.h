@@ -17,7 +17,7 @@ subject to the following restrictions:
 #define BT_SERIALIZER_H
 
 #include "btScalar.h"  // has definitions like SIMD_FORCE_INLINE
-#include "btHashMap.h"
+#include "btFlatHashMap.h"
 
 #if !defined(__CELLOS_LV2__) && !defined(__MWERKS__)
 #include <memory.h>
@@ -159,14 +159,14 @@ protected:
 	btAlignedObjectArray<char*> mTypes;
 	btAlignedObjectArray<short*> mStructs;
 	btAlignedObjectArray<short> mTlens;
-	btHashMap<btHashInt, int> mStructReverse;
-	btHashMap<btHashString, int> mTypeLookup;
+	btFlatHashMap<btHashInt, int> mStructReverse;
+	btFlatHashMap<btHashString, int> mTypeLookup;
 
-	btHashMap<btHashPtr, void*> m_chunkP;
+	btFlatHashMap<btHashPtr, void*> m_chunkP;
 
-	btHashMap<btHashPtr, const char*> m_nameMap;
+	btFlatHashMap<btHashPtr, const char*> m_nameMap;
 
-	btHashMap<btHashPtr, btPointerUid> m_uniquePointers;
+	btFlatHashMap<btHashPtr, btPointerUid> m_uniquePointers;
 	int m_uniqueIdGenerator;
 
 	int m_totalSize;
@@ -363,7 +363,7 @@ protected:
 	}
 
 public:
-	btHashMap<btHashPtr, void*> m_skipPointers;
+	btFlatHashMap<btHashPtr, void*> m_skipPointers;
 
 	btDefaultSerializer(int totalSize = 0, unsigned char* buffer = 0)
 		: m_uniqueIdGenerator(0),
@@ -373,6 +373,7 @@ public:
 		  m_dnaLength(0),
 		  m_serializationFlags(0)
 	{
+		BT_MEMORY_TAG(BT_MEMORY_TAG_SERIALIZER);
 		if (buffer == 0)
 		{
 			m_buffer = m_totalSize ? (unsigned char*)btAlignedAlloc(totalSize, 16) : 0;
@@ -486,6 +487,7 @@ public:
 
 	virtual void startSerialization()
 	{
+		BT_MEMORY_TAG(BT_MEMORY_TAG_SERIALIZER);
 		m_uniqueIdGenerator = 1;
 		if (m_totalSize)
 		{
@@ -496,6 +498,7 @@ public:
 
 	virtual void finishSerialization()
 	{
+		BT_MEMORY_TAG(BT_MEMORY_TAG_SERIALIZER);
 		writeDNA();
 
 		//if we didn't pre-allocate a buffer, we need to create a contiguous buffer now
@@ -533,6 +536,7 @@ public:
 
 	virtual void* getUniquePointer(void* oldPtr)
 	{
+		BT_MEMORY_TAG(BT_MEMORY_TAG_SERIALIZER);
 		btAssert(m_uniqueIdGenerator >= 0);
 		if (!oldPtr)
 			return 0;
@@ -570,6 +574,7 @@ public:
 
 	virtual void finalizeChunk(btChunk* chunk, const char* structType, int chunkCode, void* oldPtr)
 	{
+		BT_MEMORY_TAG(BT_MEMORY_TAG_SERIALIZER);
 		if (!(m_serializationFlags & BT_SERIALIZE_NO_DUPLICATE_ASSERT))
 		{
 			btAssert(!findPointer(oldPtr));
@@ -605,6 +610,7 @@ public:
 
 	virtual btChunk* allocate(size_t size, int numElements)
 	{
+		BT_MEMORY_TAG(BT_MEMORY_TAG_SERIALIZER);
 		unsigned char* ptr = internalAlloc(int(size) * numElements + sizeof(btChunk));
 
 		unsigned char* data = ptr + sizeof(btChunk);
@@ -630,6 +636,7 @@ public:
 
 	virtual void registerNameForPointer(const void* ptr, const char* name)
 	{
+		BT_MEMORY_TAG(BT_MEMORY_TAG_SERIALIZER);
 		m_nameMap.insert(ptr, name);
 	}
 
@@ -690,9 +697,9 @@ public:
 
 struct btInMemorySerializer : public btDefaultSerializer
 {
-	btHashMap<btHashPtr, btChunk*> m_uid2ChunkPtr;
-	btHashMap<btHashPtr, void*> m_orgPtr2UniqueDataPtr;
-	btHashMap<btHashString, const void*> m_names2Ptr;
+	btFlatHashMap<btHashPtr, btChunk*> m_uid2ChunkPtr;
+	btFlatHashMap<btHashPtr, void*> m_orgPtr2UniqueDataPtr;
+	btFlatHashMap<btHashString, const void*> m_names2Ptr;
 
 	btBulletSerializedArrays m_arrays;
 
@@ -720,6 +727,7 @@ struct btInMemorySerializer : public btDefaultSerializer
 
 	virtual void registerNameForPointer(const void* ptr, const char* name)
 	{
+		BT_MEMORY_TAG(BT_MEMORY_TAG_SERIALIZER);
 		btDefaultSerializer::registerNameForPointer(ptr, name);
 		m_names2Ptr.insert(name, ptr);
 	}
@@ -768,6 +776,7 @@ struct btInMemorySerializer : public btDefaultSerializer
 
 	virtual void finalizeChunk(btChunk* chunk, const char* structType, int chunkCode, void* oldPtr)
 	{
+		BT_MEMORY_TAG(BT_MEMORY_TAG_SERIALIZER);
 		if (!(m_serializationFlags & BT_SERIALIZE_NO_DUPLICATE_ASSERT))
 		{
 			btAssert(!findPointer(oldPtr));
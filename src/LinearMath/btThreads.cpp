@@ -14,6 +14,7 @@ subject to the following restrictions:
 
 #include "btThreads.h"
 #include "btQuickprof.h"
+#include "btAlignedAllocator.h"
 #include <algorithm>  // for min and max
 
 #if BT_USE_OPENMP && BT_THREADSAFE
@@ -216,12 +217,19 @@ bool btSpinMutex::tryLock()
 struct ThreadsafeCounter
 {
 	unsigned int mCounter;
+	bool mWrapped;                              // the counter wrapped since the last reset
+	volatile int mShared[BT_MAX_THREAD_COUNT];  // the index was handed out again after a wrap, and may belong to two live threads
 	btSpinMutex mMutex;
 
 	ThreadsafeCounter()
 	{
 		mCounter = 0;
 		--mCounter;  // first count should come back 0
+		mWrapped = false;
+		for (unsigned int i = 0; i < BT_MAX_THREAD_COUNT; ++i)
+		{
+			mShared[i] = 0;
+		}
 	}
 
 	unsigned int getNext()
@@ -234,11 +242,28 @@ struct ThreadsafeCounter
 			btAssert(!"thread counter exceeded");
 			// wrap back to the first worker index
 			mCounter = 1;
+			mWrapped = true;
 		}
 		unsigned int val = mCounter;
+		if (mWrapped)
+		{
+			mShared[val] = 1;
+		}
 		mMutex.unlock();
 		return val;
 	}
+
+	void reset()
+	{
+		mMutex.lock();
+		mCounter = 0;
+		mWrapped = false;
+		for (unsigned int i = 0; i < BT_MAX_THREAD_COUNT; ++i)
+		{
+			mShared[i] = 0;
+		}
+		mMutex.unlock();
+	}
 };
 
 static btITaskScheduler* gBtTaskScheduler=0;
@@ -321,6 +346,12 @@ unsigned int btGetCurrentThreadIndex()
 	return sThreadIndex;
 }
 
+int btGetUniqueThreadIndex()
+{
+	unsigned int index = btGetCurrentThreadIndex();
+	return gThreadCounter.mShared[index] ? -1 : int(index);
+}
+
 bool btIsMainThread()
 {
 	return btGetCurrentThreadIndex() == 0;
@@ -330,7 +361,7 @@ void btResetThreadIndexCounter()
 {
 	// for when all current worker threads are destroyed
 	btAssert(btIsMainThread());
-	gThreadCounter.mCounter = 0;
+	gThreadCounter.reset();
 }
 
 btITaskScheduler::btITaskScheduler(const char* name)
@@ -409,6 +440,37 @@ btITaskScheduler* btGetTaskScheduler()
 	return gBtTaskScheduler;
 }
 
+#if BT_THREADSAFE && BT_USE_MEMORY_TAGS
+///runs the loop body under the memory tag of the thread that called btParallelFor
+struct btMemoryTaggedParallelForBody : public btIParallelForBody
+{
+	const btIParallelForBody& m_body;
+	btMemoryTag m_tag;
+
+	btMemoryTaggedParallelForBody(const btIParallelForBody& body) : m_body(body), m_tag(btGetMemoryTag()) {}
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		BT_MEMORY_TAG(m_tag);
+		m_body.forLoop(iBegin, iEnd);
+	}
+};
+
+struct btMemoryTaggedParallelSumBody : public btIParallelSumBody
+{
+	const btIParallelSumBody& m_body;
+	btMemoryTag m_tag;
+
+	btMemoryTaggedParallelSumBody(const btIParallelSumBody& body) : m_body(body), m_tag(btGetMemoryTag()) {}
+
+	btScalar sumLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		BT_MEMORY_TAG(m_tag);
+		return m_body.sumLoop(iBegin, iEnd);
+	}
+};
+#endif  // #if BT_THREADSAFE && BT_USE_MEMORY_TAGS
+
 void btParallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body)
 {
 #if BT_THREADSAFE
@@ -425,7 +487,12 @@ void btParallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody
 #endif  // #if BT_DETECT_BAD_THREAD_INDEX
 
 	btAssert(gBtTaskScheduler != NULL);  // call btSetTaskScheduler() with a valid task scheduler first!
+#if BT_USE_MEMORY_TAGS
+	btMemoryTaggedParallelForBody taggedBody(body);
+	gBtTaskScheduler->parallelFor(iBegin, iEnd, grainSize, taggedBody);
+#else
 	gBtTaskScheduler->parallelFor(iBegin, iEnd, grainSize, body);
+#endif
 
 #else  // #if BT_THREADSAFE
 
@@ -452,7 +519,12 @@ btScalar btParallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSum
 #endif  // #if BT_DETECT_BAD_THREAD_INDEX
 
 	btAssert(gBtTaskScheduler != NULL);  // call btSetTaskScheduler() with a valid task scheduler first!
+#if BT_USE_MEMORY_TAGS
+	btMemoryTaggedParallelSumBody taggedBody(body);
+	return gBtTaskScheduler->parallelSum(iBegin, iEnd, grainSize, taggedBody);
+#else
 	return gBtTaskScheduler->parallelSum(iBegin, iEnd, grainSize, body);
+#endif
 
 #else  // #if BT_THREADSAFE
 
@@ -463,6 +535,122 @@ btScalar btParallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSum
 #endif  //#else // #if BT_THREADSAFE
 }
 
+void btParallelForOrSerial(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body)
+{
+#if BT_THREADSAFE
+	if (gBtTaskScheduler && iEnd - iBegin > grainSize)
+	{
+		btParallelFor(iBegin, iEnd, grainSize, body);
+		return;
+	}
+#endif  // #if BT_THREADSAFE
+	body.forLoop(iBegin, iEnd);
+}
+
+void btTaskGraph::prepare()
+{
+	int numTasks = m_bodies.size();
+	int numEdges = m_edges.size() / 2;
+	m_numPredecessors.resize(numTasks);
+	m_successorStart.resize(numTasks + 1);
+	for (int i = 0; i < numTasks; ++i)
+	{
+		m_numPredecessors[i] = 0;
+		m_successorStart[i] = 0;
+	}
+	m_successorStart[numTasks] = 0;
+	for (int i = 0; i < numEdges; ++i)
+	{
+		m_numPredecessors[m_edges[i * 2 + 1]]++;
+		m_successorStart[m_edges[i * 2] + 1]++;
+	}
+	for (int i = 0; i < numTasks; ++i)
+	{
+		m_successorStart[i + 1] += m_successorStart[i];
+	}
+	btAlignedObjectArray<int> cursor;
+	cursor.resize(numTasks);
+	for (int i = 0; i < numTasks; ++i)
+	{
+		cursor[i] = m_successorStart[i];
+	}
+	m_successors.resize(numEdges);
+	for (int i = 0; i < numEdges; ++i)
+	{
+		m_successors[cursor[m_edges[i * 2]]++] = m_edges[i * 2 + 1];
+	}
+}
+
+struct TaskGraphWaveBody : public btIParallelForBody
+{
+	const btTaskGraph& m_graph;
+	const btAlignedObjectArray<int>& m_wave;
+
+	TaskGraphWaveBody(const btTaskGraph& graph, const btAlignedObjectArray<int>& wave) : m_graph(graph), m_wave(wave) {}
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			m_graph.getTaskBody(m_wave[i]).run();
+		}
+	}
+};
+
+void btITaskScheduler::runTaskGraph(const btTaskGraph& graph)
+{
+	BT_PROFILE("runTaskGraph");
+	int numTasks = graph.getNumTasks();
+	btAlignedObjectArray<int> pending;
+	btAlignedObjectArray<int> wave;
+	btAlignedObjectArray<int> nextWave;
+	pending.resize(numTasks);
+	for (int i = 0; i < numTasks; ++i)
+	{
+		pending[i] = graph.getNumPredecessors(i);
+		if (pending[i] == 0)
+		{
+			wave.push_back(i);
+		}
+	}
+	int numTasksRun = 0;
+	while (wave.size() > 0)
+	{
+		TaskGraphWaveBody body(graph, wave);
+		parallelFor(0, wave.size(), 1, body);
+		numTasksRun += wave.size();
+
+		nextWave.resizeNoInitialize(0);
+		for (int i = 0; i < wave.size(); ++i)
+		{
+			int task = wave[i];
+			for (int j = 0; j < graph.getNumSuccessors(task); ++j)
+			{
+				int successor = graph.getSuccessor(task, j);
+				if (--pending[successor] == 0)
+				{
+					nextWave.push_back(successor);
+				}
+			}
+		}
+		wave.copyFromArray(nextWave);
+	}
+	btAssert(numTasksRun == numTasks);  // the dependencies contain a cycle
+	(void)numTasksRun;
+}
+
+void btRunTaskGraph(btTaskGraph& graph)
+{
+	graph.prepare();
+#if BT_THREADSAFE
+	btAssert(gBtTaskScheduler != NULL);  // call btSetTaskScheduler() with a valid task scheduler first!
+	gBtTaskScheduler->runTaskGraph(graph);
+#else   // #if BT_THREADSAFE
+	// non-parallel version of btRunTaskGraph
+	btGetSequentialTaskScheduler()->runTaskGraph(graph);
+#endif  // #if BT_THREADSAFE
+}
+
 ///
 /// btTaskSchedulerSequential -- non-threaded implementation of task scheduler
 ///                              (really just useful for testing performance of single threaded vs multi)
@@ -599,6 +787,10 @@ public:
 			btResetThreadIndexCounter();
 		}
 	}
+	virtual bool supportsNestedParallelism() const BT_OVERRIDE
+	{
+		return true;
+	}
 	struct ForBodyAdapter
 	{
 		const btIParallelForBody* mBody;
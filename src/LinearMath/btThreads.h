@@ -16,6 +16,7 @@ subject to the following restrictions:
 #define BT_THREADS_H
 
 #include "btScalar.h"  // has definitions like SIMD_FORCE_INLINE
+#include "btAlignedObjectArray.h"
 
 #if defined(_MSC_VER) && _MSC_VER >= 1600
 // give us a compile error if any signatures of overriden methods is changed
@@ -34,6 +35,7 @@ const unsigned int BT_MAX_THREAD_COUNT = 64;  // only if BT_THREADSAFE is 1
 bool btIsMainThread();
 bool btThreadsAreRunning();
 unsigned int btGetCurrentThreadIndex();
+int btGetUniqueThreadIndex();  // btGetCurrentThreadIndex, or -1 once the counter wrapped and another live thread may have the same index
 void btResetThreadIndexCounter();  // notify that all worker threads have been destroyed
 
 ///
@@ -116,6 +118,145 @@ public:
 	virtual btScalar sumLoop(int iBegin, int iEnd) const = 0;
 };
 
+//
+// btITaskBody -- subclass this to express one task of a btTaskGraph
+//
+class btITaskBody
+{
+public:
+	virtual ~btITaskBody() {}
+	virtual void run() const = 0;
+};
+
+//
+// btTaskGraph -- a set of tasks and dependencies between them, run with btRunTaskGraph()
+//                A task starts as soon as all the tasks it depends on have finished, tasks
+//                that do not depend on each other may run at the same time. Bodies are not
+//                owned by the graph and must stay alive until the graph has run.
+//
+class btTaskGraph
+{
+	btAlignedObjectArray<const btITaskBody*> m_bodies;
+	btAlignedObjectArray<int> m_edges;  // pairs of (before, after)
+	// built by prepare()
+	btAlignedObjectArray<int> m_numPredecessors;
+	btAlignedObjectArray<int> m_successorStart;
+	btAlignedObjectArray<int> m_successors;
+
+public:
+	// returns the index of the new task
+	int addTask(const btITaskBody& body)
+	{
+		m_bodies.push_back(&body);
+		return m_bodies.size() - 1;
+	}
+	// task 'after' does not start before task 'before' has finished (it is a continuation of 'before')
+	void addDependency(int before, int after)
+	{
+		btAssert(before >= 0 && before < m_bodies.size());
+		btAssert(after >= 0 && after < m_bodies.size());
+		m_edges.push_back(before);
+		m_edges.push_back(after);
+	}
+	void clear()
+	{
+		m_bodies.resizeNoInitialize(0);
+		m_edges.resizeNoInitialize(0);
+	}
+
+	// for task schedulers, valid after prepare()
+	void prepare();
+	int getNumTasks() const { return m_bodies.size(); }
+	const btITaskBody& getTaskBody(int task) const { return *m_bodies[task]; }
+	int getNumPredecessors(int task) const { return m_numPredecessors[task]; }
+	int getNumSuccessors(int task) const { return m_successorStart[task + 1] - m_successorStart[task]; }
+	int getSuccessor(int task, int i) const { return m_successors[m_successorStart[task] + i]; }
+};
+
+//
+// btWorkerWaitPolicy -- how idle worker threads wait for more work. A worker spins for m_spinTime
+//                       microseconds, then yields its time slice for m_yieldTime microseconds, then
+//                       parks until new work arrives. Spinning wakes up fastest, parking frees the core.
+//
+struct btWorkerWaitPolicy
+{
+	unsigned int m_spinTime;
+	unsigned int m_yieldTime;
+	// whether sleepWorkerThreadsHint() parks the workers right away or is ignored
+	bool m_parkOnSleepHint;
+
+	btWorkerWaitPolicy() : m_spinTime(100), m_yieldTime(0), m_parkOnSleepHint(true) {}
+};
+
+//
+// btAffinityMask -- a set of logical processors, grows to hold any processor number
+//
+class btAffinityMask
+{
+	// processor n is bit n % 64 of word n / 64. On Windows word g holds processor group g.
+	btAlignedObjectArray<unsigned long long> m_words;
+
+public:
+	void setProcessor(int processor)
+	{
+		btAssert(processor >= 0);
+		int word = processor / 64;
+		if (word >= m_words.size())
+		{
+			m_words.resize(word + 1, 0);
+		}
+		m_words[word] |= 1ULL << (processor % 64);
+	}
+	bool hasProcessor(int processor) const
+	{
+		int word = processor / 64;
+		return processor >= 0 && word < m_words.size() && (m_words[word] & (1ULL << (processor % 64))) != 0;
+	}
+	// one past the highest processor in the set, 0 if the set is empty
+	int getProcessorLimit() const
+	{
+		for (int word = m_words.size() - 1; word >= 0; --word)
+		{
+			for (int bit = 63; bit >= 0; --bit)
+			{
+				if (m_words[word] & (1ULL << bit))
+				{
+					return word * 64 + bit + 1;
+				}
+			}
+		}
+		return 0;
+	}
+	bool isEmpty() const { return getProcessorLimit() == 0; }
+	int getNumWords() const { return m_words.size(); }
+	// processors 64 * word to 64 * word + 63
+	unsigned long long getWord(int word) const { return word < m_words.size() ? m_words[word] : 0; }
+	void setWord(int word, unsigned long long bits)
+	{
+		if (word >= m_words.size())
+		{
+			m_words.resize(word + 1, 0);
+		}
+		m_words[word] = bits;
+	}
+	void clear() { m_words.clear(); }
+};
+
+//
+// btWorkerThreadInfo -- worker thread placement for btCreateDefaultTaskScheduler() and
+//                       btCreateWorkStealingTaskScheduler()
+//
+struct btWorkerThreadInfo
+{
+	// worker thread i only runs on the logical processors in m_affinityMasks[i % m_numAffinityMasks].
+	// Workers pinned this way also allocate their scratch memory on their own NUMA node. Without masks
+	// the OS decides.
+	const btAffinityMask* m_affinityMasks;
+	int m_numAffinityMasks;
+
+	btWorkerThreadInfo() : m_affinityMasks(NULL), m_numAffinityMasks(0) {}
+};
+
 //
 // btITaskScheduler -- subclass this to implement a task scheduler that can dispatch work to
 //                     worker threads
@@ -133,6 +274,14 @@ public:
 	virtual void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body) = 0;
 	virtual btScalar parallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSumBody& body) = 0;
 	virtual void sleepWorkerThreadsHint() {}  // hint the task scheduler that we may not be using these threads for a little while
+	virtual void setWorkerWaitPolicy(const btWorkerWaitPolicy& policy) { m_workerWaitPolicy = policy; }
+	const btWorkerWaitPolicy& getWorkerWaitPolicy() const { return m_workerWaitPolicy; }
+	// whether parallelFor/parallelSum called from inside a loop body or a graph task still runs in parallel,
+	// schedulers that return false run such nested loops on the calling thread
+	virtual bool supportsNestedParallelism() const { return false; }
+	// runs all tasks of a prepared graph and returns when they are done. The default implementation
+	// runs the graph in waves of independent tasks, each wave is one parallelFor.
+	virtual void runTaskGraph(const btTaskGraph& graph);
 
 	// internal use only
 	virtual void activate();
@@ -142,6 +291,7 @@ protected:
 	const char* m_name;
 	unsigned int m_savedThreadCounter;
 	bool m_isActive;
+	btWorkerWaitPolicy m_workerWaitPolicy;
 };
 
 // set the task scheduler to use for all calls to btParallelFor()
@@ -156,6 +306,14 @@ btITaskScheduler* btGetSequentialTaskScheduler();
 
 // create a default task scheduler (Win32 or pthreads based)
 btITaskScheduler* btCreateDefaultTaskScheduler();
+btITaskScheduler* btCreateDefaultTaskScheduler(const btWorkerThreadInfo& info);
+
+// create a work-stealing task scheduler (Win32 or pthreads based), balances loops whose iterations vary in cost
+btITaskScheduler* btCreateWorkStealingTaskScheduler();
+btITaskScheduler* btCreateWorkStealingTaskScheduler(const btWorkerThreadInfo& info);
+
+// the logical processors of a NUMA node as an affinity mask for btWorkerThreadInfo, empty if unknown
+btAffinityMask btGetNumaNodeAffinityMask(int node);
 
 // get OpenMP task scheduler (if available, otherwise returns null)
 btITaskScheduler* btGetOpenMPTaskScheduler();
@@ -174,4 +332,12 @@ void btParallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody
 //                 (iterations may be done out of order, so no dependencies are allowed)
 btScalar btParallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSumBody& body);
 
+// btParallelForOrSerial -- like btParallelFor, but runs the whole range on the calling thread in a build without
+//                 BT_THREADSAFE, while no task scheduler is set, or when the range fits in one grain
+void btParallelForOrSerial(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body);
+
+// btRunTaskGraph -- call this to run the tasks of a graph in dependency order, returns when all are done
+//                  (may be called from a task or loop body, see btITaskScheduler::supportsNestedParallelism)
+void btRunTaskGraph(btTaskGraph& graph);
+
 #endif
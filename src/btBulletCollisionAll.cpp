@@ -3,7 +3,11 @@
 #include "BulletCollision/BroadphaseCollision/btOverlappingPairCache.cpp"
 #include "BulletCollision/BroadphaseCollision/btBroadphaseProxy.cpp"
 #include "BulletCollision/BroadphaseCollision/btDbvtBroadphase.cpp"
+#include "BulletCollision/BroadphaseCollision/btDbvtWide.cpp"
 #include "BulletCollision/BroadphaseCollision/btQuantizedBvh.cpp"
+#include "BulletCollision/BroadphaseCollision/btHandleBroadphase.cpp"
+#include "BulletCollision/BroadphaseCollision/btRegionBroadphase.cpp"
+#include "BulletCollision/BroadphaseCollision/btGridBroadphase.cpp"
 #include "BulletCollision/BroadphaseCollision/btCollisionAlgorithm.cpp"
 #include "BulletCollision/BroadphaseCollision/btDispatcher.cpp"
 #include "BulletCollision/BroadphaseCollision/btSimpleBroadphase.cpp"
@@ -9,6 +9,10 @@
 #include "LinearMath/btQuickprof.cpp"
 #include "LinearMath/btThreads.cpp"
 #include "LinearMath/btReducedVector.cpp"
+#include "LinearMath/btBatchedMath.cpp"
+#include "LinearMath/btPoolAllocator.cpp"
+#include "LinearMath/btFrameArena.cpp"
+#include "LinearMath/btRadixSort.cpp"
 #include "LinearMath/TaskScheduler/btTaskScheduler.cpp"
 #include "LinearMath/TaskScheduler/btThreadSupportPosix.cpp"
 #include "LinearMath/TaskScheduler/btThreadSupportWin32.cpp"
@@ -0,0 +1,179 @@
+#include "TrajectoryRecorder.hpp"
+#include "TrajectoryReader.hpp"
+#include "BodyState.hpp"
+
+#include <btBulletDynamicsCommon.h>
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace {
+
+const int bodyCount = 6;
+const int frameCount = 200;
+
+// every body exercises another part of the delta encoding
+double bodyValue(int channel, int body, int frame)
+{
+	switch (body) {
+		case 0:  // static, only in the keyframes
+			return channel + 0.5;
+		case 1:  // small steps, int8_t deltas
+			return channel + 0.0003 * frame + 1e-4 * sin(frame * 0.3);
+		case 2:  // large steps, int16_t deltas
+			return channel - 0.07 * frame;
+		case 3:  // jumps too far for a delta in frame 40, stored as raw scalars
+			return channel + 0.001 * frame + (frame >= 40 ? 100 : 0);
+		case 4:  // asleep from frame 20 to 59, left out of those delta frames
+			return channel * 0.25 + 0.002 * (frame >= 20 && frame < 60 ? 20 : frame);
+		default:  // only moves every other frame
+			return channel + 0.001 * (frame / 2);
+	}
+}
+
+unsigned char bodyFlags(int body, int frame)
+{
+	if (body == 0) {
+		return BODY_STATE_STATIC;
+	}
+	return body == 4 && frame >= 20 && frame < 60 ? BODY_STATE_SLEEPING : 0;
+}
+
+void makeFrame(int frame, std::vector<btScalar>& values, std::vector<unsigned char>& flags)
+{
+	values.resize(TRAJECTORY_CHANNEL_COUNT * bodyCount);
+	flags.resize(bodyCount);
+	for (int i = 0; i < bodyCount; i++) {
+		for (int c = 0; c < TRAJECTORY_CHANNEL_COUNT; c++) {
+			values[c * bodyCount + i] = btScalar(bodyValue(c, i, frame));
+		}
+		flags[i] = bodyFlags(i, frame);
+	}
+}
+
+struct Bodies {
+	btSphereShape sphere;
+	btBoxShape box;
+	std::vector<btRigidBody*> bodies;
+	std::vector<std::string> names;
+
+	Bodies() : sphere(0.5), box(btVector3(1, 2, 3)) {
+		for (int i = 0; i < bodyCount; i++) {
+			bodies.push_back(new btRigidBody(0, 0, i % 2 ? (btCollisionShape*)&box : &sphere));
+			names.push_back("body" + std::to_string(i));
+		}
+	}
+
+	~Bodies() {
+		for (btRigidBody* body : bodies) {
+			delete body;
+		}
+	}
+};
+
+// records frameCount frames, reads them back in order and out of order and compares them with what was recorded.
+// Delta encoded values may differ by half a quantum, everything else must be exact
+void recordAndCompare(const char* name, int framesPerBlock, bool useMemoryMap, int keyframeInterval)
+{
+	Bodies bodies;
+	std::filesystem::path path;
+	// the default quanta of setDeltaEncoding
+	double quantum[TRAJECTORY_CHANNEL_COUNT];
+	for (int c = 0; c < TRAJECTORY_CHANNEL_COUNT; c++) {
+		quantum[c] = c <= TRAJECTORY_PZ ? 1e-5 : c <= TRAJECTORY_QW ? 1e-6 : 1e-4;
+	}
+	{
+		TrajectoryRecorder recorder("RoundTrip", framesPerBlock, useMemoryMap);
+		recorder.setFileName(std::string(name) + ".bttraj");
+		if (keyframeInterval) {
+			recorder.setDeltaEncoding(keyframeInterval);
+		}
+		ASSERT_TRUE(recorder.openFile(bodies.bodies.data(), bodies.names.data(), bodyCount));
+
+		std::vector<btScalar> values;
+		std::vector<unsigned char> flags;
+		for (int f = 0; f < frameCount; f++) {
+			makeFrame(f, values, flags);
+			ASSERT_TRUE(recorder.writeFrame(values.data(), flags.data())) << "frame " << f;
+		}
+		EXPECT_EQ(uint64_t(frameCount), recorder.getFrameCount());
+		recorder.closeFile();
+		path = recorder.getFilePath();
+	}
+
+	TrajectoryReader reader;
+	ASSERT_TRUE(reader.open(path.string()));
+	EXPECT_EQ(keyframeInterval != 0, reader.isDeltaEncoded());
+	ASSERT_EQ(bodyCount, reader.getBodyCount());
+	ASSERT_EQ(uint64_t(frameCount), reader.getFrameCount());
+	for (int i = 0; i < bodyCount; i++) {
+		EXPECT_EQ("body" + std::to_string(i), reader.getBodyName(i));
+		const TrajectoryBodyInfo& info = reader.getBodyInfo(i);
+		if (i % 2) {
+			EXPECT_EQ(uint32_t(TRAJECTORY_SHAPE_BOX), info.shapeType);
+			EXPECT_NEAR(6.0, info.dims[2], 1e-5);
+		} else {
+			EXPECT_EQ(uint32_t(TRAJECTORY_SHAPE_SPHERE), info.shapeType);
+			EXPECT_NEAR(0.5, info.dims[0], 1e-6);
+		}
+	}
+
+	// in order, then jumping back and forth between keyframes
+	std::vector<int> order;
+	for (int f = 0; f < frameCount; f++) {
+		order.push_back(f);
+	}
+	int jumps[] = {150, 17, 199, 0, 63, 41, 40, 39};
+	order.insert(order.end(), jumps, jumps + sizeof(jumps) / sizeof(jumps[0]));
+
+	std::vector<btScalar> expected;
+	std::vector<unsigned char> flags;
+	std::vector<double> frame;
+	for (int f : order) {
+		ASSERT_TRUE(reader.readFrame(f, frame)) << "frame " << f;
+		makeFrame(f, expected, flags);
+		for (int i = 0; i < bodyCount; i++) {
+			for (int c = 0; c < TRAJECTORY_CHANNEL_COUNT; c++) {
+				double value = expected[c * bodyCount + i];
+				double tolerance = keyframeInterval ? quantum[c] * 0.5 + 1e-9 : 0;
+				ASSERT_NEAR(value, reader.getValue(frame, c, i), tolerance) << "frame " << f << " body " << i << " channel " << c;
+			}
+		}
+	}
+	reader.close();
+	std::filesystem::remove(path);
+}
+
+}  // namespace
+
+TEST(TrajectoryRoundTrip, Buffered)
+{
+	recordAndCompare("RoundTripBuffered", 8, false, 0);
+}
+
+TEST(TrajectoryRoundTrip, DeltaBuffered)
+{
+	recordAndCompare("RoundTripDeltaBuffered", 8, false, 16);
+}
+
+#ifndef _WIN32
+// the first mapping only holds one frame, so recording grows it again and again
+TEST(TrajectoryRoundTrip, MemoryMapped)
+{
+	recordAndCompare("RoundTripMapped", 1, true, 0);
+}
+
+TEST(TrajectoryRoundTrip, DeltaMemoryMapped)
+{
+	recordAndCompare("RoundTripDeltaMapped", 1, true, 16);
+}
+#endif
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
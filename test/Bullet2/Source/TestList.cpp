@@ -39,6 +39,8 @@
 #include "Test_3x3getRot.h"
 
 #include "Test_btDbvt.h"
+#include "Test_batchedMath.h"
+#include "Test_flatHashMap.h"
 #include "Test_quat_aos_neon.h"
 
 #include "LinearMath/btScalar.h"
@@ -90,9 +92,15 @@ TestDesc gTestList[] =
 
 		ENTRY("btDbvt", Test_btDbvt),
 		ENTRY("quat_aos_neon", Test_quat_aos_neon),
+		ENTRY("batchedMath", Test_batchedMath),
+		ENTRY("flatHashMap", Test_flatHashMap),
 
 		{NULL, NULL}};
 #else
-TestDesc gTestList[] = {{NULL, NULL}};
+TestDesc gTestList[] = {
+	ENTRY("batchedMath", Test_batchedMath),
+	ENTRY("flatHashMap", Test_flatHashMap),
+
+	{NULL, NULL}};
 
 #endif
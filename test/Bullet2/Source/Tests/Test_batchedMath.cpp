@@ -0,0 +1,303 @@
+//
+//  Test_batchedMath.cpp
+//  BulletTest
+//
+//  Compares the btBatchedMath backends (scalar reference and AVX2/FMA) with the inline operators,
+//  in single and double precision builds alike.
+//
+
+#include "Test_batchedMath.h"
+#include "vector.h"
+#include "Utils.h"
+#include "main.h"
+#include <math.h>
+#include <string.h>
+
+#include <LinearMath/btBatchedMath.h>
+#include <LinearMath/btAabbUtil2.h>
+#include <LinearMath/btTransformUtil.h>
+
+#define LOOPCOUNT 1000
+#define ARRAY_SIZE 128
+
+#ifdef BT_USE_DOUBLE_PRECISION
+#define BATCHED_EPSILON 1e-12
+#else
+#define BATCHED_EPSILON 1e-5f
+#endif
+
+static btScalar rand_m1p1(void)
+{
+	return btScalar(RANDF_m1p1);
+}
+
+static btVector3 rand_v3(void)
+{
+	btVector3 v(rand_m1p1(), rand_m1p1(), rand_m1p1());
+	v.m_floats[3] = rand_m1p1();  // w is ignored, but should not leak into results
+	return v;
+}
+
+static btTransform rand_transform(void)
+{
+	btQuaternion q(rand_m1p1(), rand_m1p1(), rand_m1p1(), btScalar(1));
+	q.normalize();
+	return btTransform(q, rand_v3());
+}
+
+static bool fuzzyEqual(const btVector3 &ref, const btVector3 &other)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		if (btFabs(ref.m_floats[i] - other.m_floats[i]) > BATCHED_EPSILON)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool fuzzyEqual(const btTransform &ref, const btTransform &other)
+{
+	return fuzzyEqual(ref.getBasis()[0], other.getBasis()[0]) &&
+		   fuzzyEqual(ref.getBasis()[1], other.getBasis()[1]) &&
+		   fuzzyEqual(ref.getBasis()[2], other.getBasis()[2]) &&
+		   fuzzyEqual(ref.getOrigin(), other.getOrigin());
+}
+
+static btVector3 points[ARRAY_SIZE];
+static btVector3 directions[ARRAY_SIZE];
+static btVector3 pointsOut[ARRAY_SIZE];
+static btTransform transforms[ARRAY_SIZE];
+static btTransform children[ARRAY_SIZE];
+static btTransform transformsOut[ARRAY_SIZE];
+static btMatrix3x3 matricesOut[ARRAY_SIZE];
+static btScalar dotsOut[ARRAY_SIZE];
+
+// structure of arrays: the basis and origin of transforms, the predicted transforms, quaternions, half extents,
+// linear and angular velocities, aabbs
+static btScalar soaArrays[9 + 3 + 9 + 3 + 4 + 3 + 3 + 3 + 3 + 3][ARRAY_SIZE];
+static btTransformSoa soaTransforms;
+static btTransformSoa soaPredicted;
+static btScalar *soaRotation[4];
+static btScalar *soaHalfExtents[3];
+static btScalar *soaLinearVelocity[3];
+static btScalar *soaAngularVelocity[3];
+static btScalar *soaAabbMin[3];
+static btScalar *soaAabbMax[3];
+
+static void initSoaArrays(void)
+{
+	int next = 0;
+	for (int j = 0; j < 9; j++)
+	{
+		soaTransforms.m_basis[j] = soaArrays[next++];
+		soaPredicted.m_basis[j] = soaArrays[next++];
+	}
+	for (int j = 0; j < 3; j++)
+	{
+		soaTransforms.m_origin[j] = soaArrays[next++];
+		soaPredicted.m_origin[j] = soaArrays[next++];
+		soaHalfExtents[j] = soaArrays[next++];
+		soaLinearVelocity[j] = soaArrays[next++];
+		soaAngularVelocity[j] = soaArrays[next++];
+		soaAabbMin[j] = soaArrays[next++];
+		soaAabbMax[j] = soaArrays[next++];
+	}
+	for (int j = 0; j < 4; j++)
+	{
+		soaRotation[j] = soaArrays[next++];
+	}
+	for (int i = 0; i < ARRAY_SIZE; i++)
+	{
+		btQuaternion q = transforms[i].getRotation();
+		for (int j = 0; j < 3; j++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				soaTransforms.m_basis[3 * j + k][i] = transforms[i].getBasis()[j][k];
+			}
+			soaTransforms.m_origin[j][i] = transforms[i].getOrigin()[j];
+			soaHalfExtents[j][i] = btFabs(points[i][j]);
+			soaLinearVelocity[j][i] = directions[i][j];
+			// slow, fast (clamped by the motion threshold) and resting bodies
+			soaAngularVelocity[j][i] = (i % 3) == 0 ? btScalar(0) : directions[i][j] * ((i % 3) == 1 ? btScalar(3) : btScalar(300));
+		}
+		for (int j = 0; j < 4; j++)
+		{
+			soaRotation[j][i] = q[j];
+		}
+	}
+}
+
+static int checkBackend(const char *backendName)
+{
+	size_t i;
+	btTransformPoints(transforms[0], points, pointsOut, ARRAY_SIZE);
+	for (i = 0; i < ARRAY_SIZE; i++)
+	{
+		if (!fuzzyEqual(transforms[0](points[i]), pointsOut[i]))
+		{
+			vlog("Error - %s btTransformPoints result error! failure @ %ld\n", backendName, (long)i);
+			return -1;
+		}
+	}
+
+	btMultiplyTransforms(transforms, children, transformsOut, ARRAY_SIZE);
+	for (i = 0; i < ARRAY_SIZE; i++)
+	{
+		if (!fuzzyEqual(transforms[i] * children[i], transformsOut[i]))
+		{
+			vlog("Error - %s btMultiplyTransforms result error! failure @ %ld\n", backendName, (long)i);
+			return -1;
+		}
+	}
+
+	btMultiplyTransforms(transforms[1], children, transformsOut, ARRAY_SIZE);
+	for (i = 0; i < ARRAY_SIZE; i++)
+	{
+		if (!fuzzyEqual(transforms[1] * children[i], transformsOut[i]))
+		{
+			vlog("Error - %s btMultiplyTransforms (parent) result error! failure @ %ld\n", backendName, (long)i);
+			return -1;
+		}
+	}
+
+	for (i = 0; i < ARRAY_SIZE; i++)
+	{
+		matricesOut[i] = transforms[i].getBasis();
+	}
+	btMultiplyMatrices(matricesOut, &children[0].getBasis(), matricesOut, 1);  // in place
+	if (!fuzzyEqual(btTransform(transforms[0].getBasis() * children[0].getBasis()), btTransform(matricesOut[0])))
+	{
+		vlog("Error - %s btMultiplyMatrices result error!\n", backendName);
+		return -1;
+	}
+
+	btAddScaledVectors(points, directions, btScalar(0.25), pointsOut, ARRAY_SIZE);
+	for (i = 0; i < ARRAY_SIZE; i++)
+	{
+		if (!fuzzyEqual(points[i] + directions[i] * btScalar(0.25), pointsOut[i]))
+		{
+			vlog("Error - %s btAddScaledVectors result error! failure @ %ld\n", backendName, (long)i);
+			return -1;
+		}
+	}
+
+	btDotVectors(points, directions, dotsOut, ARRAY_SIZE - 1);  // with a remainder
+	for (i = 0; i < ARRAY_SIZE - 1; i++)
+	{
+		if (btFabs(points[i].dot(directions[i]) - dotsOut[i]) > BATCHED_EPSILON)
+		{
+			vlog("Error - %s btDotVectors result error! failure @ %ld\n", backendName, (long)i);
+			return -1;
+		}
+	}
+
+	btTransformAabbs(soaTransforms, soaHalfExtents, btScalar(0.02), soaAabbMin, soaAabbMax, ARRAY_SIZE - 1);
+	for (i = 0; i < ARRAY_SIZE - 1; i++)
+	{
+		btVector3 aabbMin, aabbMax;
+		btTransformAabb(btVector3(soaHalfExtents[0][i], soaHalfExtents[1][i], soaHalfExtents[2][i]), btScalar(0), transforms[i], aabbMin, aabbMax);
+		aabbMin -= btVector3(btScalar(0.02), btScalar(0.02), btScalar(0.02));
+		aabbMax += btVector3(btScalar(0.02), btScalar(0.02), btScalar(0.02));
+		if (!fuzzyEqual(aabbMin, btVector3(soaAabbMin[0][i], soaAabbMin[1][i], soaAabbMin[2][i])) ||
+			!fuzzyEqual(aabbMax, btVector3(soaAabbMax[0][i], soaAabbMax[1][i], soaAabbMax[2][i])))
+		{
+			vlog("Error - %s btTransformAabbs result error! failure @ %ld\n", backendName, (long)i);
+			return -1;
+		}
+	}
+
+	btIntegrateTransforms(soaTransforms.m_origin, soaRotation, soaLinearVelocity, soaAngularVelocity, btScalar(1. / 60.), soaPredicted, ARRAY_SIZE - 1);
+	for (i = 0; i < ARRAY_SIZE - 1; i++)
+	{
+		btTransform predicted;
+		btTransformUtil::integrateTransform(transforms[i], btVector3(soaLinearVelocity[0][i], soaLinearVelocity[1][i], soaLinearVelocity[2][i]),
+											btVector3(soaAngularVelocity[0][i], soaAngularVelocity[1][i], soaAngularVelocity[2][i]), btScalar(1. / 60.), predicted);
+		btTransform result;
+		result.getBasis().setValue(soaPredicted.m_basis[0][i], soaPredicted.m_basis[1][i], soaPredicted.m_basis[2][i],
+								   soaPredicted.m_basis[3][i], soaPredicted.m_basis[4][i], soaPredicted.m_basis[5][i],
+								   soaPredicted.m_basis[6][i], soaPredicted.m_basis[7][i], soaPredicted.m_basis[8][i]);
+		result.getOrigin().setValue(soaPredicted.m_origin[0][i], soaPredicted.m_origin[1][i], soaPredicted.m_origin[2][i]);
+		if (!fuzzyEqual(predicted, result))
+		{
+			vlog("Error - %s btIntegrateTransforms result error! failure @ %ld\n", backendName, (long)i);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+// best (or average) ticks of one call for the whole array
+#define TIME_BATCH(_result, _call)                     \
+	{                                                  \
+		uint64_t startTime, bestTime, currentTime;     \
+		bestTime = -1LL;                               \
+		_result = 0;                                   \
+		for (j = 0; j < LOOPCOUNT; j++)                \
+		{                                              \
+			startTime = ReadTicks();                   \
+			_call;                                     \
+			currentTime = ReadTicks() - startTime;     \
+			_result += currentTime;                    \
+			if (currentTime < bestTime)                \
+				bestTime = currentTime;                \
+		}                                              \
+		if (0 == gReportAverageTimes)                  \
+			_result = bestTime;                        \
+		else                                           \
+			_result /= LOOPCOUNT;                      \
+	}
+
+int Test_batchedMath(void)
+{
+	size_t i, j;
+	for (i = 0; i < ARRAY_SIZE; i++)
+	{
+		points[i] = rand_v3();
+		directions[i] = rand_v3();
+		transforms[i] = rand_transform();
+		children[i] = rand_transform();
+	}
+	initSoaArrays();
+
+	const btBatchedMathBackend backends[2] = {BT_BATCHED_MATH_SCALAR, BT_BATCHED_MATH_AVX2};
+	const char *backendNames[2] = {"scalar", "avx2"};
+	const btBatchedMathBackend defaultBackend = btGetBatchedMathBackend();
+	uint64_t times[2][7];
+	memset(times, 0, sizeof(times));
+	int numBackends = 0;
+	for (int b = 0; b < 2; b++)
+	{
+		if (!btSetBatchedMathBackend(backends[b]))
+		{
+			vlog("%s backend not supported, skipped\n", backendNames[b]);
+			continue;
+		}
+		numBackends++;
+		if (checkBackend(backendNames[b]))
+		{
+			btSetBatchedMathBackend(defaultBackend);
+			return -1;
+		}
+		TIME_BATCH(times[b][0], btTransformPoints(transforms[j & 7], points, pointsOut, ARRAY_SIZE));
+		TIME_BATCH(times[b][1], btMultiplyMatrices(&transforms[0].getBasis(), &children[0].getBasis(), matricesOut, 1); btMultiplyTransforms(transforms, children, transformsOut, ARRAY_SIZE));
+		TIME_BATCH(times[b][2], btMultiplyTransforms(transforms[j & 7], children, transformsOut, ARRAY_SIZE));
+		TIME_BATCH(times[b][3], btAddScaledVectors(points, directions, btScalar(0.25), pointsOut, ARRAY_SIZE));
+		TIME_BATCH(times[b][4], btDotVectors(points, directions, dotsOut, ARRAY_SIZE));
+		TIME_BATCH(times[b][5], btTransformAabbs(soaTransforms, soaHalfExtents, btScalar(0.02), soaAabbMin, soaAabbMax, ARRAY_SIZE));
+		TIME_BATCH(times[b][6], btIntegrateTransforms(soaTransforms.m_origin, soaRotation, soaLinearVelocity, soaAngularVelocity, btScalar(1. / 60.), soaPredicted, ARRAY_SIZE));
+	}
+	btSetBatchedMathBackend(defaultBackend);
+
+	const char *names[7] = {"transformPoints", "multiplyTransforms", "multiplyTransforms(parent)", "addScaledVectors", "dotVectors", "transformAabbs", "integrateTransforms"};
+	vlog("Timing (cycles per element, %s precision):\n", sizeof(btScalar) == sizeof(double) ? "double" : "single");
+	vlog("\t    scalar\t      avx2\n");
+	for (i = 0; i < 7; i++)
+	{
+		vlog("\t%10.2f\t%10.2f\t%s\n", TicksToCycles(times[0][i]) / ARRAY_SIZE,
+			 numBackends > 1 ? TicksToCycles(times[1][i]) / ARRAY_SIZE : 0.0, names[i]);
+	}
+	return 0;
+}
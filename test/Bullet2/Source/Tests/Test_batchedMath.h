@@ -0,0 +1,20 @@
+//
+//  Test_batchedMath.h
+//  BulletTest
+//
+
+#ifndef BulletTest_Test_batchedMath_h
+#define BulletTest_Test_batchedMath_h
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	int Test_batchedMath(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,105 @@
+//
+//  Test_flatHashMap.cpp
+//  BulletTest
+//
+//  Compares btFlatHashMap with btHashMap on maps with a million entries: insertion, lookups that hit and
+//  lookups that miss in random order, and removal.
+//
+
+#include "Test_flatHashMap.h"
+#include "Utils.h"
+#include "main.h"
+
+#include <LinearMath/btHashMap.h>
+#include <LinearMath/btFlatHashMap.h>
+
+#define NUM_ENTRIES (1024 * 1024)
+
+static btAlignedObjectArray<int> keys;
+static btAlignedObjectArray<int> lookupOrder;
+
+// ticks per operation of insert, hit, miss and remove
+template <class Map>
+static int timeMap(const char *name, double *times)
+{
+	Map map;
+	uint64_t startTime = ReadTicks();
+	for (int i = 0; i < NUM_ENTRIES; i++)
+	{
+		map.insert(btHashInt(keys[i]), i);
+	}
+	times[0] = TicksToCycles(ReadTicks() - startTime) / NUM_ENTRIES;
+
+	int errors = 0;
+	startTime = ReadTicks();
+	for (int i = 0; i < NUM_ENTRIES; i++)
+	{
+		int k = lookupOrder[i];
+		const int *value = map.find(btHashInt(keys[k]));
+		errors += !value || *value != k;
+	}
+	times[1] = TicksToCycles(ReadTicks() - startTime) / NUM_ENTRIES;
+
+	startTime = ReadTicks();
+	for (int i = 0; i < NUM_ENTRIES; i++)
+	{
+		// the keys are even, so odd keys miss
+		errors += map.find(btHashInt(keys[lookupOrder[i]] + 1)) != 0;
+	}
+	times[2] = TicksToCycles(ReadTicks() - startTime) / NUM_ENTRIES;
+
+	startTime = ReadTicks();
+	for (int i = 0; i < NUM_ENTRIES; i += 2)
+	{
+		map.remove(btHashInt(keys[lookupOrder[i]]));
+	}
+	times[3] = TicksToCycles(ReadTicks() - startTime) / (NUM_ENTRIES / 2);
+
+	errors += map.size() != NUM_ENTRIES / 2;
+	for (int i = 0; i < NUM_ENTRIES; i++)
+	{
+		int k = lookupOrder[i];
+		const int *value = map.find(btHashInt(keys[k]));
+		errors += (i & 1) ? (!value || *value != k) : value != 0;
+	}
+	if (errors)
+	{
+		vlog("Error - %s returned %d wrong results\n", name, errors);
+		return -1;
+	}
+	return 0;
+}
+
+int Test_flatHashMap(void)
+{
+	keys.resize(NUM_ENTRIES);
+	lookupOrder.resize(NUM_ENTRIES);
+	for (int i = 0; i < NUM_ENTRIES; i++)
+	{
+		// distinct even keys spread over the int range
+		keys[i] = int(((unsigned int)i * 2654435761u) << 1);
+		lookupOrder[i] = i;
+	}
+	for (int i = NUM_ENTRIES - 1; i > 0; i--)
+	{
+		lookupOrder.swap(i, int(random_number32() % (unsigned int)(i + 1)));
+	}
+
+	double times[2][4];
+	if (timeMap<btHashMap<btHashInt, int> >("btHashMap", times[0]) ||
+		timeMap<btFlatHashMap<btHashInt, int> >("btFlatHashMap", times[1]))
+	{
+		return -1;
+	}
+
+	const char *names[4] = {"insert", "find (hit)", "find (miss)", "remove"};
+	vlog("Timing (cycles per operation, %d entries):\n", NUM_ENTRIES);
+	vlog("\t btHashMap\t btFlatHashMap\n");
+	for (int i = 0; i < 4; i++)
+	{
+		vlog("\t%10.2f\t%14.2f\t%s\n", times[0][i], times[1][i], names[i]);
+	}
+	keys.clear();
+	lookupOrder.clear();
+	return 0;
+}
@@ -0,0 +1,20 @@
+//
+//  Test_flatHashMap.h
+//  BulletTest
+//
+
+#ifndef BulletTest_Test_flatHashMap_h
+#define BulletTest_Test_flatHashMap_h
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	int Test_flatHashMap(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,144 @@
+#include <btBulletDynamicsCommon.h>
+#include <BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.h>
+#include <BulletCollision/CollisionDispatch/btSimulationIslandManager.h>
+#include <LinearMath/btFrameArena.h>
+#include <LinearMath/btThreads.h>
+#include <gtest/gtest.h>
+#include <stdlib.h>
+
+static int gNumAllocations = 0;
+
+static void* countingAlloc(size_t size)
+{
+	gNumAllocations++;
+	return malloc(size);
+}
+
+static void countingFree(void* ptr)
+{
+	free(ptr);
+}
+
+GTEST_TEST(BulletDynamics, FrameArenaReusesOneBlock)
+{
+	btFrameArena arena(1024);
+	for (int frame = 0; frame < 4; frame++)
+	{
+		arena.reset();
+		for (int i = 0; i < 100; i++)
+		{
+			{
+				// gives its memory back at the end of the block
+				btFrameArenaScope scope(&arena);
+				btAlignedObjectArray<btVector3> scratch;
+				arena.initializeArray(scratch, 10);
+				scratch.push_back(btVector3(1, 2, 3));
+				EXPECT_EQ(0, int(size_t(&scratch[0]) & 15));
+			}
+			btAlignedObjectArray<btVector3> array;
+			arena.initializeArray(array, 10);
+			for (int j = 0; j < 10; j++)
+			{
+				array.push_back(btVector3(j, j, j));
+			}
+			EXPECT_EQ(10, array.capacity());
+		}
+	}
+	// the first frame chains blocks, the first reset replaces them by one block that fits everything
+	unsigned long long heapAllocations = arena.getHeapAllocationCount();
+	arena.reset();
+	for (int i = 0; i < 100; i++)
+	{
+		arena.allocate(sizeof(btVector3) * 10, 16);
+	}
+	EXPECT_EQ(heapAllocations, arena.getHeapAllocationCount());
+	EXPECT_GE(arena.getHighWaterMark(), 100 * sizeof(btVector3) * 10);
+}
+
+GTEST_TEST(BulletDynamics, SteadyStateSteppingDoesNotAllocate)
+{
+	btDefaultCollisionConfiguration collisionConfiguration;
+	btCollisionDispatcher dispatcher(&collisionConfiguration);
+	btDbvtBroadphase broadphase;
+	btSequentialImpulseConstraintSolverMt solver;
+	btDiscreteDynamicsWorld world(&dispatcher, &broadphase, &solver, &collisionConfiguration);
+	// one solver call for the whole scene, set up with the batched code path that takes its temporary arrays from the arena
+	world.getSimulationIslandManager()->setSplitIslands(false);
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+	int minimumContactManifoldsForBatching = btSequentialImpulseConstraintSolverMt::s_minimumContactManifoldsForBatching;
+	btSequentialImpulseConstraintSolverMt::s_minimumContactManifoldsForBatching = 1;
+
+	btStaticPlaneShape groundShape(btVector3(0, 1, 0), 0);
+	btRigidBody ground(0, 0, &groundShape);
+	world.addRigidBody(&ground);
+
+	btBoxShape boxShape(btVector3(0.5, 0.5, 0.5));
+	btSphereShape sphereShape(0.5);
+	btCompoundShape compoundShape;
+	btTransform childTransform = btTransform::getIdentity();
+	childTransform.setOrigin(btVector3(0.5, 0, 0));
+	compoundShape.addChildShape(childTransform, &boxShape);
+	childTransform.setOrigin(btVector3(-0.5, 0, 0));
+	compoundShape.addChildShape(childTransform, &boxShape);
+	btCollisionShape* shapes[] = {&boxShape, &sphereShape, &compoundShape};
+
+	// rows of bodies resting on the ground, chained with point to point constraints
+	btAlignedObjectArray<btRigidBody*> bodies;
+	btAlignedObjectArray<btTypedConstraint*> constraints;
+	for (int i = 0; i < 60; i++)
+	{
+		btCollisionShape* shape = shapes[i % 3];
+		btVector3 localInertia;
+		shape->calculateLocalInertia(1, localInertia);
+		btRigidBody::btRigidBodyConstructionInfo info(1, 0, shape, localInertia);
+		info.m_startWorldTransform.setOrigin(btVector3((i % 10) * 3, 0.5, (i / 10) * 3));
+		btRigidBody* body = new btRigidBody(info);
+		body->setActivationState(DISABLE_DEACTIVATION);
+		world.addRigidBody(body);
+		if (i % 10)
+		{
+			btTypedConstraint* constraint = new btPoint2PointConstraint(*bodies[i - 1], *body, btVector3(1.5, 0, 0), btVector3(-1.5, 0, 0));
+			world.addConstraint(constraint);
+			constraints.push_back(constraint);
+		}
+		bodies.push_back(body);
+	}
+
+	for (int i = 0; i < 120; i++)
+	{
+		world.stepSimulation(btScalar(1. / 60.));
+	}
+	unsigned long long arenaAllocations = world.getFrameArena()->getHeapAllocationCount();
+
+	btAlignedAllocSetCustom(countingAlloc, countingFree);
+	gNumAllocations = 0;
+	for (int i = 0; i < 60; i++)
+	{
+		world.stepSimulation(btScalar(1. / 60.));
+	}
+	int numAllocations = gNumAllocations;
+	btAlignedAllocSetCustom(0, 0);
+
+	EXPECT_EQ(0, numAllocations);
+	EXPECT_EQ(arenaAllocations, world.getFrameArena()->getHeapAllocationCount());
+	EXPECT_GT(world.getFrameArena()->getHighWaterMark(), 0u);
+
+	for (int i = 0; i < constraints.size(); i++)
+	{
+		world.removeConstraint(constraints[i]);
+		delete constraints[i];
+	}
+	for (int i = 0; i < bodies.size(); i++)
+	{
+		world.removeRigidBody(bodies[i]);
+		delete bodies[i];
+	}
+	world.removeRigidBody(&ground);
+	btSequentialImpulseConstraintSolverMt::s_minimumContactManifoldsForBatching = minimumContactManifoldsForBatching;
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
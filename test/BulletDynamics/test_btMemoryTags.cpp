@@ -0,0 +1,162 @@
+#include <btBulletDynamicsCommon.h>
+#include <LinearMath/btAlignedAllocator.h>
+#include <LinearMath/btSerializer.h>
+#include <gtest/gtest.h>
+
+static btMemoryTagStatistics getStatistics(btMemoryTag tag)
+{
+	btMemoryTagStatistics stats;
+	btGetMemoryTagStatistics(tag, stats);
+	return stats;
+}
+
+#if BT_USE_MEMORY_TAGS
+
+GTEST_TEST(LinearMath, MemoryTagsTrackLiveBytes)
+{
+	btMemoryTagStatistics before = getStatistics(BT_MEMORY_TAG_SOLVER);
+	void* ptr;
+	{
+		BT_MEMORY_TAG(BT_MEMORY_TAG_SOLVER);
+		EXPECT_EQ(BT_MEMORY_TAG_SOLVER, btGetMemoryTag());
+		ptr = btAlignedAlloc(1000, 64);
+		EXPECT_EQ(0, int(size_t(ptr) & 63));
+	}
+	EXPECT_EQ(BT_MEMORY_TAG_GENERAL, btGetMemoryTag());
+
+	btMemoryTagStatistics allocated = getStatistics(BT_MEMORY_TAG_SOLVER);
+	EXPECT_EQ(before.m_liveBytes + 1000, allocated.m_liveBytes);
+	EXPECT_GE(allocated.m_peakBytes, allocated.m_liveBytes);
+	EXPECT_EQ(before.m_numAllocations + 1, allocated.m_numAllocations);
+
+	// the header remembers the tag, so the bytes go back to the solver
+	btAlignedFree(ptr);
+	btMemoryTagStatistics freed = getStatistics(BT_MEMORY_TAG_SOLVER);
+	EXPECT_EQ(before.m_liveBytes, freed.m_liveBytes);
+	EXPECT_EQ(before.m_numFrees + 1, freed.m_numFrees);
+	EXPECT_EQ(allocated.m_peakBytes, freed.m_peakBytes);
+
+	btResetMemoryTagPeaks();
+	EXPECT_EQ(freed.m_liveBytes, getStatistics(BT_MEMORY_TAG_SOLVER).m_peakBytes);
+}
+
+static int gNumBudgetCalls = 0;
+
+static void budgetExceeded(btMemoryTag tag, size_t liveBytes, size_t budget, void* userData)
+{
+	EXPECT_EQ(BT_MEMORY_TAG_SERIALIZER, tag);
+	EXPECT_GT(liveBytes, budget);
+	EXPECT_EQ(&gNumBudgetCalls, userData);
+	gNumBudgetCalls++;
+}
+
+GTEST_TEST(LinearMath, MemoryBudgetCallback)
+{
+	BT_MEMORY_TAG(BT_MEMORY_TAG_SERIALIZER);
+	size_t liveBytes = getStatistics(BT_MEMORY_TAG_SERIALIZER).m_liveBytes;
+	btSetMemoryBudget(BT_MEMORY_TAG_SERIALIZER, liveBytes + 500, budgetExceeded, &gNumBudgetCalls);
+	EXPECT_EQ(liveBytes + 500, getStatistics(BT_MEMORY_TAG_SERIALIZER).m_budget);
+
+	void* a = btAlignedAlloc(400, 16);
+	EXPECT_EQ(0, gNumBudgetCalls);
+	void* b = btAlignedAlloc(200, 16);
+	EXPECT_EQ(1, gNumBudgetCalls);
+	// still over budget, the callback only hears about the crossing
+	void* c = btAlignedAlloc(100, 16);
+	EXPECT_EQ(1, gNumBudgetCalls);
+	btAlignedFree(b);
+	btAlignedFree(c);
+	b = btAlignedAlloc(300, 16);
+	EXPECT_EQ(2, gNumBudgetCalls);
+	btAlignedFree(a);
+	btAlignedFree(b);
+
+	btSetMemoryBudget(BT_MEMORY_TAG_SERIALIZER, 0, 0);
+	a = btAlignedAlloc(1000, 16);
+	btAlignedFree(a);
+	EXPECT_EQ(2, gNumBudgetCalls);
+}
+
+GTEST_TEST(BulletDynamics, MemoryTagsAttributeWorldAllocations)
+{
+	btMemoryTagStatistics before[BT_NUM_MEMORY_TAGS];
+	for (int i = 0; i < BT_NUM_MEMORY_TAGS; i++)
+	{
+		btGetMemoryTagStatistics(btMemoryTag(i), before[i]);
+	}
+	{
+		btDefaultCollisionConfiguration collisionConfiguration;
+		btCollisionDispatcher dispatcher(&collisionConfiguration);
+		btDbvtBroadphase broadphase;
+		btSequentialImpulseConstraintSolver solver;
+		btDiscreteDynamicsWorld world(&dispatcher, &broadphase, &solver, &collisionConfiguration);
+
+		btStaticPlaneShape groundShape(btVector3(0, 1, 0), 0);
+		btRigidBody ground(0, 0, &groundShape);
+		world.addRigidBody(&ground);
+
+		btBoxShape boxShape(btVector3(0.5, 0.5, 0.5));
+		btVector3 localInertia;
+		boxShape.calculateLocalInertia(1, localInertia);
+		btAlignedObjectArray<btRigidBody*> bodies;
+		for (int i = 0; i < 20; i++)
+		{
+			btRigidBody::btRigidBodyConstructionInfo info(1, 0, &boxShape, localInertia);
+			info.m_startWorldTransform.setOrigin(btVector3((i % 5) * 2, 0.5, (i / 5) * 2));
+			bodies.push_back(new btRigidBody(info));
+			world.addRigidBody(bodies[i]);
+		}
+		for (int i = 0; i < 10; i++)
+		{
+			world.stepSimulation(btScalar(1. / 60.));
+		}
+
+		EXPECT_GT(getStatistics(BT_MEMORY_TAG_BROADPHASE).m_liveBytes, before[BT_MEMORY_TAG_BROADPHASE].m_liveBytes);
+		EXPECT_GT(getStatistics(BT_MEMORY_TAG_NARROWPHASE).m_liveBytes, before[BT_MEMORY_TAG_NARROWPHASE].m_liveBytes);
+		EXPECT_GT(getStatistics(BT_MEMORY_TAG_SOLVER).m_numAllocations, before[BT_MEMORY_TAG_SOLVER].m_numAllocations);
+
+		btDefaultSerializer* serializer = new btDefaultSerializer();
+		world.serialize(serializer);
+		EXPECT_GT(getStatistics(BT_MEMORY_TAG_SERIALIZER).m_liveBytes, before[BT_MEMORY_TAG_SERIALIZER].m_liveBytes);
+		delete serializer;
+
+		for (int i = 0; i < bodies.size(); i++)
+		{
+			world.removeRigidBody(bodies[i]);
+			delete bodies[i];
+		}
+		world.removeRigidBody(&ground);
+	}
+	// everything the world allocated went back to the tag it came from
+	for (int i = 0; i < BT_NUM_MEMORY_TAGS; i++)
+	{
+		EXPECT_EQ(before[i].m_liveBytes, getStatistics(btMemoryTag(i)).m_liveBytes) << btGetMemoryTagName(btMemoryTag(i));
+	}
+}
+
+#else  //BT_USE_MEMORY_TAGS
+
+GTEST_TEST(LinearMath, MemoryTagsOffByDefault)
+{
+	// without BT_USE_MEMORY_TAGS allocations are not tracked, the statistics stay 0
+	void* ptr;
+	{
+		BT_MEMORY_TAG(BT_MEMORY_TAG_SOLVER);
+		EXPECT_EQ(BT_MEMORY_TAG_GENERAL, btGetMemoryTag());
+		ptr = btAlignedAlloc(1000, 64);
+		EXPECT_EQ(0, int(size_t(ptr) & 63));
+	}
+	btMemoryTagStatistics stats = getStatistics(BT_MEMORY_TAG_SOLVER);
+	EXPECT_EQ(0u, stats.m_liveBytes);
+	EXPECT_EQ(0u, stats.m_numAllocations);
+	btAlignedFree(ptr);
+	EXPECT_EQ(0u, getStatistics(BT_MEMORY_TAG_SOLVER).m_numFrees);
+}
+
+#endif  //BT_USE_MEMORY_TAGS
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -49,6 +49,7 @@ void testSharedMemory(b3PhysicsClientHandle sm)
 	double startPosX, startPosY, startPosZ;
 	int imuLinkIndex = -1;
 	int bodyIndex = -1;
+	int groundIndex = -1;
 
 	if (b3CanSubmitCommand(sm))
 	{
@@ -193,6 +194,39 @@ void testSharedMemory(b3PhysicsClientHandle sm)
 			ret = b3CreateBoxCommandSetHalfExtents(command, 10, 10, 1);
 			statusHandle = b3SubmitClientCommandAndWaitStatus(sm, command);
 			ASSERT_EQ(b3GetStatusType(statusHandle), CMD_RIGID_BODY_CREATION_COMPLETED);
+			groundIndex = b3GetStatusBodyIndex(statusHandle);
+		}
+
+		{
+			b3SharedMemoryStatusHandle statusHandle;
+			b3SharedMemoryCommandHandle command;
+			struct b3RaycastInformation raycastInfo;
+			double rayFrom[3 * 256];
+			double rayTo[3 * 256];
+			int numThreads;
+			for (i = 0; i < 256; i++)
+			{
+				rayFrom[3 * i + 0] = rayTo[3 * i + 0] = -9 + 0.2 * (i % 16);
+				rayFrom[3 * i + 1] = rayTo[3 * i + 1] = -9 + 0.2 * (i / 16);
+				rayFrom[3 * i + 2] = 5;
+				rayTo[3 * i + 2] = -5;
+			}
+			//cast a grid of rays down onto the ground box, on one thread and then on the task scheduler
+			for (numThreads = 1; numThreads >= 0; numThreads--)
+			{
+				command = b3CreateRaycastBatchCommandInit(sm);
+				b3RaycastBatchSetNumThreads(command, numThreads);
+				b3RaycastBatchAddRays(sm, command, rayFrom, rayTo, 256);
+				statusHandle = b3SubmitClientCommandAndWaitStatus(sm, command);
+				ASSERT_EQ(b3GetStatusType(statusHandle), CMD_REQUEST_RAY_CAST_INTERSECTIONS_COMPLETED);
+				b3GetRaycastInformation(sm, &raycastInfo);
+				ASSERT_EQ(raycastInfo.m_numRayHits, 256);
+				for (i = 0; i < 256; i++)
+				{
+					ASSERT_EQ(raycastInfo.m_rayHits[i].m_hitObjectUniqueId, groundIndex);
+					ASSERT_EQ(raycastInfo.m_rayHits[i].m_hitPositionWorld[2] > -0.01 && raycastInfo.m_rayHits[i].m_hitPositionWorld[2] < 0.01, 1);
+				}
+			}
 		}
 
 		{
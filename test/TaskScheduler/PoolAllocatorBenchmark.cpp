@@ -0,0 +1,118 @@
+// Times collision detection under heavy pair creation and destruction with btCollisionDispatcherMt,
+// with and without the thread caches of the manifold and collision algorithm pools. Spheres jump to
+// random places every frame, so most overlapping pairs, their algorithms and manifolds are new.
+//
+// Benchmark_PoolAllocator [spheres] [frames]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "btBulletCollisionCommon.h"
+#include "BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h"
+#include "LinearMath/btThreads.h"
+#include "LinearMath/btQuickprof.h"
+#include "LinearMath/btPoolAllocator.h"
+#include "LinearMath/btMinMax.h"
+
+static void printStatistics(const char* name, const btPoolAllocator* pool)
+{
+	btPoolAllocatorStatistics stats;
+	pool->getStatistics(stats);
+	printf("    %-10s cache hits %10llu  locks %10llu  contended %8llu  high-water %7d  slabs %2d  heap fallbacks %llu\n", name, stats.m_cacheHits, stats.m_lockCount,
+		   stats.m_contendedLockCount, stats.m_highWaterMark, stats.m_numSlabs, stats.m_failedAllocations);
+}
+
+static double churn(int numSpheres, int frames, bool threadCaches)
+{
+	btDefaultCollisionConstructionInfo info;
+	info.m_usePoolThreadCaches = threadCaches;
+	info.m_growablePools = true;
+	// the default sized pools grow to the high-water mark in the first frames
+	btDefaultCollisionConfiguration config(info);
+	btCollisionDispatcherMt dispatcher(&config);
+	btDbvtBroadphase broadphase;
+	broadphase.m_cupdates = 100;  // remove all pairs that stopped overlapping every frame
+	btCollisionWorld world(&dispatcher, &broadphase, &config);
+	btSphereShape sphere(1);
+	btAlignedObjectArray<btCollisionObject*> objects;
+	// about 7 overlapping pairs per sphere
+	btScalar size = btPow(btScalar(numSpheres) * btScalar(8), btScalar(1) / 3);
+	unsigned int seed = 12345;
+	for (int i = 0; i < numSpheres; ++i)
+	{
+		btCollisionObject* obj = new btCollisionObject();
+		obj->setCollisionShape(&sphere);
+		world.addCollisionObject(obj);
+		objects.push_back(obj);
+	}
+
+	btClock clock;
+	unsigned long long time = 0;
+	for (int frame = 0; frame <= frames; ++frame)
+	{
+		for (int i = 0; i < numSpheres; ++i)
+		{
+			btVector3 pos;
+			for (int j = 0; j < 3; ++j)
+			{
+				seed = seed * 1664525u + 1013904223u;
+				pos[j] = size * btScalar(seed >> 8) / btScalar(1 << 24);
+			}
+			objects[i]->getWorldTransform().setOrigin(pos);
+		}
+		clock.reset();
+		world.performDiscreteCollisionDetection();
+		if (frame == 0)
+		{
+			// warm up, the first frame only creates pairs
+			config.getPersistentManifoldPool()->resetStatistics();
+			config.getCollisionAlgorithmPool()->resetStatistics();
+		}
+		else
+		{
+			time += clock.getTimeMicroseconds();
+		}
+	}
+	printStatistics("manifolds", config.getPersistentManifoldPool());
+	printStatistics("algorithms", config.getCollisionAlgorithmPool());
+
+	for (int i = 0; i < objects.size(); ++i)
+	{
+		world.removeCollisionObject(objects[i]);
+		delete objects[i];
+	}
+	return double(time) / frames;
+}
+
+int main(int argc, char** argv)
+{
+	int numSpheres = argc > 1 ? atoi(argv[1]) : 4000;
+	int frames = argc > 2 ? atoi(argv[2]) : 50;
+
+	btITaskScheduler* ts = btCreateWorkStealingTaskScheduler();
+	if (!ts)
+	{
+		printf("the multithreaded dispatcher needs a BT_THREADSAFE build (BULLET2_MULTITHREADING)\n");
+		return 0;
+	}
+	btSetTaskScheduler(ts);
+	printf("%d spheres, %d frames, time per frame in microseconds\n", numSpheres, frames);
+	for (int numThreads = 1;; numThreads *= 2)
+	{
+		numThreads = btMin(numThreads, ts->getMaxNumThreads());
+		ts->setNumThreads(numThreads);
+		for (int caches = 0; caches < 2; ++caches)
+		{
+			printf("%2d threads, %s\n", numThreads, caches ? "thread caches" : "shared free lists");
+			double t = churn(numSpheres, frames, caches != 0);
+			printf("    %10.1f us\n", t);
+		}
+		if (numThreads == ts->getMaxNumThreads())
+		{
+			break;
+		}
+	}
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+	delete ts;
+	return 0;
+}
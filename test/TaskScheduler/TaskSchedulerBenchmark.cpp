@@ -0,0 +1,107 @@
+
+// Times btITaskScheduler::parallelFor for the built-in task schedulers over 1..N threads.
+// The loop imitates the solver batches of btSequentialImpulseConstraintSolverMt: a few
+// iterations are much more expensive than the rest, so static splitting leaves threads idle.
+//
+// Benchmark_TaskScheduler [iterations] [repeats]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "LinearMath/btThreads.h"
+#include "LinearMath/btQuickprof.h"
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btMinMax.h"
+
+struct UnevenBody : public btIParallelForBody
+{
+	btAlignedObjectArray<int> m_cost;
+	mutable btAlignedObjectArray<float> m_results;
+
+	UnevenBody(int count)
+	{
+		m_cost.resize(count);
+		m_results.resize(count);
+		unsigned int seed = 12345;
+		for (int i = 0; i < count; ++i)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			// one iteration in 16 is 50 times more expensive
+			m_cost[i] = ((seed >> 16) & 15) == 0 ? 5000 : 100;
+		}
+	}
+
+	virtual void forLoop(int iBegin, int iEnd) const
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			float x = float(i);
+			for (int j = 0; j < m_cost[i]; ++j)
+			{
+				x = x * 0.999f + 1.0f;
+			}
+			m_results[i] = x;
+		}
+	}
+};
+
+static double timeLoop(btITaskScheduler* ts, const UnevenBody& body, int grainSize, int repeats)
+{
+	btClock clock;
+	ts->parallelFor(0, body.m_cost.size(), grainSize, body);  // warm up, wakes the workers
+	clock.reset();
+	for (int r = 0; r < repeats; ++r)
+	{
+		ts->parallelFor(0, body.m_cost.size(), grainSize, body);
+	}
+	return double(clock.getTimeMicroseconds()) / repeats;
+}
+
+int main(int argc, char** argv)
+{
+	int iterations = argc > 1 ? atoi(argv[1]) : 20000;
+	int repeats = argc > 2 ? atoi(argv[2]) : 50;
+	const int grainSizes[] = {1, 64};
+
+	btITaskScheduler* schedulers[] = {btCreateDefaultTaskScheduler(), btCreateWorkStealingTaskScheduler()};
+	if (!schedulers[0] || !schedulers[1])
+	{
+		printf("task schedulers need a BT_THREADSAFE build (BULLET2_MULTITHREADING)\n");
+		return 0;
+	}
+
+	UnevenBody body(iterations);
+	printf("%d iterations, %d repeats, time per parallelFor in microseconds\n", iterations, repeats);
+	printf("%-14s %8s %8s %10s %10s\n", "scheduler", "grain", "threads", "time", "speedup");
+
+	for (int s = 0; s < 2; ++s)
+	{
+		btITaskScheduler* ts = schedulers[s];
+		btSetTaskScheduler(ts);
+		for (int g = 0; g < 2; ++g)
+		{
+			double singleThreaded = 0;
+			for (int numThreads = 1;; numThreads *= 2)
+			{
+				numThreads = btMin(numThreads, ts->getMaxNumThreads());
+				ts->setNumThreads(numThreads);
+				double t = timeLoop(ts, body, grainSizes[g], repeats);
+				if (numThreads == 1)
+				{
+					singleThreaded = t;
+				}
+				printf("%-14s %8d %8d %10.1f %10.2f\n", ts->getName(), grainSizes[g], numThreads, t, singleThreaded / t);
+				if (numThreads == ts->getMaxNumThreads())
+				{
+					break;
+				}
+			}
+		}
+		ts->setNumThreads(ts->getMaxNumThreads());
+	}
+
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+	delete schedulers[0];
+	delete schedulers[1];
+	return 0;
+}
@@ -0,0 +1,408 @@
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "LinearMath/btThreads.h"
+#include "LinearMath/btPoolAllocator.h"
+
+namespace {
+
+// counts how often each index is visited, the cost of an iteration grows with its index
+struct CountingBody : public btIParallelForBody
+{
+	mutable std::vector<int> m_visits;
+
+	CountingBody(int count) : m_visits(count, 0) {}
+
+	virtual void forLoop(int iBegin, int iEnd) const
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			volatile int work = 0;
+			for (int j = 0; j < i; ++j)
+			{
+				work += j;
+			}
+			m_visits[i]++;
+		}
+	}
+};
+
+struct SumBody : public btIParallelSumBody
+{
+	virtual btScalar sumLoop(int iBegin, int iEnd) const
+	{
+		btScalar sum = 0;
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			sum += btScalar(i & 7);
+		}
+		return sum;
+	}
+};
+
+// parallelFor over rows, each row runs a nested parallelFor over its columns
+struct NestedBody : public btIParallelForBody
+{
+	CountingBody& m_cells;
+	int m_numColumns;
+
+	NestedBody(CountingBody& cells, int numColumns) : m_cells(cells), m_numColumns(numColumns) {}
+
+	struct RowBody : public btIParallelForBody
+	{
+		CountingBody& m_cells;
+		int m_rowStart;
+
+		RowBody(CountingBody& cells, int rowStart) : m_cells(cells), m_rowStart(rowStart) {}
+
+		virtual void forLoop(int iBegin, int iEnd) const
+		{
+			m_cells.forLoop(m_rowStart + iBegin, m_rowStart + iEnd);
+		}
+	};
+
+	virtual void forLoop(int iBegin, int iEnd) const
+	{
+		for (int row = iBegin; row < iEnd; ++row)
+		{
+			btGetTaskScheduler()->parallelFor(0, m_numColumns, 4, RowBody(m_cells, row * m_numColumns));
+		}
+	}
+};
+
+// records the order in which tasks finish, checks that dependencies have finished before
+struct GraphTask : public btITaskBody
+{
+	mutable int m_finishedAt;
+	btAlignedObjectArray<const GraphTask*> m_dependencies;
+	mutable bool m_dependenciesDone;
+	btSpinMutex* m_mutex;
+	int* m_counter;
+
+	GraphTask() : m_finishedAt(-1), m_dependenciesDone(false), m_mutex(NULL), m_counter(NULL) {}
+
+	virtual void run() const
+	{
+		m_dependenciesDone = true;
+		for (int i = 0; i < m_dependencies.size(); ++i)
+		{
+			m_mutex->lock();
+			m_dependenciesDone &= m_dependencies[i]->m_finishedAt >= 0;
+			m_mutex->unlock();
+		}
+		volatile int work = 0;
+		for (int j = 0; j < 10000; ++j)
+		{
+			work += j;
+		}
+		m_mutex->lock();
+		m_finishedAt = (*m_counter)++;
+		m_mutex->unlock();
+	}
+};
+
+void checkTaskGraph(btITaskScheduler* ts)
+{
+	btSetTaskScheduler(ts);
+	// layers of tasks, every task depends on two tasks of the layer before
+	const int numLayers = 8;
+	const int layerSize = 300;  // more ready tasks than the initial deque capacity
+	btAlignedObjectArray<GraphTask> tasks;
+	tasks.resize(numLayers * layerSize);
+	btSpinMutex mutex;
+	int counter = 0;
+	btTaskGraph graph;
+	for (int i = 0; i < tasks.size(); ++i)
+	{
+		tasks[i].m_mutex = &mutex;
+		tasks[i].m_counter = &counter;
+		EXPECT_EQ(i, graph.addTask(tasks[i]));
+	}
+	for (int layer = 1; layer < numLayers; ++layer)
+	{
+		for (int i = 0; i < layerSize; ++i)
+		{
+			int task = layer * layerSize + i;
+			int before[2] = {(layer - 1) * layerSize + i, (layer - 1) * layerSize + (i * 7 + 3) % layerSize};
+			for (int j = 0; j < 2; ++j)
+			{
+				graph.addDependency(before[j], task);
+				tasks[task].m_dependencies.push_back(&tasks[before[j]]);
+			}
+		}
+	}
+	btRunTaskGraph(graph);
+	EXPECT_EQ(tasks.size(), counter) << ts->getName();
+	for (int i = 0; i < tasks.size(); ++i)
+	{
+		EXPECT_GE(tasks[i].m_finishedAt, 0) << ts->getName();
+		EXPECT_TRUE(tasks[i].m_dependenciesDone) << ts->getName() << " task " << i;
+	}
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+}
+
+void checkNestedLoops(btITaskScheduler* ts)
+{
+	btSetTaskScheduler(ts);
+	const int numRows = 37;
+	const int numColumns = 101;
+	CountingBody cells(numRows * numColumns);
+	ts->parallelFor(0, numRows, 1, NestedBody(cells, numColumns));
+	for (int i = 0; i < numRows * numColumns; ++i)
+	{
+		ASSERT_EQ(1, cells.m_visits[i]) << ts->getName() << " index " << i;
+	}
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+}
+
+// every iteration frees the element of its slot, allocated by whichever thread ran the iteration before,
+// and allocates a new one. An element that is handed out twice gets overwritten by the other slot
+struct PoolChurnBody : public btIParallelForBody
+{
+	btPoolAllocator* m_pool;
+	mutable std::vector<int*> m_slots;
+	mutable std::vector<int> m_errors;
+
+	PoolChurnBody(btPoolAllocator* pool, int count) : m_pool(pool), m_slots(count, (int*)NULL), m_errors(count, 0) {}
+
+	virtual void forLoop(int iBegin, int iEnd) const
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			if (m_slots[i])
+			{
+				m_errors[i] += *m_slots[i] != i;
+				m_pool->freeMemory(m_slots[i]);
+			}
+			// may fail while other threads cache free elements
+			m_slots[i] = (int*)m_pool->allocate(sizeof(int));
+			if (m_slots[i])
+			{
+				*m_slots[i] = i;
+			}
+		}
+	}
+};
+
+void checkPoolAllocator(btITaskScheduler* ts)
+{
+	btSetTaskScheduler(ts);
+	const int count = 1000;
+	for (int caches = 0; caches < 2; ++caches)
+	{
+		for (int growable = 0; growable < 2; ++growable)
+		{
+			// a growable pool starts far too small and has to chain slabs while the threads churn
+			btPoolAllocator pool(sizeof(int) * 4, growable ? count / 8 : count + count / 4, caches != 0);
+			pool.setGrowable(growable != 0);
+			PoolChurnBody body(&pool, count);
+			for (int round = 0; round < 20; ++round)
+			{
+				ts->parallelFor(0, count, 1 + round, body);
+			}
+			for (int i = 0; i < count; ++i)
+			{
+				ASSERT_EQ(0, body.m_errors[i]) << ts->getName() << " index " << i;
+				if (growable)
+				{
+					ASSERT_TRUE(body.m_slots[i] != NULL) << ts->getName() << " index " << i;
+				}
+				if (body.m_slots[i])
+				{
+					EXPECT_TRUE(pool.validPtr(body.m_slots[i]));
+					pool.freeMemory(body.m_slots[i]);
+				}
+			}
+			pool.flushThreadCaches();
+			EXPECT_EQ(pool.getMaxCount(), pool.getFreeCount()) << ts->getName();
+			btPoolAllocatorStatistics stats;
+			pool.getStatistics(stats);
+			EXPECT_GT(stats.m_lockCount, 0u);
+			EXPECT_LE(stats.m_contendedLockCount, stats.m_lockCount);
+			EXPECT_LE(stats.m_highWaterMark, pool.getMaxCount());
+			if (pool.hasThreadCaches())
+			{
+				EXPECT_GT(stats.m_cacheHits, stats.m_lockCount) << ts->getName();
+			}
+			if (growable)
+			{
+				EXPECT_EQ(0u, stats.m_failedAllocations) << ts->getName();
+				EXPECT_GT(stats.m_numSlabs, 1);
+				EXPECT_GE(stats.m_highWaterMark, count);
+			}
+			else
+			{
+				EXPECT_EQ(1, stats.m_numSlabs);
+			}
+		}
+	}
+
+	// pre-sizing from the high-water mark of a previous run
+	btPoolAllocator pool(sizeof(int) * 4, 16);
+	EXPECT_TRUE(pool.reserve(count));
+	EXPECT_EQ(count, pool.getMaxCount());
+	EXPECT_EQ(count, pool.getFreeCount());
+	std::vector<void*> elements;
+	for (int i = 0; i < count; ++i)
+	{
+		elements.push_back(pool.allocate(sizeof(int)));
+		ASSERT_TRUE(pool.validPtr(elements[i]));
+	}
+	EXPECT_TRUE(pool.allocate(sizeof(int)) == NULL);
+	btPoolAllocatorStatistics stats;
+	pool.getStatistics(stats);
+	EXPECT_EQ(1u, stats.m_failedAllocations);
+	EXPECT_EQ(count, stats.m_highWaterMark);
+	EXPECT_EQ(2, stats.m_numSlabs);
+	for (int i = 0; i < count; ++i)
+	{
+		pool.freeMemory(elements[i]);
+	}
+	EXPECT_EQ(count, pool.getFreeCount());
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+}
+
+void checkScheduler(btITaskScheduler* ts)
+{
+	btSetTaskScheduler(ts);
+	const int counts[] = {0, 1, 7, 100, 1000, 10007};
+	const int grainSizes[] = {1, 3, 64};
+	for (int c = 0; c < int(sizeof(counts) / sizeof(counts[0])); ++c)
+	{
+		for (int g = 0; g < int(sizeof(grainSizes) / sizeof(grainSizes[0])); ++g)
+		{
+			int count = counts[c];
+			CountingBody body(count);
+			ts->parallelFor(0, count, grainSizes[g], body);
+			for (int i = 0; i < count; ++i)
+			{
+				ASSERT_EQ(1, body.m_visits[i]) << ts->getName() << " count " << count << " grain " << grainSizes[g] << " index " << i;
+			}
+
+			btScalar expected = 0;
+			for (int i = 0; i < count; ++i)
+			{
+				expected += btScalar(i & 7);
+			}
+			EXPECT_EQ(expected, ts->parallelSum(0, count, grainSizes[g], SumBody())) << ts->getName();
+		}
+	}
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+}
+
+}  // namespace
+
+TEST(TaskScheduler, Sequential)
+{
+	checkScheduler(btGetSequentialTaskScheduler());
+	checkNestedLoops(btGetSequentialTaskScheduler());
+	checkPoolAllocator(btGetSequentialTaskScheduler());
+	checkTaskGraph(btGetSequentialTaskScheduler());
+}
+
+TEST(TaskScheduler, Default)
+{
+	if (btITaskScheduler* ts = btCreateDefaultTaskScheduler())
+	{
+		for (int numThreads = 1; numThreads <= ts->getMaxNumThreads(); numThreads *= 2)
+		{
+			ts->setNumThreads(numThreads);
+			checkScheduler(ts);
+			checkNestedLoops(ts);
+			checkTaskGraph(ts);
+			checkPoolAllocator(ts);
+		}
+		delete ts;
+	}
+}
+
+TEST(TaskScheduler, WorkStealing)
+{
+	if (btITaskScheduler* ts = btCreateWorkStealingTaskScheduler())
+	{
+		for (int numThreads = 1; numThreads <= ts->getMaxNumThreads(); numThreads *= 2)
+		{
+			ts->setNumThreads(numThreads);
+			checkScheduler(ts);
+			checkNestedLoops(ts);
+			checkTaskGraph(ts);
+			checkPoolAllocator(ts);
+		}
+		delete ts;
+	}
+}
+
+TEST(TaskScheduler, WaitPolicy)
+{
+	btITaskScheduler* schedulers[] = {btCreateDefaultTaskScheduler(), btCreateWorkStealingTaskScheduler()};
+	for (int s = 0; s < 2; ++s)
+	{
+		if (btITaskScheduler* ts = schedulers[s])
+		{
+			btWorkerWaitPolicy policies[3];
+			policies[0].m_spinTime = 0;  // park right away
+			policies[1].m_spinTime = 50;
+			policies[1].m_yieldTime = 500;
+			policies[2].m_spinTime = 2000;
+			policies[2].m_parkOnSleepHint = false;
+			for (int p = 0; p < 3; ++p)
+			{
+				ts->setWorkerWaitPolicy(policies[p]);
+				EXPECT_EQ(policies[p].m_yieldTime, ts->getWorkerWaitPolicy().m_yieldTime);
+				checkScheduler(ts);
+				ts->sleepWorkerThreadsHint();
+				checkScheduler(ts);
+			}
+			delete ts;
+		}
+	}
+}
+
+TEST(TaskScheduler, AffinityMaskBeyond64Processors)
+{
+	btAffinityMask mask;
+	EXPECT_TRUE(mask.isEmpty());
+	mask.setProcessor(3);
+	mask.setProcessor(64);
+	mask.setProcessor(200);
+	EXPECT_EQ(201, mask.getProcessorLimit());
+	EXPECT_EQ(4, mask.getNumWords());
+	EXPECT_TRUE(mask.hasProcessor(3));
+	EXPECT_TRUE(mask.hasProcessor(64));
+	EXPECT_TRUE(mask.hasProcessor(200));
+	EXPECT_FALSE(mask.hasProcessor(67));
+	EXPECT_FALSE(mask.hasProcessor(1000));
+	EXPECT_EQ(1ULL, mask.getWord(1));
+	EXPECT_EQ(0ULL, mask.getWord(2));
+}
+
+TEST(TaskScheduler, AffinityMasks)
+{
+	// pin all workers to the first NUMA node, or to processor 0 if it is unknown
+	btAffinityMask mask = btGetNumaNodeAffinityMask(0);
+	btWorkerThreadInfo info;
+	if (mask.isEmpty())
+	{
+		mask.setProcessor(0);
+	}
+	info.m_affinityMasks = &mask;
+	info.m_numAffinityMasks = 1;
+	btITaskScheduler* schedulers[] = {btCreateDefaultTaskScheduler(info), btCreateWorkStealingTaskScheduler(info)};
+	for (int s = 0; s < 2; ++s)
+	{
+		if (btITaskScheduler* ts = schedulers[s])
+		{
+			checkScheduler(ts);
+			checkTaskGraph(ts);
+			delete ts;
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,235 @@
+/*
+Copyright (c) 2003-2020 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BROADPHASE_TEST_HELPERS_H
+#define BROADPHASE_TEST_HELPERS_H
+
+#include <BulletCollision/BroadphaseCollision/btBroadphaseInterface.h>
+#include <BulletCollision/BroadphaseCollision/btOverlappingPairCache.h>
+#include <LinearMath/btAabbUtil2.h>
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+
+inline btScalar randomScalar(btScalar range)
+{
+	return range * btScalar(rand()) / btScalar(RAND_MAX);
+}
+
+struct LessThan
+{
+	template <typename T>
+	bool operator()(const T& a, const T& b) const { return a < b; }
+};
+
+///collects the unique ids of the proxies that an aabb or ray query reports
+struct CollectProxies : btBroadphaseRayCallback
+{
+	btAlignedObjectArray<int> m_ids;
+	bool process(const btBroadphaseProxy* proxy)
+	{
+		m_ids.push_back(proxy->m_uniqueId);
+		return true;
+	}
+};
+
+inline void expectSameIds(btAlignedObjectArray<int>& expected, btAlignedObjectArray<int>& ids)
+{
+	expected.quickSort(LessThan());
+	ids.quickSort(LessThan());
+	ASSERT_EQ(expected.size(), ids.size());
+	for (int i = 0; i < expected.size(); i++)
+	{
+		EXPECT_EQ(expected[i], ids[i]);
+	}
+}
+
+///creates numProxies points on a grid 30 proxies wide, for moveGridProxy
+inline void createGridProxies(btBroadphaseInterface& broadphase, btAlignedObjectArray<btBroadphaseProxy*>& proxies, int numProxies)
+{
+	for (int i = 0; i < numProxies; i++)
+	{
+		btVector3 center(btScalar(i % 30), 0, btScalar(i / 30));
+		proxies.push_back(broadphase.createProxy(center, center, 0, 0, btBroadphaseProxy::DefaultFilter, btBroadphaseProxy::AllFilter, 0));
+	}
+}
+
+inline void destroyProxies(btBroadphaseInterface& broadphase, btAlignedObjectArray<btBroadphaseProxy*>& proxies)
+{
+	for (int i = 0; i < proxies.size(); i++)
+	{
+		if (proxies[i])
+		{
+			broadphase.destroyProxy(proxies[i], 0);
+		}
+	}
+	proxies.resize(0);
+}
+
+///moves proxy i of the grid around a circle at height y, so that it overlaps a few of its neighbours
+inline void moveGridProxy(btBroadphaseInterface& broadphase, btBroadphaseProxy* proxy, int i, int frame, btScalar y, btScalar radius = btScalar(1))
+{
+	btScalar x = btScalar(i % 30) + btSin(btScalar(frame + i) * btScalar(0.1)) * radius;
+	btScalar z = btScalar(i / 30) + btCos(btScalar(frame * 2 + i) * btScalar(0.1)) * radius;
+	btVector3 center(x, y, z);
+	broadphase.setAabb(proxy, center - btVector3(0.6, 0.6, 0.6), center + btVector3(0.6, 0.6, 0.6), 0);
+}
+
+///moves all proxies of the grid, in layers of 7 heights, and updates the pairs
+inline void stepBroadphase(btBroadphaseInterface& broadphase, btAlignedObjectArray<btBroadphaseProxy*>& proxies, int frame)
+{
+	for (int i = 0; i < proxies.size(); i++)
+	{
+		moveGridProxy(broadphase, proxies[i], i, frame, btScalar(i % 7) * btScalar(0.3));
+	}
+	broadphase.calculateOverlappingPairs(0);
+}
+
+///broadphase finds the pairs of expected, for proxies that were created in the same order
+inline void expectSameProxyPairs(btBroadphaseInterface& expected, const btAlignedObjectArray<btBroadphaseProxy*>& expectedProxies,
+								 btBroadphaseInterface& broadphase, const btAlignedObjectArray<btBroadphaseProxy*>& proxies)
+{
+	const btBroadphasePairArray& pairs = expected.getOverlappingPairCache()->getOverlappingPairArray();
+	ASSERT_EQ(pairs.size(), broadphase.getOverlappingPairCache()->getNumOverlappingPairs());
+	for (int i = 0; i < pairs.size(); i++)
+	{
+		int a = pairs[i].m_pProxy0->m_uniqueId - expectedProxies[0]->m_uniqueId;
+		int b = pairs[i].m_pProxy1->m_uniqueId - expectedProxies[0]->m_uniqueId;
+		EXPECT_TRUE(broadphase.getOverlappingPairCache()->findPair(proxies[a], proxies[b]) != 0);
+	}
+}
+
+///a broadphase with random proxies, and a brute force check of its pairs and queries
+template <typename Broadphase>
+struct BroadphaseWorld
+{
+	Broadphase& m_broadphase;
+	btAlignedObjectArray<btBroadphaseProxy*> m_proxies;
+
+	BroadphaseWorld(Broadphase& broadphase) : m_broadphase(broadphase) {}
+
+	void move(int i, btScalar range)
+	{
+		btVector3 center(randomScalar(range), randomScalar(4), randomScalar(range));
+		// a few proxies are larger, and may move between the cells of the broadphase and its large proxies
+		const btScalar size = (rand() % 20) ? btScalar(1) : btScalar(3);
+		btVector3 extents(randomScalar(size), randomScalar(size), randomScalar(size));
+		if (m_proxies[i])
+			m_broadphase.setAabb(m_proxies[i], center - extents, center + extents, 0);
+		else
+			m_proxies[i] = m_broadphase.createProxy(center - extents, center + extents, 0, 0, btBroadphaseProxy::DefaultFilter, btBroadphaseProxy::AllFilter, 0);
+	}
+
+	void checkPairs()
+	{
+		int expected = 0;
+		for (int i = 0; i < m_proxies.size(); i++)
+		{
+			for (int j = i + 1; j < m_proxies.size(); j++)
+			{
+				if (m_proxies[i] && m_proxies[j] &&
+					TestAabbAgainstAabb2(m_proxies[i]->m_aabbMin, m_proxies[i]->m_aabbMax, m_proxies[j]->m_aabbMin, m_proxies[j]->m_aabbMax))
+				{
+					expected++;
+					EXPECT_TRUE(m_broadphase.getOverlappingPairCache()->findPair(m_proxies[i], m_proxies[j]) != 0);
+				}
+			}
+		}
+		EXPECT_EQ(expected, m_broadphase.getOverlappingPairCache()->getNumOverlappingPairs());
+	}
+
+	void checkQueries(btScalar range)
+	{
+		btVector3 queryMin(randomScalar(range), 0, randomScalar(range));
+		btVector3 queryMax = queryMin + btVector3(20, 2, 20);
+		btAlignedObjectArray<int> expected;
+		for (int i = 0; i < m_proxies.size(); i++)
+		{
+			if (m_proxies[i] && TestAabbAgainstAabb2(queryMin, queryMax, m_proxies[i]->m_aabbMin, m_proxies[i]->m_aabbMax))
+				expected.push_back(m_proxies[i]->m_uniqueId);
+		}
+		CollectProxies hits;
+		m_broadphase.aabbTest(queryMin, queryMax, hits);
+		EXPECT_GT(hits.m_ids.size(), 0);
+		expectSameIds(expected, hits.m_ids);
+
+		btVector3 from(randomScalar(range), 1, randomScalar(range));
+		btVector3 to(randomScalar(range), 2, randomScalar(range));
+		btVector3 direction = to - from;
+		CollectProxies rayHits;
+		for (int i = 0; i < 3; i++)
+		{
+			rayHits.m_rayDirectionInverse[i] = direction[i] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / direction[i];
+			rayHits.m_signs[i] = rayHits.m_rayDirectionInverse[i] < 0.0;
+		}
+		rayHits.m_lambda_max = 1;
+		expected.resize(0);
+		for (int i = 0; i < m_proxies.size(); i++)
+		{
+			btScalar tmin;
+			btVector3 bounds[2] = {m_proxies[i] ? m_proxies[i]->m_aabbMin : btVector3(0, 0, 0), m_proxies[i] ? m_proxies[i]->m_aabbMax : btVector3(0, 0, 0)};
+			if (m_proxies[i] && btRayAabb2(from, rayHits.m_rayDirectionInverse, rayHits.m_signs, bounds, tmin, 0, 1))
+				expected.push_back(m_proxies[i]->m_uniqueId);
+		}
+		m_broadphase.rayTest(from, to, rayHits);
+		expectSameIds(expected, rayHits.m_ids);
+	}
+};
+
+///runs frames of moved, new and destroyed proxies above a ground and beside a wall, and checks the pairs and queries of the
+///broadphase against brute force. checkLargeProxies is called after each update, to check where the ground and wall went.
+template <typename Broadphase>
+void checkBroadphaseFindsAllPairs(Broadphase& broadphase, void (*checkLargeProxies)(const Broadphase&))
+{
+	const btScalar range = 100;
+	BroadphaseWorld<Broadphase> world(broadphase);
+	srand(11);
+	world.m_proxies.resize(2000, 0);
+	for (int i = 0; i < world.m_proxies.size(); i++)
+	{
+		world.move(i, range);
+	}
+	btBroadphaseProxy* ground = broadphase.createProxy(btVector3(-10, -1, -10), btVector3(110, 0.5, 110), 0, 0, btBroadphaseProxy::DefaultFilter, btBroadphaseProxy::AllFilter, 0);
+	btBroadphaseProxy* wall = broadphase.createProxy(btVector3(50, -1, -10), btVector3(51, 30, 110), 0, 0, btBroadphaseProxy::DefaultFilter, btBroadphaseProxy::AllFilter, 0);
+	world.m_proxies.push_back(ground);
+	world.m_proxies.push_back(wall);
+
+	for (int frame = 0; frame < 10; frame++)
+	{
+		broadphase.calculateOverlappingPairs(0);
+		checkLargeProxies(broadphase);
+		world.checkPairs();
+		world.checkQueries(range);
+
+		// queries see moved, new and destroyed proxies before the next update
+		for (int i = 0; i < 200; i++)
+		{
+			int index = rand() % 2000;
+			if (frame % 3 == 1 && i % 4 == 0 && world.m_proxies[index])
+			{
+				broadphase.destroyProxy(world.m_proxies[index], 0);
+				world.m_proxies[index] = 0;
+			}
+			else
+			{
+				world.move(index, range);
+			}
+		}
+		world.checkQueries(range);
+	}
+	destroyProxies(broadphase, world.m_proxies);
+	EXPECT_EQ(0, broadphase.getOverlappingPairCache()->getNumOverlappingPairs());
+}
+
+#endif  //BROADPHASE_TEST_HELPERS_H
@@ -39,6 +39,10 @@
 		"../../src/BulletCollision/CollisionShapes/btConvexPolyhedron.cpp",
 
 	}
+	-- the test_bt*.cpp files are separate CMake tests with their own main
+	excludes {
+		"test_bt*.cpp",
+	}
 
 	if os.is("Linux") then
                 links {"pthread"}
@@ -0,0 +1,232 @@
+#include <BulletCollision/BroadphaseCollision/btDbvtBroadphase.h>
+#include <BulletCollision/BroadphaseCollision/btOverlappingPairCache.h>
+#include <LinearMath/btThreads.h>
+#include <gtest/gtest.h>
+
+#include "BroadphaseTestHelpers.h"
+
+#if BT_THREADSAFE
+#include <thread>
+#include <vector>
+#endif
+
+static void createProxies(btAlignedObjectArray<btBroadphaseProxy>& proxies, int numProxies)
+{
+	proxies.resize(numProxies);
+	for (int i = 0; i < numProxies; i++)
+	{
+		proxies[i].m_uniqueId = i + 1;
+		proxies[i].m_collisionFilterGroup = btBroadphaseProxy::DefaultFilter;
+		proxies[i].m_collisionFilterMask = btBroadphaseProxy::AllFilter;
+	}
+}
+
+static void expectSamePairs(const btBroadphasePairArray& a, const btBroadphasePairArray& b)
+{
+	ASSERT_EQ(a.size(), b.size());
+	for (int i = 0; i < a.size(); i++)
+	{
+		EXPECT_EQ(a[i].m_pProxy0, b[i].m_pProxy0);
+		EXPECT_EQ(a[i].m_pProxy1, b[i].m_pProxy1);
+	}
+}
+
+GTEST_TEST(BulletCollision, ConcurrentPairsDoNotDependOnOrder)
+{
+	btAlignedObjectArray<btBroadphaseProxy> proxies;
+	createProxies(proxies, 200);
+
+	btAlignedObjectArray<int> pairIds;
+	srand(42);
+	for (int i = 0; i < 5000; i++)
+	{
+		int a = rand() % proxies.size();
+		int b = rand() % proxies.size();
+		if (a != b)
+		{
+			pairIds.push_back(a);
+			pairIds.push_back(b);
+		}
+	}
+
+	btHashedOverlappingPairCache forward;
+	btHashedOverlappingPairCache backward;
+	ASSERT_TRUE(forward.supportsConcurrentPairs());
+	for (int i = 0; i < pairIds.size(); i += 2)
+	{
+		forward.addOverlappingPairConcurrent(&proxies[pairIds[i]], &proxies[pairIds[i + 1]]);
+	}
+	for (int i = pairIds.size() - 2; i >= 0; i -= 2)
+	{
+		// swapped proxies name the same pair
+		backward.addOverlappingPairConcurrent(&proxies[pairIds[i + 1]], &proxies[pairIds[i]]);
+	}
+	EXPECT_EQ(0, forward.getNumOverlappingPairs());
+	int numAdded = forward.flushConcurrentPairs(0);
+	EXPECT_EQ(numAdded, forward.getNumOverlappingPairs());
+	EXPECT_EQ(numAdded, backward.flushConcurrentPairs(0));
+	expectSamePairs(forward.getOverlappingPairArray(), backward.getOverlappingPairArray());
+
+	// the pairs are added sorted by uid, and the hash table finds them all
+	const btBroadphasePairArray& pairs = forward.getOverlappingPairArray();
+	for (int i = 0; i < pairs.size(); i++)
+	{
+		EXPECT_LT(pairs[i].m_pProxy0->m_uniqueId, pairs[i].m_pProxy1->m_uniqueId);
+		if (i > 0)
+		{
+			EXPECT_TRUE(pairs[i - 1].m_pProxy0->m_uniqueId < pairs[i].m_pProxy0->m_uniqueId ||
+						(pairs[i - 1].m_pProxy0->m_uniqueId == pairs[i].m_pProxy0->m_uniqueId &&
+						 pairs[i - 1].m_pProxy1->m_uniqueId < pairs[i].m_pProxy1->m_uniqueId));
+		}
+		EXPECT_EQ(&pairs[i], forward.findPair(pairs[i].m_pProxy1, pairs[i].m_pProxy0));
+	}
+
+	// remove the pairs with an even sum of indices, in two different orders
+	for (int i = 0; i < pairIds.size(); i += 2)
+	{
+		if (((pairIds[i] + pairIds[i + 1]) & 1) == 0)
+		{
+			forward.removeOverlappingPairConcurrent(&proxies[pairIds[i]], &proxies[pairIds[i + 1]], 0);
+		}
+	}
+	for (int i = pairIds.size() - 2; i >= 0; i -= 2)
+	{
+		if (((pairIds[i] + pairIds[i + 1]) & 1) == 0)
+		{
+			backward.removeOverlappingPairConcurrent(&proxies[pairIds[i + 1]], &proxies[pairIds[i]], 0);
+		}
+	}
+	EXPECT_EQ(0, forward.flushConcurrentPairs(0));
+	EXPECT_EQ(0, backward.flushConcurrentPairs(0));
+	expectSamePairs(forward.getOverlappingPairArray(), backward.getOverlappingPairArray());
+	for (int i = 0; i < pairIds.size(); i += 2)
+	{
+		btBroadphasePair* pair = forward.findPair(&proxies[pairIds[i]], &proxies[pairIds[i + 1]]);
+		EXPECT_EQ(((pairIds[i] + pairIds[i + 1]) & 1) == 0, pair == 0);
+	}
+}
+
+GTEST_TEST(BulletCollision, ParallelDbvtBroadphaseFindsSamePairs)
+{
+#if BT_THREADSAFE
+	btITaskScheduler* scheduler = btCreateDefaultTaskScheduler();
+	btSetTaskScheduler(scheduler ? scheduler : btGetSequentialTaskScheduler());
+#endif
+	btDbvtBroadphase serial;
+	btDbvtBroadphase parallel;
+	serial.m_deferedcollide = true;
+	parallel.m_deferedcollide = true;
+	parallel.m_parallelcollide = true;
+	// check every pair in each cleanup, so that both caches hold exactly the overlapping pairs
+	serial.m_cupdates = 100;
+	parallel.m_cupdates = 100;
+
+	btAlignedObjectArray<btBroadphaseProxy*> serialProxies;
+	btAlignedObjectArray<btBroadphaseProxy*> parallelProxies;
+	createGridProxies(serial, serialProxies, 600);
+	createGridProxies(parallel, parallelProxies, 600);
+	for (int frame = 0; frame < 20; frame++)
+	{
+		stepBroadphase(serial, serialProxies, frame);
+		stepBroadphase(parallel, parallelProxies, frame);
+
+		expectSameProxyPairs(serial, serialProxies, parallel, parallelProxies);
+	}
+	destroyProxies(serial, serialProxies);
+	destroyProxies(parallel, parallelProxies);
+#if BT_THREADSAFE
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+	delete scheduler;
+#endif
+}
+
+static int countStalePairs(btDbvtBroadphase& broadphase)
+{
+	const btBroadphasePairArray& pairs = broadphase.getOverlappingPairCache()->getOverlappingPairArray();
+	int numStale = 0;
+	for (int i = 0; i < pairs.size(); i++)
+	{
+		const btBroadphaseProxy* a = pairs[i].m_pProxy0;
+		const btBroadphaseProxy* b = pairs[i].m_pProxy1;
+		numStale += TestAabbAgainstAabb2(a->m_aabbMin, a->m_aabbMax, b->m_aabbMin, b->m_aabbMax) ? 0 : 1;
+	}
+	return numStale;
+}
+
+GTEST_TEST(BulletCollision, ParallelDbvtBroadphaseRemovesStalePairsLikeSerial)
+{
+#if BT_THREADSAFE
+	btITaskScheduler* scheduler = btCreateDefaultTaskScheduler();
+	btSetTaskScheduler(scheduler ? scheduler : btGetSequentialTaskScheduler());
+#endif
+	// the default cleanup window checks about as many pairs as were reported in the frame
+	btDbvtBroadphase serial;
+	btDbvtBroadphase parallel;
+	serial.m_deferedcollide = true;
+	parallel.m_deferedcollide = true;
+	parallel.m_parallelcollide = true;
+
+	btAlignedObjectArray<btBroadphaseProxy*> serialProxies;
+	btAlignedObjectArray<btBroadphaseProxy*> parallelProxies;
+	createGridProxies(serial, serialProxies, 600);
+	createGridProxies(parallel, parallelProxies, 600);
+	int serialStale = 0;
+	int parallelStale = 0;
+	for (int frame = 0; frame < 40; frame++)
+	{
+		stepBroadphase(serial, serialProxies, frame);
+		stepBroadphase(parallel, parallelProxies, frame);
+		serialStale += countStalePairs(serial);
+		parallelStale += countStalePairs(parallel);
+	}
+	// the pairs are in a different order, so the windows do not cover exactly the same pairs
+	EXPECT_GT(serialStale, 0);
+	EXPECT_LE(parallelStale, serialStale + serialStale / 10);
+	destroyProxies(serial, serialProxies);
+	destroyProxies(parallel, parallelProxies);
+#if BT_THREADSAFE
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+	delete scheduler;
+#endif
+}
+
+#if BT_THREADSAFE
+GTEST_TEST(BulletCollision, ConcurrentPairsFromMoreThreadsThanThreadIndices)
+{
+	// the thread counter wraps, so the later threads may share their index and have to use the locked shared buffer
+	const int numThreads = BT_MAX_THREAD_COUNT + 16;
+	const int pairsPerThread = 50;
+	btAlignedObjectArray<btBroadphaseProxy> proxies;
+	createProxies(proxies, numThreads + pairsPerThread);
+
+	btHashedOverlappingPairCache hashed;
+	btRadixSortedOverlappingPairCache radixSorted;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < numThreads; t++)
+	{
+		threads.push_back(std::thread([&, t]() {
+			for (int i = 0; i < pairsPerThread; i++)
+			{
+				hashed.addOverlappingPairConcurrent(&proxies[t], &proxies[numThreads + i]);
+				radixSorted.addOverlappingPairConcurrent(&proxies[t], &proxies[numThreads + i]);
+			}
+		}));
+	}
+	for (size_t t = 0; t < threads.size(); t++)
+	{
+		threads[t].join();
+	}
+	btResetThreadIndexCounter();
+
+	EXPECT_EQ(numThreads * pairsPerThread, hashed.flushConcurrentPairs(0));
+	EXPECT_EQ(numThreads * pairsPerThread, radixSorted.flushConcurrentPairs(0));
+	EXPECT_EQ(numThreads * pairsPerThread, hashed.getNumOverlappingPairs());
+	EXPECT_EQ(numThreads * pairsPerThread, radixSorted.getNumOverlappingPairs());
+}
+#endif
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
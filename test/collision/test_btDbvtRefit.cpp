@@ -0,0 +1,152 @@
+#include <BulletCollision/BroadphaseCollision/btDbvt.h>
+#include <BulletCollision/BroadphaseCollision/btDbvtBroadphase.h>
+#include <LinearMath/btThreads.h>
+#include <gtest/gtest.h>
+
+#include "BroadphaseTestHelpers.h"
+
+static btDbvtVolume randomVolume(btScalar range)
+{
+	btVector3 center(randomScalar(range), randomScalar(range), randomScalar(range));
+	btVector3 extents(randomScalar(1), randomScalar(1), randomScalar(1));
+	return btDbvtVolume::FromCE(center, extents);
+}
+
+// every internal node bounds its children exactly, and the parent links match
+static int checkNode(const btDbvtNode* node, const btDbvtNode* parent)
+{
+	EXPECT_EQ(parent, node->parent);
+	if (node->isleaf())
+	{
+		return 1;
+	}
+	btDbvtVolume merged;
+	Merge(node->childs[0]->volume, node->childs[1]->volume, merged);
+	EXPECT_FALSE(NotEqual(merged, node->volume));
+	return checkNode(node->childs[0], node) + checkNode(node->childs[1], node);
+}
+
+struct CountLeaves : btDbvt::ICollide
+{
+	int m_count;
+	CountLeaves() : m_count(0) {}
+	void Process(const btDbvtNode*) { ++m_count; }
+};
+
+GTEST_TEST(BulletCollision, DbvtRefitRebuildsDegradedSubtrees)
+{
+	btDbvt tree;
+	btAlignedObjectArray<btDbvtNode*> leaves;
+	srand(3);
+	for (int i = 0; i < 5000; i++)
+	{
+		leaves.push_back(tree.insert(randomVolume(100), (void*)(size_t)i));
+	}
+
+	// the first refit rebuilds the subtrees of the inserted tree, small motions after it only refit
+	EXPECT_GT(tree.refit(btScalar(1.5)), 0);
+	EXPECT_EQ(leaves.size(), checkNode(tree.m_root, 0));
+	for (int i = 0; i < leaves.size(); i++)
+	{
+		leaves[i]->volume = btDbvtVolume::FromCE(leaves[i]->volume.Center() + btVector3(0.01, 0, 0), leaves[i]->volume.Extents());
+	}
+	EXPECT_EQ(0, tree.refit(btScalar(1.5)));
+	EXPECT_EQ(leaves.size(), checkNode(tree.m_root, 0));
+
+	// scrambling the leaves degrades the subtrees, which are rebuilt
+	for (int i = 0; i < leaves.size(); i++)
+	{
+		leaves[i]->volume = randomVolume(100);
+	}
+	EXPECT_GT(tree.refit(btScalar(1.5)), 0);
+	EXPECT_EQ(leaves.size(), checkNode(tree.m_root, 0));
+	EXPECT_EQ(leaves.size(), tree.m_leaves);
+
+	// queries see the new volumes
+	btDbvtVolume query = btDbvtVolume::FromCE(btVector3(50, 50, 50), btVector3(20, 20, 20));
+	int expected = 0;
+	for (int i = 0; i < leaves.size(); i++)
+	{
+		expected += Intersect(query, leaves[i]->volume) ? 1 : 0;
+	}
+	CountLeaves counter;
+	tree.collideTV(tree.m_root, query, counter);
+	EXPECT_EQ(expected, counter.m_count);
+
+	// the subtrees are chosen again after a remove, and measured against their own cost, so nothing is rebuilt
+	for (int i = 0; i < 100; i++)
+	{
+		tree.remove(leaves[i]);
+	}
+	EXPECT_EQ(0, tree.refit(btScalar(1.5)));
+	EXPECT_EQ(leaves.size() - 100, checkNode(tree.m_root, 0));
+	EXPECT_EQ(0, tree.refit(btScalar(1.5)));
+}
+
+GTEST_TEST(BulletCollision, DbvtRefitRebuildsDeepTrees)
+{
+	// leaves inserted along a line grow a tree about as deep as it has leaves
+	btDbvt tree;
+	const int numLeaves = 3000;
+	for (int i = 0; i < numLeaves; i++)
+	{
+		tree.insert(btDbvtVolume::FromCE(btVector3(btScalar(i * i) * btScalar(0.01), 0, 0), btVector3(0.5, 0.5, 0.5)), (void*)(size_t)i);
+	}
+	int depth = tree.maxdepth(tree.m_root);
+	EXPECT_GT(depth, 100);
+	EXPECT_GT(tree.refit(btScalar(1.5)), 0);
+	EXPECT_EQ(numLeaves, checkNode(tree.m_root, 0));
+	EXPECT_LT(tree.maxdepth(tree.m_root), depth);
+}
+
+static void stepBroadphaseWithTeleports(btDbvtBroadphase& broadphase, btAlignedObjectArray<btBroadphaseProxy*>& proxies, int frame)
+{
+	for (int i = 0; i < proxies.size(); i++)
+	{
+		// some proxies teleport, the rest move a little
+		btScalar radius = (i % 11 == 0 && frame % 5 == 0) ? btScalar(3) : btScalar(1);
+		moveGridProxy(broadphase, proxies[i], i, frame, btScalar(i % 7) * btScalar(0.3), radius);
+	}
+	broadphase.calculateOverlappingPairs(0);
+}
+
+GTEST_TEST(BulletCollision, DbvtBroadphaseBulkRefitFindsSamePairs)
+{
+#if BT_THREADSAFE
+	btITaskScheduler* scheduler = btCreateDefaultTaskScheduler();
+	btSetTaskScheduler(scheduler ? scheduler : btGetSequentialTaskScheduler());
+#endif
+	btDbvtBroadphase incremental;
+	btDbvtBroadphase bulk;
+	incremental.m_deferedcollide = true;
+	bulk.m_deferedcollide = true;
+	bulk.m_bulkrefit = true;
+	// check every pair in each cleanup, so that both caches hold exactly the overlapping pairs
+	incremental.m_cupdates = 100;
+	bulk.m_cupdates = 100;
+
+	btAlignedObjectArray<btBroadphaseProxy*> incrementalProxies;
+	btAlignedObjectArray<btBroadphaseProxy*> bulkProxies;
+	createGridProxies(incremental, incrementalProxies, 900);
+	createGridProxies(bulk, bulkProxies, 900);
+	for (int frame = 0; frame < 30; frame++)
+	{
+		stepBroadphaseWithTeleports(incremental, incrementalProxies, frame);
+		stepBroadphaseWithTeleports(bulk, bulkProxies, frame);
+		EXPECT_FALSE(bulk.m_needrefit);
+
+		expectSameProxyPairs(incremental, incrementalProxies, bulk, bulkProxies);
+	}
+	destroyProxies(incremental, incrementalProxies);
+	destroyProxies(bulk, bulkProxies);
+#if BT_THREADSAFE
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+	delete scheduler;
+#endif
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,170 @@
+#include <BulletCollision/BroadphaseCollision/btDbvt.h>
+#include <BulletCollision/BroadphaseCollision/btDbvtWide.h>
+#include <BulletCollision/BroadphaseCollision/btDbvtBroadphase.h>
+#include <gtest/gtest.h>
+
+#include "BroadphaseTestHelpers.h"
+
+static btDbvtVolume randomVolume(btScalar range)
+{
+	btVector3 center(randomScalar(range), randomScalar(range), randomScalar(range));
+	btVector3 extents(randomScalar(1), randomScalar(1), randomScalar(1));
+	return btDbvtVolume::FromCE(center, extents);
+}
+
+struct CollectLeaves : btDbvt::ICollide
+{
+	btAlignedObjectArray<size_t> m_leaves;
+	void Process(const btDbvtNode* leaf) { m_leaves.push_back((size_t)leaf->data); }
+	void Process(const btDbvtNode* a, const btDbvtNode* b) { m_leaves.push_back((size_t)a->data * 100000 + (size_t)b->data); }
+	void sort() { m_leaves.quickSort(LessThan()); }
+};
+
+static void expectSameLeaves(CollectLeaves& binary, CollectLeaves& wide)
+{
+	binary.sort();
+	wide.sort();
+	ASSERT_EQ(binary.m_leaves.size(), wide.m_leaves.size());
+	for (int i = 0; i < binary.m_leaves.size(); i++)
+	{
+		EXPECT_EQ(binary.m_leaves[i], wide.m_leaves[i]);
+	}
+}
+
+static void rayInverse(const btVector3& direction, btVector3& inverse, unsigned int signs[3])
+{
+	for (int i = 0; i < 3; i++)
+	{
+		inverse[i] = direction[i] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / direction[i];
+		signs[i] = inverse[i] < 0.0;
+	}
+}
+
+GTEST_TEST(BulletCollision, DbvtWideFindsSameLeaves)
+{
+	btDbvt tree;
+	btDbvt other;
+	srand(5);
+	btDbvtWide wide;
+	wide.build(tree);
+	EXPECT_TRUE(wide.empty());
+	for (int i = 0; i < 3000; i++)
+	{
+		tree.insert(randomVolume(100), (void*)(size_t)i);
+		if (i < 500)
+		{
+			other.insert(randomVolume(100), (void*)(size_t)i);
+		}
+	}
+	wide.build(tree);
+	EXPECT_EQ(tree.m_topology, wide.m_topology);
+	EXPECT_EQ(3000, wide.m_leaves.size());
+
+	for (int q = 0; q < 50; q++)
+	{
+		btDbvtVolume query = btDbvtVolume::FromCE(btVector3(randomScalar(100), randomScalar(100), randomScalar(100)), btVector3(10, 10, 10));
+		CollectLeaves binaryLeaves;
+		CollectLeaves wideLeaves;
+		tree.collideTV(tree.m_root, query, binaryLeaves);
+		wide.collideTV(query, wideLeaves);
+		expectSameLeaves(binaryLeaves, wideLeaves);
+	}
+
+	// axis aligned and diagonal rays, with and without a box swept along
+	btAlignedObjectArray<const btDbvtNode*> stack;
+	for (int r = 0; r < 50; r++)
+	{
+		btVector3 from(randomScalar(100), randomScalar(100), randomScalar(100));
+		btVector3 to(randomScalar(100), randomScalar(100), randomScalar(100));
+		if (r % 5 == 0)
+		{
+			to = from;
+			to[r % 3] = -10;
+		}
+		btVector3 aabbMax = (r & 1) ? btVector3(1, 1, 1) : btVector3(0, 0, 0);
+		btVector3 inverse;
+		unsigned int signs[3];
+		rayInverse(to - from, inverse, signs);
+		btScalar lambda_max = 1;
+		CollectLeaves binaryLeaves;
+		CollectLeaves wideLeaves;
+		tree.rayTestInternal(tree.m_root, from, to, inverse, signs, lambda_max, -aabbMax, aabbMax, stack, binaryLeaves);
+		wide.rayTest(from, inverse, signs, lambda_max, -aabbMax, aabbMax, wideLeaves);
+		expectSameLeaves(binaryLeaves, wideLeaves);
+	}
+
+	CollectLeaves binaryPairs;
+	CollectLeaves widePairs;
+	other.collideTT(other.m_root, tree.m_root, binaryPairs);
+	wide.collideTT(other.m_root, widePairs);
+	EXPECT_GT(binaryPairs.m_leaves.size(), 0);
+	expectSameLeaves(binaryPairs, widePairs);
+}
+
+static void stepBroadphaseHalfFixed(btDbvtBroadphase& broadphase, btAlignedObjectArray<btBroadphaseProxy*>& proxies, int frame)
+{
+	// the first half is moving, the rest settles into the fixed set
+	for (int i = 0; i < proxies.size() / 2; i++)
+	{
+		moveGridProxy(broadphase, proxies[i], i, frame, btScalar(1));
+	}
+	if (frame == 10)
+	{
+		// wake a fixed proxy up
+		btVector3 center(5, 0.5, 5);
+		broadphase.setAabb(proxies[proxies.size() - 1], center - btVector3(0.6, 0.6, 0.6), center + btVector3(0.6, 0.6, 0.6), 0);
+	}
+	broadphase.calculateOverlappingPairs(0);
+}
+
+GTEST_TEST(BulletCollision, DbvtBroadphaseWideFixedFindsSamePairs)
+{
+	for (int deferred = 0; deferred < 2; deferred++)
+	{
+		btDbvtBroadphase binary;
+		btDbvtBroadphase wide;
+		binary.m_deferedcollide = deferred != 0;
+		wide.m_deferedcollide = deferred != 0;
+		wide.m_widefixed = true;
+		binary.m_cupdates = 100;
+		wide.m_cupdates = 100;
+
+		btAlignedObjectArray<btBroadphaseProxy*> binaryProxies;
+		btAlignedObjectArray<btBroadphaseProxy*> wideProxies;
+		for (int i = 0; i < 1200; i++)
+		{
+			btVector3 center(btScalar(i % 30), i < 600 ? btScalar(1) : btScalar(0), btScalar((i % 600) / 30));
+			btVector3 extents(0.6, 0.6, 0.6);
+			binaryProxies.push_back(binary.createProxy(center - extents, center + extents, 0, 0, btBroadphaseProxy::DefaultFilter, btBroadphaseProxy::AllFilter, 0));
+			wideProxies.push_back(wide.createProxy(center - extents, center + extents, 0, 0, btBroadphaseProxy::DefaultFilter, btBroadphaseProxy::AllFilter, 0));
+		}
+		for (int frame = 0; frame < 20; frame++)
+		{
+			stepBroadphaseHalfFixed(binary, binaryProxies, frame);
+			stepBroadphaseHalfFixed(wide, wideProxies, frame);
+			EXPECT_EQ(binary.m_sets[1].m_leaves, wide.m_widefixedset.m_leaves.size());
+
+			expectSameProxyPairs(binary, binaryProxies, wide, wideProxies);
+
+			CollectProxies binaryHits;
+			CollectProxies wideHits;
+			btVector3 from(-1, 0.2, btScalar(frame));
+			btVector3 to(31, 0.2, btScalar(frame) + btScalar(0.5));
+			rayInverse(to - from, binaryHits.m_rayDirectionInverse, binaryHits.m_signs);
+			rayInverse(to - from, wideHits.m_rayDirectionInverse, wideHits.m_signs);
+			binaryHits.m_lambda_max = wideHits.m_lambda_max = 1;
+			binary.rayTest(from, to, binaryHits);
+			wide.rayTest(from, to, wideHits);
+			EXPECT_GT(wideHits.m_ids.size(), 0);
+			expectSameIds(binaryHits.m_ids, wideHits.m_ids);
+		}
+		destroyProxies(binary, binaryProxies);
+		destroyProxies(wide, wideProxies);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,131 @@
+#include <LinearMath/btHashMap.h>
+#include <LinearMath/btFlatHashMap.h>
+#include <BulletCollision/CollisionDispatch/btHashedSimplePairCache.h>
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// the two maps must agree on the contents and on the order of getAtIndex
+template <class Key, class Value>
+static void expectSameMaps(const btHashMap<Key, Value>& expected, const btFlatHashMap<Key, Value>& map)
+{
+	ASSERT_EQ(expected.size(), map.size());
+	for (int i = 0; i < expected.size(); i++)
+	{
+		EXPECT_TRUE(expected.getKeyAtIndex(i).equals(map.getKeyAtIndex(i)));
+		EXPECT_EQ(*expected.getAtIndex(i), *map.getAtIndex(i));
+		EXPECT_EQ(i, map.findIndex(map.getKeyAtIndex(i)));
+	}
+}
+
+GTEST_TEST(LinearMath, FlatHashMapMatchesHashMap)
+{
+	btHashMap<btHashInt, int> expected;
+	btFlatHashMap<btHashInt, int> map;
+	srand(1234);
+	for (int i = 0; i < 100000; i++)
+	{
+		// few distinct keys, so inserts replace values and removes hit
+		btHashInt key(rand() % 3000);
+		switch (rand() % 4)
+		{
+			case 0:
+			case 1:
+				expected.insert(key, i);
+				map.insert(key, i);
+				break;
+			case 2:
+				expected.remove(key);
+				map.remove(key);
+				break;
+			default:
+			{
+				const int* a = expected.find(key);
+				const int* b = map.find(key);
+				ASSERT_EQ(a == 0, b == 0);
+				if (a)
+				{
+					EXPECT_EQ(*a, *b);
+				}
+			}
+		}
+	}
+	expectSameMaps(expected, map);
+
+	btFlatHashMap<btHashInt, int> copy(map);
+	expectSameMaps(expected, copy);
+	map.clear();
+	EXPECT_EQ(0, map.size());
+	EXPECT_EQ(0, map.find(btHashInt(1)));
+	map = copy;
+	expectSameMaps(expected, map);
+}
+
+GTEST_TEST(LinearMath, FlatHashMapStringKeys)
+{
+	btFlatHashMap<btHashString, int> map;
+	char name[32];
+	for (int i = 0; i < 1000; i++)
+	{
+		sprintf(name, "body%d", i);
+		map.insert(name, i);
+	}
+	for (int i = 0; i < 1000; i++)
+	{
+		sprintf(name, "body%d", i);
+		ASSERT_TRUE(map.find(name) != 0);
+		EXPECT_EQ(i, *map.find(name));
+	}
+	EXPECT_EQ(0, map.find("body1000"));
+}
+
+GTEST_TEST(BulletCollision, HashedSimplePairCache)
+{
+	btHashedSimplePairCache cache;
+	btHashMap<btHashInt, int> expected;
+	srand(4321);
+	for (int i = 0; i < 50000; i++)
+	{
+		int indexA = rand() % 60;
+		int indexB = rand() % 60;
+		btHashInt key(indexA | (indexB << 16));
+		if (rand() % 3)
+		{
+			btSimplePair* pair = cache.addOverlappingPair(indexA, indexB);
+			ASSERT_TRUE(pair != 0);
+			EXPECT_EQ(indexA, pair->m_indexA);
+			EXPECT_EQ(indexB, pair->m_indexB);
+			if (!expected.find(key))
+			{
+				EXPECT_EQ(0, pair->m_userValue);
+				pair->m_userValue = i + 1;
+				expected.insert(key, i + 1);
+			}
+			EXPECT_EQ(*expected.find(key), pair->m_userValue);
+		}
+		else
+		{
+			void* userPointer = cache.removeOverlappingPair(indexA, indexB);
+			EXPECT_EQ(expected.find(key) != 0, userPointer != 0);
+			expected.remove(key);
+		}
+	}
+	ASSERT_EQ(expected.size(), cache.getNumOverlappingPairs());
+	for (int i = 0; i < cache.getNumOverlappingPairs(); i++)
+	{
+		const btSimplePair& pair = cache.getOverlappingPairArray()[i];
+		btSimplePair* found = cache.findPair(pair.m_indexA, pair.m_indexB);
+		EXPECT_EQ(&pair, found);
+		EXPECT_EQ(*expected.find(btHashInt(pair.m_indexA | (pair.m_indexB << 16))), pair.m_userValue);
+	}
+	cache.removeAllPairs();
+	EXPECT_EQ(0, cache.getNumOverlappingPairs());
+	EXPECT_EQ(0, cache.findPair(1, 2));
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,38 @@
+#include <BulletCollision/BroadphaseCollision/btGridBroadphase.h>
+#include <LinearMath/btThreads.h>
+#include <gtest/gtest.h>
+
+#include "BroadphaseTestHelpers.h"
+
+// the ground, the wall and the larger proxies stay out of the grid of 16 cells, which wraps several times across the world
+static void checkLargeProxies(const btGridBroadphase& broadphase)
+{
+	EXPECT_LT(2, broadphase.m_largeTree.m_leaves);
+}
+
+GTEST_TEST(BulletCollision, GridBroadphaseFindsAllPairs)
+{
+#if BT_THREADSAFE
+	btITaskScheduler* scheduler = btCreateDefaultTaskScheduler();
+	btSetTaskScheduler(scheduler ? scheduler : btGetSequentialTaskScheduler());
+#endif
+	btHashedOverlappingPairCache hashedCache;
+	btGridBroadphase hashed(btScalar(2), 16, &hashedCache);
+	checkBroadphaseFindsAllPairs(hashed, checkLargeProxies);
+	btRadixSortedOverlappingPairCache radixSortedCache;
+	btGridBroadphase radixSorted(btScalar(2), 16, &radixSortedCache);
+	checkBroadphaseFindsAllPairs(radixSorted, checkLargeProxies);
+	btSortedOverlappingPairCache sortedCache;
+	btGridBroadphase sorted(btScalar(2), 16, &sortedCache);
+	checkBroadphaseFindsAllPairs(sorted, checkLargeProxies);
+#if BT_THREADSAFE
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+	delete scheduler;
+#endif
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,133 @@
+#include <LinearMath/btRadixSort.h>
+#include <BulletCollision/BroadphaseCollision/btDbvtBroadphase.h>
+#include <BulletCollision/BroadphaseCollision/btOverlappingPairCache.h>
+#include <LinearMath/btThreads.h>
+#include <gtest/gtest.h>
+
+#include "BroadphaseTestHelpers.h"
+
+struct KeyThenValuePredicate
+{
+	bool operator()(const btRadixSortEntry& a, const btRadixSortEntry& b) const
+	{
+		return a.m_key < b.m_key || (a.m_key == b.m_key && a.m_value < b.m_value);
+	}
+};
+
+static void checkRadixSort(int numEntries, int numKeyBits)
+{
+	btAlignedObjectArray<btRadixSortEntry> entries;
+	btAlignedObjectArray<btRadixSortEntry> expected;
+	btAlignedObjectArray<btRadixSortEntry> scratch;
+	entries.resize(numEntries);
+	for (int i = 0; i < numEntries; i++)
+	{
+		unsigned long long key = ((unsigned long long)rand() << 32) ^ ((unsigned long long)rand() << 16) ^ (unsigned long long)rand();
+		entries[i].m_key = numKeyBits < 64 ? key & ((1ULL << numKeyBits) - 1) : key;
+		entries[i].m_value = i;
+	}
+	// the values are the original positions, so sorting by key then value gives the stable order
+	expected.copyFromArray(entries);
+	expected.quickSort(KeyThenValuePredicate());
+
+	btRadixSort(entries, scratch, numKeyBits);
+	ASSERT_EQ(expected.size(), entries.size());
+	for (int i = 0; i < numEntries; i++)
+	{
+		EXPECT_EQ(expected[i].m_key, entries[i].m_key);
+		EXPECT_EQ(expected[i].m_value, entries[i].m_value);
+	}
+}
+
+GTEST_TEST(LinearMath, RadixSortIsStable)
+{
+	srand(7);
+	checkRadixSort(0, 64);
+	checkRadixSort(1, 64);
+	checkRadixSort(1000, 64);
+	// few distinct keys, and more than one block
+	checkRadixSort(50000, 5);
+	checkRadixSort(50000, 20);
+	checkRadixSort(50000, 64);
+}
+
+GTEST_TEST(BulletCollision, RadixSortedPairCacheFindsSamePairs)
+{
+#if BT_THREADSAFE
+	btITaskScheduler* scheduler = btCreateDefaultTaskScheduler();
+	btSetTaskScheduler(scheduler ? scheduler : btGetSequentialTaskScheduler());
+#endif
+	btHashedOverlappingPairCache hashedCache;
+	btRadixSortedOverlappingPairCache sortedCache;
+	btDbvtBroadphase hashed(&hashedCache);
+	btDbvtBroadphase sorted(&sortedCache);
+	hashed.m_deferedcollide = true;
+	// check every pair in each cleanup, so that the hashed cache holds exactly the overlapping pairs
+	hashed.m_cupdates = 100;
+	sorted.m_parallelcollide = true;
+
+	btAlignedObjectArray<btBroadphaseProxy*> hashedProxies;
+	btAlignedObjectArray<btBroadphaseProxy*> sortedProxies;
+	createGridProxies(hashed, hashedProxies, 600);
+	createGridProxies(sorted, sortedProxies, 600);
+	int numKept = 0;
+	for (int frame = 0; frame < 20; frame++)
+	{
+		stepBroadphase(hashed, hashedProxies, frame);
+		stepBroadphase(sorted, sortedProxies, frame);
+
+		const btBroadphasePairArray& hashedPairs = hashedCache.getOverlappingPairArray();
+		btBroadphasePairArray& sortedPairs = sortedCache.getOverlappingPairArray();
+		ASSERT_EQ(hashedPairs.size(), sortedPairs.size());
+		for (int i = 0; i < hashedPairs.size(); i++)
+		{
+			int a = hashedPairs[i].m_pProxy0->m_uniqueId - hashedProxies[0]->m_uniqueId;
+			int b = hashedPairs[i].m_pProxy1->m_uniqueId - hashedProxies[0]->m_uniqueId;
+			EXPECT_TRUE(sortedCache.findPair(sortedProxies[a], sortedProxies[b]) != 0);
+		}
+		for (int i = 0; i < sortedPairs.size(); i++)
+		{
+			if (i > 0)
+			{
+				EXPECT_TRUE(sortedPairs[i - 1].m_pProxy0->m_uniqueId < sortedPairs[i].m_pProxy0->m_uniqueId ||
+							(sortedPairs[i - 1].m_pProxy0->m_uniqueId == sortedPairs[i].m_pProxy0->m_uniqueId &&
+							 sortedPairs[i - 1].m_pProxy1->m_uniqueId < sortedPairs[i].m_pProxy1->m_uniqueId));
+			}
+			// pairs that stay overlapping are kept, with their data
+			if (sortedPairs[i].m_internalTmpValue == 1)
+			{
+				numKept++;
+			}
+			sortedPairs[i].m_internalTmpValue = 1;
+		}
+	}
+	EXPECT_GT(numKept, 0);
+
+	// destroying a proxy removes its pairs
+	btBroadphaseProxy* destroyed = sortedProxies[0];
+	sorted.destroyProxy(destroyed, 0);
+	for (int i = 0; i < sortedCache.getNumOverlappingPairs(); i++)
+	{
+		const btBroadphasePair& pair = sortedCache.getOverlappingPairArray()[i];
+		EXPECT_TRUE(pair.m_pProxy0 != destroyed && pair.m_pProxy1 != destroyed);
+	}
+	for (int i = 0; i < hashedProxies.size(); i++)
+	{
+		hashed.destroyProxy(hashedProxies[i], 0);
+		if (i > 0)
+		{
+			sorted.destroyProxy(sortedProxies[i], 0);
+		}
+	}
+	EXPECT_EQ(0, sortedCache.getNumOverlappingPairs());
+#if BT_THREADSAFE
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+	delete scheduler;
+#endif
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,235 @@
+#include <BulletCollision/BroadphaseCollision/btDbvtBroadphase.h>
+#include <BulletCollision/BroadphaseCollision/btAxisSweep3.h>
+#include <BulletCollision/CollisionDispatch/btCollisionWorld.h>
+#include <BulletCollision/CollisionDispatch/btCollisionDispatcher.h>
+#include <BulletCollision/CollisionDispatch/btDefaultCollisionConfiguration.h>
+#include <BulletCollision/CollisionShapes/btBoxShape.h>
+#include <BulletCollision/CollisionShapes/btSphereShape.h>
+#include <BulletCollision/CollisionShapes/btCapsuleShape.h>
+#include <BulletCollision/CollisionShapes/btTriangleMesh.h>
+#include <BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h>
+#include <BulletCollision/CollisionShapes/btScaledBvhTriangleMeshShape.h>
+#include <gtest/gtest.h>
+
+#include "BroadphaseTestHelpers.h"
+
+// a bumpy terrain mesh, some boxes, spheres and capsules above it, and rays from a few sensors
+struct RayWorld
+{
+	btDefaultCollisionConfiguration m_configuration;
+	btCollisionDispatcher m_dispatcher;
+	btCollisionWorld m_world;
+	btTriangleMesh m_mesh;
+	btAlignedObjectArray<btCollisionShape*> m_shapes;
+	btAlignedObjectArray<btCollisionObject*> m_objects;
+	btAlignedObjectArray<btVector3> m_rayFrom;
+	btAlignedObjectArray<btVector3> m_rayTo;
+
+	RayWorld(btBroadphaseInterface* broadphase)
+		: m_dispatcher(&m_configuration),
+		  m_world(&m_dispatcher, broadphase, &m_configuration)
+	{
+		srand(3);
+		const int size = 40;
+		for (int i = 0; i < size; i++)
+		{
+			for (int j = 0; j < size; j++)
+			{
+				btVector3 v[4];
+				for (int k = 0; k < 4; k++)
+				{
+					btScalar x = btScalar(i + (k & 1));
+					btScalar z = btScalar(j + (k >> 1));
+					v[k] = btVector3(x, btSin(x * btScalar(0.7)) + btCos(z * btScalar(0.4)), z);
+				}
+				m_mesh.addTriangle(v[0], v[1], v[2]);
+				m_mesh.addTriangle(v[1], v[3], v[2]);
+			}
+		}
+		btBvhTriangleMeshShape* quantized = new btBvhTriangleMeshShape(&m_mesh, true);
+		btBvhTriangleMeshShape* unquantized = new btBvhTriangleMeshShape(&m_mesh, false);
+		m_shapes.push_back(quantized);
+		m_shapes.push_back(unquantized);
+		m_shapes.push_back(new btScaledBvhTriangleMeshShape(quantized, btVector3(0.5, 1, 0.75)));
+		addObject(quantized, btTransform::getIdentity());
+		addObject(unquantized, btTransform(btQuaternion(btVector3(0, 1, 0), btScalar(0.3)), btVector3(-45, -2, 10)));
+		addObject(m_shapes[2], btTransform(btQuaternion::getIdentity(), btVector3(0, 0, -35)));
+
+		m_shapes.push_back(new btBoxShape(btVector3(0.5, 0.3, 0.8)));
+		m_shapes.push_back(new btSphereShape(0.6));
+		m_shapes.push_back(new btCapsuleShape(0.3, 1));
+		for (int i = 0; i < 300; i++)
+		{
+			btQuaternion rotation(btVector3(randomScalar(1), randomScalar(1), randomScalar(1) + 0.1).normalized(), randomScalar(3));
+			btVector3 position(randomScalar(size), btScalar(2) + randomScalar(4), randomScalar(size));
+			addObject(m_shapes[3 + i % 3], btTransform(rotation, position));
+		}
+		m_world.updateAabbs();
+		for (int i = 0; i < 3; i++)
+		{
+			m_world.performDiscreteCollisionDetection();
+		}
+
+		// two spinning lidars and some scattered rays, a few without length
+		for (int sensor = 0; sensor < 2; sensor++)
+		{
+			btVector3 origin(btScalar(10 + 20 * sensor), 4, btScalar(20 - 10 * sensor));
+			for (int i = 0; i < 64; i++)
+			{
+				for (int j = 0; j < 32; j++)
+				{
+					btScalar yaw = btScalar(i) * SIMD_2_PI / btScalar(64);
+					btScalar pitch = btScalar(j - 24) * btScalar(0.05);
+					btVector3 direction(btCos(yaw) * btCos(pitch), btSin(pitch), btSin(yaw) * btCos(pitch));
+					m_rayFrom.push_back(origin);
+					m_rayTo.push_back(origin + direction * btScalar(60));
+				}
+			}
+		}
+		for (int i = 0; i < 500; i++)
+		{
+			btVector3 from(randomScalar(60) - 10, randomScalar(10), randomScalar(60) - 10);
+			btVector3 to = (i % 50 == 0) ? from : btVector3(randomScalar(60) - 10, randomScalar(10) - 5, randomScalar(60) - 10);
+			m_rayFrom.push_back(from);
+			m_rayTo.push_back(to);
+		}
+	}
+
+	~RayWorld()
+	{
+		for (int i = 0; i < m_objects.size(); i++)
+		{
+			m_world.removeCollisionObject(m_objects[i]);
+			delete m_objects[i];
+		}
+		for (int i = m_shapes.size() - 1; i >= 0; i--)
+		{
+			delete m_shapes[i];
+		}
+	}
+
+	void addObject(btCollisionShape* shape, const btTransform& transform)
+	{
+		btCollisionObject* object = new btCollisionObject();
+		object->setCollisionShape(shape);
+		object->setWorldTransform(transform);
+		// the meshes are in their own group, that some rays skip
+		int group = m_objects.size() < 3 ? btBroadphaseProxy::StaticFilter : btBroadphaseProxy::DefaultFilter;
+		m_world.addCollisionObject(object, group, btBroadphaseProxy::AllFilter);
+		m_objects.push_back(object);
+	}
+
+	void checkClosestHits()
+	{
+		const int numRays = m_rayFrom.size();
+		btAlignedObjectArray<btCollisionWorld::ClosestRayResultCallback> single;
+		btAlignedObjectArray<btCollisionWorld::ClosestRayResultCallback> batch;
+		btAlignedObjectArray<btCollisionWorld::RayResultCallback*> batchPointers;
+		int numHits = 0;
+		for (int i = 0; i < numRays; i++)
+		{
+			single.push_back(btCollisionWorld::ClosestRayResultCallback(m_rayFrom[i], m_rayTo[i]));
+			batch.push_back(btCollisionWorld::ClosestRayResultCallback(m_rayFrom[i], m_rayTo[i]));
+			if (i % 7 == 0)
+			{
+				single[i].m_collisionFilterMask = batch[i].m_collisionFilterMask = btBroadphaseProxy::DefaultFilter;
+			}
+			if (m_rayFrom[i] != m_rayTo[i])
+			{
+				m_world.rayTest(m_rayFrom[i], m_rayTo[i], single[i]);
+			}
+			numHits += single[i].hasHit() ? 1 : 0;
+		}
+		for (int i = 0; i < numRays; i++)
+		{
+			batchPointers.push_back(&batch[i]);
+		}
+		m_world.rayTestBatch(&m_rayFrom[0], &m_rayTo[0], &batchPointers[0], numRays);
+
+		EXPECT_GT(numHits, numRays / 2);
+		for (int i = 0; i < numRays; i++)
+		{
+			ASSERT_EQ(single[i].hasHit(), batch[i].hasHit()) << "ray " << i;
+			if (single[i].hasHit())
+			{
+				EXPECT_EQ(single[i].m_collisionObject, batch[i].m_collisionObject) << "ray " << i;
+				EXPECT_EQ(single[i].m_closestHitFraction, batch[i].m_closestHitFraction) << "ray " << i;
+				EXPECT_EQ(single[i].m_hitNormalWorld, batch[i].m_hitNormalWorld) << "ray " << i;
+			}
+		}
+	}
+
+	void checkAllHits()
+	{
+		const int numRays = 300;
+		btAlignedObjectArray<btCollisionWorld::AllHitsRayResultCallback*> single;
+		btAlignedObjectArray<btCollisionWorld::RayResultCallback*> batch;
+		for (int i = 0; i < numRays; i++)
+		{
+			int ray = i * 7 % m_rayFrom.size();
+			single.push_back(new btCollisionWorld::AllHitsRayResultCallback(m_rayFrom[ray], m_rayTo[ray]));
+			batch.push_back(new btCollisionWorld::AllHitsRayResultCallback(m_rayFrom[ray], m_rayTo[ray]));
+			if (m_rayFrom[ray] != m_rayTo[ray])
+			{
+				m_world.rayTest(m_rayFrom[ray], m_rayTo[ray], *single[i]);
+			}
+		}
+		btAlignedObjectArray<btVector3> rayFrom;
+		btAlignedObjectArray<btVector3> rayTo;
+		for (int i = 0; i < numRays; i++)
+		{
+			rayFrom.push_back(m_rayFrom[i * 7 % m_rayFrom.size()]);
+			rayTo.push_back(m_rayTo[i * 7 % m_rayFrom.size()]);
+		}
+		m_world.rayTestBatch(&rayFrom[0], &rayTo[0], &batch[0], numRays);
+		for (int i = 0; i < numRays; i++)
+		{
+			btCollisionWorld::AllHitsRayResultCallback* hits = (btCollisionWorld::AllHitsRayResultCallback*)batch[i];
+			EXPECT_EQ(single[i]->m_hitFractions.size(), hits->m_hitFractions.size()) << "ray " << i;
+			delete single[i];
+			delete hits;
+		}
+	}
+};
+
+GTEST_TEST(BulletCollision, RayTestBatchMatchesRayTest)
+{
+	btDbvtBroadphase broadphase;
+	RayWorld world(&broadphase);
+	world.checkClosestHits();
+	world.checkAllHits();
+}
+
+GTEST_TEST(BulletCollision, RayTestBatchMatchesRayTestWideFixed)
+{
+	btDbvtBroadphase broadphase;
+	broadphase.m_widefixed = true;
+	RayWorld world(&broadphase);
+	// sleeping objects keep their aabbs, and move to the fixed set after a few frames
+	world.m_world.setForceUpdateAllAabbs(false);
+	for (int i = 0; i < world.m_objects.size(); i++)
+	{
+		world.m_objects[i]->setActivationState(ISLAND_SLEEPING);
+	}
+	for (int i = 0; i < 4; i++)
+	{
+		world.m_world.performDiscreteCollisionDetection();
+	}
+	EXPECT_EQ(world.m_objects.size(), broadphase.m_sets[1].m_leaves);
+	EXPECT_EQ(world.m_objects.size(), broadphase.m_widefixedset.m_leaves.size());
+	world.checkClosestHits();
+}
+
+GTEST_TEST(BulletCollision, RayTestBatchMatchesRayTestWithoutPacketBroadphase)
+{
+	btAxisSweep3 broadphase(btVector3(-100, -100, -100), btVector3(100, 100, 100));
+	RayWorld world(&broadphase);
+	world.checkClosestHits();
+	world.checkAllHits();
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
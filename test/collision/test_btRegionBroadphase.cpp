@@ -0,0 +1,38 @@
+#include <BulletCollision/BroadphaseCollision/btRegionBroadphase.h>
+#include <LinearMath/btThreads.h>
+#include <gtest/gtest.h>
+
+#include "BroadphaseTestHelpers.h"
+
+// only the ground and the wall overlap too many regions
+static void checkLargeProxies(const btRegionBroadphase& broadphase)
+{
+	EXPECT_EQ(2, broadphase.m_largeProxies.size());
+}
+
+GTEST_TEST(BulletCollision, RegionBroadphaseFindsAllPairs)
+{
+#if BT_THREADSAFE
+	btITaskScheduler* scheduler = btCreateDefaultTaskScheduler();
+	btSetTaskScheduler(scheduler ? scheduler : btGetSequentialTaskScheduler());
+#endif
+	btHashedOverlappingPairCache hashedCache;
+	btRegionBroadphase hashed(btScalar(8), &hashedCache);
+	checkBroadphaseFindsAllPairs(hashed, checkLargeProxies);
+	btRadixSortedOverlappingPairCache radixSortedCache;
+	btRegionBroadphase radixSorted(btScalar(8), &radixSortedCache);
+	checkBroadphaseFindsAllPairs(radixSorted, checkLargeProxies);
+	btSortedOverlappingPairCache sortedCache;
+	btRegionBroadphase sorted(btScalar(8), &sortedCache);
+	checkBroadphaseFindsAllPairs(sorted, checkLargeProxies);
+#if BT_THREADSAFE
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+	delete scheduler;
+#endif
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}